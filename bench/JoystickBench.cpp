@@ -0,0 +1,763 @@
+// Microbenchmarks for the portable hot paths. Linux only: hardware counters
+// come from perf_event_open and are left out where the kernel refuses them
+// (e.g. perf_event_paranoid > 2, or no PMU in a VM).
+//
+//   joystick_bench [--filter TEXT] [--min-time-ms N] [--json PATH|-]
+//
+// A table goes to stdout (stderr when the JSON does); --json writes the
+// results in a stable shape, one object per benchmark, so two releases' runs
+// can be diffed.
+
+#include "CameraCatalog.h"
+#include "CameraSearch.h"
+#include "FlightRecorder.h"
+#include "JoystickScaling.h"
+#include "JsonUtils.h"
+#include "LogUtils.h"
+#include "OnvifSoap.h"
+#include "PipelineTrace.h"
+#include "ScalarUtf8.h"
+#include "StringUtils.h"
+#include "ViscaProtocol.h"
+
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::atomic<uint64_t> g_allocations{ 0 };
+
+constexpr int kSamples = 5;
+
+// Keeps the compiler from discarding a result it can see is unused.
+template <typename T>
+void KeepAlive(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct CounterSpec
+{
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr CounterSpec kCounters[] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "branchMisses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "cacheMisses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+};
+constexpr size_t kCounterCount = sizeof(kCounters) / sizeof(kCounters[0]);
+
+// One user-space counter per event, for this thread; any the kernel refuses
+// stays closed and reads as absent.
+class PerfCounters
+{
+public:
+    PerfCounters()
+    {
+        for (size_t i = 0; i < kCounterCount; ++i)
+        {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = kCounters[i].type;
+            attr.config = kCounters[i].config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    }
+
+    ~PerfCounters()
+    {
+        for (const int fd : fds_)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool Available(size_t counter) const { return fds_[counter] >= 0; }
+
+    bool AnyAvailable() const
+    {
+        return std::any_of(std::begin(fds_), std::end(fds_), [](int fd) { return fd >= 0; });
+    }
+
+    void Start()
+    {
+        for (const int fd : fds_)
+        {
+            if (fd < 0)
+                continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    void Stop(uint64_t* values)
+    {
+        for (size_t i = 0; i < kCounterCount; ++i)
+        {
+            values[i] = 0;
+            if (fds_[i] < 0)
+                continue;
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fds_[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+                values[i] = 0;
+        }
+    }
+
+private:
+    int fds_[kCounterCount] = {};
+};
+
+// Runs |iterations| operations; the loop lives in the body so calling it
+// costs nothing per operation.
+using BenchBody = std::function<void(uint64_t iterations)>;
+
+struct BenchCase
+{
+    std::string name;
+    // Input bytes one operation consumes, for throughput; 0 if not meaningful.
+    size_t bytesPerOp = 0;
+    BenchBody body;
+};
+
+struct BenchResult
+{
+    std::string name;
+    size_t bytesPerOp = 0;
+    uint64_t iterations = 0;
+    double nsPerOp = 0.0;
+    double minNsPerOp = 0.0;
+    double allocsPerOp = 0.0;
+    double counters[kCounterCount] = {};
+};
+
+struct Options
+{
+    std::string filter;
+    double minTimeMs = 200.0;
+    std::string jsonPath;
+};
+
+double TimeBody(const BenchBody& body, uint64_t iterations)
+{
+    const auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// Sizes a sample to about a fifth of |minTimeMs|, then takes kSamples of
+// them: the median and the best are reported, allocations and counters
+// averaged over all.
+BenchResult RunCase(const BenchCase& bench, const Options& options, PerfCounters& perf)
+{
+    const double sampleNs = options.minTimeMs * 1e6 / kSamples;
+    uint64_t iterations = 1;
+    TimeBody(bench.body, iterations);
+    for (;;)
+    {
+        const double elapsed = TimeBody(bench.body, iterations);
+        if (elapsed >= sampleNs / 10 || iterations >= (1ull << 40))
+        {
+            const double scale = elapsed > 0.0 ? sampleNs / elapsed : 10.0;
+            iterations = std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(iterations) * scale));
+            break;
+        }
+        iterations *= 10;
+    }
+
+    std::vector<double> samples;
+    uint64_t allocations = 0;
+    uint64_t counterTotals[kCounterCount] = {};
+    for (int sample = 0; sample < kSamples; ++sample)
+    {
+        uint64_t values[kCounterCount] = {};
+        const uint64_t allocationsBefore = g_allocations.load(std::memory_order_relaxed);
+        perf.Start();
+        const double elapsed = TimeBody(bench.body, iterations);
+        perf.Stop(values);
+        allocations += g_allocations.load(std::memory_order_relaxed) - allocationsBefore;
+        samples.push_back(elapsed / static_cast<double>(iterations));
+        for (size_t i = 0; i < kCounterCount; ++i)
+            counterTotals[i] += values[i];
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = bench.name;
+    result.bytesPerOp = bench.bytesPerOp;
+    result.iterations = iterations;
+    result.nsPerOp = samples[samples.size() / 2];
+    result.minNsPerOp = samples.front();
+    const double totalOps = static_cast<double>(iterations) * kSamples;
+    result.allocsPerOp = static_cast<double>(allocations) / totalOps;
+    for (size_t i = 0; i < kCounterCount; ++i)
+        result.counters[i] = static_cast<double>(counterTotals[i]) / totalOps;
+    return result;
+}
+
+std::string JsonEscape(std::string_view text)
+{
+    std::string escaped;
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+void WriteJson(FILE* out, const std::vector<BenchResult>& results, const PerfCounters& perf)
+{
+    fprintf(out, "{\n  \"schema\": 1,\n  \"compiler\": \"%s\",\n  \"benchmarks\": [\n",
+        JsonEscape(__VERSION__).c_str());
+    for (size_t r = 0; r < results.size(); ++r)
+    {
+        const BenchResult& result = results[r];
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"nsPerOp\": %.3f, \"minNsPerOp\": %.3f, "
+            "\"allocsPerOp\": %.3f, \"bytesPerOp\": %zu",
+            JsonEscape(result.name).c_str(), static_cast<unsigned long long>(result.iterations),
+            result.nsPerOp, result.minNsPerOp, result.allocsPerOp, result.bytesPerOp);
+        if (perf.AnyAvailable())
+        {
+            fprintf(out, ", \"counters\": {");
+            bool first = true;
+            for (size_t i = 0; i < kCounterCount; ++i)
+            {
+                if (!perf.Available(i))
+                    continue;
+                fprintf(out, "%s\"%s\": %.3f", first ? "" : ", ", kCounters[i].name, result.counters[i]);
+                first = false;
+            }
+            fprintf(out, "}");
+        }
+        fprintf(out, "}%s\n", r + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+void PrintRow(FILE* out, const BenchResult& result, const PerfCounters& perf)
+{
+    char throughput[32] = "";
+    if (result.bytesPerOp > 0 && result.nsPerOp > 0.0)
+        snprintf(throughput, sizeof(throughput), "%.1f MB/s", result.bytesPerOp * 1e3 / result.nsPerOp);
+    char ipc[32] = "";
+    if (perf.Available(0) && perf.Available(1) && result.counters[0] > 0.0)
+        snprintf(ipc, sizeof(ipc), "%.2f", result.counters[1] / result.counters[0]);
+    fprintf(out, "%-40s %12.1f %12.1f %10.2f %14s %6s\n", result.name.c_str(), result.nsPerOp,
+        result.minNsPerOp, result.allocsPerOp, throughput, ipc);
+}
+
+// ---- Inputs ----
+
+std::string BuildCameraListBody(size_t cameraCount)
+{
+    // Shaped like the controller's GET /v1/cameras (references/GetAllCameras.md).
+    std::string body = "[";
+    for (size_t i = 0; i < cameraCount; ++i)
+    {
+        if (i > 0)
+            body += ",";
+        const std::string index = std::to_string(i);
+        body += "{\"id\":\"65a1f0c2" + index + "\",\"modelKey\":\"camera\",\"state\":\"CONNECTED\","
+            "\"name\":\"Camera " + index + "\",\"mac\":\"F4E2C60A" + index + "\",\"isMicEnabled\":true,"
+            "\"osdSettings\":{\"isNameEnabled\":true,\"isDateEnabled\":true,\"isLogoEnabled\":false,"
+            "\"isDebugEnabled\":false,\"overlayLocation\":\"topLeft\"},"
+            "\"ledSettings\":{\"isEnabled\":true,\"welcomeLed\":false,\"floodLed\":false},"
+            "\"lcdMessage\":{\"type\":\"LEAVE_PACKAGE_AT_DOOR\",\"resetAt\":null,\"text\":\"\"},"
+            "\"micVolume\":100,\"activePatrolSlot\":0,\"videoMode\":\"default\",\"hdrType\":\"auto\","
+            "\"featureFlags\":{\"supportFullHdSnapshot\":true,\"hasHdr\":true,\"smartDetectTypes\":[\"person\"],"
+            "\"smartDetectAudioTypes\":[\"alrmSmoke\"],\"videoModes\":[\"default\"],\"hasMic\":true,"
+            "\"hasLedStatus\":true,\"hasSpeaker\":true},"
+            "\"smartDetectSettings\":{\"objectTypes\":[\"person\"],\"audioTypes\":[\"alrmSmoke\"]},"
+            "\"ptz\":{\"returnHomeAfterInactivityMs\":" + std::string(i % 2 ? "null" : "30000") + "}}";
+    }
+    body += "]";
+    return body;
+}
+
+// A camera document with |fillerKeys| unrelated members ahead of the setting.
+std::string BuildCameraDocument(size_t fillerKeys)
+{
+    std::string body = "{\"id\":\"65a1f0c2\",\"name\":\"Lobby\"";
+    for (size_t i = 0; i < fillerKeys; ++i)
+        body += ",\"setting" + std::to_string(i) + "\":{\"enabled\":true,\"values\":[1,2,3],\"label\":\"x\"}";
+    body += ",\"ptz\":{\"returnHomeAfterInactivityMs\":null}}";
+    return body;
+}
+
+std::vector<CameraInfo> BuildCameraInfos(size_t count)
+{
+    static const char* const kWords[] = { "Lobby", "North", "Gate", "Dock", "Hall", "East", "Lab", "Roof" };
+    std::vector<CameraInfo> cameras(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        cameras[i].id = "65a1f0c2" + std::to_string(i * 7919);
+        cameras[i].name = std::string(kWords[i % 8]) + " " + kWords[(i / 8) % 8] + " " + std::to_string(i);
+        cameras[i].state = i % 5 ? "CONNECTED" : "DISCONNECTED";
+    }
+    return cameras;
+}
+
+// Stick samples sweeping the whole range, deadzone included.
+std::vector<JoystickState> BuildRawSamples()
+{
+    std::vector<JoystickState> samples;
+    for (int i = 0; i < 1024; ++i)
+    {
+        const double angle = i * 0.0061359;
+        const double radius = (i % 32) * 8.0;
+        samples.push_back({ radius * std::cos(angle), radius * std::sin(angle), ((i % 64) - 32) * 8.0 });
+    }
+    return samples;
+}
+
+std::string RepeatText(std::string_view unit, size_t bytes)
+{
+    std::string text;
+    while (text.size() < bytes)
+        text += unit;
+    text.resize(bytes);
+    return text;
+}
+
+// ---- Cases ----
+
+void AddCases(std::vector<BenchCase>* cases)
+{
+    const auto samples = std::make_shared<std::vector<JoystickState>>(BuildRawSamples());
+
+    cases->push_back({ "BuildMovePayload", 0, [samples](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            const JoystickState& state = (*samples)[i & 1023];
+            const std::string payload = JsonUtils::BuildMovePayload({ state.x * 2.9, state.y * 2.9, state.z });
+            KeepAlive(payload.data());
+        }
+    } });
+
+    cases->push_back({ "ScaleJoystickAxes", 0, [samples](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            const JoystickState& raw = (*samples)[i & 1023];
+            JoystickState state;
+            KeepAlive(ScaleJoystickAxes(raw.x, raw.y, raw.z, (i & 1024) != 0, &state));
+            KeepAlive(state);
+        }
+    } });
+
+    for (const size_t count : { 1, 10, 100, 1000 })
+    {
+        const auto body = std::make_shared<std::string>(BuildCameraListBody(count));
+        cases->push_back({ "TryParseCameraList/" + std::to_string(count), body->size(), [body](uint64_t n)
+        {
+            std::vector<CameraInfo> cameras;
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                JsonUtils::TryParseCameraList(*body, &cameras);
+                KeepAlive(cameras.data());
+            }
+        } });
+    }
+
+    for (const size_t fillers : { 0, 16, 256 })
+    {
+        const auto body = std::make_shared<std::string>(BuildCameraDocument(fillers));
+        cases->push_back({ "TryParseReturnHomeDisabled/" + std::to_string(fillers), body->size(),
+            [body](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                bool disabled = false;
+                KeepAlive(JsonUtils::TryParseReturnHomeDisabled(*body, &disabled));
+                KeepAlive(disabled);
+            }
+        } });
+    }
+
+    for (const size_t length : { 16, 256, 4096 })
+    {
+        const auto text = std::make_shared<std::wstring>(
+            L"  \t" + Utf8ToWide(RepeatText("Camera 12 ", length)) + L" \r\n");
+        cases->push_back({ "TrimWide/" + std::to_string(length), text->size() * sizeof(wchar_t), [text](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                const std::wstring trimmed = TrimWide(*text);
+                KeepAlive(trimmed.data());
+            }
+        } });
+    }
+
+    // ASCII takes the vector path; the mixed text keeps leaving it. The
+    // Scalar arms are the one-code-point-at-a-time baseline.
+    const std::pair<const char*, std::string_view> kTexts[] = {
+        { "ascii", "North Gate PTZ 04 " },
+        { "mixed", "Caf\xC3\xA9 \xE5\x8C\x97\xE9\x97\xA8 \xF0\x9F\x93\xB7 " },
+    };
+    for (const auto& [label, unit] : kTexts)
+    {
+        for (const size_t bytes : { 16, 1024 })
+        {
+            const auto utf8 = std::make_shared<std::string>(RepeatText(unit, bytes));
+            const auto wide = std::make_shared<std::wstring>(Utf8ToWide(*utf8));
+            const std::string suffix = std::string("/") + label + "/" + std::to_string(bytes);
+            cases->push_back({ "Utf8ToWide" + suffix, utf8->size(), [utf8](uint64_t n)
+            {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    const std::wstring converted = Utf8ToWide(*utf8);
+                    KeepAlive(converted.data());
+                }
+            } });
+            cases->push_back({ "Utf8ToWideScalar" + suffix, utf8->size(), [utf8](uint64_t n)
+            {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    const std::wstring converted = ScalarUtf8::Utf8ToWide(*utf8);
+                    KeepAlive(converted.data());
+                }
+            } });
+            cases->push_back({ "WideToUtf8" + suffix, utf8->size(), [wide](uint64_t n)
+            {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    const std::string converted = WideToUtf8(*wide);
+                    KeepAlive(converted.data());
+                }
+            } });
+            cases->push_back({ "WideToUtf8Scalar" + suffix, utf8->size(), [wide](uint64_t n)
+            {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    const std::string converted = ScalarUtf8::WideToUtf8(*wide);
+                    KeepAlive(converted.data());
+                }
+            } });
+        }
+    }
+
+    // Whether logging is on is read once, at the first line; see main().
+    cases->push_back({ "AppendLogLine", 0, [](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+            AppendLogLine(std::string_view("Move sent to camera 65a1f0c2 in 12.4 ms"));
+    } });
+
+    // Paid on every stage of every sample, always on.
+    cases->push_back({ "ScopedTraceSpan", 0, [](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+            ScopedTraceSpan span(TraceStage::Filter);
+    } });
+
+    // Recorded for every submitted sample, always on.
+    cases->push_back({ "RecordFlightEvent", 0, [samples](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            const JoystickState& state = (*samples)[i & 1023];
+            RecordFlightEvent(FlightEventType::StateSubmitted, "65a1f0c2", static_cast<int32_t>(state.x * 1000),
+                static_cast<int32_t>(state.y * 1000), static_cast<int32_t>(state.z * 1000));
+        }
+    } });
+
+    // A full ring, as after a few minutes of use.
+    cases->push_back({ "ExportChromeTrace", 0, [](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            const std::string trace = ExportChromeTrace();
+            KeepAlive(trace.data());
+        }
+    } });
+
+    cases->push_back({ "BuildViscaPanTiltDrive", 0, [samples](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            const std::vector<uint8_t> packet = BuildViscaPanTiltDrive((*samples)[i & 1023], static_cast<uint32_t>(i));
+            KeepAlive(packet.data());
+        }
+    } });
+
+    const auto onvif = std::make_shared<OnvifMoveTemplate>();
+    onvif->Build(BuildOnvifSecurityHeader("admin", "bm9uY2U=", "2026-01-01T00:00:00Z", "ZGlnZXN0"), "Profile_1");
+    cases->push_back({ "OnvifMoveTemplate::Serialize", 0, [samples, onvif](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            const JoystickState& state = (*samples)[i & 1023];
+            KeepAlive(onvif->Serialize({ state.x * 2.9, state.y * 2.9, state.z }).data());
+        }
+    } });
+
+    for (const size_t count : { 100, 10000 })
+    {
+        const auto cameras = std::make_shared<std::vector<CameraInfo>>(BuildCameraInfos(count));
+        const auto catalog = std::make_shared<CameraCatalog>();
+        cases->push_back({ "CameraCatalog::BuildSnapshot/" + std::to_string(count), 0, [cameras, catalog](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; ++i)
+                KeepAlive(catalog->BuildSnapshot(*cameras).get());
+        } });
+
+        const auto snapshot = catalog->BuildSnapshot(*cameras);
+        cases->push_back({ "CameraSearchIndex::Build/" + std::to_string(count), 0, [snapshot](uint64_t n)
+        {
+            CameraSearchIndex index;
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                index.Build(snapshot);
+                KeepAlive(index.Cameras().get());
+            }
+        } });
+
+        // Typing a query a key at a time, then clearing it.
+        const auto index = std::make_shared<CameraSearchIndex>();
+        index->Build(snapshot);
+        cases->push_back({ "CameraSearchIndex::Search/" + std::to_string(count), 0, [index](uint64_t n)
+        {
+            static constexpr std::string_view kTyped = "gate 12";
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                const size_t length = i % (kTyped.size() + 1);
+                KeepAlive(index->Search(kTyped.substr(0, length)).size());
+            }
+        } });
+    }
+}
+
+bool ParseOptions(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        if (arg == "--filter")
+            options->filter = argv[++i];
+        else if (arg == "--min-time-ms")
+            options->minTimeMs = std::max(1.0, atof(argv[++i]));
+        else if (arg == "--json")
+            options->jsonPath = argv[++i];
+        else
+            return false;
+    }
+    return true;
+}
+}
+
+// Counts every allocation the benchmarks make, on any thread. Every form of
+// operator new and delete is replaced, so none falls through to the
+// library's, and all of them go through these two functions; keeping them
+// out of line stops GCC from pairing an inlined free() with a new
+// expression and warning (-Wmismatched-new-delete).
+namespace {
+[[gnu::noinline]] void* CountedAllocate(size_t size, size_t alignment) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    size = size ? size : 1;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        return malloc(size);
+    // aligned_alloc wants a multiple of the alignment; free() releases it.
+    return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+}
+
+[[gnu::noinline]] void CountedFree(void* block) noexcept
+{
+    free(block);
+}
+
+void* CountedAllocateOrThrow(size_t size, size_t alignment)
+{
+    if (void* block = CountedAllocate(size, alignment))
+        return block;
+    throw std::bad_alloc();
+}
+}
+
+void* operator new(size_t size)
+{
+    return CountedAllocateOrThrow(size, 0);
+}
+
+void* operator new[](size_t size)
+{
+    return CountedAllocateOrThrow(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return CountedAllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return CountedAllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* block) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete[](void* block, size_t) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete(void* block, std::align_val_t) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete[](void* block, std::align_val_t) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete(void* block, size_t, std::align_val_t) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete[](void* block, size_t, std::align_val_t) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete(void* block, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    CountedFree(block);
+}
+
+void operator delete[](void* block, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    CountedFree(block);
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, &options))
+    {
+        fprintf(stderr, "usage: %s [--filter TEXT] [--min-time-ms N] [--json PATH|-]\n", argv[0]);
+        return 2;
+    }
+
+    // Time logging as the app does it with debug output on; the lines
+    // themselves go to /dev/null.
+    setenv("JOYSTICK_DEBUG", "1", 1);
+    const int savedStderr = dup(STDERR_FILENO);
+    const int devNull = open("/dev/null", O_WRONLY);
+
+    std::vector<BenchCase> cases;
+    AddCases(&cases);
+
+    PerfCounters perf;
+    if (!perf.AnyAvailable())
+        fprintf(stderr, "Hardware counters unavailable; reporting time and allocations only\n");
+
+    FILE* table = options.jsonPath == "-" ? stderr : stdout;
+    fprintf(table, "%-40s %12s %12s %10s %14s %6s\n", "benchmark", "ns/op", "min ns/op", "allocs/op", "throughput", "IPC");
+    std::vector<BenchResult> results;
+    for (const BenchCase& bench : cases)
+    {
+        if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos)
+            continue;
+
+        const bool quiet = bench.name == "AppendLogLine" && devNull >= 0;
+        if (quiet)
+            dup2(devNull, STDERR_FILENO);
+        results.push_back(RunCase(bench, options, perf));
+        if (quiet)
+            dup2(savedStderr, STDERR_FILENO);
+        PrintRow(table, results.back(), perf);
+        fflush(table);
+    }
+
+    if (!options.jsonPath.empty())
+    {
+        FILE* out = options.jsonPath == "-" ? stdout : fopen(options.jsonPath.c_str(), "w");
+        if (!out)
+        {
+            fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        WriteJson(out, results, perf);
+        if (out != stdout)
+            fclose(out);
+    }
+    return 0;
+}
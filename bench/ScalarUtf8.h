@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// One code point at a time, with no ASCII runs or preallocation: the
+// baseline joystick_bench times StringUtils' converters against, and the
+// reference tests/StringUtilsTests.cpp checks them with. It follows the
+// same replacement policy, written from the Unicode well-formed byte table
+// rather than by decoding first and range-checking after: a byte that cannot
+// start or continue a sequence becomes U+FFFD and only that byte is consumed.
+namespace ScalarUtf8
+{
+constexpr char32_t kReplacementChar = 0xFFFD;
+
+// The sequence length a lead byte announces and the allowed range of the
+// byte after it; 0 for bytes that never lead.
+struct LeadByte
+{
+    size_t length;
+    unsigned char secondMin;
+    unsigned char secondMax;
+};
+
+inline LeadByte ClassifyLeadByte(unsigned char lead)
+{
+    if (lead < 0x80)
+        return { 1, 0, 0 };
+    if (lead >= 0xC2 && lead <= 0xDF)
+        return { 2, 0x80, 0xBF };
+    if (lead == 0xE0)
+        return { 3, 0xA0, 0xBF };
+    if (lead == 0xED)
+        return { 3, 0x80, 0x9F };
+    if (lead >= 0xE1 && lead <= 0xEF)
+        return { 3, 0x80, 0xBF };
+    if (lead == 0xF0)
+        return { 4, 0x90, 0xBF };
+    if (lead == 0xF4)
+        return { 4, 0x80, 0x8F };
+    if (lead >= 0xF1 && lead <= 0xF3)
+        return { 4, 0x80, 0xBF };
+    return { 0, 0, 0 };
+}
+
+inline std::wstring Utf8ToWide(std::string_view value)
+{
+    std::wstring output;
+    size_t pos = 0;
+    while (pos < value.size())
+    {
+        const auto* in = reinterpret_cast<const unsigned char*>(value.data() + pos);
+        const size_t available = value.size() - pos;
+        const LeadByte lead = ClassifyLeadByte(in[0]);
+        bool valid = lead.length != 0 && lead.length <= available;
+        if (valid && lead.length > 1)
+            valid = in[1] >= lead.secondMin && in[1] <= lead.secondMax;
+        for (size_t i = 2; valid && i < lead.length; ++i)
+            valid = in[i] >= 0x80 && in[i] <= 0xBF;
+        if (!valid)
+        {
+            output.push_back(static_cast<wchar_t>(kReplacementChar));
+            ++pos;
+            continue;
+        }
+
+        char32_t codePoint = lead.length == 1 ? in[0] : in[0] & (0x7F >> lead.length);
+        for (size_t i = 1; i < lead.length; ++i)
+            codePoint = (codePoint << 6) | (in[i] & 0x3F);
+        pos += lead.length;
+
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+        {
+            output.push_back(static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10)));
+            output.push_back(static_cast<wchar_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF)));
+        }
+        else
+        {
+            output.push_back(static_cast<wchar_t>(codePoint));
+        }
+    }
+    return output;
+}
+
+inline std::string WideToUtf8(std::wstring_view value)
+{
+    std::string output;
+    for (size_t pos = 0; pos < value.size(); ++pos)
+    {
+        char32_t codePoint = static_cast<char32_t>(value[pos]);
+        if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint <= 0xDBFF && pos + 1 < value.size() &&
+            static_cast<char32_t>(value[pos + 1]) >= 0xDC00 && static_cast<char32_t>(value[pos + 1]) <= 0xDFFF)
+        {
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (static_cast<char32_t>(value[pos + 1]) - 0xDC00);
+            ++pos;
+        }
+        else if ((codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF)
+        {
+            codePoint = kReplacementChar;
+        }
+
+        if (codePoint < 0x80)
+        {
+            output.push_back(static_cast<char>(codePoint));
+        }
+        else if (codePoint < 0x800)
+        {
+            output.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else if (codePoint < 0x10000)
+        {
+            output.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else
+        {
+            output.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            output.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+    return output;
+}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "AsyncTask.h"
+#include "Cancellation.h"
+#include "NetworkReactor.h"
+
+#include <Windows.h>
+#include <winhttp.h>
+
+#include <memory>
+#include <string>
+
+struct HttpResponse
+{
+    DWORD status = 0;
+    std::wstring setCookieHeader;
+    std::wstring csrfToken;
+};
+
+// Per-phase limits in milliseconds; 0 keeps the session's. Connect also
+// bounds name resolution, and receive bounds the wait for the response
+// headers as well as each read of the body.
+struct HttpTimeouts
+{
+    DWORD connectMs = 0;
+    DWORD sendMs = 0;
+    DWORD receiveMs = 0;
+};
+
+struct HttpRequest
+{
+    std::wstring method = L"POST";
+    std::wstring path;
+    std::string payload;
+    // Each line terminated by CRLF.
+    std::wstring headers;
+    HttpTimeouts timeouts;
+    // Cancelling it aborts the request; its result then has |cancelled| set.
+    std::shared_ptr<CancellationSource> cancellation;
+    // Plain HTTP is only for devices that offer nothing else.
+    bool secure = true;
+    // Offer HTTP/2 through ALPN. Requests to a peer that accepts share one
+    // connection as concurrent streams; others fall back to HTTP/1.1.
+    bool allowHttp2 = false;
+};
+
+struct HttpResult
+{
+    // Transport outcome; on failure |error| is the WinHTTP error code.
+    HRESULT hr = S_OK;
+    DWORD error = 0;
+    std::wstring errorText;
+    // WINHTTP_CALLBACK_STATUS_FLAG_* reported for a failed TLS handshake.
+    DWORD secureFailureFlags = 0;
+    // A phase ran past its timeout.
+    bool timedOut = false;
+    // Aborted through the request's cancellation; nothing was logged.
+    bool cancelled = false;
+    // WinHTTP had no idle connection to reuse and opened one, with its TCP
+    // and TLS handshakes.
+    bool newConnection = false;
+    // The response came back over HTTP/2.
+    bool http2 = false;
+    HttpResponse response;
+    std::string body;
+};
+
+// A WinHTTP session in asynchronous mode; requests on it must go through
+// SendHttpRequestAsync. Its pool keeps connections open between requests,
+// so keep the session for as long as the peer stays the same. Its default
+// timeouts are seconds, not WinHTTP's minutes.
+HINTERNET OpenAsyncHttpSession();
+
+// Sends |request|, over TLS unless it says otherwise, and resumes the caller
+// on |reactor|'s thread once the whole response has been read. Many requests
+// may share |connection|.
+Task<HttpResult> SendHttpRequestAsync(NetworkReactor& reactor, HINTERNET connection, HttpRequest request);
+
+HttpTimeouts UniformHttpTimeouts(DWORD timeoutMs);
+
+std::wstring FormatWin32Error(DWORD error);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CameraTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// A camera ID interned by a CameraCatalog; stable for the catalog's lifetime,
+// so it can be stored and compared instead of the ID.
+using CameraHandle = uint32_t;
+constexpr CameraHandle kNoCamera = 0;
+
+// One camera in a snapshot. The views point into the catalog's arena and
+// stay valid for as long as the snapshot is held.
+struct CameraRecord
+{
+    CameraHandle handle = kNoCamera;
+    std::string_view id;
+    std::string_view name;
+    std::string_view state;
+    bool hasReturnHome = false;
+    bool returnHomeDisabled = false;
+};
+
+// An immutable camera list, shared by reference between the worker and the
+// UI. Holding it keeps the interned strings it points at alive.
+class CameraCatalogSnapshot
+{
+public:
+    // In the controller's order, with cameras added since at the end.
+    const std::vector<CameraRecord>& Cameras() const { return cameras_; }
+    // nullptr if |handle| is not in this snapshot.
+    const CameraRecord* Find(CameraHandle handle) const;
+
+private:
+    friend class CameraCatalog;
+
+    void IndexHandles();
+
+    std::shared_ptr<const void> arena_;
+    std::vector<CameraRecord> cameras_;
+    // Sorted by handle: (handle, index into |cameras_|).
+    std::vector<std::pair<CameraHandle, uint32_t>> byHandle_;
+};
+
+// Interns camera IDs, names and states into an append-only arena, so each
+// distinct string is stored once however many snapshots refer to it; a
+// refreshed list of the same cameras allocates no new strings. Used from
+// one thread (the network reactor); its snapshots may be read anywhere.
+class CameraCatalog
+{
+public:
+    CameraCatalog();
+    CameraCatalog(const CameraCatalog&) = delete;
+    CameraCatalog& operator=(const CameraCatalog&) = delete;
+
+    // The same ID always gets the same handle.
+    CameraHandle Intern(std::string_view id);
+    // kNoCamera for an ID never interned.
+    CameraHandle Find(std::string_view id) const;
+    // Empty for kNoCamera or an unknown handle.
+    std::string_view IdOf(CameraHandle handle) const;
+
+    std::shared_ptr<const CameraCatalogSnapshot> BuildSnapshot(const std::vector<CameraInfo>& cameras);
+    // |base| with |camera| added, or replacing the camera with its ID.
+    std::shared_ptr<const CameraCatalogSnapshot> WithCamera(const CameraCatalogSnapshot& base,
+        const CameraInfo& camera);
+    std::shared_ptr<const CameraCatalogSnapshot> WithoutCamera(const CameraCatalogSnapshot& base,
+        CameraHandle handle);
+
+    // Bytes of string data held, for checking growth.
+    size_t ArenaBytes() const;
+
+private:
+    struct Arena;
+
+    std::string_view Store(std::string_view text);
+    CameraRecord MakeRecord(const CameraInfo& camera);
+    std::shared_ptr<CameraCatalogSnapshot> NewSnapshot() const;
+
+    std::shared_ptr<Arena> arena_;
+    std::unordered_set<std::string_view> strings_;
+    std::unordered_map<std::string_view, CameraHandle> handles_;
+    // Index handle - 1.
+    std::vector<std::string_view> ids_;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "AsyncTask.h"
+#include "CameraTypes.h"
+#include "Cancellation.h"
+
+#include <Windows.h>
+
+#include <memory>
+#include <string>
+
+struct CameraCommandResult
+{
+    HRESULT hr = S_OK;
+    DWORD error = 0;
+    std::wstring errorText;
+    // The controller's reply; 0 from drivers that talk to the camera itself.
+    DWORD httpStatus = 0;
+    // The camera, or the controller on its behalf, accepted the command.
+    bool acknowledged = false;
+    // Sending it needed a new connection and its handshakes.
+    bool newConnection = false;
+    // No reply within the timeout.
+    bool timedOut = false;
+    // Aborted through the caller's cancellation.
+    bool cancelled = false;
+};
+
+// How moves reach a camera. Called on the network reactor thread; a driver
+// may keep several commands in flight and must finish each one within its
+// timeout so the worker can shut down.
+class CameraDriver
+{
+public:
+    virtual ~CameraDriver() = default;
+
+    virtual const char* Name() const = 0;
+    // A zero |state| stops the camera. |timeoutMs| of 0 uses the driver's
+    // default. Cancelling |cancellation|, which may be null, abandons the
+    // command.
+    virtual Task<CameraCommandResult> SendMove(std::string cameraId, JoystickState state, DWORD timeoutMs,
+        std::shared_ptr<CancellationSource> cancellation) = 0;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+struct CameraEventStreamEndpoint
+{
+    std::wstring host;
+    uint16_t port = 443;
+    bool secure = true;
+    std::wstring path;
+    // Auth headers for the upgrade request, each terminated by CRLF.
+    std::wstring headers;
+};
+
+// Returns false while no endpoint is usable yet (e.g. before login).
+using CameraEventEndpointProvider = std::function<bool(CameraEventStreamEndpoint*)>;
+using CameraEventConnectedCallback = std::function<void(bool reconnected)>;
+using CameraEventMessageCallback = std::function<void(const std::string& message)>;
+
+// The wait between connection attempts: |initial| after a failure,
+// doubling up to |max|, and back to |initial| once an upgrade succeeds.
+class ReconnectBackoff
+{
+public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    ReconnectBackoff(Duration initial = std::chrono::seconds(1), Duration max = std::chrono::seconds(30))
+        : initial_(initial), max_(max), current_(initial)
+    {
+    }
+
+    Duration Current() const { return current_; }
+    void Grow() { current_ = std::min(current_ * 2, max_); }
+    void Reset() { current_ = initial_; }
+
+private:
+    Duration initial_;
+    Duration max_;
+    Duration current_;
+};
+
+// Text messages larger than this close the stream (1009) rather than grow
+// the buffer without bound.
+constexpr size_t kMaxCameraEventMessage = 1 << 20;
+
+// Holds a WebSocket subscription open on its own thread and reconnects with
+// exponential backoff. Each complete text message is passed to |onMessage|.
+#ifdef _WIN32
+void StartCameraEventStream(CameraEventEndpointProvider provider,
+    CameraEventConnectedCallback onConnected,
+    CameraEventMessageCallback onMessage);
+#else
+// Plain ws:// only. |backoff| stands in for the 1 s to 30 s schedule, so
+// tests can reconnect quickly.
+void StartCameraEventStream(CameraEventEndpointProvider provider,
+    CameraEventConnectedCallback onConnected,
+    CameraEventMessageCallback onMessage,
+    ReconnectBackoff backoff = {});
+#endif
+void StopCameraEventStream();
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CameraCatalog.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Type-ahead search over one camera list snapshot. Each camera's name, ID
+// and state are lowercased (ASCII only) into one text, and every three-byte
+// run of it is indexed; a query of three bytes or more reads only the rows
+// holding all of its runs, and shorter ones scan. Used from one thread.
+class CameraSearchIndex
+{
+public:
+    // Indexes |cameras|, replacing any previous list; nullptr empties it.
+    void Build(std::shared_ptr<const CameraCatalogSnapshot> cameras);
+
+    // Rows of Cameras() whose name, ID or state contains |query|, ignoring
+    // ASCII case; every row for an empty query. Rows whose displayed name
+    // starts with |query| come first, otherwise the list's order is kept.
+    // A query extending the previous one only rechecks its results.
+    const std::vector<uint32_t>& Search(std::string_view query);
+
+    // The indexed snapshot; nullptr before the first Build().
+    const std::shared_ptr<const CameraCatalogSnapshot>& Cameras() const { return cameras_; }
+    // The rows last returned by Search().
+    const std::vector<uint32_t>& Results() const { return results_; }
+
+private:
+    std::string_view RowText(uint32_t row) const;
+    void CollectCandidates(const std::string& query, std::vector<uint32_t>* candidates) const;
+    size_t FilterResults(const std::string& query, std::vector<uint32_t>* candidates) const;
+
+    std::shared_ptr<const CameraCatalogSnapshot> cameras_;
+    // Lowercased "name\nid\nstate" per row (the ID standing in for a missing
+    // name), back to back; row r spans textOffsets_[r] to textOffsets_[r + 1].
+    std::string text_;
+    std::vector<uint32_t> textOffsets_;
+    // Length of each row's first field, for the name-prefix ordering.
+    std::vector<uint32_t> nameLengths_;
+    // Sorted three-byte keys; keys_[k]'s rows, ascending, are
+    // postings_[postingOffsets_[k]] to postings_[postingOffsets_[k + 1]].
+    std::vector<uint32_t> keys_;
+    std::vector<uint32_t> postingOffsets_;
+    std::vector<uint32_t> postings_;
+
+    std::string lastQuery_;
+    bool hasResults_ = false;
+    std::vector<uint32_t> results_;
+    // The name-prefix matches leading |results_|.
+    size_t prefixMatches_ = 0;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+// Kept free of Windows headers so the protocol code can be built anywhere.
+
+// Pan (x), tilt (y) and zoom (z) speeds, each within +/-750.
+struct JoystickState
+{
+    double x;
+    double y;
+    double z;
+};
+
+// UTF-8, as received from the controller.
+struct CameraInfo
+{
+    std::string id;
+    std::string name;
+    std::string state;
+    // Set when the source document carried the camera's PTZ settings.
+    bool hasReturnHome = false;
+    bool returnHomeDisabled = false;
+};
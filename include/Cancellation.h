@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+
+// Aborts the operations registered with it. Register() and Cancel() are
+// called on the thread that starts the operations (the network reactor's),
+// so an operation is never cancelled while it is being started; it may
+// unregister from any thread once it finishes on its own.
+class CancellationSource
+{
+public:
+    // Returns 0, registering nothing, once cancelled.
+    uint64_t Register(std::function<void()> onCancel)
+    {
+        std::scoped_lock lock(mutex_);
+        if (cancelled_)
+            return 0;
+        callbacks_.emplace(++nextId_, std::move(onCancel));
+        return nextId_;
+    }
+
+    // False once Cancel() has taken the callback: it runs, or has run, on
+    // the cancelling thread, and cleanup it does is left to it.
+    bool Unregister(uint64_t id)
+    {
+        std::scoped_lock lock(mutex_);
+        return callbacks_.erase(id) != 0;
+    }
+
+    void Cancel()
+    {
+        std::map<uint64_t, std::function<void()>> callbacks;
+        {
+            std::scoped_lock lock(mutex_);
+            if (cancelled_)
+                return;
+            cancelled_ = true;
+            callbacks.swap(callbacks_);
+        }
+        // Outside the lock: a callback may finish its operation, which then
+        // unregisters.
+        for (auto& [id, callback] : callbacks)
+            callback();
+    }
+
+    bool IsCancelled() const
+    {
+        std::scoped_lock lock(mutex_);
+        return cancelled_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    bool cancelled_ = false;
+    uint64_t nextId_ = 0;
+    std::map<uint64_t, std::function<void()>> callbacks_;
+};
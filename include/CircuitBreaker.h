@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+// Controller failures in a row that open the circuit breaker, and the
+// bounds of its backoff between probes.
+constexpr uint32_t kBreakerFailureThreshold = 3;
+constexpr auto kBreakerInitialBackoff = std::chrono::milliseconds(1000);
+constexpr auto kBreakerMaxBackoff = std::chrono::milliseconds(60000);
+
+// Keeps the worker from hammering a controller that is down. Closed, it
+// admits everything; kBreakerFailureThreshold failures in a row open it,
+// and nothing is admitted until a jittered backoff has passed. Then one
+// request goes out as a probe (half-open): success closes the breaker,
+// failure reopens it with the backoff doubled. Not thread safe; the
+// network worker keeps it on the reactor thread.
+class CircuitBreaker
+{
+public:
+    enum class State
+    {
+        Closed,
+        Open,
+        HalfOpen
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // |seed| drives the jitter; tests pass a fixed one.
+    explicit CircuitBreaker(unsigned seed = static_cast<unsigned>(Clock::now().time_since_epoch().count()))
+        : random_(seed)
+    {
+    }
+
+    State GetState() const { return state_; }
+    Clock::time_point NextProbe() const { return nextProbe_; }
+
+    // Whether Admit() would let a request through; changes nothing.
+    bool WouldAdmit(Clock::time_point now) const
+    {
+        return state_ == State::Closed || (state_ == State::Open && now >= nextProbe_);
+    }
+
+    // The request admitted once the backoff has passed is the probe.
+    bool Admit(Clock::time_point now)
+    {
+        if (!WouldAdmit(now))
+            return false;
+        if (state_ == State::Open)
+            state_ = State::HalfOpen;
+        return true;
+    }
+
+    // Returns true if the breaker was not closed.
+    bool RecordSuccess()
+    {
+        const bool wasOpen = state_ != State::Closed;
+        state_ = State::Closed;
+        failures_ = 0;
+        backoff_ = kBreakerInitialBackoff;
+        return wasOpen;
+    }
+
+    // Returns true if this failure opened the breaker. |openNow| skips the
+    // threshold, for failures that repeating cannot fix.
+    bool RecordFailure(Clock::time_point now, bool openNow)
+    {
+        ++failures_;
+        if (state_ == State::Open)
+            return false;
+        if (state_ == State::Closed && failures_ < kBreakerFailureThreshold && !openNow)
+            return false;
+
+        // Equal jitter: half the backoff is fixed and half random, so
+        // clients that failed together do not all probe together.
+        const auto half = backoff_ / 2;
+        std::uniform_int_distribution<long long> jitter(0, half.count());
+        nextProbe_ = now + half + std::chrono::milliseconds(jitter(random_));
+        backoff_ = std::min(backoff_ * 2, kBreakerMaxBackoff);
+        state_ = State::Open;
+        return true;
+    }
+
+    // A probe cancelled before it was answered; the next request probes.
+    void RecordAbandoned()
+    {
+        if (state_ == State::HalfOpen)
+            state_ = State::Open;
+    }
+
+    uint32_t Failures() const { return failures_; }
+
+    void Reset()
+    {
+        RecordSuccess();
+        nextProbe_ = {};
+    }
+
+private:
+    State state_ = State::Closed;
+    uint32_t failures_ = 0;
+    std::chrono::milliseconds backoff_ = kBreakerInitialBackoff;
+    Clock::time_point nextProbe_;
+    std::minstd_rand random_;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <functional>
+
+enum class DeviceChange
+{
+    Arrival,
+    Removal,
+};
+
+// The callback runs on the watcher thread; marshal to the UI thread before
+// touching input devices.
+using DeviceChangeCallback = std::function<void(DeviceChange change)>;
+
+#ifdef _WIN32
+bool StartDeviceWatcher(DeviceChangeCallback callback);
+#else
+// |directory| stands in for /dev/input, so tests can watch one of their own.
+bool StartDeviceWatcher(DeviceChangeCallback callback, const char* directory = "/dev/input");
+#endif
+void StopDeviceWatcher();
@@ -2,8 +2,26 @@
 
 #include <Windows.h>
 
+// Posted to the dialog once background device enumeration has finished.
+constexpr UINT WM_APP_JOYSTICK_READY = WM_APP + 1;
+// Posted by the device watcher; wParam is nonzero for an arrival.
+constexpr UINT WM_APP_DEVICE_CHANGE = WM_APP + 2;
+// Posted by the network worker when it has queued events for the dialog.
+constexpr UINT WM_APP_NETWORK_EVENT = WM_APP + 3;
+
 void SetFilterOutXInputDevices(bool enable);
+// Applies a changed Invert Y setting to the input thread.
+void SetInputInvertY(bool enable);
 HRESULT InitDirectInput(HWND dialog);
+HRESULT CompleteDirectInputInit(HWND dialog);
+void HandleInputDeviceChange(HWND dialog, bool arrival);
 void AcquireJoystick();
 void FreeDirectInput();
 HRESULT UpdateInputState(HWND dialog);
+void HandleNetworkEvents(HWND dialog);
+// The camera list is a virtual list view filtered by the search box.
+void InitCameraList(HWND dialog);
+// Reruns the search after the search box changed.
+void FilterCameraList(HWND dialog);
+// True if |header| was a camera list notification, now handled.
+bool HandleCameraListNotify(HWND dialog, const NMHDR* header);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FlightRecorder.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reads the dumps written by WriteFlightDump; shared by tools/FlightDecode.cpp
+// and the tests.
+
+struct FlightDump
+{
+    FlightDumpHeader header;
+    // Oldest first; empty and torn slots are left out.
+    std::vector<FlightRecord> records;
+};
+
+// False with |error| set if |bytes| is not a whole dump of this version.
+bool ParseFlightDump(std::string_view bytes, FlightDump* dump, std::string* error);
+// The dump as flight_decode prints it: a summary, then a line per record.
+std::string FormatFlightDump(const FlightDump& dump);
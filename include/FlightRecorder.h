@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// flight_decode reads dumps through this header on whatever machine they
+// end up on.
+
+// A fixed ring of the last kFlightRecordCount events, always on, so that
+// what led up to a fault is still there when it happens. Recording takes no
+// lock and allocates nothing; the oldest records are overwritten.
+
+enum class FlightEventType : uint16_t
+{
+    None,
+    // values: x, y, z in thousandths; text: camera ID, empty for the
+    // selected camera.
+    StateSubmitted,
+    // text: camera ID, empty for the selected camera.
+    StopSubmitted,
+    // values: HTTP status, Win32 error, duration in microseconds;
+    // text: method and path.
+    Request,
+    // text: the status line shown in the dialog.
+    Status,
+    // values: error code; text: what failed.
+    Error,
+};
+
+constexpr uint32_t kFlightRecordCount = 8192;
+constexpr uint32_t kFlightDumpVersion = 1;
+constexpr char kFlightDumpMagic[8] = { 'J', 'S', 'F', 'L', 'I', 'G', 'H', 'T' };
+
+// Dumps are a FlightDumpHeader followed by kFlightRecordCount records in
+// slot order, in the writing machine's byte order.
+struct FlightDumpHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t recordCount;
+    uint32_t reserved;
+    // Records ever written, as the dump began.
+    uint64_t written;
+    // The steady clock and the Unix time in milliseconds at the dump, to
+    // place records on the wall clock.
+    uint64_t dumpSteadyNs;
+    int64_t dumpUnixMs;
+    char reason[88];
+};
+static_assert(sizeof(FlightDumpHeader) == 136);
+
+struct FlightRecord
+{
+    // The record's position in the history plus one; 0 for an empty slot,
+    // or one that was being written when the dump copied it.
+    uint64_t sequence;
+    // Steady clock, in nanoseconds.
+    uint64_t timeNs;
+    // 1 for the first thread to record, and so on.
+    uint32_t thread;
+    uint16_t type;
+    uint16_t textLength;
+    int32_t values[3];
+    // UTF-8, not terminated; longer text is cut.
+    char text[92];
+};
+static_assert(sizeof(FlightRecord) == 128);
+
+void RecordFlightEvent(FlightEventType type, std::string_view text = {},
+    int32_t value0 = 0, int32_t value1 = 0, int32_t value2 = 0);
+// Encodes into the record directly, so it allocates nothing either.
+void RecordFlightEvent(FlightEventType type, std::wstring_view text,
+    int32_t value0 = 0, int32_t value1 = 0, int32_t value2 = 0);
+
+// Receives a dump's bytes, a piece at a time; returning false stops it.
+using FlightDumpWriter = bool (*)(const void* data, size_t size, void* context);
+
+// Hands a dump of the ring to |write|. Allocates nothing and takes no lock,
+// so it can run from a crash handler while other threads still record. One
+// dump runs at a time; false if another is running or |write| failed.
+bool WriteFlightDump(const char* reason, FlightDumpWriter write, void* context);
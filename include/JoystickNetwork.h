@@ -1,32 +1,85 @@
 #pragma once
 
+#include "CameraCatalog.h"
+#include "CameraTypes.h"
+#include "NetworkEvents.h"
+
 #include <Windows.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
-struct JoystickState
+// Time from a stop being submitted to the controller acknowledging it.
+struct StopLatencyStats
+{
+    uint32_t acknowledged = 0;
+    double lastMs = 0.0;
+    double maxMs = 0.0;
+    double meanMs = 0.0;
+    uint32_t retries = 0;
+    // Stops sent again because a move issued before them was still in flight.
+    uint32_t watchdogResends = 0;
+};
+
+// Moves carry a deadline from their capture time: expired ones are dropped
+// unsent, and sent ones acknowledged after it are counted as late.
+struct MoveDeadlineStats
+{
+    uint32_t sent = 0;
+    uint32_t dropped = 0;
+    uint32_t late = 0;
+};
+
+// Connections opened to the controller, each paying TCP and TLS handshakes,
+// and how the first move after an idle spell fared.
+struct ConnectionStats
 {
-    double x;
-    double y;
-    double z;
+    uint32_t handshakes = 0;
+    double handshakesPerHour = 0.0;
+    uint32_t firstMovesAfterIdle = 0;
+    // First moves that had to open a connection.
+    uint32_t coldFirstMoves = 0;
+    double firstMoveMeanMs = 0.0;
+    double firstMoveMaxMs = 0.0;
 };
 
-struct CameraInfo
+// Requests and commands that ran past their deadlines, and moves abandoned
+// in flight: superseded by a newer one for their camera, or stalled with
+// nothing newer behind them.
+struct TimeoutStats
 {
-    std::wstring id;
-    std::wstring name;
-    std::wstring state;
+    // Controller requests of every kind.
+    uint32_t requests = 0;
+    // Moves and stops through any driver.
+    uint32_t moves = 0;
+    uint32_t stops = 0;
+    uint32_t movesSuperseded = 0;
+    uint32_t movesStalled = 0;
 };
 
 void StartNetworkWorker();
 void StopNetworkWorker();
 void SubmitJoystickState(const JoystickState& state);
-std::wstring GetNetworkStatusText();
+void SubmitCameraJoystickState(const std::string& cameraId, const JoystickState& state);
+// Stops bypass the move queue and are retried until acknowledged.
+void SubmitJoystickStop();
+void SubmitCameraJoystickStop(const std::string& cameraId);
+StopLatencyStats GetStopLatencyStats();
+MoveDeadlineStats GetMoveDeadlineStats();
+ConnectionStats GetConnectionStats();
+TimeoutStats GetTimeoutStats();
 bool GetInvertYSetting();
 void SetInvertYSetting(bool enabled);
 void SubmitReturnHomeSetting(bool disabled);
-bool ConsumeReturnHomeSettingUpdate(bool* disabled);
 void RequestCameraListRefresh();
-bool ConsumeCameraListUpdate(std::vector<CameraInfo>* cameras);
-void SelectCameraId(const std::wstring& cameraId);
+// A handle from the camera list events; kNoCamera clears the selection.
+void SelectCamera(CameraHandle camera);
 void NotifyNetworkConfigChanged();
+// |notifier| runs on the worker's threads when an event is queued and the
+// previous ones have been drained, e.g. to post a window message. Events
+// already queued are announced at once.
+void SetNetworkEventNotifier(std::function<void()> notifier);
+// Moves the queued events, oldest first, into |events|.
+bool DrainNetworkEvents(std::vector<NetworkEvent>* events);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "CameraTypes.h"
+
+// Maps raw stick axes, each within +/-255, to camera speeds within +/-750.
+// The speed follows the deflection past a radial deadzone; twist has its own
+// smaller one. Returns false, with |outState| zeroed, inside the deadzone.
+bool ScaleJoystickAxes(double x, double y, double z, bool invertY, JoystickState* outState);
@@ -1,13 +1,114 @@
 #pragma once
 
-#include "JoystickNetwork.h"
+#include "CameraTypes.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace JsonUtils
 {
-bool TryParseReturnHomeDisabled(const std::string& body, bool* outDisabled);
-bool TryParseCameraList(const std::string& body, std::vector<CameraInfo>* cameras);
-}
+enum class DeviceEventType
+{
+    Add,
+    Update,
+    Remove,
+};
+
+// One message from the controller's device subscription. Updates carry only
+// the fields that changed, so each optional field has a presence flag.
+struct DeviceEvent
+{
+    DeviceEventType type = DeviceEventType::Update;
+    std::string modelKey;
+    CameraInfo camera;
+    bool hasName = false;
+    bool hasState = false;
+};
+
+enum class JsonKind
+{
+    Missing,
+    Null,
+    Bool,
+    Number,
+    String,
+    Object,
+    Array,
+};
+
+// A value found by JsonPathQuery. |text| views the source buffer: the still
+// escaped contents of a string, the token of a number, boolean or null, and
+// the full span of an object or array.
+struct JsonValue
+{
+    JsonKind kind = JsonKind::Missing;
+    std::string_view text;
+    bool hasEscapes = false;
+};
+
+// A fixed set of JSON pointer paths (e.g. "/ptz/returnHomeAfterInactivityMs",
+// "/items/0/id") resolved in one pass without building a tree. Each level
+// keeps a perfect hash of the keys wanted there, so a member costs one hash
+// and at most one compare; everything off the paths is skipped unparsed.
+// Keys are matched as written, without unescaping.
+class JsonPathQuery
+{
+public:
+    JsonPathQuery(std::initializer_list<std::string_view> paths);
 
+    size_t Size() const { return pathCount_; }
+
+    // |values| holds Size() entries in constructor order; paths not present
+    // stay Missing. Returns false if the part of |body| walked is malformed.
+    bool Extract(std::string_view body, std::span<JsonValue> values) const;
+    // Walks the one value starting at |*pos| (after any whitespace) to its
+    // end, with no early exit, and moves |*pos| just past it. For queries
+    // run on each element of a larger document in place.
+    bool Extract(std::string_view body, size_t* pos, std::span<JsonValue> values) const;
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Node
+    {
+        std::string key;
+        uint32_t valueIndex = kNone;
+        std::vector<uint32_t> children;
+        // Perfect hash over the children's keys: slot -> child node + 1.
+        uint32_t seed = 0;
+        std::vector<uint32_t> slots;
+    };
+
+    struct WalkState;
+
+    void AddPath(std::string_view path, uint32_t valueIndex);
+    void BuildHashes();
+    uint32_t FindChild(const Node& node, std::string_view key) const;
+    bool WalkValue(WalkState& state, uint32_t nodeIndex) const;
+    bool WalkObject(WalkState& state, const Node& node) const;
+    bool WalkArray(WalkState& state, const Node& node) const;
+
+    std::vector<Node> nodes_;
+    size_t pathCount_ = 0;
+};
+
+// Integer value of a number, or of a string holding only one.
+bool TryGetInt64(const JsonValue& value, int64_t* outValue);
+// Unescaped UTF-8 contents of a string value; empty for other kinds.
+std::string DecodeString(const JsonValue& value);
+// The value of the first member named |key| at any depth, in document
+// order; Missing if there is none.
+JsonValue FindMember(std::string_view body, std::string_view key);
+
+// The controller's continuous move body, speeds truncated to integers.
+std::string BuildMovePayload(const JoystickState& state);
+
+bool TryParseReturnHomeDisabled(std::string_view body, bool* outDisabled);
+bool TryParseCameraList(std::string_view body, std::vector<CameraInfo>* cameras);
+bool TryParseDeviceEvent(std::string_view body, DeviceEvent* outEvent);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Single-producer, single-consumer slot that keeps only the newest value: a
+// triple buffer. Publish() never blocks or allocates and Take() returns each
+// value at most once; values the consumer never saw are simply overwritten.
+template<typename T>
+class LatestValueMailbox
+{
+public:
+    // Producer thread.
+    void Publish(const T& value)
+    {
+        buffers_[back_] = value;
+        const uint8_t previous = middle_.exchange(back_ | kFresh);
+        back_ = previous & kIndexMask;
+    }
+
+    // Consumer thread. Sequentially consistent with Publish(), so a consumer
+    // that sets its own "idle" flag and then checks here cannot miss a value
+    // whose producer saw the flag still clear.
+    bool HasUpdate() const
+    {
+        return (middle_.load() & kFresh) != 0;
+    }
+
+    bool Take(T* value)
+    {
+        if (!HasUpdate())
+            return false;
+        const uint8_t previous = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & kIndexMask;
+        *value = buffers_[front_];
+        return true;
+    }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+
+    T buffers_[3] = {};
+    // Index of the buffer between producer and consumer, plus kFresh while
+    // it holds a value not yet taken.
+    alignas(64) std::atomic<uint8_t> middle_ = 1;
+    alignas(64) uint8_t back_ = 0;
+    alignas(64) uint8_t front_ = 2;
+};
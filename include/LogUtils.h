@@ -1,9 +1,12 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 struct HWND__;
 using HWND = HWND__*;
 
 void SetLogAnchorWindow(HWND window);
+// Log lines are UTF-8; the wide overload converts for UI-side callers.
+void AppendLogLine(std::string_view line);
 void AppendLogLine(const std::wstring& line);
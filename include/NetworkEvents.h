@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CameraCatalog.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Cameras added or updated, and cameras removed, by pushed device events;
+// the changed ones are looked up in the snapshot sent with the patch.
+struct CameraListPatch
+{
+    std::vector<CameraHandle> changed;
+    std::vector<CameraHandle> removed;
+};
+
+enum class NetworkEventType
+{
+    Status,
+    CameraListReplaced,
+    CameraListPatched,
+    ReturnHomeState,
+};
+
+// Sent from the worker to the UI. Payloads are shared and never modified
+// once queued; only the members for |type| are set. A patch carries the
+// snapshot it produced as well.
+struct NetworkEvent
+{
+    NetworkEventType type = NetworkEventType::Status;
+    std::shared_ptr<const std::wstring> status;
+    std::shared_ptr<const CameraCatalogSnapshot> cameras;
+    std::shared_ptr<const CameraListPatch> patch;
+    bool returnHomeDisabled = false;
+};
+
+// |newer| applied after |older|, as one patch.
+std::shared_ptr<const CameraListPatch> MergeCameraListPatches(const CameraListPatch& older,
+    const CameraListPatch& newer);
+
+// Events waiting for the UI. A new event replaces the queued ones it
+// supersedes, so the queue never holds more than one of each type; the UI
+// is notified once per batch rather than once per event.
+class NetworkEventQueue
+{
+public:
+    // Runs |notifier| now if events are already waiting.
+    void SetNotifier(std::function<void()> notifier);
+    void Push(NetworkEvent event);
+    // Takes every queued event, oldest first, and rearms the notifier.
+    bool Drain(std::vector<NetworkEvent>* events);
+
+private:
+    std::mutex mutex_;
+    std::deque<NetworkEvent> events_;
+    std::function<void()> notifier_;
+    // Set once the notifier has run for events not yet drained.
+    bool notified_ = false;
+
+    void Coalesce(NetworkEvent* event);
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "AsyncTask.h"
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// OS wait primitive behind the reactor: an I/O completion port on Windows,
+// epoll plus an eventfd on Linux.
+class ReactorPoller
+{
+public:
+    ReactorPoller();
+    ~ReactorPoller();
+
+    ReactorPoller(const ReactorPoller&) = delete;
+    ReactorPoller& operator=(const ReactorPoller&) = delete;
+
+    bool IsValid() const;
+    // Returns after Wake() or once |timeoutMs| has elapsed; -1 waits forever.
+    void Wait(int timeoutMs);
+    void Wake();
+
+private:
+#if defined(_WIN32)
+    void* port_ = nullptr;
+#else
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
+#endif
+};
+
+// A coroutine parked on a timer, a condition or both; whichever fires first
+// resumes it.
+struct ReactorWaiter
+{
+    std::coroutine_handle<> handle;
+    bool resumed = false;
+};
+
+class NetworkReactor;
+
+// Lock-free wake-up for a reactor-thread handler. Raise() from any thread
+// sets a flag and wakes the poller only if the flag was clear; the reactor
+// runs the handler once per batch of raises. Construct before Start().
+class ReactorSignal
+{
+public:
+    ReactorSignal(NetworkReactor& reactor, std::function<void()> handler);
+
+    ReactorSignal(const ReactorSignal&) = delete;
+    ReactorSignal& operator=(const ReactorSignal&) = delete;
+
+    void Raise();
+
+private:
+    friend class NetworkReactor;
+
+    NetworkReactor& reactor_;
+    std::function<void()> handler_;
+    std::atomic<bool> raised_ = false;
+};
+
+// Single-threaded event loop for the network worker. Other threads hand it
+// work through Post(); on the reactor thread, coroutines park on timers and
+// conditions and are resumed in turn, so many requests can be in flight
+// without locks around the state they share.
+class NetworkReactor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class SleepAwaiter;
+
+    bool Start();
+    // Keeps running until every spawned task has finished, then joins. The
+    // owner wakes its loops first so they can exit.
+    void Stop();
+
+    // Thread-safe. Work posted while stopped runs after the next Start().
+    void Post(std::function<void()> work);
+    // Thread-safe; returns the loop for another pass without queuing work.
+    void Wake();
+    bool IsReactorThread() const;
+
+    // Reactor thread only.
+    void Spawn(Task<void> task);
+    SleepAwaiter SleepUntil(Clock::time_point deadline);
+    SleepAwaiter SleepFor(Clock::duration duration);
+
+    // Used by the awaiters; reactor thread only.
+    void AddTimer(Clock::time_point deadline, std::shared_ptr<ReactorWaiter> waiter);
+    void Resume(std::shared_ptr<ReactorWaiter> waiter);
+
+private:
+    friend class ReactorSignal;
+
+    struct Timer
+    {
+        Clock::time_point deadline;
+        uint64_t sequence = 0;
+        std::shared_ptr<ReactorWaiter> waiter;
+
+        bool operator>(const Timer& other) const
+        {
+            return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    void Run();
+    void RunPosted();
+    void RunSignals();
+    void RunReady();
+    void RunDueTimers();
+    int NextTimeoutMs() const;
+    DetachedTask RunDetached(Task<void> task);
+
+    ReactorPoller poller_;
+    // Registered before Start(), never changed while running.
+    std::vector<ReactorSignal*> signals_;
+    std::thread thread_;
+    std::thread::id threadId_;
+
+    std::mutex mutex_;
+    std::vector<std::function<void()>> posted_;
+    bool stopRequested_ = false;
+
+    // Reactor thread only.
+    std::deque<std::shared_ptr<ReactorWaiter>> ready_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+    uint64_t timerSequence_ = 0;
+    size_t liveTasks_ = 0;
+};
+
+class NetworkReactor::SleepAwaiter
+{
+public:
+    SleepAwaiter(NetworkReactor& reactor, Clock::time_point deadline)
+        : reactor_(reactor),
+          deadline_(deadline)
+    {
+    }
+
+    bool await_ready() const { return deadline_ <= Clock::now(); }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        auto waiter = std::make_shared<ReactorWaiter>();
+        waiter->handle = handle;
+        reactor_.AddTimer(deadline_, std::move(waiter));
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    NetworkReactor& reactor_;
+    Clock::time_point deadline_;
+};
+
+// Condition for coroutines on one reactor. Everything runs on the reactor
+// thread, so a waiter re-checks its predicate without a lock:
+//     while (!ready) co_await condition.Wait();
+class AsyncCondition
+{
+public:
+    class Awaiter
+    {
+    public:
+        Awaiter(AsyncCondition& condition, std::optional<NetworkReactor::Clock::time_point> deadline)
+            : condition_(condition),
+              deadline_(deadline)
+        {
+        }
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { condition_.Park(handle, deadline_); }
+        void await_resume() const noexcept {}
+
+    private:
+        AsyncCondition& condition_;
+        std::optional<NetworkReactor::Clock::time_point> deadline_;
+    };
+
+    explicit AsyncCondition(NetworkReactor& reactor)
+        : reactor_(reactor)
+    {
+    }
+
+    Awaiter Wait() { return Awaiter(*this, std::nullopt); }
+    // Also resumes at |deadline| if nothing notifies first.
+    Awaiter WaitUntil(NetworkReactor::Clock::time_point deadline) { return Awaiter(*this, deadline); }
+    void NotifyAll();
+
+private:
+    void Park(std::coroutine_handle<> handle, std::optional<NetworkReactor::Clock::time_point> deadline);
+
+    NetworkReactor& reactor_;
+    std::vector<std::shared_ptr<ReactorWaiter>> waiters_;
+};
+
+// Runs tasks side by side on the reactor and lets one coroutine await them
+// all: group.Spawn(...) for each, then co_await group.Join().
+class TaskGroup
+{
+public:
+    explicit TaskGroup(NetworkReactor& reactor)
+        : done_(reactor)
+    {
+    }
+
+    void Spawn(Task<void> task);
+    Task<void> Join();
+
+private:
+    DetachedTask Run(Task<void> task);
+
+    AsyncCondition done_;
+    size_t pending_ = 0;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "AsyncHttp.h"
+#include "CameraDriver.h"
+#include "NetworkReactor.h"
+#include "OnvifSoap.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+
+struct OnvifCameraConfig
+{
+    std::wstring host;
+    INTERNET_PORT port = 80;
+    bool secure = false;
+    std::wstring ptzPath = L"/onvif/ptz_service";
+    std::wstring mediaPath = L"/onvif/media_service";
+    // Empty: requests carry no WS-Security header.
+    std::string username;
+    std::string password;
+};
+
+// Drives ONVIF cameras with PTZ ContinuousMove and Stop on the first media
+// profile, found once with GetProfiles. Envelopes are serialized ahead of
+// time; the WS-Security digest is computed once per camera and reused until
+// it ages out or the camera rejects a request.
+class OnvifCameraDriver : public CameraDriver
+{
+public:
+    explicit OnvifCameraDriver(NetworkReactor& reactor);
+    ~OnvifCameraDriver() override;
+
+    OnvifCameraDriver(const OnvifCameraDriver&) = delete;
+    OnvifCameraDriver& operator=(const OnvifCameraDriver&) = delete;
+
+    // Reactor thread.
+    bool AddCamera(const std::string& cameraId, const OnvifCameraConfig& config);
+    // Closes the handles and forgets the cameras; call once the reactor has
+    // stopped.
+    void Close();
+
+    const char* Name() const override { return "ONVIF"; }
+    Task<CameraCommandResult> SendMove(std::string cameraId, JoystickState state, DWORD timeoutMs,
+        std::shared_ptr<CancellationSource> cancellation) override;
+
+private:
+    struct Camera
+    {
+        OnvifCameraConfig config;
+        HINTERNET connection = nullptr;
+        std::string profileToken;
+        std::string securityHeader;
+        std::chrono::steady_clock::time_point securityExpiresAt;
+        OnvifMoveTemplate move;
+        std::string stop;
+    };
+
+    bool RefreshSecurity(Camera& camera);
+    void BuildEnvelopes(Camera& camera);
+    // Renews an aged-out digest and loads the profile token if needed.
+    Task<bool> Prepare(Camera* camera, DWORD timeoutMs, std::shared_ptr<CancellationSource> cancellation,
+        CameraCommandResult* result);
+    // |headers| names the SOAP action.
+    Task<HttpResult> Post(Camera* camera, std::wstring path, const wchar_t* headers, std::string envelope,
+        DWORD timeoutMs, std::shared_ptr<CancellationSource> cancellation);
+
+    NetworkReactor& reactor_;
+    HINTERNET session_ = nullptr;
+    // Reactor thread only; the cameras stay put while requests await.
+    std::map<std::string, std::unique_ptr<Camera>> cameras_;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CameraTypes.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// SOAP 1.2 envelopes for the ONVIF PTZ and media services, and the
+// WS-Security digest. Kept free of Windows headers; the transport and the
+// nonce's randomness live in OnvifCameraDriver.
+
+// A ContinuousMove envelope serialized once per profile and security
+// header. Each move only overwrites its fixed-width velocity fields, so
+// serializing one allocates nothing.
+class OnvifMoveTemplate
+{
+public:
+    // |securityHeader| may be empty for cameras without authentication.
+    void Build(const std::string& securityHeader, const std::string& profileToken);
+    bool IsBuilt() const { return !envelope_.empty(); }
+
+    // Velocities are normalized to -1..1 from the +/-750 stick range and
+    // written with four decimals; NaN is written as 0. ONVIF tilts up for
+    // positive y, the stick for negative.
+    const std::string& Serialize(const JoystickState& state);
+
+private:
+    std::string envelope_;
+    size_t panOffset_ = 0;
+    size_t tiltOffset_ = 0;
+    size_t zoomOffset_ = 0;
+};
+
+std::string BuildOnvifStopEnvelope(const std::string& securityHeader, const std::string& profileToken);
+std::string BuildOnvifGetProfilesEnvelope(const std::string& securityHeader);
+// A WS-Security UsernameToken with a password digest; |nonce| and |digest|
+// are base64, |created| is UTC in xsd:dateTime form.
+std::string BuildOnvifSecurityHeader(const std::string& username,
+    const std::string& nonce,
+    const std::string& created,
+    const std::string& digest);
+// PasswordDigest = Base64(SHA-1(nonce + created + password)), with the raw
+// nonce bytes.
+std::string ComputeOnvifPasswordDigest(std::string_view nonce, std::string_view created, std::string_view password);
+// The token of the first media profile in a GetProfiles response.
+bool TryParseOnvifProfileToken(const std::string& response, std::string* token);
+
+// A SOAP 1.2 fault: the most specific code (the innermost Subcode, else the
+// Code), e.g. "ter:NotAuthorized", and the first Reason text.
+struct OnvifFault
+{
+    std::string code;
+    std::string reason;
+};
+
+// False unless |response| carries a Fault; cameras send one with HTTP 400
+// or 500 for a rejected digest or argument.
+bool TryParseOnvifFault(const std::string& response, OnvifFault* fault);
+std::string EncodeBase64(const uint8_t* data, size_t size);
+std::array<uint8_t, 20> ComputeSha1(std::string_view data);
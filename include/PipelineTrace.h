@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Stages of a stick sample's trip to the camera, and of the UI's side.
+enum class TraceStage : uint8_t
+{
+    // Input thread.
+    Poll,
+    Filter,
+    Submit,
+    // From capture until the worker takes the sample; keyed by move.
+    WorkerWakeup,
+    Serialize,
+    // One HTTP request and its phases; keyed by request. Connect is only
+    // there when the request opened a connection.
+    Request,
+    Connect,
+    Send,
+    FirstByte,
+    Read,
+    Parse,
+    UiUpdate,
+};
+
+// Spans go into a fixed ring per thread, so recording one takes no lock and
+// allocates nothing once the thread's ring exists; the oldest are
+// overwritten. Always on: a span costs two clock reads.
+
+// Steady clock, in nanoseconds.
+uint64_t TraceNow();
+// A fresh id for RecordTraceSpan; never 0.
+uint64_t NextTraceId();
+// Records [startNs, endNs) on the calling thread. Spans of the keyed stages
+// (WorkerWakeup, Request and its phases) may overlap others and cross
+// threads; they are tied together by |id|.
+void RecordTraceSpan(TraceStage stage, uint64_t startNs, uint64_t endNs, uint64_t id = 0);
+// Names the calling thread in exported traces.
+void SetTraceThreadName(const char* name);
+
+// Every thread's retained spans as Chrome trace-event JSON, which Perfetto
+// and chrome://tracing open. Safe to call while spans are being recorded.
+std::string ExportChromeTrace();
+
+class ScopedTraceSpan
+{
+public:
+    explicit ScopedTraceSpan(TraceStage stage, uint64_t id = 0)
+        : stage_(stage),
+          id_(id),
+          start_(TraceNow())
+    {
+    }
+
+    ~ScopedTraceSpan()
+    {
+        RecordTraceSpan(stage_, start_, TraceNow(), id_);
+    }
+
+    ScopedTraceSpan(const ScopedTraceSpan&) = delete;
+    ScopedTraceSpan& operator=(const ScopedTraceSpan&) = delete;
+
+private:
+    TraceStage stage_;
+    uint64_t id_;
+    uint64_t start_;
+};
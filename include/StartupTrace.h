@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+
+// Startup phases are recorded once each, relative to BeginStartupTrace().
+void BeginStartupTrace();
+void RecordStartupPhase(const wchar_t* phase,
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end);
+void MarkStartupMilestone(const wchar_t* milestone);
+void MarkFirstMoveSent();
+double GetTimeToFirstMoveMs();
+
+class ScopedStartupPhase
+{
+public:
+    explicit ScopedStartupPhase(const wchar_t* phase)
+        : phase_(phase),
+          start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedStartupPhase()
+    {
+        RecordStartupPhase(phase_, start_, std::chrono::steady_clock::now());
+    }
+
+    ScopedStartupPhase(const ScopedStartupPhase&) = delete;
+    ScopedStartupPhase& operator=(const ScopedStartupPhase&) = delete;
+
+private:
+    const wchar_t* phase_ = nullptr;
+    std::chrono::steady_clock::time_point start_;
+};
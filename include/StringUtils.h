@@ -1,7 +1,15 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 
-std::wstring Utf8ToWide(const std::string& value);
-std::string WideToUtf8(const std::wstring& value);
+// Network, JSON and log text stays UTF-8; convert only where it meets a wide
+// Win32 API. Invalid input is replaced with U+FFFD. wchar_t is UTF-16 on
+// Windows and UTF-32 elsewhere.
+std::wstring Utf8ToWide(std::string_view value);
+std::string WideToUtf8(std::wstring_view value);
+// Encodes as much of |value| as fits in |capacity| bytes, whole code points
+// only, and returns the bytes written. Allocates nothing.
+size_t WideToUtf8Prefix(std::wstring_view value, char* out, size_t capacity);
 std::wstring TrimWide(const std::wstring& value);
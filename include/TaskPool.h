@@ -0,0 +1,74 @@
+#pragma once
+
+#include "NetworkReactor.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// One worker's queue. |stolen| counts tasks this worker took from the other
+// queues once its own ran dry.
+struct TaskPoolQueueStats
+{
+    size_t depth = 0;
+    size_t maxDepth = 0;
+    uint64_t executed = 0;
+    uint64_t stolen = 0;
+};
+
+// A small work-stealing pool for short background jobs (parsing, log
+// output), shared so subsystems need not start threads of their own. Each
+// worker runs its own queue newest first and steals the oldest task from
+// the others when idle. Tasks must not block on I/O.
+// |threadCount| of 0 sizes the pool from the hardware.
+void StartTaskPool(size_t threadCount = 0);
+// Runs what is already queued, then joins the workers.
+void StopTaskPool();
+// Returns false when the pool is not running; the caller runs |task| itself.
+bool SubmitPoolTask(std::function<void()> task);
+std::vector<TaskPoolQueueStats> GetTaskPoolStats();
+// One line per queue, as logged when the pool stops.
+std::string DescribeTaskPoolQueue(size_t index, const TaskPoolQueueStats& stats);
+
+// co_await RunOnTaskPool(reactor, work): runs |work| on the pool and resumes
+// on the reactor thread, or runs it inline if the pool is stopped.
+class TaskPoolAwaiter
+{
+public:
+    TaskPoolAwaiter(NetworkReactor& reactor, std::function<void()> work)
+        : reactor_(reactor),
+          work_(std::move(work))
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        // The awaiter lives in the suspended frame until the resume.
+        if (SubmitPoolTask([this, handle]()
+            {
+                work_();
+                reactor_.Post([handle]() { handle.resume(); });
+            }))
+        {
+            return true;
+        }
+        work_();
+        return false;
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    NetworkReactor& reactor_;
+    std::function<void()> work_;
+};
+
+inline TaskPoolAwaiter RunOnTaskPool(NetworkReactor& reactor, std::function<void()> work)
+{
+    return TaskPoolAwaiter(reactor, std::move(work));
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CameraDriver.h"
+#include "NetworkReactor.h"
+#include "ViscaProtocol.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Drives cameras directly with VISCA over UDP instead of through the
+// controller: no TLS, HTTP or JSON per update. Every command carries the
+// camera's next sequence number and waits for its ACK or completion; the
+// socket's replies are read on a thread of their own and handed to the
+// reactor.
+class ViscaCameraDriver : public CameraDriver
+{
+public:
+    explicit ViscaCameraDriver(NetworkReactor& reactor);
+    ~ViscaCameraDriver() override;
+
+    ViscaCameraDriver(const ViscaCameraDriver&) = delete;
+    ViscaCameraDriver& operator=(const ViscaCameraDriver&) = delete;
+
+    // Reactor thread. |address| is an IPv4 literal; opens the socket on
+    // first use.
+    bool AddCamera(const std::string& cameraId, const std::wstring& address, uint16_t port);
+    // Closes the socket and forgets the cameras; call once the reactor has
+    // stopped.
+    void Close();
+
+    const char* Name() const override { return "VISCA"; }
+    Task<CameraCommandResult> SendMove(std::string cameraId, JoystickState state, DWORD timeoutMs,
+        std::shared_ptr<CancellationSource> cancellation) override;
+
+private:
+    // One camera's address; IDs that share it share its sequence.
+    struct Endpoint
+    {
+        uint32_t address = 0;
+        uint16_t port = 0;
+        ViscaSession session;
+        // Last zoom command acknowledged; zoom is only re-sent on change.
+        int lastZoomCode = -1;
+    };
+
+    bool Open();
+    bool SendPacket(const Endpoint& endpoint, const std::vector<uint8_t>& packet, CameraCommandResult* result);
+    void ReceiveReplies();
+    void HandleReply(uint64_t key, const ViscaReply& reply);
+
+    NetworkReactor& reactor_;
+    // A SOCKET; kept opaque so this header needs no Winsock.
+    uintptr_t socket_ = 0;
+    bool open_ = false;
+    std::thread receiveThread_;
+
+    // Reactor thread only.
+    std::map<std::string, uint64_t> cameras_;
+    std::map<uint64_t, Endpoint> endpoints_;
+    AsyncCondition replied_{ reactor_ };
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CameraTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// VISCA over IP, as Sony and most PTZ vendors frame it on UDP: an 8-byte
+// big-endian header (payload type, payload length, sequence number) and
+// then the VISCA message itself.
+constexpr uint16_t kViscaDefaultPort = 52381;
+
+enum class ViscaReplyKind
+{
+    Ack,
+    Completion,
+    Error,
+    // Reply to the sequence reset.
+    ControlAck,
+    // The camera rejected the sequence number or framing; reset and resend.
+    ControlError,
+};
+
+struct ViscaReply
+{
+    ViscaReplyKind kind = ViscaReplyKind::Ack;
+    uint32_t sequence = 0;
+    // VISCA error code of an Error reply, e.g. 0x41 for "not executable".
+    uint8_t errorCode = 0;
+};
+
+// Pan/tilt drive at speeds scaled from |state|: x > 0 pans right, y < 0
+// tilts up (the stick's raw axis). A centred axis stops.
+std::vector<uint8_t> BuildViscaPanTiltDrive(const JoystickState& state, uint32_t sequence);
+// Variable-speed zoom: z > 0 zooms in, 0 stops.
+std::vector<uint8_t> BuildViscaZoom(double z, uint32_t sequence);
+// The zoom command byte for |z|, so callers can skip repeating it.
+uint8_t ViscaZoomCode(double z);
+// Restarts the camera's sequence numbering at 0.
+std::vector<uint8_t> BuildViscaSequenceReset();
+// False for anything that is not a reply this driver understands.
+bool ParseViscaReply(const uint8_t* data, size_t size, ViscaReply* reply);
+
+// What became of one command.
+struct ViscaCommandStatus
+{
+    bool done = false;
+    bool acknowledged = false;
+    // VISCA error code of an Error reply.
+    uint8_t errorCode = 0;
+    // The camera refused the sequence number, or a reset overtook the
+    // command before its reply came.
+    bool sequenceRejected = false;
+};
+
+// A command's handle: its sequence number plus the reset it was numbered
+// after, so numbers reused after a reset never meet older commands.
+struct ViscaCommand
+{
+    uint64_t id = 0;
+    uint32_t sequence = 0;
+};
+
+// Sequence numbers and outstanding commands for one camera address, kept
+// apart from the socket. Numbers run on through 0xFFFFFFFF to 0 as the
+// camera counts. A reply only completes a command still outstanding, so
+// one that arrives after its command was given up on is dropped.
+class ViscaSession
+{
+public:
+    // Until the first reset, and again once the camera refuses a number.
+    bool NeedsReset() const { return needsReset_; }
+    // Call once the reset is sent. Numbering restarts at |firstSequence|;
+    // commands still outstanding are failed, since replies to their
+    // numbers can no longer be told apart from the new ones.
+    void OnResetSent(uint32_t firstSequence = 0);
+
+    ViscaCommand BeginCommand();
+    // False if |reply| completed nothing.
+    bool HandleReply(const ViscaReply& reply);
+    bool IsDone(const ViscaCommand& command) const;
+    // Stops tracking |command| and returns how it ended.
+    ViscaCommandStatus FinishCommand(const ViscaCommand& command);
+    size_t OutstandingCount() const { return pending_.size(); }
+
+private:
+    std::map<uint64_t, ViscaCommandStatus> pending_;
+    uint32_t generation_ = 0;
+    uint32_t nextSequence_ = 0;
+    bool needsReset_ = true;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// RFC 6455 framing for the camera event stream. WinHTTP frames the Windows
+// stream itself and only message reassembly is shared; the Linux backend
+// and the tests' stand-in server use all of it.
+enum class WebSocketOpcode : uint8_t
+{
+    Continuation = 0x0,
+    Text = 0x1,
+    Binary = 0x2,
+    Close = 0x8,
+    Ping = 0x9,
+    Pong = 0xA,
+};
+
+constexpr uint16_t kWebSocketCloseNormal = 1000;
+constexpr uint16_t kWebSocketCloseGoingAway = 1001;
+constexpr uint16_t kWebSocketCloseProtocolError = 1002;
+constexpr uint16_t kWebSocketCloseTooBig = 1009;
+// Reported for a Close frame without a code; never sent.
+constexpr uint16_t kWebSocketCloseNoStatus = 1005;
+
+struct WebSocketFrame
+{
+    WebSocketOpcode opcode = WebSocketOpcode::Text;
+    bool final = true;
+    bool masked = false;
+    // Unmasked.
+    std::string payload;
+};
+
+// Appends one frame to |out|. Clients mask every frame with a fresh
+// |maskKey|; servers pass nullptr.
+void AppendWebSocketFrame(std::string* out, WebSocketOpcode opcode, std::string_view payload, bool final,
+    const uint8_t* maskKey);
+
+// The Sec-WebSocket-Accept value a server answers |key| with.
+std::string ComputeWebSocketAccept(std::string_view key);
+
+// Codes an endpoint may put in a Close frame; 1005, 1006 and 1015 are
+// reserved for reporting and never sent.
+bool IsValidWebSocketCloseCode(uint16_t code);
+std::string BuildWebSocketClosePayload(uint16_t code, std::string_view reason);
+// An empty payload is kWebSocketCloseNoStatus. False for a one-byte
+// payload or a code that may not be sent.
+bool TryParseWebSocketClose(std::string_view payload, uint16_t* code, std::string* reason);
+
+// Cuts frames out of a byte stream as it arrives.
+class WebSocketFrameReader
+{
+public:
+    enum class Result
+    {
+        NeedMore,
+        Frame,
+        // The stream is unusable; close with the code Next() reported.
+        Error,
+    };
+
+    explicit WebSocketFrameReader(size_t maxPayload) : maxPayload_(maxPayload) {}
+
+    void Append(const char* data, size_t size);
+    Result Next(WebSocketFrame* frame, uint16_t* closeCode);
+
+private:
+    std::string buffer_;
+    size_t consumed_ = 0;
+    size_t maxPayload_;
+};
+
+// Joins the data frames of one message; control frames are the caller's.
+class WebSocketMessageAssembler
+{
+public:
+    enum class Result
+    {
+        Partial,
+        Text,
+        Binary,
+        // A continuation with no message started, or a new message before
+        // the last one finished.
+        ProtocolError,
+        TooBig,
+    };
+
+    explicit WebSocketMessageAssembler(size_t maxMessage) : maxMessage_(maxMessage) {}
+
+    bool InProgress() const { return inProgress_; }
+    Result Add(WebSocketOpcode opcode, bool final, std::string_view payload);
+    // The message Add() last completed; valid until the next Add().
+    const std::string& Message() const { return message_; }
+    void Reset();
+
+private:
+    std::string message_;
+    size_t maxMessage_;
+    bool inProgress_ = false;
+    bool complete_ = false;
+    bool binary_ = false;
+};
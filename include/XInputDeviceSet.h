@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// VID in the low word, PID in the high word; matches MAKELONG(vid, pid) and
+// the Data1 field of a DirectInput product GUID.
+constexpr uint32_t MakeVidPid(uint16_t vid, uint16_t pid)
+{
+    return static_cast<uint32_t>(vid) | (static_cast<uint32_t>(pid) << 16);
+}
+
+// Open-addressing set of VID/PID pairs; lookups touch one or two cache lines.
+class XInputDeviceSet
+{
+public:
+    void Insert(uint32_t vidPid);
+    bool Contains(uint32_t vidPid) const;
+    void Clear();
+    size_t Size() const { return count_ + (hasZero_ ? 1 : 0); }
+    std::vector<uint32_t> ToSortedVector() const;
+
+private:
+    size_t SlotFor(uint32_t vidPid) const;
+    void Rehash(size_t capacity);
+
+    // Zero marks an empty slot; a literal zero key is tracked separately.
+    std::vector<uint32_t> slots_;
+    size_t count_ = 0;
+    bool hasZero_ = false;
+};
+
+// Parses a PnP device ID such as "HID\VID_045E&PID_028E&IG_00\...". Only IDs
+// carrying the IG_ marker belong to XInput devices. VID_ and PID_ take one to
+// four hex digits of either case; a missing or malformed field reads as 0.
+bool TryGetXInputVidPid(const wchar_t* deviceId, uint32_t* outVidPid);
+
+std::wstring FormatVidPidList(const XInputDeviceSet& devices);
+bool TryParseVidPidList(const std::wstring& text, XInputDeviceSet* devices);
+
+// Order-independent FNV-1a digest of attached device paths, used to key the
+// persisted XInput device cache.
+std::wstring ComputeDeviceFingerprint(std::vector<std::wstring> devicePaths);
@@ -1,7 +1,18 @@
 #pragma once
 
+#include <cstdint>
+
+#ifdef _WIN32
 #include <Windows.h>
 
 HRESULT SetupForIsXInputDevice();
 bool IsXInputDevice(const GUID* productGuid);
+#else
+// Scans sysfs for controllers bound to the xpad driver or exposing an XInput
+// USB interface. Returns false when sysfs is unavailable. |sysfsRoot| stands
+// in for /sys, so tests can scan a tree of their own.
+bool SetupForIsXInputDevice(const char* sysfsRoot = "/sys");
+#endif
+
+bool IsXInputVidPid(uint32_t vidPid);
 void CleanupForIsXInputDevice();
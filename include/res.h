@@ -38,8 +38,13 @@
 #define IDC_CAMERA_LIST                 1049
 #define IDC_CAMERA_REFRESH              1050
 #define IDC_SETTINGS_BUTTON             1051
+#define IDC_CAMERA_SEARCH               1052
 #define IDC_SETTINGS_ADDRESS            2001
 #define IDC_SETTINGS_USERNAME           2002
 #define IDC_SETTINGS_PASSWORD           2003
 #define IDC_SETTINGS_USE_API_KEY        2004
 #define IDC_SETTINGS_API_KEY            2005
+// System menu commands keep their low four bits clear.
+#define IDM_SAVE_PIPELINE_TRACE         0x0010
+#define IDM_SAVE_FLIGHT_RECORDER        0x0020
+#define IDM_SHOW_TASK_POOL_STATS        0x0030
@@ -0,0 +1,537 @@
+#include "AsyncHttp.h"
+
+#include "FlightRecorder.h"
+#include "LogUtils.h"
+#include "PipelineTrace.h"
+#include "StringUtils.h"
+
+#include <vector>
+
+namespace {
+// Session defaults for requests that set no timeouts of their own.
+constexpr int kDefaultResolveTimeoutMs = 5000;
+constexpr int kDefaultConnectTimeoutMs = 5000;
+constexpr int kDefaultSendTimeoutMs = 10000;
+constexpr int kDefaultReceiveTimeoutMs = 15000;
+
+// When a request reached each phase, TraceNow() nanoseconds; 0 for phases
+// it never reached.
+struct HttpPhaseTimes
+{
+    uint64_t started = 0;
+    uint64_t connecting = 0;
+    uint64_t connected = 0;
+    uint64_t sent = 0;
+    uint64_t headers = 0;
+    uint64_t finished = 0;
+};
+
+// Everything one request needs while WinHTTP works on it. Owned by the
+// request handle: set as its context value and freed when WinHTTP reports
+// the handle closing.
+struct HttpOperation
+{
+    NetworkReactor* reactor = nullptr;
+    std::coroutine_handle<> waiter;
+    HttpResult* target = nullptr;
+    HINTERNET request = nullptr;
+    HttpRequest source;
+    HttpResult result;
+    std::vector<char> chunk;
+    // Registration with |source.cancellation|, 0 if there is none.
+    uint64_t cancelId = 0;
+    bool completed = false;
+    HttpPhaseTimes times;
+};
+
+std::wstring ExtractCookiePair(const std::wstring& setCookieHeader)
+{
+    const size_t end = setCookieHeader.find(L';');
+    if (end == std::wstring::npos)
+        return setCookieHeader;
+    return setCookieHeader.substr(0, end);
+}
+
+std::wstring JoinCookies(const std::vector<std::wstring>& cookies)
+{
+    std::wstring result;
+    for (size_t i = 0; i < cookies.size(); ++i)
+    {
+        if (i > 0)
+            result += L"; ";
+        result += cookies[i];
+    }
+    return result;
+}
+
+std::wstring ReadHeaderValue(HINTERNET request, DWORD query, const wchar_t* name)
+{
+    DWORD size = 0;
+    if (!WinHttpQueryHeaders(request, query, name, nullptr, &size, nullptr))
+    {
+        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+            return L"";
+    }
+
+    std::wstring buffer;
+    buffer.resize(size / sizeof(wchar_t));
+    if (!WinHttpQueryHeaders(request, query, name, buffer.data(), &size, nullptr))
+        return L"";
+
+    if (!buffer.empty() && buffer.back() == L'\0')
+        buffer.pop_back();
+    return buffer;
+}
+
+std::vector<std::wstring> ReadSetCookieHeaders(HINTERNET request)
+{
+    std::vector<std::wstring> cookies;
+    DWORD index = 0;
+
+    for (;;)
+    {
+        DWORD size = 0;
+        if (!WinHttpQueryHeaders(request, WINHTTP_QUERY_SET_COOKIE, WINHTTP_HEADER_NAME_BY_INDEX,
+            nullptr, &size, &index))
+        {
+            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+                break;
+        }
+
+        std::wstring buffer;
+        buffer.resize(size / sizeof(wchar_t));
+        if (!WinHttpQueryHeaders(request, WINHTTP_QUERY_SET_COOKIE, WINHTTP_HEADER_NAME_BY_INDEX,
+            buffer.data(), &size, &index))
+        {
+            break;
+        }
+
+        if (!buffer.empty() && buffer.back() == L'\0')
+            buffer.pop_back();
+
+        if (!buffer.empty())
+            cookies.push_back(ExtractCookiePair(buffer));
+    }
+
+    return cookies;
+}
+
+void ReadResponseHeaders(HINTERNET request, HttpResponse* response)
+{
+    DWORD statusSize = sizeof(response->status);
+    WinHttpQueryHeaders(request,
+        WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+        WINHTTP_HEADER_NAME_BY_INDEX,
+        &response->status,
+        &statusSize,
+        nullptr);
+
+    const auto cookies = ReadSetCookieHeaders(request);
+    if (!cookies.empty())
+        response->setCookieHeader = JoinCookies(cookies);
+
+    response->csrfToken = ReadHeaderValue(request, WINHTTP_QUERY_CUSTOM, L"X-CSRF-Token");
+}
+
+void RecordCancelled(HttpResult* result)
+{
+    result->hr = E_ABORT;
+    result->error = ERROR_WINHTTP_OPERATION_CANCELLED;
+    result->errorText = L"Cancelled";
+    result->cancelled = true;
+}
+
+void RecordFailure(HttpResult* result, DWORD error, const char* action)
+{
+    result->hr = E_FAIL;
+    result->error = error;
+    result->errorText = FormatWin32Error(error);
+    result->timedOut = (error == ERROR_WINHTTP_TIMEOUT);
+
+    std::string logLine = action;
+    logLine += " failed: ";
+    logLine += std::to_string(error);
+    if (!result->errorText.empty())
+    {
+        logLine += " ";
+        logLine += WideToUtf8(result->errorText);
+    }
+    AppendLogLine(logLine);
+}
+
+const char* DescribeAsyncApi(DWORD_PTR api)
+{
+    switch (api)
+    {
+    case API_SEND_REQUEST:
+        return "SendRequest";
+    case API_RECEIVE_RESPONSE:
+        return "ReceiveResponse";
+    case API_QUERY_DATA_AVAILABLE:
+        return "QueryDataAvailable";
+    case API_READ_DATA:
+        return "ReadData";
+    default:
+        return "WinHTTP call";
+    }
+}
+
+// One span for the request and one per phase it went through, under an id
+// of its own.
+void RecordHttpSpans(const HttpPhaseTimes& times)
+{
+    const uint64_t id = NextTraceId();
+    RecordTraceSpan(TraceStage::Request, times.started, times.finished, id);
+    if (times.connecting != 0 && times.connected != 0)
+        RecordTraceSpan(TraceStage::Connect, times.connecting, times.connected, id);
+    if (times.sent != 0)
+        RecordTraceSpan(TraceStage::Send, times.connected != 0 ? times.connected : times.started, times.sent, id);
+    if (times.headers != 0)
+    {
+        RecordTraceSpan(TraceStage::FirstByte, times.sent, times.headers, id);
+        RecordTraceSpan(TraceStage::Read, times.headers, times.finished, id);
+    }
+}
+
+// Hands the result to the awaiting coroutine on the reactor thread.
+void ResumeWaiter(HttpOperation* operation)
+{
+    operation->completed = true;
+    operation->times.finished = TraceNow();
+
+    // "METHOD path", built on the stack: this runs on WinHTTP's threads.
+    const HttpRequest& source = operation->source;
+    char text[sizeof(FlightRecord::text)];
+    size_t length = WideToUtf8Prefix(source.method, text, sizeof(text));
+    if (length < sizeof(text))
+        text[length++] = ' ';
+    length += WideToUtf8Prefix(source.path, text + length, sizeof(text) - length);
+    RecordFlightEvent(FlightEventType::Request, std::string_view(text, length),
+        static_cast<int32_t>(operation->result.response.status), static_cast<int32_t>(operation->result.error),
+        static_cast<int32_t>((operation->times.finished - operation->times.started) / 1000));
+    HttpResult* target = operation->target;
+    const std::coroutine_handle<> waiter = operation->waiter;
+    operation->reactor->Post(
+        [target, waiter, times = operation->times, result = std::move(operation->result)]() mutable
+    {
+        // Recorded here so the spans land on the reactor's trace rather
+        // than on WinHTTP's threads.
+        RecordHttpSpans(times);
+        *target = std::move(result);
+        waiter.resume();
+    });
+}
+
+// Resumes the waiter and closes the request; |operation| is freed by the
+// closing notification, so nothing may touch it afterwards.
+void CompleteOperation(HttpOperation* operation)
+{
+    if (operation->completed)
+        return;
+    ResumeWaiter(operation);
+
+    // A cancelled request's handle is closed by the cancelling thread.
+    const auto& cancellation = operation->source.cancellation;
+    if (!cancellation || cancellation->Unregister(operation->cancelId))
+        WinHttpCloseHandle(operation->request);
+}
+
+void FailOperation(HttpOperation* operation, DWORD error, const char* action)
+{
+    if (error == ERROR_WINHTTP_OPERATION_CANCELLED)
+        RecordCancelled(&operation->result);
+    else
+        RecordFailure(&operation->result, error, action);
+    CompleteOperation(operation);
+}
+
+void SetTimeoutOption(HINTERNET request, DWORD option, DWORD timeoutMs)
+{
+    if (timeoutMs != 0)
+        WinHttpSetOption(request, option, &timeoutMs, sizeof(timeoutMs));
+}
+
+void QueryNextChunk(HttpOperation* operation)
+{
+    if (!WinHttpQueryDataAvailable(operation->request, nullptr))
+        FailOperation(operation, GetLastError(), "QueryDataAvailable");
+}
+
+// Runs on WinHTTP's threads. Each step starts the next asynchronous call;
+// once a call is accepted its completion may already be running elsewhere.
+void CALLBACK AsyncHttpStatusCallback(
+    HINTERNET,
+    DWORD_PTR context,
+    DWORD status,
+    LPVOID statusInfo,
+    DWORD statusInfoLength)
+{
+    auto* operation = reinterpret_cast<HttpOperation*>(context);
+    if (!operation)
+        return;
+
+    switch (status)
+    {
+    case WINHTTP_CALLBACK_STATUS_SENDREQUEST_COMPLETE:
+        operation->times.sent = TraceNow();
+        if (!WinHttpReceiveResponse(operation->request, nullptr))
+            FailOperation(operation, GetLastError(), "ReceiveResponse");
+        break;
+
+    case WINHTTP_CALLBACK_STATUS_HEADERS_AVAILABLE:
+    {
+        operation->times.headers = TraceNow();
+        ReadResponseHeaders(operation->request, &operation->result.response);
+        DWORD protocol = 0;
+        DWORD protocolSize = sizeof(protocol);
+        if (operation->source.allowHttp2 &&
+            WinHttpQueryOption(operation->request, WINHTTP_OPTION_HTTP_PROTOCOL_USED, &protocol, &protocolSize))
+        {
+            operation->result.http2 = (protocol & WINHTTP_PROTOCOL_FLAG_HTTP2) != 0;
+        }
+        QueryNextChunk(operation);
+        break;
+    }
+
+    case WINHTTP_CALLBACK_STATUS_DATA_AVAILABLE:
+    {
+        const DWORD available = statusInfo ? *static_cast<DWORD*>(statusInfo) : 0;
+        if (available == 0)
+        {
+            CompleteOperation(operation);
+            break;
+        }
+        operation->chunk.resize(available);
+        if (!WinHttpReadData(operation->request, operation->chunk.data(), available, nullptr))
+            FailOperation(operation, GetLastError(), "ReadData");
+        break;
+    }
+
+    case WINHTTP_CALLBACK_STATUS_READ_COMPLETE:
+        if (statusInfoLength == 0)
+        {
+            CompleteOperation(operation);
+            break;
+        }
+        operation->result.body.append(operation->chunk.data(), statusInfoLength);
+        QueryNextChunk(operation);
+        break;
+
+    case WINHTTP_CALLBACK_STATUS_CONNECTING_TO_SERVER:
+        operation->times.connecting = TraceNow();
+        break;
+
+    case WINHTTP_CALLBACK_STATUS_CONNECTED_TO_SERVER:
+        operation->times.connected = TraceNow();
+        operation->result.newConnection = true;
+        break;
+
+    case WINHTTP_CALLBACK_STATUS_SECURE_FAILURE:
+        if (statusInfo && statusInfoLength >= sizeof(DWORD))
+            operation->result.secureFailureFlags = *static_cast<DWORD*>(statusInfo);
+        break;
+
+    case WINHTTP_CALLBACK_STATUS_REQUEST_ERROR:
+    {
+        const auto* asyncResult = static_cast<WINHTTP_ASYNC_RESULT*>(statusInfo);
+        FailOperation(operation, asyncResult->dwError, DescribeAsyncApi(asyncResult->dwResult));
+        break;
+    }
+
+    case WINHTTP_CALLBACK_STATUS_HANDLE_CLOSING:
+        // Closed by a cancellation before any step failed on its own.
+        if (!operation->completed)
+        {
+            RecordCancelled(&operation->result);
+            ResumeWaiter(operation);
+        }
+        delete operation;
+        break;
+    }
+}
+
+class HttpRequestAwaiter
+{
+public:
+    HttpRequestAwaiter(NetworkReactor& reactor, HINTERNET connection, HttpRequest request, HttpResult* result)
+        : reactor_(reactor),
+          connection_(connection),
+          request_(std::move(request)),
+          result_(result)
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    // Returns false, without suspending, when the request could not start.
+    bool await_suspend(std::coroutine_handle<> waiter)
+    {
+        HINTERNET request = WinHttpOpenRequest(
+            connection_,
+            request_.method.c_str(),
+            request_.path.c_str(),
+            nullptr,
+            WINHTTP_NO_REFERER,
+            WINHTTP_DEFAULT_ACCEPT_TYPES,
+            request_.secure ? WINHTTP_FLAG_SECURE : 0);
+        if (!request)
+        {
+            RecordFailure(result_, GetLastError(), "OpenRequest");
+            return false;
+        }
+
+        const HttpTimeouts& timeouts = request_.timeouts;
+        SetTimeoutOption(request, WINHTTP_OPTION_RESOLVE_TIMEOUT, timeouts.connectMs);
+        SetTimeoutOption(request, WINHTTP_OPTION_CONNECT_TIMEOUT, timeouts.connectMs);
+        SetTimeoutOption(request, WINHTTP_OPTION_SEND_TIMEOUT, timeouts.sendMs);
+        SetTimeoutOption(request, WINHTTP_OPTION_RECEIVE_RESPONSE_TIMEOUT, timeouts.receiveMs);
+        SetTimeoutOption(request, WINHTTP_OPTION_RECEIVE_TIMEOUT, timeouts.receiveMs);
+
+        // Windows versions without HTTP/2 reject the option and stay on 1.1.
+        if (request_.allowHttp2 && request_.secure)
+        {
+            DWORD protocols = WINHTTP_PROTOCOL_FLAG_HTTP2;
+            WinHttpSetOption(request, WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL, &protocols, sizeof(protocols));
+        }
+
+        auto* operation = new HttpOperation();
+        operation->reactor = &reactor_;
+        operation->waiter = waiter;
+        operation->target = result_;
+        operation->request = request;
+        operation->source = std::move(request_);
+        DWORD_PTR context = reinterpret_cast<DWORD_PTR>(operation);
+        WinHttpSetOption(request, WINHTTP_OPTION_CONTEXT_VALUE, &context, sizeof(context));
+
+        // Cancel() runs on this thread, so it cannot close the handle
+        // before WinHttpSendRequest below has taken it.
+        const auto& cancellation = operation->source.cancellation;
+        if (cancellation)
+        {
+            operation->cancelId = cancellation->Register([request]() { WinHttpCloseHandle(request); });
+            if (operation->cancelId == 0)
+            {
+                RecordCancelled(result_);
+                operation->completed = true;
+                WinHttpCloseHandle(request);
+                return false;
+            }
+        }
+
+        // The payload and headers live in |operation| until the handle closes.
+        const HttpRequest& source = operation->source;
+        const bool hasPayload = !source.payload.empty();
+        const DWORD payloadSize = hasPayload ? static_cast<DWORD>(source.payload.size()) : 0;
+        operation->times.started = TraceNow();
+        if (!WinHttpSendRequest(
+            request,
+            source.headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : source.headers.c_str(),
+            source.headers.empty() ? 0 : static_cast<DWORD>(-1L),
+            hasPayload ? const_cast<char*>(source.payload.data()) : WINHTTP_NO_REQUEST_DATA,
+            payloadSize,
+            payloadSize,
+            context))
+        {
+            RecordFailure(result_, GetLastError(), "SendRequest");
+            operation->completed = true;
+            if (cancellation)
+                cancellation->Unregister(operation->cancelId);
+            WinHttpCloseHandle(request);
+            return false;
+        }
+        return true;
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    NetworkReactor& reactor_;
+    HINTERNET connection_ = nullptr;
+    HttpRequest request_;
+    HttpResult* result_ = nullptr;
+};
+}
+
+HINTERNET OpenAsyncHttpSession()
+{
+    HINTERNET session = WinHttpOpen(
+        L"JoystickTesting/1.0",
+        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+        WINHTTP_NO_PROXY_NAME,
+        WINHTTP_NO_PROXY_BYPASS,
+        WINHTTP_FLAG_ASYNC);
+    if (!session)
+        return nullptr;
+
+    // Connection and request handles inherit the callback.
+    if (WinHttpSetStatusCallback(
+        session,
+        AsyncHttpStatusCallback,
+        WINHTTP_CALLBACK_FLAG_ALL_COMPLETIONS | WINHTTP_CALLBACK_FLAG_SECURE_FAILURE |
+            WINHTTP_CALLBACK_FLAG_HANDLES | WINHTTP_CALLBACK_FLAG_CONNECT_TO_SERVER,
+        0) == WINHTTP_INVALID_STATUS_CALLBACK)
+    {
+        WinHttpCloseHandle(session);
+        return nullptr;
+    }
+
+    WinHttpSetTimeouts(session, kDefaultResolveTimeoutMs, kDefaultConnectTimeoutMs, kDefaultSendTimeoutMs,
+        kDefaultReceiveTimeoutMs);
+
+    // Shave round trips off the handshakes that do happen. Both need a
+    // recent Windows; older ones reject the option and connect as before.
+    // Schannel resumes TLS sessions from its own cache.
+    BOOL enable = TRUE;
+    WinHttpSetOption(session, WINHTTP_OPTION_TCP_FAST_OPEN, &enable, sizeof(enable));
+    WinHttpSetOption(session, WINHTTP_OPTION_TLS_FALSE_START, &enable, sizeof(enable));
+    return session;
+}
+
+Task<HttpResult> SendHttpRequestAsync(NetworkReactor& reactor, HINTERNET connection, HttpRequest request)
+{
+    HttpResult result;
+    co_await HttpRequestAwaiter(reactor, connection, std::move(request), &result);
+    co_return result;
+}
+
+HttpTimeouts UniformHttpTimeouts(DWORD timeoutMs)
+{
+    HttpTimeouts timeouts;
+    timeouts.connectMs = timeoutMs;
+    timeouts.sendMs = timeoutMs;
+    timeouts.receiveMs = timeoutMs;
+    return timeouts;
+}
+
+std::wstring FormatWin32Error(DWORD error)
+{
+    if (error == 0)
+        return L"";
+
+    wchar_t* messageBuffer = nullptr;
+    const DWORD length = FormatMessageW(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+        nullptr,
+        error,
+        0,
+        reinterpret_cast<LPWSTR>(&messageBuffer),
+        0,
+        nullptr);
+
+    if (length == 0 || !messageBuffer)
+        return L"";
+
+    std::wstring message(messageBuffer, length);
+    LocalFree(messageBuffer);
+
+    while (!message.empty())
+    {
+        const wchar_t ch = message.back();
+        if (ch == L'\r' || ch == L'\n')
+            message.pop_back();
+        else
+            break;
+    }
+
+    return message;
+}
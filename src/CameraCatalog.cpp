@@ -0,0 +1,168 @@
+#include "CameraCatalog.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// Strings are packed into blocks of this size; longer ones get their own.
+constexpr size_t kArenaBlockSize = 16 * 1024;
+}
+
+// Blocks are never moved or freed while the catalog or any snapshot holds
+// the arena, so views into them stay valid.
+struct CameraCatalog::Arena
+{
+    std::vector<std::unique_ptr<char[]>> blocks;
+    // Strings too long to pack, one allocation each.
+    std::vector<std::unique_ptr<char[]>> large;
+    size_t blockUsed = kArenaBlockSize;
+    size_t bytes = 0;
+};
+
+const CameraRecord* CameraCatalogSnapshot::Find(CameraHandle handle) const
+{
+    const auto it = std::lower_bound(byHandle_.begin(), byHandle_.end(), std::make_pair(handle, uint32_t{ 0 }));
+    if (it == byHandle_.end() || it->first != handle)
+        return nullptr;
+    return &cameras_[it->second];
+}
+
+void CameraCatalogSnapshot::IndexHandles()
+{
+    byHandle_.clear();
+    byHandle_.reserve(cameras_.size());
+    for (size_t i = 0; i < cameras_.size(); ++i)
+        byHandle_.emplace_back(cameras_[i].handle, static_cast<uint32_t>(i));
+    std::sort(byHandle_.begin(), byHandle_.end());
+}
+
+CameraCatalog::CameraCatalog()
+    : arena_(std::make_shared<Arena>())
+{
+}
+
+std::string_view CameraCatalog::Store(std::string_view text)
+{
+    if (text.empty())
+        return {};
+    const auto existing = strings_.find(text);
+    if (existing != strings_.end())
+        return *existing;
+
+    Arena& arena = *arena_;
+    char* target = nullptr;
+    if (text.size() > kArenaBlockSize / 4)
+    {
+        arena.large.push_back(std::make_unique<char[]>(text.size()));
+        target = arena.large.back().get();
+    }
+    else
+    {
+        if (arena.blockUsed + text.size() > kArenaBlockSize)
+        {
+            arena.blocks.push_back(std::make_unique<char[]>(kArenaBlockSize));
+            arena.blockUsed = 0;
+        }
+        target = arena.blocks.back().get() + arena.blockUsed;
+        arena.blockUsed += text.size();
+    }
+    memcpy(target, text.data(), text.size());
+    arena.bytes += text.size();
+
+    const std::string_view stored(target, text.size());
+    strings_.insert(stored);
+    return stored;
+}
+
+CameraHandle CameraCatalog::Intern(std::string_view id)
+{
+    const auto existing = handles_.find(id);
+    if (existing != handles_.end())
+        return existing->second;
+
+    const std::string_view stored = Store(id);
+    ids_.push_back(stored);
+    const CameraHandle handle = static_cast<CameraHandle>(ids_.size());
+    handles_.emplace(stored, handle);
+    return handle;
+}
+
+CameraHandle CameraCatalog::Find(std::string_view id) const
+{
+    const auto existing = handles_.find(id);
+    return existing != handles_.end() ? existing->second : kNoCamera;
+}
+
+std::string_view CameraCatalog::IdOf(CameraHandle handle) const
+{
+    if (handle == kNoCamera || handle > ids_.size())
+        return {};
+    return ids_[handle - 1];
+}
+
+CameraRecord CameraCatalog::MakeRecord(const CameraInfo& camera)
+{
+    CameraRecord record;
+    record.handle = Intern(camera.id);
+    record.id = IdOf(record.handle);
+    record.name = Store(camera.name);
+    record.state = Store(camera.state);
+    record.hasReturnHome = camera.hasReturnHome;
+    record.returnHomeDisabled = camera.returnHomeDisabled;
+    return record;
+}
+
+std::shared_ptr<CameraCatalogSnapshot> CameraCatalog::NewSnapshot() const
+{
+    auto snapshot = std::make_shared<CameraCatalogSnapshot>();
+    snapshot->arena_ = arena_;
+    return snapshot;
+}
+
+std::shared_ptr<const CameraCatalogSnapshot> CameraCatalog::BuildSnapshot(const std::vector<CameraInfo>& cameras)
+{
+    auto snapshot = NewSnapshot();
+    snapshot->cameras_.reserve(cameras.size());
+    for (const auto& camera : cameras)
+        snapshot->cameras_.push_back(MakeRecord(camera));
+    snapshot->IndexHandles();
+    return snapshot;
+}
+
+std::shared_ptr<const CameraCatalogSnapshot> CameraCatalog::WithCamera(const CameraCatalogSnapshot& base,
+    const CameraInfo& camera)
+{
+    auto snapshot = NewSnapshot();
+    snapshot->cameras_ = base.cameras_;
+    const CameraRecord record = MakeRecord(camera);
+    auto it = std::find_if(snapshot->cameras_.begin(), snapshot->cameras_.end(),
+        [&](const CameraRecord& existing) { return existing.handle == record.handle; });
+    if (it != snapshot->cameras_.end())
+    {
+        *it = record;
+        snapshot->byHandle_ = base.byHandle_;
+        return snapshot;
+    }
+    snapshot->cameras_.push_back(record);
+    snapshot->IndexHandles();
+    return snapshot;
+}
+
+std::shared_ptr<const CameraCatalogSnapshot> CameraCatalog::WithoutCamera(const CameraCatalogSnapshot& base,
+    CameraHandle handle)
+{
+    auto snapshot = NewSnapshot();
+    snapshot->cameras_.reserve(base.cameras_.size());
+    for (const auto& camera : base.cameras_)
+    {
+        if (camera.handle != handle)
+            snapshot->cameras_.push_back(camera);
+    }
+    snapshot->IndexHandles();
+    return snapshot;
+}
+
+size_t CameraCatalog::ArenaBytes() const
+{
+    return arena_->bytes;
+}
@@ -0,0 +1,294 @@
+#include "CameraEventStream.h"
+
+#include "LogUtils.h"
+#include "WebSocketFrame.h"
+
+#include <Windows.h>
+#include <winhttp.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+constexpr DWORD kReceiveBufferSize = 4096;
+constexpr DWORD kSwitchingProtocols = 101;
+
+struct CameraEventStreamState
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread thread;
+    bool stopRequested = false;
+    HINTERNET session = nullptr;
+    // Handles of the attempt in flight; StopCameraEventStream closes them to
+    // unblock a pending send or receive.
+    HINTERNET connection = nullptr;
+    HINTERNET request = nullptr;
+    HINTERNET webSocket = nullptr;
+    CameraEventEndpointProvider provider;
+    CameraEventConnectedCallback onConnected;
+    CameraEventMessageCallback onMessage;
+};
+
+CameraEventStreamState& GetStreamState()
+{
+    static CameraEventStreamState state;
+    return state;
+}
+
+void CloseInternetHandle(HINTERNET* handle)
+{
+    if (*handle)
+    {
+        WinHttpCloseHandle(*handle);
+        *handle = nullptr;
+    }
+}
+
+void CloseConnection(CameraEventStreamState& state)
+{
+    std::scoped_lock lock(state.mutex);
+    CloseInternetHandle(&state.webSocket);
+    CloseInternetHandle(&state.request);
+    CloseInternetHandle(&state.connection);
+}
+
+void LogStreamError(const char* action, DWORD error)
+{
+    AppendLogLine(std::string("Event stream ") + action + " failed: " + std::to_string(error));
+}
+
+// Publishes |handle| for StopCameraEventStream; fails once a stop is pending.
+bool PublishHandle(CameraEventStreamState& state, HINTERNET* slot, HINTERNET handle)
+{
+    std::scoped_lock lock(state.mutex);
+    if (state.stopRequested)
+    {
+        WinHttpCloseHandle(handle);
+        return false;
+    }
+    *slot = handle;
+    return true;
+}
+
+HINTERNET ConnectWebSocket(CameraEventStreamState& state, const CameraEventStreamEndpoint& endpoint)
+{
+    if (!state.session)
+    {
+        state.session = WinHttpOpen(
+            L"JoystickTesting/1.0",
+            WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+            WINHTTP_NO_PROXY_NAME,
+            WINHTTP_NO_PROXY_BYPASS,
+            0);
+        if (!state.session)
+        {
+            LogStreamError("session", GetLastError());
+            return nullptr;
+        }
+    }
+
+    HINTERNET connection = WinHttpConnect(state.session, endpoint.host.c_str(), endpoint.port, 0);
+    if (!connection)
+    {
+        LogStreamError("connect", GetLastError());
+        return nullptr;
+    }
+    if (!PublishHandle(state, &state.connection, connection))
+        return nullptr;
+
+    HINTERNET request = WinHttpOpenRequest(
+        connection,
+        L"GET",
+        endpoint.path.c_str(),
+        nullptr,
+        WINHTTP_NO_REFERER,
+        WINHTTP_DEFAULT_ACCEPT_TYPES,
+        endpoint.secure ? WINHTTP_FLAG_SECURE : 0);
+    if (!request)
+    {
+        LogStreamError("open request", GetLastError());
+        return nullptr;
+    }
+    if (!PublishHandle(state, &state.request, request))
+        return nullptr;
+
+    if (!WinHttpSetOption(request, WINHTTP_OPTION_UPGRADE_TO_WEB_SOCKET, nullptr, 0))
+    {
+        LogStreamError("upgrade option", GetLastError());
+        return nullptr;
+    }
+
+    const wchar_t* headers = endpoint.headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : endpoint.headers.c_str();
+    if (!WinHttpSendRequest(request, headers, static_cast<DWORD>(-1L), WINHTTP_NO_REQUEST_DATA, 0, 0, 0))
+    {
+        LogStreamError("send", GetLastError());
+        return nullptr;
+    }
+    if (!WinHttpReceiveResponse(request, nullptr))
+    {
+        LogStreamError("receive response", GetLastError());
+        return nullptr;
+    }
+
+    DWORD status = 0;
+    DWORD statusSize = sizeof(status);
+    WinHttpQueryHeaders(request,
+        WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+        WINHTTP_HEADER_NAME_BY_INDEX,
+        &status,
+        &statusSize,
+        WINHTTP_NO_HEADER_INDEX);
+    if (status != kSwitchingProtocols)
+    {
+        AppendLogLine("Event stream upgrade refused: HTTP " + std::to_string(status));
+        return nullptr;
+    }
+
+    HINTERNET webSocket = WinHttpWebSocketCompleteUpgrade(request, 0);
+    if (!webSocket)
+    {
+        LogStreamError("upgrade", GetLastError());
+        return nullptr;
+    }
+
+    {
+        std::scoped_lock lock(state.mutex);
+        CloseInternetHandle(&state.request);
+    }
+    if (!PublishHandle(state, &state.webSocket, webSocket))
+        return nullptr;
+    return webSocket;
+}
+
+void LogCloseStatus(HINTERNET webSocket)
+{
+    USHORT code = 0;
+    char reason[WINHTTP_WEB_SOCKET_MAX_CLOSE_REASON_LENGTH] = {};
+    DWORD reasonSize = 0;
+    if (WinHttpWebSocketQueryCloseStatus(webSocket, &code, reason, sizeof(reason), &reasonSize) != ERROR_SUCCESS)
+        return;
+    std::string line = "Event stream closed by server: " + std::to_string(code);
+    if (reasonSize > 0)
+        line += " (" + std::string(reason, reasonSize) + ")";
+    AppendLogLine(line);
+}
+
+void ReceiveMessages(CameraEventStreamState& state, HINTERNET webSocket)
+{
+    // WinHTTP unmasks and answers pings; fragments still arrive one buffer
+    // at a time.
+    WebSocketMessageAssembler assembler(kMaxCameraEventMessage);
+    char buffer[kReceiveBufferSize];
+    for (;;)
+    {
+        DWORD bytesRead = 0;
+        WINHTTP_WEB_SOCKET_BUFFER_TYPE type = WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE;
+        const DWORD error = WinHttpWebSocketReceive(webSocket, buffer, sizeof(buffer), &bytesRead, &type);
+        if (error != ERROR_SUCCESS)
+        {
+            std::scoped_lock lock(state.mutex);
+            if (!state.stopRequested)
+                LogStreamError("receive", error);
+            return;
+        }
+
+        if (type == WINHTTP_WEB_SOCKET_CLOSE_BUFFER_TYPE)
+        {
+            LogCloseStatus(webSocket);
+            return;
+        }
+
+        const bool binary = type == WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE ||
+            type == WINHTTP_WEB_SOCKET_BINARY_FRAGMENT_BUFFER_TYPE;
+        const bool final = type == WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE ||
+            type == WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE;
+        const WebSocketOpcode opcode = assembler.InProgress()
+            ? WebSocketOpcode::Continuation
+            : (binary ? WebSocketOpcode::Binary : WebSocketOpcode::Text);
+        const auto result = assembler.Add(opcode, final, std::string_view(buffer, bytesRead));
+        if (result == WebSocketMessageAssembler::Result::TooBig)
+        {
+            AppendLogLine("Event stream message too large; reconnecting");
+            WinHttpWebSocketClose(webSocket, kWebSocketCloseTooBig, nullptr, 0);
+            return;
+        }
+        if (result == WebSocketMessageAssembler::Result::Text && state.onMessage)
+            state.onMessage(assembler.Message());
+    }
+}
+
+void RunCameraEventStream()
+{
+    CameraEventStreamState& state = GetStreamState();
+    ReconnectBackoff backoff;
+    bool connectedBefore = false;
+
+    for (;;)
+    {
+        CameraEventStreamEndpoint endpoint;
+        const bool hasEndpoint = state.provider && state.provider(&endpoint);
+        if (hasEndpoint)
+        {
+            if (HINTERNET webSocket = ConnectWebSocket(state, endpoint))
+            {
+                AppendLogLine(connectedBefore ? "Event stream reconnected" : "Event stream connected");
+                if (state.onConnected)
+                    state.onConnected(connectedBefore);
+                connectedBefore = true;
+                backoff.Reset();
+                ReceiveMessages(state, webSocket);
+            }
+            CloseConnection(state);
+        }
+
+        std::unique_lock lock(state.mutex);
+        if (state.cv.wait_for(lock, backoff.Current(), [&]() { return state.stopRequested; }))
+            break;
+
+        // Waiting for login polls at the base rate; failed attempts back off.
+        if (hasEndpoint)
+            backoff.Grow();
+    }
+}
+}
+
+void StartCameraEventStream(CameraEventEndpointProvider provider,
+    CameraEventConnectedCallback onConnected,
+    CameraEventMessageCallback onMessage)
+{
+    CameraEventStreamState& state = GetStreamState();
+    std::scoped_lock lock(state.mutex);
+    if (state.thread.joinable())
+        return;
+
+    state.stopRequested = false;
+    state.provider = std::move(provider);
+    state.onConnected = std::move(onConnected);
+    state.onMessage = std::move(onMessage);
+    state.thread = std::thread(RunCameraEventStream);
+}
+
+void StopCameraEventStream()
+{
+    CameraEventStreamState& state = GetStreamState();
+    {
+        std::scoped_lock lock(state.mutex);
+        if (!state.thread.joinable())
+            return;
+        state.stopRequested = true;
+        CloseInternetHandle(&state.webSocket);
+        CloseInternetHandle(&state.request);
+        CloseInternetHandle(&state.connection);
+    }
+    state.cv.notify_all();
+    state.thread.join();
+
+    std::scoped_lock lock(state.mutex);
+    CloseInternetHandle(&state.session);
+    state.provider = nullptr;
+    state.onConnected = nullptr;
+    state.onMessage = nullptr;
+}
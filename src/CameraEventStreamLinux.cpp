@@ -0,0 +1,402 @@
+#include "CameraEventStream.h"
+
+#include "LogUtils.h"
+#include "OnvifSoap.h"
+#include "StringUtils.h"
+#include "WebSocketFrame.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+namespace {
+constexpr int kHandshakeTimeoutMs = 5000;
+constexpr size_t kMaxHandshakeSize = 16 * 1024;
+constexpr size_t kReceiveBufferSize = 4096;
+constexpr int kSwitchingProtocols = 101;
+
+struct CameraEventStreamState
+{
+    std::thread thread;
+    // Readable once StopCameraEventStream is called; every wait polls it.
+    int stopFd = -1;
+    CameraEventEndpointProvider provider;
+    CameraEventConnectedCallback onConnected;
+    CameraEventMessageCallback onMessage;
+    ReconnectBackoff backoff;
+    std::random_device random;
+};
+
+CameraEventStreamState& GetStreamState()
+{
+    static CameraEventStreamState state;
+    return state;
+}
+
+enum class WaitResult
+{
+    Ready,
+    TimedOut,
+    Stopped,
+};
+
+// Waits for |events| on |fd|, or for the stop signal alone when |fd| is -1.
+WaitResult WaitFor(CameraEventStreamState& state, int fd, short events, int timeoutMs)
+{
+    pollfd fds[2] = {};
+    fds[0].fd = state.stopFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = fd;
+    fds[1].events = events;
+    const int ready = poll(fds, fd >= 0 ? 2 : 1, timeoutMs);
+    if (ready < 0 || (fds[0].revents & POLLIN))
+        return WaitResult::Stopped;
+    return ready == 0 ? WaitResult::TimedOut : WaitResult::Ready;
+}
+
+void LogStreamError(const char* action, int error)
+{
+    AppendLogLine(std::string("Event stream ") + action + " failed: " + std::to_string(error));
+}
+
+int ConnectSocket(CameraEventStreamState& state, const CameraEventStreamEndpoint& endpoint)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    const std::string host = WideToUtf8(endpoint.host);
+    const int resolved = getaddrinfo(host.c_str(), std::to_string(endpoint.port).c_str(), &hints, &addresses);
+    if (resolved != 0)
+    {
+        AppendLogLine("Event stream resolve failed for " + host + ": " + gai_strerror(resolved));
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo* address = addresses; address && fd < 0; address = address->ai_next)
+    {
+        fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, address->ai_protocol);
+        if (fd < 0)
+            continue;
+        // Non-blocking only for the connect, so a stop does not wait it out.
+        bool connected = connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+        if (!connected && errno == EINPROGRESS &&
+            WaitFor(state, fd, POLLOUT, kHandshakeTimeoutMs) == WaitResult::Ready)
+        {
+            int error = 0;
+            socklen_t size = sizeof(error);
+            connected = getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &size) == 0 && error == 0;
+        }
+        if (!connected)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0)
+    {
+        LogStreamError("connect", errno);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    const int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return fd;
+}
+
+bool SendAll(int fd, std::string_view data)
+{
+    while (!data.empty())
+    {
+        const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent <= 0)
+            return false;
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+// Client frames are always masked, each with a key of its own.
+bool SendFrame(CameraEventStreamState& state, int fd, WebSocketOpcode opcode, std::string_view payload)
+{
+    const uint32_t key = state.random();
+    const uint8_t maskKey[4] = { static_cast<uint8_t>(key), static_cast<uint8_t>(key >> 8),
+        static_cast<uint8_t>(key >> 16), static_cast<uint8_t>(key >> 24) };
+    std::string frame;
+    AppendWebSocketFrame(&frame, opcode, payload, true, maskKey);
+    return SendAll(fd, frame);
+}
+
+void SendClose(CameraEventStreamState& state, int fd, uint16_t code)
+{
+    SendFrame(state, fd, WebSocketOpcode::Close, BuildWebSocketClosePayload(code, ""));
+}
+
+// The value of response header |name|; the names are case-insensitive.
+std::string FindHeader(const std::string& head, std::string_view name)
+{
+    size_t lineStart = head.find("\r\n");
+    while (lineStart != std::string::npos)
+    {
+        lineStart += 2;
+        const size_t lineEnd = head.find("\r\n", lineStart);
+        const size_t colon = head.find(':', lineStart);
+        if (colon != std::string::npos && colon < lineEnd && colon - lineStart == name.size() &&
+            strncasecmp(head.data() + lineStart, name.data(), name.size()) == 0)
+        {
+            const size_t valueStart = head.find_first_not_of(' ', colon + 1);
+            const size_t valueEnd = head.find_last_not_of(' ', lineEnd - 1);
+            return valueStart > valueEnd ? std::string() : head.substr(valueStart, valueEnd - valueStart + 1);
+        }
+        lineStart = lineEnd;
+    }
+    return {};
+}
+
+// Sends the upgrade request and checks the 101 answer; bytes the server
+// sent after it go to |reader|.
+bool UpgradeConnection(CameraEventStreamState& state, int fd, const CameraEventStreamEndpoint& endpoint,
+    WebSocketFrameReader* reader)
+{
+    uint8_t keyBytes[16] = {};
+    for (uint8_t& byte : keyBytes)
+        byte = static_cast<uint8_t>(state.random());
+    const std::string key = EncodeBase64(keyBytes, sizeof(keyBytes));
+
+    const std::string request = "GET " + WideToUtf8(endpoint.path) + " HTTP/1.1\r\n"
+        "Host: " + WideToUtf8(endpoint.host) + ":" + std::to_string(endpoint.port) + "\r\n"
+        "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: " + key + "\r\nSec-WebSocket-Version: 13\r\n" + WideToUtf8(endpoint.headers) + "\r\n";
+    if (!SendAll(fd, request))
+    {
+        LogStreamError("send", errno);
+        return false;
+    }
+
+    std::string response;
+    size_t headEnd = std::string::npos;
+    while ((headEnd = response.find("\r\n\r\n")) == std::string::npos)
+    {
+        char buffer[kReceiveBufferSize];
+        if (response.size() > kMaxHandshakeSize ||
+            WaitFor(state, fd, POLLIN, kHandshakeTimeoutMs) != WaitResult::Ready)
+        {
+            AppendLogLine("Event stream upgrade timed out");
+            return false;
+        }
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            LogStreamError("receive response", received < 0 ? errno : 0);
+            return false;
+        }
+        response.append(buffer, static_cast<size_t>(received));
+    }
+
+    const std::string head = response.substr(0, headEnd);
+    const size_t statusStart = head.find(' ');
+    const int status = statusStart == std::string::npos ? 0 : atoi(head.c_str() + statusStart + 1);
+    if (status != kSwitchingProtocols)
+    {
+        AppendLogLine("Event stream upgrade refused: HTTP " + std::to_string(status));
+        return false;
+    }
+    if (FindHeader(head, "Sec-WebSocket-Accept") != ComputeWebSocketAccept(key))
+    {
+        AppendLogLine("Event stream upgrade refused: bad Sec-WebSocket-Accept");
+        return false;
+    }
+
+    reader->Append(response.data() + headEnd + 4, response.size() - headEnd - 4);
+    return true;
+}
+
+// Handles one frame; false once the connection is finished with.
+bool HandleFrame(CameraEventStreamState& state, int fd, const WebSocketFrame& frame,
+    WebSocketMessageAssembler& assembler)
+{
+    // Servers never mask.
+    if (frame.masked)
+    {
+        AppendLogLine("Event stream protocol error: masked frame from server");
+        SendClose(state, fd, kWebSocketCloseProtocolError);
+        return false;
+    }
+
+    switch (frame.opcode)
+    {
+    case WebSocketOpcode::Ping:
+        return SendFrame(state, fd, WebSocketOpcode::Pong, frame.payload);
+    case WebSocketOpcode::Pong:
+        return true;
+    case WebSocketOpcode::Close:
+    {
+        uint16_t code = 0;
+        std::string reason;
+        if (!TryParseWebSocketClose(frame.payload, &code, &reason))
+        {
+            AppendLogLine("Event stream protocol error: bad close frame");
+            SendClose(state, fd, kWebSocketCloseProtocolError);
+            return false;
+        }
+        AppendLogLine("Event stream closed by server: " + std::to_string(code) +
+            (reason.empty() ? std::string() : " (" + reason + ")"));
+        // Echo the code back; a close without one is answered the same way.
+        SendFrame(state, fd, WebSocketOpcode::Close,
+            code == kWebSocketCloseNoStatus ? std::string() : BuildWebSocketClosePayload(code, ""));
+        return false;
+    }
+    default:
+        break;
+    }
+
+    switch (assembler.Add(frame.opcode, frame.final, frame.payload))
+    {
+    case WebSocketMessageAssembler::Result::ProtocolError:
+        AppendLogLine("Event stream protocol error: unexpected fragment");
+        SendClose(state, fd, kWebSocketCloseProtocolError);
+        return false;
+    case WebSocketMessageAssembler::Result::TooBig:
+        AppendLogLine("Event stream message too large; reconnecting");
+        SendClose(state, fd, kWebSocketCloseTooBig);
+        return false;
+    case WebSocketMessageAssembler::Result::Text:
+        if (state.onMessage)
+            state.onMessage(assembler.Message());
+        return true;
+    default:
+        return true;
+    }
+}
+
+void ReceiveMessages(CameraEventStreamState& state, int fd, WebSocketFrameReader& reader)
+{
+    WebSocketMessageAssembler assembler(kMaxCameraEventMessage);
+    WebSocketFrame frame;
+    for (;;)
+    {
+        uint16_t closeCode = 0;
+        WebSocketFrameReader::Result result;
+        while ((result = reader.Next(&frame, &closeCode)) == WebSocketFrameReader::Result::Frame)
+        {
+            if (!HandleFrame(state, fd, frame, assembler))
+                return;
+        }
+        if (result == WebSocketFrameReader::Result::Error)
+        {
+            AppendLogLine("Event stream protocol error: bad frame, closing with " + std::to_string(closeCode));
+            SendClose(state, fd, closeCode);
+            return;
+        }
+
+        if (WaitFor(state, fd, POLLIN, -1) == WaitResult::Stopped)
+        {
+            SendClose(state, fd, kWebSocketCloseGoingAway);
+            return;
+        }
+        char buffer[kReceiveBufferSize];
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            LogStreamError("receive", received < 0 ? errno : 0);
+            return;
+        }
+        reader.Append(buffer, static_cast<size_t>(received));
+    }
+}
+
+void RunCameraEventStream()
+{
+    CameraEventStreamState& state = GetStreamState();
+    bool connectedBefore = false;
+
+    for (;;)
+    {
+        CameraEventStreamEndpoint endpoint;
+        const bool hasEndpoint = state.provider && state.provider(&endpoint);
+        if (hasEndpoint && endpoint.secure)
+        {
+            AppendLogLine("Event stream: wss:// needs the Windows build");
+        }
+        else if (hasEndpoint)
+        {
+            const int fd = ConnectSocket(state, endpoint);
+            WebSocketFrameReader reader(kMaxCameraEventMessage);
+            if (fd >= 0 && UpgradeConnection(state, fd, endpoint, &reader))
+            {
+                AppendLogLine(connectedBefore ? "Event stream reconnected" : "Event stream connected");
+                if (state.onConnected)
+                    state.onConnected(connectedBefore);
+                connectedBefore = true;
+                state.backoff.Reset();
+                ReceiveMessages(state, fd, reader);
+            }
+            if (fd >= 0)
+                close(fd);
+        }
+
+        const int backoffMs = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(state.backoff.Current()).count());
+        if (WaitFor(state, -1, 0, backoffMs) == WaitResult::Stopped)
+            break;
+
+        // Waiting for login polls at the base rate; failed attempts back off.
+        if (hasEndpoint)
+            state.backoff.Grow();
+    }
+}
+}
+
+void StartCameraEventStream(CameraEventEndpointProvider provider,
+    CameraEventConnectedCallback onConnected,
+    CameraEventMessageCallback onMessage,
+    ReconnectBackoff backoff)
+{
+    CameraEventStreamState& state = GetStreamState();
+    if (state.thread.joinable())
+        return;
+
+    state.stopFd = eventfd(0, EFD_CLOEXEC);
+    if (state.stopFd < 0)
+    {
+        LogStreamError("eventfd", errno);
+        return;
+    }
+    state.provider = std::move(provider);
+    state.onConnected = std::move(onConnected);
+    state.onMessage = std::move(onMessage);
+    state.backoff = backoff;
+    state.thread = std::thread(RunCameraEventStream);
+}
+
+void StopCameraEventStream()
+{
+    CameraEventStreamState& state = GetStreamState();
+    if (!state.thread.joinable())
+        return;
+
+    const uint64_t one = 1;
+    if (write(state.stopFd, &one, sizeof(one)) != sizeof(one))
+        LogStreamError("stop", errno);
+    state.thread.join();
+
+    close(state.stopFd);
+    state.stopFd = -1;
+    state.provider = nullptr;
+    state.onConnected = nullptr;
+    state.onMessage = nullptr;
+}
@@ -0,0 +1,210 @@
+#include "CameraSearch.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr size_t kKeyLength = 3;
+
+void AppendLowered(std::string_view text, std::string* out)
+{
+    for (const char c : text)
+        out->push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c);
+}
+
+uint32_t PackKey(const char* text)
+{
+    return (static_cast<uint32_t>(static_cast<unsigned char>(text[0])) << 16) |
+        (static_cast<uint32_t>(static_cast<unsigned char>(text[1])) << 8) |
+        static_cast<uint32_t>(static_cast<unsigned char>(text[2]));
+}
+
+// Runs across a field separator never match a query, so are not indexed.
+bool SpansFields(const char* text)
+{
+    return text[0] == '\n' || text[1] == '\n' || text[2] == '\n';
+}
+}
+
+void CameraSearchIndex::Build(std::shared_ptr<const CameraCatalogSnapshot> cameras)
+{
+    cameras_ = std::move(cameras);
+    text_.clear();
+    textOffsets_.clear();
+    nameLengths_.clear();
+    keys_.clear();
+    postingOffsets_.clear();
+    postings_.clear();
+    lastQuery_.clear();
+    hasResults_ = false;
+    results_.clear();
+    prefixMatches_ = 0;
+    if (!cameras_)
+        return;
+
+    const auto& records = cameras_->Cameras();
+    textOffsets_.reserve(records.size() + 1);
+    nameLengths_.reserve(records.size());
+    textOffsets_.push_back(0);
+    for (const auto& camera : records)
+    {
+        const std::string_view name = camera.name.empty() ? camera.id : camera.name;
+        AppendLowered(name, &text_);
+        text_ += '\n';
+        AppendLowered(camera.id, &text_);
+        text_ += '\n';
+        AppendLowered(camera.state, &text_);
+        nameLengths_.push_back(static_cast<uint32_t>(name.size()));
+        textOffsets_.push_back(static_cast<uint32_t>(text_.size()));
+    }
+
+    // (key, row) pairs in row order; a stable radix sort on the key, one
+    // byte at a time, leaves each key's rows ascending.
+    std::vector<std::pair<uint32_t, uint32_t>> entries;
+    std::vector<uint32_t> rowKeys;
+    for (uint32_t row = 0; row < records.size(); ++row)
+    {
+        const std::string_view text = RowText(row);
+        rowKeys.clear();
+        for (size_t i = 0; i + kKeyLength <= text.size(); ++i)
+        {
+            if (!SpansFields(text.data() + i))
+                rowKeys.push_back(PackKey(text.data() + i));
+        }
+        std::sort(rowKeys.begin(), rowKeys.end());
+        rowKeys.erase(std::unique(rowKeys.begin(), rowKeys.end()), rowKeys.end());
+        for (const uint32_t key : rowKeys)
+            entries.emplace_back(key, row);
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> sorted(entries.size());
+    for (uint32_t shift = 0; shift < kKeyLength * 8; shift += 8)
+    {
+        size_t counts[257] = {};
+        for (const auto& entry : entries)
+            ++counts[((entry.first >> shift) & 0xFF) + 1];
+        for (size_t i = 1; i < 257; ++i)
+            counts[i] += counts[i - 1];
+        for (const auto& entry : entries)
+            sorted[counts[(entry.first >> shift) & 0xFF]++] = entry;
+        entries.swap(sorted);
+    }
+
+    postings_.reserve(entries.size());
+    for (const auto& [key, row] : entries)
+    {
+        if (keys_.empty() || keys_.back() != key)
+        {
+            keys_.push_back(key);
+            postingOffsets_.push_back(static_cast<uint32_t>(postings_.size()));
+        }
+        postings_.push_back(row);
+    }
+    postingOffsets_.push_back(static_cast<uint32_t>(postings_.size()));
+}
+
+const std::vector<uint32_t>& CameraSearchIndex::Search(std::string_view query)
+{
+    std::string lowered;
+    AppendLowered(query, &lowered);
+    if (hasResults_ && lowered == lastQuery_)
+        return results_;
+
+    std::vector<uint32_t> candidates;
+    if (lowered.find('\n') != std::string::npos)
+    {
+        // The fields' separator; nothing shown in the list contains it.
+    }
+    else if (hasResults_ && !lastQuery_.empty() && lowered.find(lastQuery_) != std::string::npos)
+    {
+        // Whatever contains the new query contains the previous one.
+        // Back into list order: both groups of them are already ascending.
+        candidates = std::move(results_);
+        std::inplace_merge(candidates.begin(), candidates.begin() + prefixMatches_, candidates.end());
+    }
+    else
+    {
+        CollectCandidates(lowered, &candidates);
+    }
+
+    prefixMatches_ = FilterResults(lowered, &candidates);
+    results_ = std::move(candidates);
+    lastQuery_ = std::move(lowered);
+    hasResults_ = true;
+    return results_;
+}
+
+std::string_view CameraSearchIndex::RowText(uint32_t row) const
+{
+    return std::string_view(text_).substr(textOffsets_[row], textOffsets_[row + 1] - textOffsets_[row]);
+}
+
+// Rows that may match |query|, ascending: those holding all of its keys, or
+// every row for a query too short to have any.
+void CameraSearchIndex::CollectCandidates(const std::string& query, std::vector<uint32_t>* candidates) const
+{
+    candidates->clear();
+    const uint32_t rowCount = static_cast<uint32_t>(nameLengths_.size());
+    if (query.size() < kKeyLength)
+    {
+        candidates->reserve(rowCount);
+        for (uint32_t row = 0; row < rowCount; ++row)
+            candidates->push_back(row);
+        return;
+    }
+
+    // [begin, end) of each key's rows in |postings_|.
+    std::vector<std::pair<uint32_t, uint32_t>> lists;
+    for (size_t i = 0; i + kKeyLength <= query.size(); ++i)
+    {
+        const uint32_t key = PackKey(query.data() + i);
+        const auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+        if (it == keys_.end() || *it != key)
+            return;
+        const size_t index = static_cast<size_t>(it - keys_.begin());
+        lists.emplace_back(postingOffsets_[index], postingOffsets_[index + 1]);
+    }
+
+    // Intersect starting from the rarest key, so the work is bounded by it.
+    std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b)
+    {
+        return a.second - a.first < b.second - b.first;
+    });
+    candidates->assign(postings_.begin() + lists[0].first, postings_.begin() + lists[0].second);
+    for (size_t list = 1; list < lists.size() && !candidates->empty(); ++list)
+    {
+        auto position = postings_.begin() + lists[list].first;
+        const auto end = postings_.begin() + lists[list].second;
+        size_t kept = 0;
+        for (size_t i = 0; i < candidates->size() && position != end; ++i)
+        {
+            const uint32_t row = (*candidates)[i];
+            position = std::lower_bound(position, end, row);
+            if (position != end && *position == row)
+                (*candidates)[kept++] = row;
+        }
+        candidates->resize(kept);
+    }
+}
+
+// Keeps the ascending |candidates| that really contain |query|, then moves
+// the name-prefix matches to the front and returns how many there are.
+size_t CameraSearchIndex::FilterResults(const std::string& query, std::vector<uint32_t>* candidates) const
+{
+    std::vector<uint32_t> others;
+    size_t kept = 0;
+    for (const uint32_t row : *candidates)
+    {
+        const std::string_view text = RowText(row);
+        const size_t position = text.find(query);
+        if (position == std::string_view::npos)
+            continue;
+        if (position == 0 && nameLengths_[row] >= query.size())
+            (*candidates)[kept++] = row;
+        else
+            others.push_back(row);
+    }
+    candidates->resize(kept);
+    candidates->insert(candidates->end(), others.begin(), others.end());
+    return kept;
+}
@@ -0,0 +1,151 @@
+#include "DeviceWatcher.h"
+
+#include "LogUtils.h"
+
+#include <Windows.h>
+#include <dbt.h>
+
+#include <mutex>
+#include <thread>
+
+namespace {
+constexpr wchar_t kWatcherWindowClass[] = L"JoystickTestingDeviceWatcher";
+
+// GUID_DEVINTERFACE_HID; declared here to avoid pulling in the DDK headers.
+constexpr GUID kHidInterfaceGuid =
+    { 0x4D1E55B2, 0xF16F, 0x11CF, { 0x88, 0xCB, 0x00, 0x11, 0x11, 0x00, 0x00, 0x30 } };
+
+struct DeviceWatcherState
+{
+    std::mutex mutex;
+    std::thread thread;
+    HWND window = nullptr;
+    DeviceChangeCallback callback;
+};
+
+DeviceWatcherState& GetWatcherState()
+{
+    static DeviceWatcherState state;
+    return state;
+}
+
+LRESULT CALLBACK DeviceWatcherWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    switch (msg)
+    {
+        case WM_DEVICECHANGE:
+        {
+            if (wParam != DBT_DEVICEARRIVAL && wParam != DBT_DEVICEREMOVECOMPLETE)
+                break;
+
+            const auto* header = reinterpret_cast<const DEV_BROADCAST_HDR*>(lParam);
+            if (!header || header->dbch_devicetype != DBT_DEVTYP_DEVICEINTERFACE)
+                break;
+
+            DeviceWatcherState& state = GetWatcherState();
+            if (state.callback)
+            {
+                state.callback(wParam == DBT_DEVICEARRIVAL
+                    ? DeviceChange::Arrival
+                    : DeviceChange::Removal);
+            }
+            return TRUE;
+        }
+
+        case WM_CLOSE:
+            DestroyWindow(hWnd);
+            return 0;
+
+        case WM_DESTROY:
+            PostQuitMessage(0);
+            return 0;
+    }
+
+    return DefWindowProcW(hWnd, msg, wParam, lParam);
+}
+
+void RunDeviceWatcher(HANDLE readyEvent)
+{
+    DeviceWatcherState& state = GetWatcherState();
+    HINSTANCE instance = GetModuleHandle(nullptr);
+
+    WNDCLASSEXW windowClass = {};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = DeviceWatcherWndProc;
+    windowClass.hInstance = instance;
+    windowClass.lpszClassName = kWatcherWindowClass;
+    RegisterClassExW(&windowClass);
+
+    HWND window = CreateWindowExW(0, kWatcherWindowClass, L"", 0, 0, 0, 0, 0,
+        HWND_MESSAGE, nullptr, instance, nullptr);
+
+    HDEVNOTIFY notification = nullptr;
+    if (window)
+    {
+        DEV_BROADCAST_DEVICEINTERFACE_W filter = {};
+        filter.dbcc_size = sizeof(filter);
+        filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+        filter.dbcc_classguid = kHidInterfaceGuid;
+        notification = RegisterDeviceNotificationW(window, &filter, DEVICE_NOTIFY_WINDOW_HANDLE);
+        if (!notification)
+            AppendLogLine(L"Device watcher: RegisterDeviceNotification failed: " +
+                std::to_wstring(GetLastError()));
+    }
+
+    {
+        std::scoped_lock lock(state.mutex);
+        state.window = window;
+    }
+    SetEvent(readyEvent);
+
+    if (!window)
+        return;
+
+    MSG msg = {};
+    while (GetMessageW(&msg, nullptr, 0, 0) > 0)
+    {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+
+    if (notification)
+        UnregisterDeviceNotification(notification);
+    UnregisterClassW(kWatcherWindowClass, instance);
+}
+}
+
+bool StartDeviceWatcher(DeviceChangeCallback callback)
+{
+    DeviceWatcherState& state = GetWatcherState();
+    if (state.thread.joinable())
+        return true;
+
+    HANDLE readyEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!readyEvent)
+        return false;
+
+    state.callback = std::move(callback);
+    state.thread = std::thread(RunDeviceWatcher, readyEvent);
+    WaitForSingleObject(readyEvent, INFINITE);
+    CloseHandle(readyEvent);
+
+    std::scoped_lock lock(state.mutex);
+    return state.window != nullptr;
+}
+
+void StopDeviceWatcher()
+{
+    DeviceWatcherState& state = GetWatcherState();
+    if (!state.thread.joinable())
+        return;
+
+    {
+        std::scoped_lock lock(state.mutex);
+        if (state.window)
+            PostMessageW(state.window, WM_CLOSE, 0, 0);
+        state.window = nullptr;
+    }
+
+    state.thread.join();
+    state.callback = nullptr;
+}
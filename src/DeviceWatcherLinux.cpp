@@ -0,0 +1,124 @@
+#include "DeviceWatcher.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace {
+struct DeviceWatcherState
+{
+    std::thread thread;
+    int inotifyFd = -1;
+    int stopFd = -1;
+    DeviceChangeCallback callback;
+};
+
+DeviceWatcherState& GetWatcherState()
+{
+    static DeviceWatcherState state;
+    return state;
+}
+
+bool IsJoystickNode(const char* name)
+{
+    return std::strncmp(name, "event", 5) == 0 || std::strncmp(name, "js", 2) == 0;
+}
+
+void CloseWatcherHandles(DeviceWatcherState& state)
+{
+    if (state.inotifyFd >= 0)
+        close(state.inotifyFd);
+    if (state.stopFd >= 0)
+        close(state.stopFd);
+    state.inotifyFd = -1;
+    state.stopFd = -1;
+}
+
+void RunDeviceWatcher()
+{
+    DeviceWatcherState& state = GetWatcherState();
+    alignas(inotify_event) char buffer[4096];
+
+    for (;;)
+    {
+        pollfd fds[2] = {};
+        fds[0].fd = state.inotifyFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = state.stopFd;
+        fds[1].events = POLLIN;
+
+        if (poll(fds, 2, -1) < 0)
+            continue;
+        if (fds[1].revents & POLLIN)
+            break;
+        if (!(fds[0].revents & POLLIN))
+            continue;
+
+        const ssize_t length = read(state.inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            continue;
+
+        // Coalesce a burst (event node, js node, permission fix-up) into at
+        // most one notification of each kind.
+        bool arrived = false;
+        bool removed = false;
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->len == 0 || !IsJoystickNode(event->name))
+                continue;
+
+            // udev creates the node before fixing its permissions, so
+            // IN_ATTRIB is the point where it can actually be opened.
+            if (event->mask & (IN_CREATE | IN_ATTRIB))
+                arrived = true;
+            if (event->mask & IN_DELETE)
+                removed = true;
+        }
+
+        if (removed && state.callback)
+            state.callback(DeviceChange::Removal);
+        if (arrived && state.callback)
+            state.callback(DeviceChange::Arrival);
+    }
+}
+}
+
+bool StartDeviceWatcher(DeviceChangeCallback callback, const char* directory)
+{
+    DeviceWatcherState& state = GetWatcherState();
+    if (state.thread.joinable())
+        return true;
+
+    state.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    state.stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (state.inotifyFd < 0 || state.stopFd < 0 ||
+        inotify_add_watch(state.inotifyFd, directory, IN_CREATE | IN_DELETE | IN_ATTRIB) < 0)
+    {
+        CloseWatcherHandles(state);
+        return false;
+    }
+
+    state.callback = std::move(callback);
+    state.thread = std::thread(RunDeviceWatcher);
+    return true;
+}
+
+void StopDeviceWatcher()
+{
+    DeviceWatcherState& state = GetWatcherState();
+    if (!state.thread.joinable())
+        return;
+
+    const uint64_t value = 1;
+    (void)write(state.stopFd, &value, sizeof(value));
+    state.thread.join();
+    CloseWatcherHandles(state);
+    state.callback = nullptr;
+}
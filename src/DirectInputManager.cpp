@@ -3,40 +3,117 @@
 
 #include "DirectInputManager.h"
 
+#include "CameraSearch.h"
 #include "ComPtr.h"
+#include "DeviceWatcher.h"
 #include "JoystickNetwork.h"
+#include "JoystickScaling.h"
+#include "LogUtils.h"
+#include "PipelineTrace.h"
+#include "RegistryUtils.h"
+#include "StartupTrace.h"
+#include "StringUtils.h"
 #include "XInputFilter.h"
 #include "res.h"
 
 #include <tchar.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+#include <commctrl.h>
 #include <dinput.h>
 #include <dinputd.h>
 
 namespace {
-constexpr double kDeadzoneMagnitude = 20.0; // Raw axis magnitude threshold.
-constexpr double kAxisMaxMagnitude = 255.0;
-constexpr double kOutputMaxMagnitude = 750.0;
-constexpr double kTwistDeadzone = 10.0;
+// Devices signal their events on change; the timeout keeps held positions
+// refreshed at the previous 30 Hz and services polled devices.
+constexpr DWORD kInputRefreshMs = 1000 / 30;
+constexpr wchar_t kRegistryBindingsSubkey[] = L"SOFTWARE\\JoystickTesting\\Joystick Bindings";
 ComPtr<IDirectInput8> g_directInput;
-ComPtr<IDirectInputDevice8> g_joystick;
 bool g_filterOutXinputDevices = false;
-std::vector<CameraInfo> g_cameraList;
-std::vector<std::wstring> g_cameraComboIds;
-std::wstring g_lastSelectedCameraId;
+// The latest camera list, shared with the worker. The list view is virtual:
+// its rows are the search results, drawn on demand.
+CameraSearchIndex g_cameraSearch;
+CameraHandle g_selectedCamera = kNoCamera;
+std::thread g_enumThread;
+bool g_enumInProgress = false;
+bool g_rescanRequested = false;
+bool g_joystickLost = false;
+std::chrono::steady_clock::time_point g_joystickLostAt;
+
+struct JoystickDevice
+{
+    ComPtr<IDirectInputDevice8> device;
+    GUID instance = {};
+    std::wstring name;
+    // Empty: the stick follows the camera selected in the dialog.
+    std::vector<std::string> cameraIds;
+    HANDLE event = nullptr;
+    bool wasActive = false;
+    bool lost = false;
+};
+
+struct JoystickDisplayState
+{
+    bool valid = false;
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+    BYTE buttons[128] = {};
+};
+
+// Every open stick is serviced by a single input thread; the UI timer only
+// renders what it published.
+struct InputThreadState
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<JoystickDevice>> devices;
+    JoystickDisplayState display;
+    HWND dialog = nullptr;
+    HANDLE wakeEvent = nullptr;
+    std::atomic<bool> stopRequested = false;
+    // Read from the registry when the thread starts, then kept current by
+    // SetInputInvertY rather than read again on every wake.
+    std::atomic<bool> invertY = false;
+    std::thread thread;
+};
+
+InputThreadState g_input;
+
+struct EnumeratedJoystick
+{
+    ComPtr<IDirectInputDevice8> device;
+    GUID instance = {};
+    std::wstring name;
+};
+
+struct PendingJoysticks
+{
+    std::mutex mutex;
+    std::vector<EnumeratedJoystick> devices;
+    HRESULT hr = S_OK;
+};
+
+PendingJoysticks g_pendingJoysticks;
 
 struct DI_ENUM_CONTEXT
 {
-    DIJOYCONFIG* preferredJoyCfg;
-    bool preferredJoyCfgValid;
+    std::vector<DIDEVICEINSTANCE>* candidates;
 };
 
 struct DI_OBJECT_ENUM_CONTEXT
 {
     HWND dialog;
+    IDirectInputDevice8* device = nullptr;
+    bool primary = false;
     int sliderCount = 0;
     int povCount = 0;
 };
@@ -61,9 +138,22 @@ private:
 
 BOOL CALLBACK EnumObjectsCallback(const DIDEVICEOBJECTINSTANCE* pdidoi, VOID* pContext);
 BOOL CALLBACK EnumJoysticksCallback(const DIDEVICEINSTANCE* pdidInstance, VOID* pContext);
-
-std::wstring BuildCameraDisplayName(const CameraInfo& camera);
-void UpdateCameraListUI(HWND hDlg);
+void RunJoystickEnumeration(HWND dialog, std::vector<GUID> openInstances);
+void BeginJoystickEnumeration(HWND dialog);
+void StartInputThread(HWND dialog);
+void StopInputThread();
+void SubmitJoystickForDevice(const JoystickDevice& joystick, const JoystickState& state);
+void SubmitJoystickNeutral(const JoystickDevice& joystick);
+void ReleaseJoystick(JoystickDevice& joystick);
+bool IsJoystickDisconnectError(HRESULT hr);
+std::wstring FormatGuid(const GUID& guid);
+std::vector<std::string> LoadJoystickBinding(const GUID& instance);
+
+std::wstring BuildCameraDisplayName(const CameraRecord& camera);
+void RebuildCameraList(HWND hDlg, std::shared_ptr<const CameraCatalogSnapshot> cameras);
+void ShowCameraResults(HWND hDlg);
+int FindCameraResultRow(CameraHandle camera);
+void RestoreCameraSelection(HWND list);
 void UpdateSelectedCamera(HWND hDlg);
 }
 
@@ -72,10 +162,19 @@ void SetFilterOutXInputDevices(bool enable)
     g_filterOutXinputDevices = enable;
 }
 
+void SetInputInvertY(bool enable)
+{
+    g_input.invertY = enable;
+}
+
 void AcquireJoystick()
 {
-    if (g_joystick)
-        g_joystick->Acquire();
+    std::scoped_lock lock(g_input.mutex);
+    for (const auto& joystick : g_input.devices)
+    {
+        if (!joystick->lost)
+            joystick->device->Acquire();
+    }
 }
 
 HRESULT InitDirectInput(HWND hDlg)
@@ -85,267 +184,732 @@ HRESULT InitDirectInput(HWND hDlg)
     if (FAILED(hr))
         return hr;
 
-    ScopedXInputDeviceCleanup xinputCleanup(g_filterOutXinputDevices);
-    if (g_filterOutXinputDevices)
-        (void)SetupForIsXInputDevice();
+    EnsureRegistryKey(kRegistryBindingsSubkey);
+    StartInputThread(hDlg);
 
-    DIJOYCONFIG preferredJoyCfg = {};
-    DI_ENUM_CONTEXT enumContext = {};
-    enumContext.preferredJoyCfg = &preferredJoyCfg;
-    enumContext.preferredJoyCfgValid = false;
+    // Arrivals and removals are marshalled to the dialog; enumeration only
+    // reruns when the device set actually changes.
+    if (!StartDeviceWatcher([hDlg](DeviceChange change)
+        {
+            PostMessage(hDlg, WM_APP_DEVICE_CHANGE, change == DeviceChange::Arrival ? 1 : 0, 0);
+        }))
+    {
+        AppendLogLine(L"Device watcher unavailable; hot-plug disabled");
+    }
 
-    ComPtr<IDirectInputJoyConfig8> joyConfig;
-    hr = g_directInput->QueryInterface(IID_IDirectInputJoyConfig8,
-        reinterpret_cast<void**>(joyConfig.put()));
-    if (FAILED(hr))
-        return hr;
+    BeginJoystickEnumeration(hDlg);
+    return S_OK;
+}
 
-    preferredJoyCfg.dwSize = sizeof(preferredJoyCfg);
-    if (SUCCEEDED(joyConfig->GetConfig(0, &preferredJoyCfg, DIJC_GUIDINSTANCE)))
-        enumContext.preferredJoyCfgValid = true;
+void HandleInputDeviceChange(HWND hDlg, bool arrival)
+{
+    if (!g_directInput)
+        return;
 
-    hr = g_directInput->EnumDevices(DI8DEVCLASS_GAMECTRL,
-        EnumJoysticksCallback, &enumContext, DIEDFL_ATTACHEDONLY);
-    if (FAILED(hr))
-        return hr;
+    if (arrival)
+    {
+        BeginJoystickEnumeration(hDlg);
+        return;
+    }
 
-    if (!g_joystick)
+    std::vector<std::unique_ptr<JoystickDevice>> removed;
     {
-        MessageBox(nullptr, TEXT("Joystick not found. The sample will now exit."),
-            TEXT("DirectInput Sample"), MB_ICONERROR | MB_OK);
-        EndDialog(hDlg, 0);
-        return S_OK;
+        std::scoped_lock lock(g_input.mutex);
+        auto& devices = g_input.devices;
+        for (auto it = devices.begin(); it != devices.end();)
+        {
+            JoystickDevice& joystick = **it;
+            if (!joystick.lost && g_directInput->GetDeviceStatus(joystick.instance) == DI_OK)
+            {
+                ++it;
+                continue;
+            }
+
+            // Stop the bound cameras before anything else; the last move
+            // would otherwise keep them panning until the stick returns.
+            if (!joystick.lost)
+                SubmitJoystickNeutral(joystick);
+            removed.push_back(std::move(*it));
+            it = devices.erase(it);
+        }
+
+        if (!removed.empty() && devices.empty())
+            g_input.display = {};
     }
 
-    hr = g_joystick->SetDataFormat(&c_dfDIJoystick2);
-    if (FAILED(hr))
-        return hr;
+    if (removed.empty())
+        return;
 
-    hr = g_joystick->SetCooperativeLevel(hDlg, DISCL_EXCLUSIVE | DISCL_FOREGROUND);
-    if (FAILED(hr))
-        return hr;
+    for (auto& joystick : removed)
+    {
+        AppendLogLine(L"Joystick disconnected: " + joystick->name);
+        ReleaseJoystick(*joystick);
+    }
 
-    DI_OBJECT_ENUM_CONTEXT objectContext = {};
-    objectContext.dialog = hDlg;
-    hr = g_joystick->EnumObjects(EnumObjectsCallback, &objectContext, DIDFT_ALL);
+    g_joystickLost = true;
+    g_joystickLostAt = std::chrono::steady_clock::now();
+    SetWindowText(GetDlgItem(hDlg, IDC_BUTTONS), TEXT("Joystick disconnected"));
+}
+
+HRESULT CompleteDirectInputInit(HWND hDlg)
+{
+    HRESULT hr = S_OK;
+    std::vector<EnumeratedJoystick> found;
+    {
+        std::scoped_lock lock(g_pendingJoysticks.mutex);
+        hr = g_pendingJoysticks.hr;
+        found = std::move(g_pendingJoysticks.devices);
+        g_pendingJoysticks.devices.clear();
+    }
+    g_enumInProgress = false;
     if (FAILED(hr))
         return hr;
 
+    size_t openCount = 0;
+    {
+        std::scoped_lock lock(g_input.mutex);
+        openCount = g_input.devices.size();
+    }
+
+    for (auto& candidate : found)
+    {
+        auto joystick = std::make_unique<JoystickDevice>();
+        joystick->device = std::move(candidate.device);
+        joystick->instance = candidate.instance;
+        joystick->name = std::move(candidate.name);
+        joystick->cameraIds = LoadJoystickBinding(joystick->instance);
+
+        IDirectInputDevice8* device = joystick->device.get();
+        hr = device->SetDataFormat(&c_dfDIJoystick2);
+        if (SUCCEEDED(hr))
+            hr = device->SetCooperativeLevel(hDlg, DISCL_EXCLUSIVE | DISCL_FOREGROUND);
+        if (SUCCEEDED(hr))
+        {
+            joystick->event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+            hr = joystick->event ? device->SetEventNotification(joystick->event) : E_OUTOFMEMORY;
+        }
+        if (SUCCEEDED(hr))
+        {
+            DI_OBJECT_ENUM_CONTEXT objectContext = {};
+            objectContext.dialog = hDlg;
+            objectContext.device = device;
+            objectContext.primary = (openCount == 0);
+            hr = device->EnumObjects(EnumObjectsCallback, &objectContext, DIDFT_ALL);
+        }
+        if (FAILED(hr))
+        {
+            AppendLogLine(L"Joystick setup failed: " + joystick->name);
+            ReleaseJoystick(*joystick);
+            continue;
+        }
+
+        // WM_ACTIVATE has usually been handled before the device was ready.
+        device->Acquire();
+
+        std::string line = "Joystick opened: " + WideToUtf8(joystick->name) + " " +
+            WideToUtf8(FormatGuid(joystick->instance)) + " -> ";
+        if (joystick->cameraIds.empty())
+        {
+            line += "selected camera";
+        }
+        else
+        {
+            for (size_t i = 0; i < joystick->cameraIds.size(); ++i)
+            {
+                if (i > 0)
+                    line += ", ";
+                line += joystick->cameraIds[i];
+            }
+        }
+        AppendLogLine(line);
+
+        std::scoped_lock lock(g_input.mutex);
+        g_input.devices.push_back(std::move(joystick));
+        ++openCount;
+    }
+
+    // An arrival seen while the previous scan ran may not be in its results.
+    if (g_rescanRequested)
+        BeginJoystickEnumeration(hDlg);
+
+    if (openCount == 0)
+    {
+        SetWindowText(GetDlgItem(hDlg, IDC_BUTTONS),
+            g_joystickLost ? TEXT("Joystick disconnected") : TEXT("Waiting for joystick"));
+        return S_OK;
+    }
+
+    SetEvent(g_input.wakeEvent);
+    MarkStartupMilestone(L"Joystick ready");
+
+    if (g_joystickLost && !found.empty())
+    {
+        const double reconnectMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - g_joystickLostAt).count();
+        g_joystickLost = false;
+        AppendLogLine(L"Joystick reconnected in " +
+            std::to_wstring(static_cast<long long>(reconnectMs)) + L" ms");
+    }
     return S_OK;
 }
 
 void FreeDirectInput()
 {
-    if (g_joystick)
-        g_joystick->Unacquire();
+    StopDeviceWatcher();
+    if (g_enumThread.joinable())
+        g_enumThread.join();
+
+    {
+        std::scoped_lock lock(g_pendingJoysticks.mutex);
+        g_pendingJoysticks.devices.clear();
+    }
 
-    g_joystick.reset();
+    StopInputThread();
     g_directInput.reset();
 }
 
 HRESULT UpdateInputState(HWND hDlg)
 {
-    HRESULT hr = S_OK;
+    ScopedTraceSpan span(TraceStage::UiUpdate);
     TCHAR strText[512] = {};
-    DIJOYSTATE2 js = {};
-    static bool wasActive = false;
-
-    if (!g_joystick)
-        return S_OK;
+    JoystickDisplayState display;
+    {
+        std::scoped_lock lock(g_input.mutex);
+        display = g_input.display;
+    }
 
-    hr = g_joystick->Poll();
-    if (FAILED(hr))
+    if (display.valid)
     {
-        hr = g_joystick->Acquire();
-        while (hr == DIERR_INPUTLOST)
-            hr = g_joystick->Acquire();
-        return S_OK;
+        _stprintf_s(strText, 512, TEXT("%.0f"), display.x);
+        SetWindowText(GetDlgItem(hDlg, IDC_X_AXIS), strText);
+        _stprintf_s(strText, 512, TEXT("%.0f"), display.y);
+        SetWindowText(GetDlgItem(hDlg, IDC_Y_AXIS), strText);
+        _stprintf_s(strText, 512, TEXT("%.0f"), display.z);
+        SetWindowText(GetDlgItem(hDlg, IDC_Z_AXIS), strText);
+
+        _tcscpy_s(strText, 512, TEXT(""));
+        for (int i = 0; i < 128; ++i)
+        {
+            if (display.buttons[i] & 0x80)
+            {
+                TCHAR sz[128];
+                _stprintf_s(sz, 128, TEXT("%02d "), i);
+                _tcscat_s(strText, 512, sz);
+            }
+        }
+        SetWindowText(GetDlgItem(hDlg, IDC_BUTTONS), strText);
     }
 
-    hr = g_joystick->GetDeviceState(sizeof(DIJOYSTATE2), &js);
-    if (FAILED(hr))
-        return hr;
+    UpdateSelectedCamera(hDlg);
+    return S_OK;
+}
 
-    const double x = static_cast<double>(js.lX);
-    const double y = static_cast<double>(js.lY);
-    double z = static_cast<double>(js.lZ);
-    if (std::abs(z) <= kTwistDeadzone)
-        z = 0.0;
-    const double magnitude = std::sqrt((x * x) + (y * y) + (z * z));
-    const double maxMagnitude = kAxisMaxMagnitude;
-    double displayX = 0.0;
-    double displayY = 0.0;
-    double displayZ = 0.0;
+void HandleNetworkEvents(HWND hDlg)
+{
+    std::vector<NetworkEvent> events;
+    if (!DrainNetworkEvents(&events))
+        return;
+
+    ScopedTraceSpan span(TraceStage::UiUpdate);
 
-    if (magnitude < kDeadzoneMagnitude || magnitude <= 0.0)
+    // Every list event carries the whole snapshot, so a burst of them is
+    // indexed once, for the last.
+    std::shared_ptr<const CameraCatalogSnapshot> cameras;
+    for (const auto& event : events)
     {
-        if (wasActive)
+        switch (event.type)
         {
-            JoystickState neutral = {};
-            neutral.x = 0.0;
-            neutral.y = 0.0;
-            neutral.z = 0.0;
-            SubmitJoystickState(neutral);
+        case NetworkEventType::Status:
+            SetWindowText(GetDlgItem(hDlg, IDC_NetResponse), event.status->c_str());
+            break;
+        case NetworkEventType::CameraListReplaced:
+            cameras = event.cameras;
+            break;
+        case NetworkEventType::CameraListPatched:
+            // Before the first full list arrives there is nothing to patch;
+            // that list already includes these changes.
+            if (cameras || g_cameraSearch.Cameras())
+                cameras = event.cameras;
+            break;
+        case NetworkEventType::ReturnHomeState:
+            CheckDlgButton(hDlg, IDC_DISABLE_RETURN_HOME,
+                event.returnHomeDisabled ? BST_UNCHECKED : BST_CHECKED);
+            break;
         }
-        wasActive = false;
     }
-    else
+
+    if (cameras)
+        RebuildCameraList(hDlg, std::move(cameras));
+}
+
+void InitCameraList(HWND hDlg)
+{
+    HWND list = GetDlgItem(hDlg, IDC_CAMERA_LIST);
+    if (!list)
+        return;
+
+    RECT client = {};
+    GetClientRect(list, &client);
+    LVCOLUMNW column = {};
+    column.mask = LVCF_WIDTH;
+    column.cx = client.right - client.left - GetSystemMetrics(SM_CXVSCROLL);
+    ListView_InsertColumn(list, 0, &column);
+    ListView_SetExtendedListViewStyle(list, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+}
+
+void FilterCameraList(HWND hDlg)
+{
+    if (g_cameraSearch.Cameras())
+        ShowCameraResults(hDlg);
+}
+
+bool HandleCameraListNotify(HWND hDlg, const NMHDR* header)
+{
+    UNREFERENCED_PARAMETER(hDlg);
+
+    if (header->idFrom != IDC_CAMERA_LIST || header->code != LVN_GETDISPINFOW)
+        return false;
+
+    const auto* dispInfo = reinterpret_cast<const NMLVDISPINFOW*>(header);
+    const LVITEMW& item = dispInfo->item;
+    const auto& results = g_cameraSearch.Results();
+    if (!(item.mask & LVIF_TEXT) || item.iItem < 0 || static_cast<size_t>(item.iItem) >= results.size())
+        return true;
+
+    const CameraRecord& camera = g_cameraSearch.Cameras()->Cameras()[results[item.iItem]];
+    const std::wstring displayName = BuildCameraDisplayName(camera);
+    wcsncpy_s(item.pszText, item.cchTextMax, displayName.c_str(), _TRUNCATE);
+    return true;
+}
+
+namespace {
+void SubmitJoystickNeutral(const JoystickDevice& joystick)
+{
+    if (joystick.cameraIds.empty())
+    {
+        SubmitJoystickStop();
+        return;
+    }
+
+    for (const auto& cameraId : joystick.cameraIds)
+        SubmitCameraJoystickStop(cameraId);
+}
+
+void SubmitJoystickForDevice(const JoystickDevice& joystick, const JoystickState& state)
+{
+    ScopedTraceSpan span(TraceStage::Submit);
+    if (joystick.cameraIds.empty())
     {
-        const double invMagnitude = 1.0 / magnitude;
-        const double scaledMagnitude = std::clamp(
-            (magnitude - kDeadzoneMagnitude) / (maxMagnitude - kDeadzoneMagnitude),
-            0.0,
-            1.0);
-        const double outputScale = scaledMagnitude * kOutputMaxMagnitude;
-
-        displayX = x * invMagnitude * outputScale;
-        const double ySign = GetInvertYSetting() ? -1.0 : 1.0;
-        displayY = y * invMagnitude * outputScale * ySign;
-        displayZ = z * invMagnitude * outputScale;
-        JoystickState state = {};
-        state.x = std::round(displayX);
-        state.y = std::round(displayY);
-        state.z = std::round(displayZ);
         SubmitJoystickState(state);
-        wasActive = true;
+        return;
     }
 
-    _stprintf_s(strText, 512, TEXT("%.0f"), displayX);
-    SetWindowText(GetDlgItem(hDlg, IDC_X_AXIS), strText);
-    _stprintf_s(strText, 512, TEXT("%.0f"), displayY);
-    SetWindowText(GetDlgItem(hDlg, IDC_Y_AXIS), strText);
-    _stprintf_s(strText, 512, TEXT("%.0f"), displayZ);
-    SetWindowText(GetDlgItem(hDlg, IDC_Z_AXIS), strText);
+    for (const auto& cameraId : joystick.cameraIds)
+        SubmitCameraJoystickState(cameraId, state);
+}
 
-    _tcscpy_s(strText, 512, TEXT(""));
-    for (int i = 0; i < 128; ++i)
+bool ComputeJoystickState(const DIJOYSTATE2& js, bool invertY, JoystickState* outState)
+{
+    ScopedTraceSpan span(TraceStage::Filter);
+    return ScaleJoystickAxes(static_cast<double>(js.lX), static_cast<double>(js.lY),
+        static_cast<double>(js.lZ), invertY, outState);
+}
+
+// Called on the input thread with g_input.mutex held.
+void ReadJoystick(JoystickDevice& joystick, bool primary, bool invertY)
+{
+    DIJOYSTATE2 js = {};
+    const uint64_t pollStart = TraceNow();
+    HRESULT hr = joystick.device->Poll();
+    if (FAILED(hr))
+    {
+        // One attempt per wake; an unplugged device is handed to the watcher
+        // path instead of spinning on DIERR_INPUTLOST.
+        hr = joystick.device->Acquire();
+        if (!IsJoystickDisconnectError(hr))
+            return;
+    }
+    else
+    {
+        hr = joystick.device->GetDeviceState(sizeof(DIJOYSTATE2), &js);
+    }
+    RecordTraceSpan(TraceStage::Poll, pollStart, TraceNow());
+
+    if (IsJoystickDisconnectError(hr))
+    {
+        if (g_directInput->GetDeviceStatus(joystick.instance) == DI_OK)
+            return;
+
+        SubmitJoystickNeutral(joystick);
+        joystick.wasActive = false;
+        joystick.lost = true;
+        PostMessage(g_input.dialog, WM_APP_DEVICE_CHANGE, 0, 0);
+        return;
+    }
+    if (FAILED(hr))
+        return;
+
+    JoystickState state = {};
+    const bool active = ComputeJoystickState(js, invertY, &state);
+    if (active)
     {
-        if (js.rgbButtons[i] & 0x80)
+        JoystickState rounded = {};
+        rounded.x = std::round(state.x);
+        rounded.y = std::round(state.y);
+        rounded.z = std::round(state.z);
+        SubmitJoystickForDevice(joystick, rounded);
+        joystick.wasActive = true;
+    }
+    else if (joystick.wasActive)
+    {
+        SubmitJoystickNeutral(joystick);
+        joystick.wasActive = false;
+    }
+
+    if (primary)
+    {
+        JoystickDisplayState& display = g_input.display;
+        display.valid = true;
+        display.x = state.x;
+        display.y = state.y;
+        display.z = state.z;
+        std::copy(std::begin(js.rgbButtons), std::end(js.rgbButtons), std::begin(display.buttons));
+    }
+}
+
+void RunInputThread()
+{
+    SetTraceThreadName("Input");
+    std::vector<HANDLE> handles;
+    while (!g_input.stopRequested)
+    {
+        handles.clear();
+        handles.push_back(g_input.wakeEvent);
         {
-            TCHAR sz[128];
-            _stprintf_s(sz, 128, TEXT("%02d "), i);
-            _tcscat_s(strText, 512, sz);
+            std::scoped_lock lock(g_input.mutex);
+            for (const auto& joystick : g_input.devices)
+            {
+                if (!joystick->lost && handles.size() < MAXIMUM_WAIT_OBJECTS)
+                    handles.push_back(joystick->event);
+            }
+        }
+
+        WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(),
+            FALSE, kInputRefreshMs);
+        if (g_input.stopRequested)
+            break;
+
+        const bool invertY = g_input.invertY.load(std::memory_order_relaxed);
+        std::scoped_lock lock(g_input.mutex);
+        for (size_t i = 0; i < g_input.devices.size(); ++i)
+        {
+            JoystickDevice& joystick = *g_input.devices[i];
+            if (!joystick.lost)
+                ReadJoystick(joystick, i == 0, invertY);
         }
     }
-    SetWindowText(GetDlgItem(hDlg, IDC_BUTTONS), strText);
+}
 
-    const std::wstring networkStatus = GetNetworkStatusText();
-    SetWindowText(GetDlgItem(hDlg, IDC_NetResponse), networkStatus.c_str());
+void StartInputThread(HWND dialog)
+{
+    if (g_input.thread.joinable())
+        return;
 
-    UpdateCameraListUI(hDlg);
-    UpdateSelectedCamera(hDlg);
+    g_input.dialog = dialog;
+    g_input.stopRequested = false;
+    g_input.invertY = GetInvertYSetting();
+    g_input.wakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    g_input.thread = std::thread(RunInputThread);
+}
 
-    bool returnHomeDisabled = false;
-    if (ConsumeReturnHomeSettingUpdate(&returnHomeDisabled))
+void StopInputThread()
+{
+    if (g_input.thread.joinable())
     {
-        CheckDlgButton(hDlg, IDC_DISABLE_RETURN_HOME,
-            returnHomeDisabled ? BST_UNCHECKED : BST_CHECKED);
+        g_input.stopRequested = true;
+        SetEvent(g_input.wakeEvent);
+        g_input.thread.join();
     }
 
-    return S_OK;
+    std::vector<std::unique_ptr<JoystickDevice>> devices;
+    {
+        std::scoped_lock lock(g_input.mutex);
+        devices = std::move(g_input.devices);
+        g_input.devices.clear();
+        g_input.display = {};
+    }
+    for (auto& joystick : devices)
+        ReleaseJoystick(*joystick);
+
+    if (g_input.wakeEvent)
+    {
+        CloseHandle(g_input.wakeEvent);
+        g_input.wakeEvent = nullptr;
+    }
 }
 
-namespace {
-std::wstring BuildCameraDisplayName(const CameraInfo& camera)
+void ReleaseJoystick(JoystickDevice& joystick)
+{
+    if (joystick.device)
+    {
+        joystick.device->Unacquire();
+        joystick.device->SetEventNotification(nullptr);
+        joystick.device.reset();
+    }
+    if (joystick.event)
+    {
+        CloseHandle(joystick.event);
+        joystick.event = nullptr;
+    }
+}
+
+bool IsJoystickDisconnectError(HRESULT hr)
 {
-    std::wstring name = camera.name.empty() ? camera.id : camera.name;
+    return hr == DIERR_INPUTLOST || hr == DIERR_NOTACQUIRED || hr == DIERR_UNPLUGGED;
+}
+
+std::wstring FormatGuid(const GUID& guid)
+{
+    wchar_t buffer[64] = {};
+    if (StringFromGUID2(guid, buffer, static_cast<int>(sizeof(buffer) / sizeof(buffer[0]))) == 0)
+        return L"";
+    return buffer;
+}
+
+std::vector<std::string> LoadJoystickBinding(const GUID& instance)
+{
+    // Value name is the device instance GUID; data is a ';'-separated list of
+    // camera IDs so one stick can drive a camera group.
+    const std::wstring binding = ReadRegistryString(kRegistryBindingsSubkey, FormatGuid(instance).c_str());
+    std::vector<std::string> cameraIds;
+    size_t start = 0;
+    while (start <= binding.size())
+    {
+        size_t end = binding.find(L';', start);
+        if (end == std::wstring::npos)
+            end = binding.size();
+
+        const std::wstring cameraId = TrimWide(binding.substr(start, end - start));
+        if (!cameraId.empty())
+            cameraIds.push_back(WideToUtf8(cameraId));
+        start = end + 1;
+    }
+    return cameraIds;
+}
+
+std::wstring BuildCameraDisplayName(const CameraRecord& camera)
+{
+    std::string name(camera.name.empty() ? camera.id : camera.name);
     if (!camera.state.empty())
     {
-        name += L" (";
+        name += " (";
         name += camera.state;
-        name += L")";
+        name += ")";
     }
-    return name;
+    return Utf8ToWide(name);
 }
 
-void UpdateCameraListUI(HWND hDlg)
+void RebuildCameraList(HWND hDlg, std::shared_ptr<const CameraCatalogSnapshot> cameras)
 {
-    std::vector<CameraInfo> cameras;
-    if (!ConsumeCameraListUpdate(&cameras))
-        return;
-
-    g_cameraList = std::move(cameras);
-    g_cameraComboIds.clear();
+    g_cameraSearch.Build(std::move(cameras));
+    ShowCameraResults(hDlg);
+}
 
-    HWND combo = GetDlgItem(hDlg, IDC_CAMERA_LIST);
-    if (!combo)
+// Only the count changes here; the list view asks for the text of the rows
+// it draws.
+void ShowCameraResults(HWND hDlg)
+{
+    HWND list = GetDlgItem(hDlg, IDC_CAMERA_LIST);
+    if (!list)
         return;
 
-    SendMessage(combo, CB_RESETCONTENT, 0, 0);
-    SendMessage(combo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(L"<Select camera>"));
-    g_cameraComboIds.push_back(L"");
+    wchar_t query[256] = {};
+    GetDlgItemTextW(hDlg, IDC_CAMERA_SEARCH, query, static_cast<int>(std::size(query)));
+    const auto& results = g_cameraSearch.Search(WideToUtf8(TrimWide(query)));
 
-    for (const auto& camera : g_cameraList)
-    {
-        const std::wstring displayName = BuildCameraDisplayName(camera);
-        SendMessage(combo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(displayName.c_str()));
-        g_cameraComboIds.push_back(camera.id);
-    }
+    ListView_SetItemState(list, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+    ListView_SetItemCountEx(list, static_cast<int>(results.size()), LVSICF_NOSCROLL);
+    InvalidateRect(list, nullptr, FALSE);
+    RestoreCameraSelection(list);
+}
 
-    int selectionIndex = 0;
-    if (!g_lastSelectedCameraId.empty())
+int FindCameraResultRow(CameraHandle camera)
+{
+    const auto& records = g_cameraSearch.Cameras()->Cameras();
+    const auto& results = g_cameraSearch.Results();
+    for (size_t i = 0; i < results.size(); ++i)
     {
-        for (size_t i = 0; i < g_cameraComboIds.size(); ++i)
-        {
-            if (g_cameraComboIds[i] == g_lastSelectedCameraId)
-            {
-                selectionIndex = static_cast<int>(i);
-                break;
-            }
-        }
+        if (records[results[i]].handle == camera)
+            return static_cast<int>(i);
     }
+    return -1;
+}
 
-    SendMessage(combo, CB_SETCURSEL, selectionIndex, 0);
+// The selection survives filtering: it is shown again whenever its camera
+// is among the results, and only dropped when the camera is removed.
+void RestoreCameraSelection(HWND list)
+{
+    if (g_selectedCamera == kNoCamera)
+        return;
 
-    const std::wstring newSelection =
-        (selectionIndex >= 0 && static_cast<size_t>(selectionIndex) < g_cameraComboIds.size())
-        ? g_cameraComboIds[selectionIndex]
-        : L"";
-    if (newSelection != g_lastSelectedCameraId)
+    if (!g_cameraSearch.Cameras()->Find(g_selectedCamera))
     {
-        g_lastSelectedCameraId = newSelection;
-        SelectCameraId(g_lastSelectedCameraId);
+        g_selectedCamera = kNoCamera;
+        SelectCamera(g_selectedCamera);
+        return;
     }
+
+    const int row = FindCameraResultRow(g_selectedCamera);
+    if (row < 0)
+        return;
+    ListView_SetItemState(list, row, LVIS_SELECTED | LVIS_FOCUSED, LVIS_SELECTED | LVIS_FOCUSED);
+    ListView_EnsureVisible(list, row, FALSE);
 }
 
 void UpdateSelectedCamera(HWND hDlg)
 {
-    HWND combo = GetDlgItem(hDlg, IDC_CAMERA_LIST);
-    if (!combo || g_cameraComboIds.empty())
+    HWND list = GetDlgItem(hDlg, IDC_CAMERA_LIST);
+    if (!list || !g_cameraSearch.Cameras())
         return;
 
-    const int selectionIndex = static_cast<int>(SendMessage(combo, CB_GETCURSEL, 0, 0));
-    if (selectionIndex == CB_ERR ||
-        selectionIndex < 0 ||
-        static_cast<size_t>(selectionIndex) >= g_cameraComboIds.size())
+    const auto& results = g_cameraSearch.Results();
+    const int row = ListView_GetNextItem(list, -1, LVNI_SELECTED);
+    CameraHandle camera = kNoCamera;
+    if (row >= 0 && static_cast<size_t>(row) < results.size())
+    {
+        camera = g_cameraSearch.Cameras()->Cameras()[results[row]].handle;
+    }
+    else if (FindCameraResultRow(g_selectedCamera) < 0)
     {
+        // Filtered out rather than deselected.
         return;
     }
 
-    const std::wstring& cameraId = g_cameraComboIds[selectionIndex];
-    if (cameraId == g_lastSelectedCameraId)
+    if (camera == g_selectedCamera)
         return;
 
-    g_lastSelectedCameraId = cameraId;
-    SelectCameraId(cameraId);
+    g_selectedCamera = camera;
+    SelectCamera(camera);
 }
 
-BOOL CALLBACK EnumJoysticksCallback(const DIDEVICEINSTANCE* pdidInstance, VOID* pContext)
+HRESULT EnumerateJoysticks(IDirectInput8* directInput,
+    const std::vector<GUID>& openInstances,
+    std::vector<EnumeratedJoystick>* outJoysticks)
 {
-    auto enumContext = reinterpret_cast<DI_ENUM_CONTEXT*>(pContext);
+    // The WMI scan behind the XInput filter is only needed once candidates
+    // are known, so it runs alongside DirectInput enumeration.
+    ScopedXInputDeviceCleanup xinputCleanup(g_filterOutXinputDevices);
+    std::future<HRESULT> xinputSetup;
+    if (g_filterOutXinputDevices)
+    {
+        xinputSetup = std::async(std::launch::async, []()
+        {
+            ScopedStartupPhase phase(L"XInput filter");
+            return SetupForIsXInputDevice();
+        });
+    }
 
-    if (g_filterOutXinputDevices && IsXInputDevice(&pdidInstance->guidProduct))
-        return DIENUM_CONTINUE;
+    DIJOYCONFIG preferredJoyCfg = {};
+    bool preferredJoyCfgValid = false;
+    std::vector<DIDEVICEINSTANCE> candidates;
+    DI_ENUM_CONTEXT enumContext = {};
+    enumContext.candidates = &candidates;
 
-    if (enumContext->preferredJoyCfgValid &&
-        !IsEqualGUID(pdidInstance->guidInstance, enumContext->preferredJoyCfg->guidInstance))
-        return DIENUM_CONTINUE;
+    ComPtr<IDirectInputJoyConfig8> joyConfig;
+    HRESULT hr = directInput->QueryInterface(IID_IDirectInputJoyConfig8,
+        reinterpret_cast<void**>(joyConfig.put()));
+    if (FAILED(hr))
+        return hr;
+
+    preferredJoyCfg.dwSize = sizeof(preferredJoyCfg);
+    if (SUCCEEDED(joyConfig->GetConfig(0, &preferredJoyCfg, DIJC_GUIDINSTANCE)))
+        preferredJoyCfgValid = true;
 
-    HRESULT hr = g_directInput->CreateDevice(pdidInstance->guidInstance, g_joystick.put(), nullptr);
+    {
+        ScopedStartupPhase phase(L"Device enumeration");
+        hr = directInput->EnumDevices(DI8DEVCLASS_GAMECTRL,
+            EnumJoysticksCallback, &enumContext, DIEDFL_ATTACHEDONLY);
+    }
+    if (xinputSetup.valid())
+        (void)xinputSetup.get();
     if (FAILED(hr))
-        return DIENUM_CONTINUE;
+        return hr;
 
-    return DIENUM_STOP;
+    // The preferred device opens first so it becomes the primary stick shown
+    // in the dialog.
+    if (preferredJoyCfgValid)
+    {
+        std::stable_partition(candidates.begin(), candidates.end(),
+            [&](const DIDEVICEINSTANCE& instance)
+            {
+                return IsEqualGUID(instance.guidInstance, preferredJoyCfg.guidInstance) != FALSE;
+            });
+    }
+
+    for (const auto& instance : candidates)
+    {
+        if (g_filterOutXinputDevices && IsXInputDevice(&instance.guidProduct))
+            continue;
+
+        const bool alreadyOpen = std::any_of(openInstances.begin(), openInstances.end(),
+            [&](const GUID& open) { return IsEqualGUID(open, instance.guidInstance) != FALSE; });
+        if (alreadyOpen)
+            continue;
+
+        EnumeratedJoystick joystick;
+        if (FAILED(directInput->CreateDevice(instance.guidInstance, joystick.device.put(), nullptr)))
+            continue;
+
+        joystick.instance = instance.guidInstance;
+        joystick.name = instance.tszInstanceName;
+        outJoysticks->push_back(std::move(joystick));
+    }
+
+    return S_OK;
+}
+
+void RunJoystickEnumeration(HWND dialog, std::vector<GUID> openInstances)
+{
+    std::vector<EnumeratedJoystick> joysticks;
+    const HRESULT hr = EnumerateJoysticks(g_directInput.get(), openInstances, &joysticks);
+
+    {
+        std::scoped_lock lock(g_pendingJoysticks.mutex);
+        g_pendingJoysticks.devices = std::move(joysticks);
+        g_pendingJoysticks.hr = hr;
+    }
+    PostMessage(dialog, WM_APP_JOYSTICK_READY, 0, 0);
+}
+
+void BeginJoystickEnumeration(HWND dialog)
+{
+    if (g_enumInProgress)
+    {
+        g_rescanRequested = true;
+        return;
+    }
+
+    // The previous run has already posted its result, so this join is immediate.
+    if (g_enumThread.joinable())
+        g_enumThread.join();
+
+    std::vector<GUID> openInstances;
+    {
+        std::scoped_lock lock(g_input.mutex);
+        for (const auto& joystick : g_input.devices)
+            openInstances.push_back(joystick->instance);
+    }
+
+    g_enumInProgress = true;
+    g_rescanRequested = false;
+    g_enumThread = std::thread(RunJoystickEnumeration, dialog, std::move(openInstances));
+}
+
+BOOL CALLBACK EnumJoysticksCallback(const DIDEVICEINSTANCE* pdidInstance, VOID* pContext)
+{
+    auto enumContext = reinterpret_cast<DI_ENUM_CONTEXT*>(pContext);
+    enumContext->candidates->push_back(*pdidInstance);
+    return DIENUM_CONTINUE;
 }
 
 BOOL CALLBACK EnumObjectsCallback(const DIDEVICEOBJECTINSTANCE* pdidoi, VOID* pContext)
@@ -366,10 +930,14 @@ BOOL CALLBACK EnumObjectsCallback(const DIDEVICEOBJECTINSTANCE* pdidoi, VOID* pC
         diprg.lMin = -255;
         diprg.lMax = +255;
 
-        if (FAILED(g_joystick->SetProperty(DIPROP_RANGE, &diprg.diph)))
+        if (FAILED(enumContext->device->SetProperty(DIPROP_RANGE, &diprg.diph)))
             return DIENUM_STOP;
     }
 
+    // Only the primary stick drives the axis readouts.
+    if (!enumContext->primary)
+        return DIENUM_CONTINUE;
+
     if (pdidoi->guidType == GUID_XAxis)
     {
         EnableWindow(GetDlgItem(hDlg, IDC_X_AXIS), TRUE);
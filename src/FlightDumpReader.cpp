@@ -0,0 +1,133 @@
+#include "FlightDumpReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+const char* EventName(uint16_t type)
+{
+    switch (static_cast<FlightEventType>(type))
+    {
+    case FlightEventType::None:
+        return "none";
+    case FlightEventType::StateSubmitted:
+        return "state";
+    case FlightEventType::StopSubmitted:
+        return "stop";
+    case FlightEventType::Request:
+        return "request";
+    case FlightEventType::Status:
+        return "status";
+    case FlightEventType::Error:
+        return "error";
+    }
+    return "unknown";
+}
+
+std::string FormatUtc(int64_t unixMs)
+{
+    using namespace std::chrono;
+    const sys_time<milliseconds> time{ milliseconds(unixMs) };
+    const sys_days day = floor<days>(time);
+    const year_month_day date{ day };
+    const hh_mm_ss<milliseconds> clock{ time - day };
+
+    char text[40] = {};
+    snprintf(text, sizeof(text), "%04d-%02u-%02u %02ld:%02ld:%02lld.%03lldZ",
+        static_cast<int>(date.year()), static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()),
+        static_cast<long>(clock.hours().count()), static_cast<long>(clock.minutes().count()),
+        static_cast<long long>(clock.seconds().count()), static_cast<long long>(clock.subseconds().count()));
+    return text;
+}
+
+std::string FormatDetails(const FlightRecord& record)
+{
+    const std::string text(record.text, std::min<size_t>(record.textLength, sizeof(record.text)));
+    char details[96] = {};
+    switch (static_cast<FlightEventType>(record.type))
+    {
+    case FlightEventType::StateSubmitted:
+        snprintf(details, sizeof(details), "x=%.3f y=%.3f z=%.3f ", record.values[0] / 1000.0,
+            record.values[1] / 1000.0, record.values[2] / 1000.0);
+        return details + (text.empty() ? std::string("camera=(selected)") : "camera=" + text);
+    case FlightEventType::StopSubmitted:
+        return text.empty() ? std::string("camera=(selected)") : "camera=" + text;
+    case FlightEventType::Request:
+        snprintf(details, sizeof(details), "http=%d error=%d %.1f ms ", record.values[0], record.values[1],
+            record.values[2] / 1000.0);
+        return details + text;
+    case FlightEventType::Error:
+        snprintf(details, sizeof(details), "code=%d ", record.values[0]);
+        return details + text;
+    default:
+        return text;
+    }
+}
+}
+
+bool ParseFlightDump(std::string_view bytes, FlightDump* dump, std::string* error)
+{
+    FlightDumpHeader& header = dump->header;
+    if (bytes.size() < sizeof(header))
+    {
+        *error = "too short for a flight recorder dump";
+        return false;
+    }
+
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (memcmp(header.magic, kFlightDumpMagic, sizeof(header.magic)) != 0 ||
+        header.version != kFlightDumpVersion || header.recordSize != sizeof(FlightRecord))
+    {
+        *error = "not a version " + std::to_string(kFlightDumpVersion) + " flight recorder dump";
+        return false;
+    }
+    if (bytes.size() < sizeof(header) + static_cast<size_t>(header.recordCount) * sizeof(FlightRecord))
+    {
+        *error = "truncated";
+        return false;
+    }
+
+    dump->records.clear();
+    dump->records.reserve(header.recordCount);
+    for (uint32_t i = 0; i < header.recordCount; ++i)
+    {
+        FlightRecord record;
+        memcpy(&record, bytes.data() + sizeof(header) + i * sizeof(FlightRecord), sizeof(record));
+        if (record.sequence != 0)
+            dump->records.push_back(record);
+    }
+    std::sort(dump->records.begin(), dump->records.end(), [](const FlightRecord& a, const FlightRecord& b)
+    {
+        return a.sequence < b.sequence;
+    });
+    return true;
+}
+
+std::string FormatFlightDump(const FlightDump& dump)
+{
+    const FlightDumpHeader& header = dump.header;
+    const std::vector<FlightRecord>& records = dump.records;
+    const std::string reason(header.reason, strnlen(header.reason, sizeof(header.reason)));
+    std::string output = "Dump at " + FormatUtc(header.dumpUnixMs) + ": " + reason + "\n";
+
+    // Threads go on recording while a dump is taken.
+    const uint64_t written = records.empty() ? header.written : std::max(header.written, records.back().sequence);
+    char line[256] = {};
+    snprintf(line, sizeof(line), "%zu of %llu records kept\n", records.size(),
+        static_cast<unsigned long long>(written));
+    output += line;
+    for (const FlightRecord& record : records)
+    {
+        // Records still being written as the dump ran may postdate it.
+        const int64_t beforeNs = static_cast<int64_t>(header.dumpSteadyNs - record.timeNs);
+        snprintf(line, sizeof(line), "%12.6f s  %s  t%-3u %-8s ", -beforeNs / 1e9,
+            FormatUtc(header.dumpUnixMs - beforeNs / 1000000).c_str(), record.thread, EventName(record.type));
+        output += line;
+        output += FormatDetails(record);
+        output += '\n';
+    }
+    return output;
+}
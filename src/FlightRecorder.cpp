@@ -0,0 +1,127 @@
+#include "FlightRecorder.h"
+
+#include "StringUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+namespace {
+// Everything after FlightRecord::sequence, as words.
+constexpr size_t kRecordWords = (sizeof(FlightRecord) - sizeof(uint64_t)) / sizeof(uint64_t);
+// Records copied per call to the dump writer.
+constexpr size_t kDumpChunkRecords = 64;
+static_assert(kFlightRecordCount % kDumpChunkRecords == 0);
+
+// A record while in memory. |sequence| brackets the other words like a
+// seqlock: 0 while they are written, so a dump can tell a torn copy.
+struct FlightSlot
+{
+    std::atomic<uint64_t> sequence{ 0 };
+    std::atomic<uint64_t> words[kRecordWords] = {};
+};
+
+FlightSlot g_slots[kFlightRecordCount];
+std::atomic<uint64_t> g_written{ 0 };
+std::atomic<uint32_t> g_threadCount{ 0 };
+std::atomic<bool> g_dumping{ false };
+// Static, so dumping does not need stack; used under |g_dumping|.
+FlightRecord g_dumpChunk[kDumpChunkRecords];
+
+uint64_t SteadyNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t CurrentThreadNumber()
+{
+    thread_local const uint32_t number = g_threadCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    return number;
+}
+
+// The slot's record, or one with sequence 0 if it changed while copied.
+void CopySlot(const FlightSlot& slot, FlightRecord* out)
+{
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    uint64_t words[kRecordWords];
+    for (size_t i = 0; i < kRecordWords; ++i)
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const bool stable = slot.sequence.load(std::memory_order_relaxed) == sequence;
+
+    memcpy(reinterpret_cast<char*>(out) + sizeof(uint64_t), words, sizeof(words));
+    out->sequence = stable ? sequence : 0;
+}
+
+FlightRecord MakeRecord(FlightEventType type, int32_t value0, int32_t value1, int32_t value2)
+{
+    FlightRecord record = {};
+    record.timeNs = SteadyNowNs();
+    record.thread = CurrentThreadNumber();
+    record.type = static_cast<uint16_t>(type);
+    record.values[0] = value0;
+    record.values[1] = value1;
+    record.values[2] = value2;
+    return record;
+}
+
+void StoreRecord(const FlightRecord& record)
+{
+    uint64_t words[kRecordWords];
+    memcpy(words, reinterpret_cast<const char*>(&record) + sizeof(uint64_t), sizeof(words));
+
+    const uint64_t index = g_written.fetch_add(1, std::memory_order_relaxed);
+    FlightSlot& slot = g_slots[index % kFlightRecordCount];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kRecordWords; ++i)
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+}
+
+void RecordFlightEvent(FlightEventType type, std::string_view text, int32_t value0, int32_t value1, int32_t value2)
+{
+    FlightRecord record = MakeRecord(type, value0, value1, value2);
+    record.textLength = static_cast<uint16_t>(std::min(text.size(), sizeof(record.text)));
+    memcpy(record.text, text.data(), record.textLength);
+    StoreRecord(record);
+}
+
+void RecordFlightEvent(FlightEventType type, std::wstring_view text, int32_t value0, int32_t value1, int32_t value2)
+{
+    FlightRecord record = MakeRecord(type, value0, value1, value2);
+    record.textLength = static_cast<uint16_t>(WideToUtf8Prefix(text, record.text, sizeof(record.text)));
+    StoreRecord(record);
+}
+
+bool WriteFlightDump(const char* reason, FlightDumpWriter write, void* context)
+{
+    if (g_dumping.exchange(true, std::memory_order_acquire))
+        return false;
+
+    FlightDumpHeader header = {};
+    memcpy(header.magic, kFlightDumpMagic, sizeof(header.magic));
+    header.version = kFlightDumpVersion;
+    header.recordSize = sizeof(FlightRecord);
+    header.recordCount = kFlightRecordCount;
+    header.written = g_written.load(std::memory_order_relaxed);
+    header.dumpSteadyNs = SteadyNowNs();
+    header.dumpUnixMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (reason)
+        memcpy(header.reason, reason, std::min(strlen(reason), sizeof(header.reason) - 1));
+
+    bool ok = write(&header, sizeof(header), context);
+    for (uint32_t first = 0; ok && first < kFlightRecordCount; first += kDumpChunkRecords)
+    {
+        for (size_t i = 0; i < kDumpChunkRecords; ++i)
+            CopySlot(g_slots[first + i], &g_dumpChunk[i]);
+        ok = write(g_dumpChunk, sizeof(g_dumpChunk), context);
+    }
+
+    g_dumping.store(false, std::memory_order_release);
+    return ok;
+}
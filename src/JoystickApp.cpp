@@ -1,22 +1,35 @@
 #include "JoystickApp.h"
 
 #include "DirectInputManager.h"
+#include "FlightRecorder.h"
 #include "JoystickNetwork.h"
 #include "LogUtils.h"
+#include "PipelineTrace.h"
 #include "RegistryUtils.h"
+#include "StartupTrace.h"
 #include "StringUtils.h"
+#include "TaskPool.h"
 #include "res.h"
 
 #include <commctrl.h>
 #include <shellapi.h>
 #include <wchar.h>
 
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
 namespace {
 INT_PTR CALLBACK MainDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam);
 INT_PTR CALLBACK SettingsDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam);
 bool ShouldFilterXInputDevices();
 void EnsureRegistryDefaults();
 void UpdateSettingsAuthControls(HWND hDlg);
+void SavePipelineTrace(HWND hDlg);
+void InstallFlightRecorderCrashDump();
+void SaveFlightRecorder(HWND hDlg);
+void ShowTaskPoolStats(HWND hDlg);
+void ReportFatalError(HWND owner, const wchar_t* message, const char* reason, HRESULT hr);
 
 constexpr wchar_t kRegistrySubkey[] = L"SOFTWARE\\JoystickTesting";
 constexpr wchar_t kRegistryControllerAddress[] = L"Controller Address";
@@ -115,15 +128,26 @@ bool SaveSettingsDialog(HWND hDlg)
 
 int RunJoystickApp(HINSTANCE instance)
 {
+    BeginStartupTrace();
+    InstallFlightRecorderCrashDump();
+
     INITCOMMONCONTROLSEX icc = {};
     icc.dwSize = sizeof(icc);
     icc.dwICC = ICC_WIN95_CLASSES;
     InitCommonControlsEx(&icc);
 
-    EnsureRegistryDefaults();
+    {
+        ScopedStartupPhase phase(L"Registry defaults");
+        EnsureRegistryDefaults();
+    }
     SetFilterOutXInputDevices(ShouldFilterXInputDevices());
 
+    StartTaskPool();
+    // Login and the camera list fetch proceed while the dialog is created.
+    StartNetworkWorker();
     DialogBox(instance, MAKEINTRESOURCE(IDD_JOYST_IMM), nullptr, MainDlgProc);
+    StopNetworkWorker();
+    StopTaskPool();
     return 0;
 }
 
@@ -170,6 +194,148 @@ void EnsureRegistryDefaults()
     EnsureRegistryDwordValue(kRegistrySubkey, kRegistryDebugName, 0);
 }
 
+// %TEMP%\<prefix>-<local time><suffix>.
+std::wstring BuildTempFilePath(const wchar_t* prefix, const wchar_t* suffix)
+{
+    wchar_t directory[MAX_PATH] = {};
+    const DWORD directoryLength = GetTempPathW(MAX_PATH, directory);
+    SYSTEMTIME st = {};
+    GetLocalTime(&st);
+    wchar_t path[MAX_PATH + 64] = {};
+    swprintf_s(path, L"%s%s-%u%02u%02u-%02u%02u%02u%s",
+        directoryLength > 0 && directoryLength < MAX_PATH ? directory : L"", prefix,
+        st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, suffix);
+    return path;
+}
+
+// Writes the pipeline trace to a temp file, for Perfetto or
+// chrome://tracing.
+void SavePipelineTrace(HWND hDlg)
+{
+    const std::string trace = ExportChromeTrace();
+    const std::wstring path = BuildTempFilePath(L"JoystickTrace", L".json");
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    DWORD written = 0;
+    const bool saved = file != INVALID_HANDLE_VALUE &&
+        WriteFile(file, trace.data(), static_cast<DWORD>(trace.size()), &written, nullptr) &&
+        written == trace.size();
+    const DWORD error = saved ? 0 : GetLastError();
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    if (!saved)
+    {
+        AppendLogLine("Pipeline trace save failed: " + std::to_string(error));
+        MessageBox(hDlg, TEXT("Failed to save the pipeline trace."),
+            TEXT("Pipeline Trace"), MB_ICONERROR | MB_OK);
+        return;
+    }
+
+    AppendLogLine(L"Pipeline trace saved: " + path);
+    const std::wstring message = L"Pipeline trace saved to:\n" + path;
+    MessageBoxW(hDlg, message.c_str(), L"Pipeline Trace", MB_ICONINFORMATION | MB_OK);
+}
+
+bool WriteFlightDumpChunk(const void* data, size_t size, void* context)
+{
+    DWORD written = 0;
+    return WriteFile(static_cast<HANDLE>(context), data, static_cast<DWORD>(size), &written, nullptr) &&
+        written == size;
+}
+
+// Allocates nothing beyond what CreateFileW does, for the crash handlers.
+bool WriteFlightDumpFile(const wchar_t* path, const char* reason)
+{
+    HANDLE file = CreateFileW(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    const bool written = WriteFlightDump(reason, WriteFlightDumpChunk, file);
+    CloseHandle(file);
+    return written;
+}
+
+// Chosen at startup, so a crash need not build it.
+wchar_t g_crashDumpPath[MAX_PATH + 64] = {};
+
+LONG WINAPI DumpFlightRecorderOnCrash(EXCEPTION_POINTERS* exception)
+{
+    char reason[48] = {};
+    snprintf(reason, sizeof(reason), "Crash: exception 0x%08lX",
+        exception && exception->ExceptionRecord ? exception->ExceptionRecord->ExceptionCode : 0ul);
+    WriteFlightDumpFile(g_crashDumpPath, reason);
+    // Windows Error Reporting still gets the crash.
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+[[noreturn]] void DumpFlightRecorderOnTerminate()
+{
+    WriteFlightDumpFile(g_crashDumpPath, "Crash: std::terminate");
+    std::abort();
+}
+
+void InstallFlightRecorderCrashDump()
+{
+    wcsncpy_s(g_crashDumpPath, BuildTempFilePath(L"JoystickFlight", L"-crash.bin").c_str(), _TRUNCATE);
+    SetUnhandledExceptionFilter(DumpFlightRecorderOnCrash);
+    std::set_terminate(DumpFlightRecorderOnTerminate);
+}
+
+// The dump's path, or an empty string if it could not be written.
+std::wstring DumpFlightRecorder(const char* reason)
+{
+    const std::wstring path = BuildTempFilePath(L"JoystickFlight", L".bin");
+    if (!WriteFlightDumpFile(path.c_str(), reason))
+    {
+        AppendLogLine("Flight recorder dump failed");
+        return L"";
+    }
+    AppendLogLine(L"Flight recorder dumped: " + path);
+    return path;
+}
+
+void SaveFlightRecorder(HWND hDlg)
+{
+    const std::wstring path = DumpFlightRecorder("Requested");
+    if (path.empty())
+    {
+        MessageBox(hDlg, TEXT("Failed to save the flight recorder."),
+            TEXT("Flight Recorder"), MB_ICONERROR | MB_OK);
+        return;
+    }
+
+    const std::wstring message = L"Flight recorder saved to:\n" + path;
+    MessageBoxW(hDlg, message.c_str(), L"Flight Recorder", MB_ICONINFORMATION | MB_OK);
+}
+
+// The live queue counters, also written to the log.
+void ShowTaskPoolStats(HWND hDlg)
+{
+    std::string text;
+    const std::vector<TaskPoolQueueStats> stats = GetTaskPoolStats();
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        const std::string line = DescribeTaskPoolQueue(i, stats[i]);
+        AppendLogLine(line);
+        text += line + "\n";
+    }
+    if (text.empty())
+        text = "The task pool is not running.";
+    MessageBoxW(hDlg, Utf8ToWide(text).c_str(), L"Task Pool", MB_ICONINFORMATION | MB_OK);
+}
+
+// For the errors that end the app: records and dumps them, then tells the
+// user where the dump went.
+void ReportFatalError(HWND owner, const wchar_t* message, const char* reason, HRESULT hr)
+{
+    RecordFlightEvent(FlightEventType::Error, reason, static_cast<int32_t>(hr));
+    const std::wstring path = DumpFlightRecorder(reason);
+    std::wstring text = message;
+    if (!path.empty())
+        text += L"\n\nFlight recorder saved to:\n" + path;
+    MessageBoxW(owner, text.c_str(), L"DirectInput Sample", MB_ICONERROR | MB_OK);
+}
+
 INT_PTR CALLBACK SettingsDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam)
 {
     UNREFERENCED_PARAMETER(lParam);
@@ -204,24 +370,45 @@ INT_PTR CALLBACK SettingsDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lPar
 
 INT_PTR CALLBACK MainDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam)
 {
-    UNREFERENCED_PARAMETER(lParam);
-
     switch (msg)
     {
         case WM_INITDIALOG:
             SetLogAnchorWindow(hDlg);
-            if (FAILED(InitDirectInput(hDlg)))
+            if (const HRESULT hr = InitDirectInput(hDlg); FAILED(hr))
             {
-                MessageBox(nullptr, TEXT("Error Initializing DirectInput"),
-                    TEXT("DirectInput Sample"), MB_ICONERROR | MB_OK);
+                ReportFatalError(nullptr, L"Error Initializing DirectInput", "DirectInput init failed", hr);
                 EndDialog(hDlg, 0);
             }
 
             CheckDlgButton(hDlg, IDC_INVERT_Y, GetInvertYSetting() ? BST_CHECKED : BST_UNCHECKED);
-            StartNetworkWorker();
-            RequestCameraListRefresh();
             CheckDlgButton(hDlg, IDC_DISABLE_RETURN_HOME, BST_UNCHECKED);
+            InitCameraList(hDlg);
+            if (HMENU systemMenu = GetSystemMenu(hDlg, FALSE))
+            {
+                AppendMenuW(systemMenu, MF_SEPARATOR, 0, nullptr);
+                AppendMenuW(systemMenu, MF_STRING, IDM_SAVE_PIPELINE_TRACE, L"Save Pipeline Trace...");
+                AppendMenuW(systemMenu, MF_STRING, IDM_SAVE_FLIGHT_RECORDER, L"Save Flight Recorder...");
+                AppendMenuW(systemMenu, MF_STRING, IDM_SHOW_TASK_POOL_STATS, L"Task Pool Stats...");
+            }
             SetTimer(hDlg, 0, 1000 / 30, nullptr);
+            SetNetworkEventNotifier([hDlg]() { PostMessage(hDlg, WM_APP_NETWORK_EVENT, 0, 0); });
+            MarkStartupMilestone(L"Dialog initialized");
+            return TRUE;
+
+        case WM_APP_JOYSTICK_READY:
+            if (const HRESULT hr = CompleteDirectInputInit(hDlg); FAILED(hr))
+            {
+                ReportFatalError(nullptr, L"Error Initializing DirectInput", "DirectInput device init failed", hr);
+                EndDialog(hDlg, 0);
+            }
+            return TRUE;
+
+        case WM_APP_DEVICE_CHANGE:
+            HandleInputDeviceChange(hDlg, wParam != 0);
+            return TRUE;
+
+        case WM_APP_NETWORK_EVENT:
+            HandleNetworkEvents(hDlg);
             return TRUE;
 
         case WM_ACTIVATE:
@@ -231,27 +418,54 @@ INT_PTR CALLBACK MainDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam)
             return TRUE;
 
         case WM_TIMER:
-            if (FAILED(UpdateInputState(hDlg)))
+            if (const HRESULT hr = UpdateInputState(hDlg); FAILED(hr))
             {
                 KillTimer(hDlg, 0);
-                MessageBox(nullptr, TEXT("Error Reading Input State. ")
-                    TEXT("The sample will now exit."), TEXT("DirectInput Sample"),
-                    MB_ICONERROR | MB_OK);
+                ReportFatalError(nullptr, L"Error Reading Input State. The sample will now exit.",
+                    "Reading input state failed", hr);
                 EndDialog(hDlg, TRUE);
             }
             return TRUE;
 
+        case WM_SYSCOMMAND:
+            // The low four bits of the command are the system's own.
+            switch (wParam & 0xFFF0)
+            {
+                case IDM_SAVE_PIPELINE_TRACE:
+                    SavePipelineTrace(hDlg);
+                    return TRUE;
+                case IDM_SAVE_FLIGHT_RECORDER:
+                    SaveFlightRecorder(hDlg);
+                    return TRUE;
+                case IDM_SHOW_TASK_POOL_STATS:
+                    ShowTaskPoolStats(hDlg);
+                    return TRUE;
+            }
+            break;
+
+        case WM_NOTIFY:
+            return HandleCameraListNotify(hDlg, reinterpret_cast<const NMHDR*>(lParam)) ? TRUE : FALSE;
+
         case WM_COMMAND:
             switch (LOWORD(wParam))
             {
                 case IDCANCEL:
                     EndDialog(hDlg, 0);
                     return TRUE;
+                case IDC_CAMERA_SEARCH:
+                    if (HIWORD(wParam) != EN_CHANGE)
+                        return TRUE;
+                    FilterCameraList(hDlg);
+                    return TRUE;
                 case IDC_INVERT_Y:
+                {
                     if (HIWORD(wParam) != BN_CLICKED)
                         return TRUE;
-                    SetInvertYSetting(IsDlgButtonChecked(hDlg, IDC_INVERT_Y) == BST_CHECKED);
+                    const bool invertY = IsDlgButtonChecked(hDlg, IDC_INVERT_Y) == BST_CHECKED;
+                    SetInvertYSetting(invertY);
+                    SetInputInvertY(invertY);
                     return TRUE;
+                }
                 case IDC_DISABLE_RETURN_HOME:
                     if (HIWORD(wParam) != BN_CLICKED)
                         return TRUE;
@@ -275,8 +489,8 @@ INT_PTR CALLBACK MainDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam)
 
         case WM_DESTROY:
             SetLogAnchorWindow(nullptr);
+            SetNetworkEventNotifier(nullptr);
             KillTimer(hDlg, 0);
-            StopNetworkWorker();
             FreeDirectInput();
             return TRUE;
     }
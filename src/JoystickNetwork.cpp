@@ -1,24 +1,48 @@
 #include "JoystickNetwork.h"
 
+#include "AsyncHttp.h"
+#include "AsyncTask.h"
+#include "CameraDriver.h"
+#include "CameraEventStream.h"
+#include "CircuitBreaker.h"
+#include "FlightRecorder.h"
 #include "JsonUtils.h"
+#include "LatestValueMailbox.h"
 #include "LogUtils.h"
+#include "NetworkEvents.h"
+#include "NetworkReactor.h"
+#include "OnvifCameraDriver.h"
+#include "PipelineTrace.h"
 #include "RegistryUtils.h"
+#include "StartupTrace.h"
 #include "StringUtils.h"
+#include "TaskPool.h"
+#include "ViscaCameraDriver.h"
 
 #include <Windows.h>
 #include <winhttp.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
+#include <string_view>
 #include <vector>
 
 namespace {
-constexpr auto kSendInterval = std::chrono::milliseconds(16);
+// A stick position older than this is not sent; the input thread produces a
+// fresh one every poll while the stick is deflected.
+constexpr auto kMoveDeadline = std::chrono::milliseconds(250);
 constexpr wchar_t kRegistrySubkey[] = L"SOFTWARE\\JoystickTesting";
 constexpr wchar_t kRegistryInvertYName[] = L"Invert Y";
 constexpr wchar_t kRegistryControllerAddressName[] = L"Controller Address";
@@ -26,20 +50,65 @@ constexpr wchar_t kRegistryUsernameName[] = L"Username";
 constexpr wchar_t kRegistryPasswordName[] = L"Password";
 constexpr wchar_t kRegistryUseApiKeyName[] = L"Use API Key";
 constexpr wchar_t kRegistryApiKeyName[] = L"API Key";
+// Nonzero offers HTTP/2 to the controller, so moves, settings and list
+// requests share one connection instead of queueing for one each.
+constexpr wchar_t kRegistryUseHttp2Name[] = L"Use HTTP/2";
+// host[:port] of a plain ws:// stand-in that replaces the controller's
+// device subscription, for exercising the event stream locally.
+constexpr wchar_t kRegistryEventStreamAddressName[] = L"Event Stream Address";
+// Values named by camera ID, holding "address[:port]": those cameras are
+// driven with VISCA over UDP rather than through the controller.
+constexpr wchar_t kRegistryViscaCamerasSubkey[] = L"SOFTWARE\\JoystickTesting\\VISCA Cameras";
+// A subkey per camera ID holding "Address" (host[:port]) and optionally
+// "Username", "Password", "PTZ Path", "Media Path" and "Use TLS": those
+// cameras are driven with ONVIF PTZ.
+constexpr wchar_t kRegistryOnvifCamerasSubkey[] = L"SOFTWARE\\JoystickTesting\\ONVIF Cameras";
 constexpr DWORD kReturnHomeAfterInactivityMs = 60000;
+// Settings GETs that may be in flight beside the worker's other requests.
+constexpr size_t kPrefetchConcurrency = 2;
+// Pushed device events keep the cache current; this only bounds drift when
+// the event stream is down.
+constexpr auto kSettingsMaxAge = std::chrono::minutes(5);
+// Unacknowledged stops are retried from 50 ms, doubling up to 1 s.
+constexpr auto kStopRetryInitial = std::chrono::milliseconds(50);
+constexpr auto kStopRetryMax = std::chrono::seconds(1);
+// A move issued before a stop and still in flight this long may land after
+// it; the watchdog re-sends the stop at this interval until the move ends.
+constexpr auto kMoveStallTimeout = std::chrono::milliseconds(250);
+constexpr DWORD kStopTimeoutMs = 2000;
+// An idle controller connection is refreshed this often, well inside the
+// keep-alive timeouts of common servers.
+constexpr auto kKeepAliveInterval = std::chrono::seconds(20);
+// A warm-up is skipped if the controller was reached this recently.
+constexpr auto kWarmWindow = std::chrono::seconds(10);
+constexpr DWORD kWarmTimeoutMs = 3000;
+// Controller deadlines per request class: a move is soon replaced by a
+// newer sample, so it gives up fast; the camera list may be long.
+constexpr HttpTimeouts kMoveTimeouts = { 1000, 500, 750 };
+constexpr HttpTimeouts kSettingsTimeouts = { 2000, 2000, 5000 };
+constexpr HttpTimeouts kListTimeouts = { 3000, 3000, 15000 };
+constexpr HttpTimeouts kLoginTimeouts = { 3000, 3000, 10000 };
+// A move this long after the previous round counts as the first after idle.
+constexpr auto kMoveIdleThreshold = std::chrono::seconds(10);
 
 struct NetworkConfig
 {
     std::wstring host = L"192.168.3.251";
     INTERNET_PORT port = 443;
-    std::wstring loginPath = L"/api/auth/login";
-    std::wstring cameraBasePath = L"/proxy/protect/api/cameras/";
-    std::wstring cameraMoveSuffix = L"/move";
-    std::wstring cameraListPath = L"/proxy/protect/integration/v1/cameras";
+    std::string loginPath = "/api/auth/login";
+    std::string cameraBasePath = "/proxy/protect/api/cameras/";
+    std::string cameraMoveSuffix = "/move";
+    std::string cameraListPath = "/proxy/protect/integration/v1/cameras";
+    std::string eventStreamPath = "/proxy/protect/integration/v1/subscribe/devices";
+    // Empty: subscribe on the controller itself over TLS.
+    std::wstring eventStreamHost;
+    INTERNET_PORT eventStreamPort = 80;
     std::string username;
     std::string password;
-    std::string apiKey;
+    // Only ever sent as a WinHTTP header, so it is kept wide.
+    std::wstring apiKey;
     bool useApiKey = false;
+    bool useHttp2 = false;
 };
 
 NetworkConfig& GetNetworkConfig()
@@ -59,7 +128,7 @@ std::string BuildLoginPayload(const NetworkConfig& config)
 }
 
 
-void ApplyHostAndPort(NetworkConfig& config, const std::wstring& address)
+void ApplyHostAndPort(const std::wstring& address, std::wstring* host, INTERNET_PORT* port)
 {
     if (address.empty())
         return;
@@ -67,52 +136,49 @@ void ApplyHostAndPort(NetworkConfig& config, const std::wstring& address)
     const size_t colon = address.find(L':');
     if (colon == std::wstring::npos)
     {
-        config.host = address;
+        *host = address;
         return;
     }
 
-    config.host = address.substr(0, colon);
+    *host = address.substr(0, colon);
     const std::wstring portText = address.substr(colon + 1);
     if (!portText.empty())
     {
         const unsigned long portValue = wcstoul(portText.c_str(), nullptr, 10);
         if (portValue > 0 && portValue <= 65535)
-            config.port = static_cast<INTERNET_PORT>(portValue);
+            *port = static_cast<INTERNET_PORT>(portValue);
     }
 }
 
 bool LoadConfigFromRegistry(NetworkConfig& config)
 {
+    ScopedStartupPhase phase(L"Registry load");
     const std::wstring controllerAddress =
         TrimWide(ReadRegistryString(kRegistrySubkey, kRegistryControllerAddressName));
     const std::wstring userName = TrimWide(ReadRegistryString(kRegistrySubkey, kRegistryUsernameName));
     const std::wstring password = TrimWide(ReadRegistryString(kRegistrySubkey, kRegistryPasswordName));
     const std::wstring apiKey = TrimWide(ReadRegistryString(kRegistrySubkey, kRegistryApiKeyName));
+    const std::wstring eventStreamAddress =
+        TrimWide(ReadRegistryString(kRegistrySubkey, kRegistryEventStreamAddressName));
     DWORD useApiKeyValue = 0;
     ReadRegistryDword(kRegistrySubkey, kRegistryUseApiKeyName, &useApiKeyValue);
+    DWORD useHttp2Value = 0;
+    ReadRegistryDword(kRegistrySubkey, kRegistryUseHttp2Name, &useHttp2Value);
 
     if (controllerAddress.empty())
         return false;
 
-    ApplyHostAndPort(config, controllerAddress);
+    ApplyHostAndPort(controllerAddress, &config.host, &config.port);
+    config.eventStreamHost.clear();
+    ApplyHostAndPort(eventStreamAddress, &config.eventStreamHost, &config.eventStreamPort);
     config.username = WideToUtf8(userName);
     config.password = WideToUtf8(password);
-    config.apiKey = WideToUtf8(apiKey);
+    config.apiKey = apiKey;
     config.useApiKey = (useApiKeyValue != 0);
+    config.useHttp2 = (useHttp2Value != 0);
     return true;
 }
 
-std::string BuildMovePayload(const JoystickState& state)
-{
-    return "{"
-        "\"type\":\"continuous\","
-        "\"payload\":{"
-        "\"x\":" + std::to_string(static_cast<int>(state.x)) + ","
-        "\"y\":" + std::to_string(static_cast<int>(state.y)) + ","
-        "\"z\":" + std::to_string(static_cast<int>(state.z)) +
-        "}}";
-}
-
 std::string BuildReturnHomePayload(bool disabled)
 {
     if (disabled)
@@ -122,131 +188,96 @@ std::string BuildReturnHomePayload(bool disabled)
         std::to_string(kReturnHomeAfterInactivityMs) + "}}";
 }
 
-struct HttpResponse
+// A stick position stamped when it was captured; past |deadline| it is stale.
+// |traceId| and |capturedNs| tie its pipeline trace spans together.
+struct TimedJoystickState
 {
-    DWORD status = 0;
-    std::wstring setCookieHeader;
-    std::wstring csrfToken;
+    JoystickState state = {};
+    std::chrono::steady_clock::time_point deadline;
+    uint64_t traceId = 0;
+    uint64_t capturedNs = 0;
 };
 
-std::wstring ExtractCookiePair(const std::wstring& setCookieHeader)
+TimedJoystickState StampMove(const JoystickState& state)
 {
-    const size_t end = setCookieHeader.find(L';');
-    if (end == std::wstring::npos)
-        return setCookieHeader;
-    return setCookieHeader.substr(0, end);
+    TimedJoystickState move;
+    move.state = state;
+    move.deadline = std::chrono::steady_clock::now() + kMoveDeadline;
+    move.traceId = NextTraceId();
+    move.capturedNs = TraceNow();
+    return move;
 }
 
-std::wstring JoinCookies(const std::vector<std::wstring>& cookies)
+// The selection-following stick's latest position. |selectionGeneration|
+// is the camera selection it was captured under.
+struct SelectedMove
 {
-    std::wstring result;
-    for (size_t i = 0; i < cookies.size(); ++i)
-    {
-        if (i > 0)
-            result += L"; ";
-        result += cookies[i];
-    }
-    return result;
-}
+    TimedJoystickState move;
+    uint64_t selectionGeneration = 0;
+};
 
-std::wstring ReadHeaderValue(HINTERNET request, DWORD query, const wchar_t* name)
+struct CameraMove
 {
-    DWORD size = 0;
-    if (!WinHttpQueryHeaders(request, query, name, nullptr, &size, nullptr))
-    {
-        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
-            return L"";
-    }
-
-    std::wstring buffer;
-    buffer.resize(size / sizeof(wchar_t));
-    if (!WinHttpQueryHeaders(request, query, name, buffer.data(), &size, nullptr))
-        return L"";
-
-    if (!buffer.empty() && buffer.back() == L'\0')
-        buffer.pop_back();
-    return buffer;
-}
+    std::string cameraId;
+    TimedJoystickState move;
+};
 
-std::vector<std::wstring> ReadSetCookieHeaders(HINTERNET request)
+struct CameraSettings
 {
-    std::vector<std::wstring> cookies;
-    DWORD index = 0;
-
-    for (;;)
-    {
-        DWORD size = 0;
-        if (!WinHttpQueryHeaders(request, WINHTTP_QUERY_SET_COOKIE, WINHTTP_HEADER_NAME_BY_INDEX,
-            nullptr, &size, &index))
-        {
-            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
-                break;
-        }
-
-        std::wstring buffer;
-        buffer.resize(size / sizeof(wchar_t));
-        if (!WinHttpQueryHeaders(request, WINHTTP_QUERY_SET_COOKIE, WINHTTP_HEADER_NAME_BY_INDEX,
-            buffer.data(), &size, &index))
-        {
-            break;
-        }
-
-        if (!buffer.empty() && buffer.back() == L'\0')
-            buffer.pop_back();
-
-        if (!buffer.empty())
-            cookies.push_back(ExtractCookiePair(buffer));
-    }
-
-    return cookies;
-}
+    bool returnHomeDisabled = false;
+    std::chrono::steady_clock::time_point fetchedAt;
+};
 
-std::wstring FormatWin32Error(DWORD error)
+struct PendingStop
 {
-    if (error == 0)
-        return L"";
-
-    wchar_t* messageBuffer = nullptr;
-    const DWORD length = FormatMessageW(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-        nullptr,
-        error,
-        0,
-        reinterpret_cast<LPWSTR>(&messageBuffer),
-        0,
-        nullptr);
-
-    if (length == 0 || !messageBuffer)
-        return L"";
+    uint64_t sequence = 0;
+    std::chrono::steady_clock::time_point submittedAt;
+    std::chrono::steady_clock::time_point nextAttempt;
+    uint32_t attempts = 0;
+    bool sending = false;
+};
 
-    std::wstring message(messageBuffer, length);
-    LocalFree(messageBuffer);
+struct MoveInFlight
+{
+    // The camera's stop sequence when the move was issued.
+    uint64_t stopSequence = 0;
+    std::chrono::steady_clock::time_point startedAt;
+    std::chrono::steady_clock::time_point lastWatchdogStop;
+    // Cancelled to abandon the move for a newer one, or on shutdown.
+    std::shared_ptr<CancellationSource> cancellation;
+};
 
-    while (!message.empty())
-    {
-        const wchar_t ch = message.back();
-        if (ch == L'\r' || ch == L'\n')
-            message.pop_back();
-        else
-            break;
-    }
+struct CameraMoveResult
+{
+    const CameraDriver* driver = nullptr;
+    CameraCommandResult command;
+    double latencyMs = 0.0;
+    // Expired before it could be sent, or acknowledged after its deadline.
+    bool expired = false;
+    bool late = false;
+};
 
-    return message;
-}
+// A flow that runs once more if it is requested again while running, so
+// bursts of requests collapse into at most one run in flight.
+struct CoalescedFlow
+{
+    bool requested = false;
+    bool running = false;
+};
 
-std::wstring RedactPassword(const std::string& payload)
+std::string RedactPassword(const std::string& payload)
 {
     const std::string key = "\"password\":\"";
     const size_t start = payload.find(key);
     if (start == std::string::npos)
-        return Utf8ToWide(payload);
+        return payload;
 
     const size_t valueStart = start + key.size();
     const size_t end = payload.find("\"", valueStart);
     std::string redacted = payload;
     if (end != std::string::npos)
         redacted.replace(valueStart, end - valueStart, "****");
-    return Utf8ToWide(redacted);
+    return redacted;
 }
 
 std::wstring DescribeSecureFailureFlags(DWORD flags)
@@ -280,483 +311,1483 @@ std::wstring DescribeSecureFailureFlags(DWORD flags)
     return result;
 }
 
-class NetworkWorker;
+std::wstring BuildAuthHeaders(const std::wstring& cookieHeader,
+    const std::wstring& csrfToken,
+    const std::wstring& apiKey)
+{
+    std::wstring headers;
+    if (!csrfToken.empty())
+    {
+        headers += L"X-CSRF-Token: ";
+        headers += csrfToken;
+        headers += L"\r\n";
+    }
+    if (!cookieHeader.empty())
+    {
+        headers += L"Cookie: ";
+        headers += cookieHeader;
+        headers += L"\r\n";
+    }
+    if (!apiKey.empty())
+    {
+        headers += L"X-API-Key: ";
+        headers += apiKey;
+        headers += L"\r\n";
+    }
+    return headers;
+}
 
-void CALLBACK WinHttpStatusCallback(
-    HINTERNET,
-    DWORD_PTR context,
-    DWORD status,
-    LPVOID statusInfo,
-    DWORD statusInfoLength);
+// Moves through the controller's REST API on the worker's session; the
+// worker handles login and re-authentication around it.
+class ProtectCameraDriver : public CameraDriver
+{
+public:
+    using Sender = std::function<Task<HttpResult>(std::string path, std::string payload, DWORD timeoutMs,
+        std::shared_ptr<CancellationSource> cancellation)>;
 
-HRESULT SendJsonRequest(HINTERNET connection,
-    const wchar_t* method,
-    const std::wstring& path,
-    const std::string& payload,
-    const std::wstring& cookieHeader,
-    const std::wstring& csrfToken,
-    const std::string& apiKey,
-    HttpResponse* response,
-    DWORD* outWin32Error,
-    std::wstring* outErrorText,
-    std::string* outResponseBody,
-    NetworkWorker* statusContext);
+    explicit ProtectCameraDriver(Sender send)
+        : send_(std::move(send))
+    {
+    }
+
+    const char* Name() const override { return "HTTPS"; }
+
+    Task<CameraCommandResult> SendMove(std::string cameraId, JoystickState state, DWORD timeoutMs,
+        std::shared_ptr<CancellationSource> cancellation) override
+    {
+        const NetworkConfig& config = GetNetworkConfig();
+        std::string payload;
+        {
+            ScopedTraceSpan span(TraceStage::Serialize);
+            payload = JsonUtils::BuildMovePayload(state);
+        }
+        const HttpResult sent = co_await send_(
+            config.cameraBasePath + cameraId + config.cameraMoveSuffix, std::move(payload),
+            timeoutMs, std::move(cancellation));
+
+        CameraCommandResult result;
+        result.hr = sent.hr;
+        result.error = sent.error;
+        result.errorText = sent.errorText;
+        result.httpStatus = sent.response.status;
+        result.newConnection = sent.newConnection;
+        result.timedOut = sent.timedOut;
+        result.cancelled = sent.cancelled;
+        result.acknowledged = SUCCEEDED(sent.hr) && sent.response.status >= 200 && sent.response.status < 300;
+        co_return result;
+    }
 
+private:
+    Sender send_;
+};
+
+// Acknowledged moves per driver, for comparing the transports.
+struct MoveLatencyStats
+{
+    uint32_t acknowledged = 0;
+    double meanMs = 0.0;
+    double maxMs = 0.0;
+};
+
+NetworkEventQueue& GetNetworkEventQueue()
+{
+    static NetworkEventQueue queue;
+    return queue;
+}
+
+// Network flows run as coroutines on one reactor thread: moves, stops, the
+// camera list, settings queries and prefetches each await their own requests,
+// so a slow one never holds up the rest. Public methods post to the reactor;
+// only what other threads read is behind a mutex, and what the UI shows is
+// pushed to it as events.
 class NetworkWorker
 {
 public:
     void Start()
     {
-        std::scoped_lock lock(mutex_);
         if (running_)
             return;
-        running_ = true;
-        stopRequested_ = false;
-        needsReturnHomeQuery_ = true;
-        needsCameraListRefresh_ = true;
-        configDirty_ = false;
         SetStatus(L"Starting");
-        worker_ = std::thread(&NetworkWorker::Run, this);
+        if (!reactor_.Start())
+        {
+            SetStatus(L"Network init failed");
+            return;
+        }
+        running_ = true;
+        {
+            std::scoped_lock lock(statsMutex_);
+            connectionStats_ = {};
+            statsStartedAt_ = std::chrono::steady_clock::now();
+        }
+        reactor_.Post([this]() { OnStart(); });
+        StartEventStream();
     }
 
     void Stop()
     {
-        {
-            std::scoped_lock lock(mutex_);
-            if (!running_)
-                return;
-            stopRequested_ = true;
-        }
-        cv_.notify_all();
-        if (worker_.joinable())
-            worker_.join();
-
-        SendReturnHomeOnStop();
+        if (!running_)
+            return;
 
-        std::scoped_lock lock(mutex_);
+        reactor_.Post([this]() { BeginShutdown(); });
+        reactor_.Stop();
         running_ = false;
+        // Only now: a config change on the reactor could have restarted it.
+        StopCameraEventStream();
+
+        LogMoveDeadlineStats();
+        LogTimeoutStats();
+        LogMoveLatencyStats();
+        LogConnectionStats();
+        LogStopLatencyStats();
+
+        // The reactor thread has exited, so its state is safe to reset here.
+        SelectedMove discarded;
+        selectedMoves_.Take(&discarded);
+        moveLoopIdle_ = false;
         hasState_ = false;
-        hasReturnHomeSetting_ = false;
+        pendingCameraMoves_.clear();
         returnHomeStateKnown_ = false;
-        hasCameraListUpdate_ = false;
-        cameraList_.clear();
         selectedCameraId_.clear();
-        needsCameraListRefresh_ = true;
-        configDirty_ = false;
+        settingsCache_.clear();
+        prefetchQueue_.clear();
+        pendingStops_.clear();
+        movesInFlight_.clear();
+        listRefresh_ = {};
+        returnHomeQuery_ = {};
+        returnHomeUpdate_ = {};
+        warmUp_ = {};
+        lastRequestAt_ = {};
+        lastMoveAt_ = {};
+        breaker_.Reset();
+        cameraList_.reset();
+        cameraDrivers_.clear();
+        moveLatency_.clear();
+        viscaDriver_.Close();
+        onvifDriver_.Close();
         CloseHandles();
         ResetAuth();
         SetStatus(L"Stopped");
     }
 
-    void Submit(const JoystickState& state)
+    // Input thread. Publishes without locking. An idle move loop is woken
+    // to send the sample; a busy one takes it when its round finishes, and
+    // meanwhile the sample supersedes the selected camera's move in flight.
+    void Submit(const JoystickState& state)
+    {
+        SelectedMove sample;
+        sample.move = StampMove(state);
+        sample.selectionGeneration = selectionGeneration_.load(std::memory_order_acquire);
+        selectedMoves_.Publish(sample);
+        if (moveLoopIdle_.exchange(false))
+            moveSignal_.Raise();
+        else
+            supersedeSignal_.Raise();
+    }
+
+    void SubmitForCamera(const std::string& cameraId, const JoystickState& state)
+    {
+        const TimedJoystickState move = StampMove(state);
+        reactor_.Post([this, cameraId, move]()
+        {
+            if (stopping_)
+                return;
+            pendingCameraMoves_[cameraId] = move;
+            CancelStop(cameraId);
+            SupersedeMoveInFlight(cameraId);
+            moveReady_.NotifyAll();
+        });
+    }
+
+    // Stops skip the move slot: a queued move for the camera is dropped and
+    // the stop goes out at once, beside any move still in flight.
+    void SubmitStop()
+    {
+        reactor_.Post([this]()
+        {
+            // Samples published before the stop must not follow it.
+            SelectedMove discarded;
+            selectedMoves_.Take(&discarded);
+            hasState_ = false;
+            if (!selectedCameraId_.empty())
+                QueueStop(selectedCameraId_);
+        });
+    }
+
+    void SubmitStopForCamera(const std::string& cameraId)
+    {
+        reactor_.Post([this, cameraId]()
+        {
+            pendingCameraMoves_.erase(cameraId);
+            QueueStop(cameraId);
+        });
+    }
+
+    ConnectionStats GetConnectionStats()
+    {
+        std::scoped_lock lock(statsMutex_);
+        ConnectionStats stats = connectionStats_;
+        const double hours = std::chrono::duration<double, std::ratio<3600>>(
+            std::chrono::steady_clock::now() - statsStartedAt_).count();
+        // Under a minute in, a rate would mostly be the initial connect.
+        stats.handshakesPerHour = stats.handshakes / std::max(hours, 1.0 / 60.0);
+        return stats;
+    }
+
+    TimeoutStats GetTimeoutStats()
+    {
+        TimeoutStats stats;
+        stats.requests = requestTimeouts_;
+        stats.moves = moveTimeouts_;
+        stats.stops = stopTimeouts_;
+        stats.movesSuperseded = movesSuperseded_;
+        stats.movesStalled = movesStalled_;
+        return stats;
+    }
+
+    MoveDeadlineStats GetMoveDeadlineStats()
+    {
+        MoveDeadlineStats stats;
+        stats.sent = movesSent_;
+        stats.dropped = movesDropped_;
+        stats.late = movesLate_;
+        return stats;
+    }
+
+    StopLatencyStats GetStopLatencyStats()
+    {
+        std::scoped_lock lock(statsMutex_);
+        return stopStats_;
+    }
+
+    void SubmitReturnHomeSetting(bool disabled)
+    {
+        reactor_.Post([this, disabled]()
+        {
+            returnHomeDisabled_ = disabled;
+            RequestFlow(returnHomeUpdate_, &NetworkWorker::UpdateReturnHome);
+        });
+    }
+
+    void NotifyConfigChanged()
+    {
+        reactor_.Post([this]()
+        {
+            // The subscription may point at the old controller.
+            StopCameraEventStream();
+            cameraDrivers_.clear();
+            // The session stays, with its pooled connections; the next
+            // login reconnects only if the address changed.
+            breaker_.Reset();
+            breakerChanged_.NotifyAll();
+            ResetAuth();
+            StartEventStream();
+        });
+    }
+
+    void RequestCameraListRefresh()
+    {
+        reactor_.Post([this]() { RequestFlow(listRefresh_, &NetworkWorker::RefreshCameraList); });
+    }
+
+    void SetSelectedCamera(CameraHandle camera)
+    {
+        reactor_.Post([this, camera]() { SelectCamera(std::string(catalog_.IdOf(camera))); });
+    }
+
+private:
+    void OnStart()
+    {
+        stopping_ = false;
+        returnHomeStateKnown_ = false;
+        shutdownCancel_ = std::make_shared<CancellationSource>();
+        reactor_.Spawn(MoveLoop());
+        reactor_.Spawn(StopLane());
+        reactor_.Spawn(KeepAliveLoop());
+        reactor_.Spawn(BreakerLoop());
+        for (size_t i = 0; i < kPrefetchConcurrency; ++i)
+            reactor_.Spawn(PrefetchLoop());
+        RequestFlow(listRefresh_, &NetworkWorker::RefreshCameraList);
+        RequestFlow(returnHomeQuery_, &NetworkWorker::QueryReturnHome);
+    }
+
+    // Wakes every loop so it can exit; the reactor stops once all flows,
+    // including the final settings PATCH, have finished.
+    void BeginShutdown()
+    {
+        stopping_ = true;
+        // Requests in flight would otherwise hold the reactor for up to
+        // their timeouts. Stops are left to finish: a camera must not be
+        // left moving.
+        shutdownCancel_->Cancel();
+        shutdownCancel_ = std::make_shared<CancellationSource>();
+        for (auto& [cameraId, move] : movesInFlight_)
+            move.cancellation->Cancel();
+        moveReady_.NotifyAll();
+        stopReady_.NotifyAll();
+        prefetchReady_.NotifyAll();
+        keepAliveReady_.NotifyAll();
+        breakerChanged_.NotifyAll();
+        if (!selectedCameraId_.empty())
+            reactor_.Spawn(SendReturnHomeOnStop(selectedCameraId_));
+    }
+
+    void SelectCamera(const std::string& cameraId)
+    {
+        if (selectedCameraId_ == cameraId)
+            return;
+        selectedCameraId_ = cameraId;
+        // Samples captured under the old selection are dropped.
+        selectionGeneration_.fetch_add(1, std::memory_order_release);
+        hasState_ = false;
+        if (!cameraId.empty() && &DriverFor(cameraId) == &protectDriver_)
+            RequestFlow(warmUp_, &NetworkWorker::WarmConnection);
+
+        // A cached setting makes the switch immediate; otherwise it is
+        // queried beside the moves.
+        auto it = settingsCache_.find(cameraId);
+        if (!cameraId.empty() && it != settingsCache_.end())
+        {
+            returnHomeStateKnown_ = true;
+            PublishReturnHomeState(it->second.returnHomeDisabled);
+            return;
+        }
+        returnHomeStateKnown_ = false;
+        RequestFlow(returnHomeQuery_, &NetworkWorker::QueryReturnHome);
+    }
+
+    void RequestFlow(CoalescedFlow& flow, Task<void> (NetworkWorker::*run)())
+    {
+        if (stopping_)
+            return;
+        flow.requested = true;
+        if (flow.running)
+            return;
+        flow.running = true;
+        reactor_.Spawn(RunCoalescedFlow(flow, run));
+    }
+
+    Task<void> RunCoalescedFlow(CoalescedFlow& flow, Task<void> (NetworkWorker::*run)())
+    {
+        while (flow.requested && !stopping_)
+        {
+            flow.requested = false;
+            co_await (this->*run)();
+        }
+        flow.running = false;
+    }
+
+    Task<void> MoveLoop()
+    {
+        while (!stopping_)
+        {
+            TakeSelectedMove();
+            if (!hasState_ && pendingCameraMoves_.empty())
+            {
+                // Re-check after going idle: a sample published just before
+                // saw the loop busy and did not raise the signal.
+                moveLoopIdle_ = true;
+                if (selectedMoves_.HasUpdate())
+                {
+                    moveLoopIdle_ = false;
+                    continue;
+                }
+                co_await moveReady_.Wait();
+                continue;
+            }
+
+            // Sticks bound to a specific camera take precedence over the
+            // selection-following stick for that camera.
+            std::vector<CameraMove> moves;
+            moves.reserve(pendingCameraMoves_.size() + 1);
+            for (const auto& [cameraId, move] : pendingCameraMoves_)
+                moves.push_back(CameraMove{ cameraId, move });
+            if (hasState_ && pendingCameraMoves_.find(selectedCameraId_) == pendingCameraMoves_.end() &&
+                EnsureCameraSelected(selectedCameraId_))
+            {
+                moves.push_back(CameraMove{ selectedCameraId_, latestState_ });
+            }
+            hasState_ = false;
+            pendingCameraMoves_.clear();
+
+            const uint64_t takenNs = TraceNow();
+            for (const auto& move : moves)
+                RecordTraceSpan(TraceStage::WorkerWakeup, move.move.capturedNs, takenNs, move.move.traceId);
+
+            co_await SendMoves(std::move(moves));
+
+            if (!returnHomeStateKnown_)
+                RequestFlow(returnHomeQuery_, &NetworkWorker::QueryReturnHome);
+        }
+    }
+
+    void TakeSelectedMove()
+    {
+        SelectedMove sample;
+        if (!selectedMoves_.Take(&sample))
+            return;
+        if (sample.selectionGeneration != selectionGeneration_.load(std::memory_order_relaxed))
+            return;
+
+        latestState_ = sample.move;
+        hasState_ = true;
+        CancelStop(selectedCameraId_);
+    }
+
+    bool EnsureCameraSelected(const std::string& cameraId)
+    {
+        if (!cameraId.empty())
+            return true;
+
+        SetStatus(L"No camera selected");
+        return false;
+    }
+
+    static bool IsHttpSuccess(DWORD status)
+    {
+        return status >= 200 && status < 300;
+    }
+
+    bool HandleUnauthorizedStatus(DWORD status)
+    {
+        if (status != 401 && status != 403)
+            return false;
+
+        SetStatusHttp(L"Unauthorized", status);
+        ResetAuth();
+        return true;
+    }
+
+    Task<void> RefreshCameraList()
+    {
+        if (!co_await EnsureLogin())
+            co_return;
+
+        ScopedStartupPhase phase(L"Camera list");
+        const HttpResult result = co_await SendRequestWithReauth(
+            L"GET", GetNetworkConfig().cameraListPath, "", kListTimeouts, shutdownCancel_);
+        if (result.cancelled)
+            co_return;
+        if (FAILED(result.hr))
+        {
+            SetStatusError(L"Camera list failed", result.error, result.errorText);
+            co_return;
+        }
+
+        SetStatusHttp(L"Camera list", result.response.status);
+        if (HandleUnauthorizedStatus(result.response.status) || !IsHttpSuccess(result.response.status))
+            co_return;
+
+        // Large controllers return big lists; parse off the reactor.
+        std::vector<CameraInfo> cameras;
+        bool parsed = false;
+        co_await RunOnTaskPool(reactor_,
+            [&]()
+            {
+                ScopedTraceSpan span(TraceStage::Parse);
+                parsed = JsonUtils::TryParseCameraList(result.body, &cameras);
+            });
+        if (!parsed)
+        {
+            AppendLogLine("Camera list parse failed");
+            co_return;
+        }
+
+        AppendLogLine("Camera list parsed: " + std::to_string(cameras.size()));
+        std::vector<std::string> uncached;
+        for (const auto& camera : cameras)
+        {
+            if (camera.hasReturnHome)
+                UpdateCameraSettings(camera.id, camera.returnHomeDisabled);
+            else
+                uncached.push_back(camera.id);
+        }
+        EnqueuePrefetch(uncached);
+
+        cameraList_ = catalog_.BuildSnapshot(cameras);
+        NetworkEvent listEvent;
+        listEvent.type = NetworkEventType::CameraListReplaced;
+        listEvent.cameras = cameraList_;
+        GetNetworkEventQueue().Push(std::move(listEvent));
+    }
+
+    void StartEventStream()
+    {
+        StartCameraEventStream(
+            [this](CameraEventStreamEndpoint* endpoint) { return GetEventStreamEndpoint(endpoint); },
+            [this](bool reconnected) { HandleEventStreamConnected(reconnected); },
+            [this](const std::string& message) { HandleDeviceEventMessage(message); });
+    }
+
+    bool GetEventStreamEndpoint(CameraEventStreamEndpoint* endpoint)
+    {
+        std::scoped_lock lock(sessionMutex_);
+        if (!sessionPublished_)
+            return false;
+        *endpoint = eventStreamEndpoint_;
+        return true;
+    }
+
+    // Called once the session is authenticated; the event stream picks it
+    // up on its next connect.
+    void PublishSession()
+    {
+        const NetworkConfig& config = GetNetworkConfig();
+        CameraEventStreamEndpoint endpoint;
+        endpoint.path = Utf8ToWide(config.eventStreamPath);
+        endpoint.headers = authHeaders_;
+        if (config.eventStreamHost.empty())
+        {
+            endpoint.host = config.host;
+            endpoint.port = config.port;
+            endpoint.secure = true;
+        }
+        else
+        {
+            endpoint.host = config.eventStreamHost;
+            endpoint.port = config.eventStreamPort;
+            endpoint.secure = false;
+        }
+
+        std::scoped_lock lock(sessionMutex_);
+        eventStreamEndpoint_ = std::move(endpoint);
+        sessionPublished_ = true;
+    }
+
+    // Runs on the event stream thread.
+    void HandleEventStreamConnected(bool reconnected)
+    {
+        // Changes made while disconnected were not pushed; resync once.
+        if (reconnected)
+            RequestCameraListRefresh();
+    }
+
+    // Runs on the event stream thread; parsing stays there and the result
+    // is applied on the reactor.
+    void HandleDeviceEventMessage(const std::string& message)
+    {
+        JsonUtils::DeviceEvent event;
+        if (!JsonUtils::TryParseDeviceEvent(message, &event))
+            return;
+        if (!event.modelKey.empty() && event.modelKey != "camera")
+            return;
+
+        reactor_.Post([this, event = std::move(event)]() { ApplyDeviceEvent(event); });
+    }
+
+    void ApplyDeviceEvent(const JsonUtils::DeviceEvent& event)
+    {
+        const std::string& cameraId = event.camera.id;
+        const bool listChanged = PatchCameraList(event);
+
+        if (event.type == JsonUtils::DeviceEventType::Remove)
+            DropCameraSettings(cameraId);
+        else if (event.camera.hasReturnHome)
+            UpdateCameraSettings(cameraId, event.camera.returnHomeDisabled);
+        if (listChanged || event.camera.hasReturnHome)
+            AppendLogLine("Camera pushed update: " + cameraId);
+    }
+
+    Task<void> QueryReturnHome()
+    {
+        const std::string cameraId = selectedCameraId_;
+        if (!EnsureCameraSelected(cameraId) || !co_await EnsureLogin())
+            co_return;
+
+        const HttpResult result = co_await SendRequestWithReauth(
+            L"GET", GetNetworkConfig().cameraBasePath + cameraId, "", kSettingsTimeouts, shutdownCancel_);
+        if (result.cancelled)
+            co_return;
+        if (FAILED(result.hr))
+        {
+            SetStatusError(L"Return home query failed", result.error, result.errorText);
+            co_return;
+        }
+
+        SetStatusHttp(L"Return home query", result.response.status);
+        if (HandleUnauthorizedStatus(result.response.status) || !IsHttpSuccess(result.response.status))
+            co_return;
+
+        bool disabled = false;
+        if (!JsonUtils::TryParseReturnHomeDisabled(result.body, &disabled))
+        {
+            AppendLogLine("Return home parse failed");
+            co_return;
+        }
+
+        AppendLogLine(disabled ? "Return home parsed: disabled" : "Return home parsed: enabled");
+        UpdateCameraSettings(cameraId, disabled);
+    }
+
+    Task<void> UpdateReturnHome()
+    {
+        const std::string cameraId = selectedCameraId_;
+        const bool disabled = returnHomeDisabled_;
+        if (!EnsureCameraSelected(cameraId) || !co_await EnsureLogin())
+            co_return;
+
+        const HttpResult result = co_await SendRequestWithReauth(L"PATCH",
+            GetNetworkConfig().cameraBasePath + cameraId, BuildReturnHomePayload(disabled), kSettingsTimeouts,
+            shutdownCancel_);
+        if (result.cancelled)
+            co_return;
+        if (FAILED(result.hr))
+        {
+            SetStatusError(L"Return home update failed", result.error, result.errorText);
+            co_return;
+        }
+
+        SetStatusHttp(L"Return home updated", result.response.status);
+        if (HandleUnauthorizedStatus(result.response.status))
+            co_return;
+
+        // The controller may normalize the value; read it back rather than
+        // trusting what was sent.
+        if (IsHttpSuccess(result.response.status))
+            InvalidateCameraSettings(cameraId);
+    }
+
+    // The list shown to the UI is shared with it, so a change is made to a
+    // copy and published as a patch. Returns false when nothing changed.
+    bool PatchCameraList(const JsonUtils::DeviceEvent& event)
+    {
+        // Before the first full list there is nothing to patch; that list
+        // will include this change.
+        if (!cameraList_)
+            return false;
+
+        const std::string& cameraId = event.camera.id;
+        const CameraHandle handle = catalog_.Find(cameraId);
+        const CameraRecord* existing = cameraList_->Find(handle);
+        const bool remove = event.type == JsonUtils::DeviceEventType::Remove;
+
+        CameraInfo camera;
+        camera.id = cameraId;
+        if (existing)
+        {
+            camera.name = existing->name;
+            camera.state = existing->state;
+            camera.hasReturnHome = existing->hasReturnHome;
+            camera.returnHomeDisabled = existing->returnHomeDisabled;
+        }
+        else
+        {
+            camera.name = cameraId;
+        }
+        if (!remove)
+        {
+            if (event.hasName && !event.camera.name.empty())
+                camera.name = event.camera.name;
+            if (event.hasState)
+                camera.state = event.camera.state;
+        }
+        if (remove ? !existing
+            : (existing && camera.name == existing->name && camera.state == existing->state))
+        {
+            return false;
+        }
+
+        auto patch = std::make_shared<CameraListPatch>();
+        if (remove)
+        {
+            cameraList_ = catalog_.WithoutCamera(*cameraList_, handle);
+            patch->removed.push_back(handle);
+        }
+        else
+        {
+            cameraList_ = catalog_.WithCamera(*cameraList_, camera);
+            patch->changed.push_back(catalog_.Find(cameraId));
+        }
+
+        NetworkEvent patchEvent;
+        patchEvent.type = NetworkEventType::CameraListPatched;
+        patchEvent.cameras = cameraList_;
+        patchEvent.patch = std::move(patch);
+        GetNetworkEventQueue().Push(std::move(patchEvent));
+        return true;
+    }
+
+    void PublishReturnHomeState(bool disabled)
+    {
+        NetworkEvent event;
+        event.type = NetworkEventType::ReturnHomeState;
+        event.returnHomeDisabled = disabled;
+        GetNetworkEventQueue().Push(std::move(event));
+    }
+
+    // Caches |cameraId|'s settings and, when it is the selected camera,
+    // publishes them to the UI.
+    void UpdateCameraSettings(const std::string& cameraId, bool returnHomeDisabled)
+    {
+        CameraSettings& settings = settingsCache_[cameraId];
+        settings.returnHomeDisabled = returnHomeDisabled;
+        settings.fetchedAt = std::chrono::steady_clock::now();
+
+        if (cameraId != selectedCameraId_)
+            return;
+        returnHomeStateKnown_ = true;
+        PublishReturnHomeState(returnHomeDisabled);
+    }
+
+    void InvalidateCameraSettings(const std::string& cameraId)
+    {
+        settingsCache_.erase(cameraId);
+        EnqueuePrefetch({ cameraId });
+    }
+
+    void DropCameraSettings(const std::string& cameraId)
+    {
+        settingsCache_.erase(cameraId);
+        prefetchQueue_.erase(
+            std::remove(prefetchQueue_.begin(), prefetchQueue_.end(), cameraId),
+            prefetchQueue_.end());
+    }
+
+    void EnqueuePrefetch(const std::vector<std::string>& cameraIds)
+    {
+        if (cameraIds.empty())
+            return;
+        for (const auto& cameraId : cameraIds)
+        {
+            if (std::find(prefetchQueue_.begin(), prefetchQueue_.end(), cameraId) == prefetchQueue_.end())
+                prefetchQueue_.push_back(cameraId);
+        }
+        prefetchReady_.NotifyAll();
+    }
+
+    void EnqueueStaleSettings()
+    {
+        const auto oldest = std::chrono::steady_clock::now() - kSettingsMaxAge;
+        for (const auto& [cameraId, settings] : settingsCache_)
+        {
+            if (settings.fetchedAt < oldest &&
+                std::find(prefetchQueue_.begin(), prefetchQueue_.end(), cameraId) == prefetchQueue_.end())
+            {
+                prefetchQueue_.push_back(cameraId);
+            }
+        }
+    }
+
+    // kPrefetchConcurrency of these run, so that many settings GETs at most
+    // are in flight beside the other flows.
+    Task<void> PrefetchLoop()
+    {
+        while (!stopping_)
+        {
+            if (prefetchQueue_.empty())
+            {
+                co_await prefetchReady_.WaitUntil(std::chrono::steady_clock::now() + kSettingsMaxAge);
+                if (prefetchQueue_.empty())
+                    EnqueueStaleSettings();
+                continue;
+            }
+
+            const std::string cameraId = std::move(prefetchQueue_.front());
+            prefetchQueue_.pop_front();
+
+            // Before login there is nothing to fetch with; the next list
+            // refresh queues the camera again.
+            if (!loggedIn_)
+                continue;
+
+            const HttpResult result = co_await SendRequest(
+                L"GET", GetNetworkConfig().cameraBasePath + cameraId, "", kSettingsTimeouts, true, shutdownCancel_);
+            bool disabled = false;
+            if (SUCCEEDED(result.hr) && IsHttpSuccess(result.response.status) &&
+                JsonUtils::TryParseReturnHomeDisabled(result.body, &disabled))
+            {
+                UpdateCameraSettings(cameraId, disabled);
+            }
+        }
+    }
+
+    // Each camera gets its own request, all in flight together, so one slow
+    // camera does not hold up the others.
+    Task<void> SendMoves(std::vector<CameraMove> moves)
+    {
+        // Only moves through the controller wait for its login.
+        const auto viaController = [this](const CameraMove& move)
+        {
+            return &DriverFor(move.cameraId) == &protectDriver_;
+        };
+        // While the breaker is open they are dropped without a login attempt.
+        if (std::any_of(moves.begin(), moves.end(), viaController) &&
+            (!breaker_.WouldAdmit(std::chrono::steady_clock::now()) || !co_await EnsureLogin()))
+        {
+            moves.erase(std::remove_if(moves.begin(), moves.end(), viaController), moves.end());
+        }
+        if (moves.empty())
+            co_return;
+
+        const bool afterIdle = std::chrono::steady_clock::now() - lastMoveAt_ >= kMoveIdleThreshold;
+        std::vector<CameraMoveResult> results(moves.size());
+        TaskGroup group(reactor_);
+        for (size_t i = 0; i < moves.size(); ++i)
+            group.Spawn(SendMove(moves[i], &results[i]));
+        co_await group.Join();
+        lastMoveAt_ = std::chrono::steady_clock::now();
+        if (afterIdle)
+            RecordFirstMoveAfterIdle(results);
+
+        for (const auto& result : results)
+        {
+            if (result.expired)
+            {
+                ++movesDropped_;
+                continue;
+            }
+            ++movesSent_;
+            if (result.late)
+                ++movesLate_;
+
+            const CameraCommandResult& command = result.command;
+            if (command.timedOut)
+                ++moveTimeouts_;
+            // Superseded, or shut down; neither is worth a status.
+            if (command.cancelled)
+                continue;
+            if (FAILED(command.hr))
+            {
+                SetStatusError(L"Move failed", command.error, command.errorText);
+                continue;
+            }
+
+            if (command.httpStatus != 0)
+                SetStatusHttp(L"Move", command.httpStatus);
+            else
+                SetStatus((L"Move (" + Utf8ToWide(result.driver->Name()) + L")").c_str());
+            if (command.acknowledged)
+                MarkFirstMoveSent();
+            if (HandleUnauthorizedStatus(command.httpStatus))
+                break;
+        }
+    }
+
+    // Checked here rather than when the round was built: login may have
+    // delayed the send.
+    Task<void> SendMove(CameraMove move, CameraMoveResult* result)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (now > move.move.deadline)
+        {
+            result->expired = true;
+            const double overdueMs = std::chrono::duration<double, std::milli>(now - move.move.deadline).count();
+            char line[64] = {};
+            snprintf(line, sizeof(line), " (%.1f ms past deadline)", overdueMs);
+            AppendLogLine("Move dropped: " + move.cameraId + line);
+            co_return;
+        }
+
+        CameraDriver& driver = DriverFor(move.cameraId);
+        result->driver = &driver;
+        auto cancellation = BeginMoveInFlight(move.cameraId);
+        result->command = co_await driver.SendMove(move.cameraId, move.move.state, 0, std::move(cancellation));
+        EndMoveInFlight(move.cameraId);
+
+        const auto end = std::chrono::steady_clock::now();
+        result->late = end > move.move.deadline;
+        result->latencyMs = std::chrono::duration<double, std::milli>(end - now).count();
+        if (result->command.acknowledged)
+            RecordMoveLatency(driver, result->latencyMs);
+    }
+
+    void RecordFirstMoveAfterIdle(const std::vector<CameraMoveResult>& results)
+    {
+        const auto first = std::find_if(results.begin(), results.end(),
+            [](const CameraMoveResult& result) { return result.command.acknowledged; });
+        if (first == results.end())
+            return;
+
+        std::scoped_lock lock(statsMutex_);
+        ConnectionStats& stats = connectionStats_;
+        ++stats.firstMovesAfterIdle;
+        if (first->command.newConnection)
+            ++stats.coldFirstMoves;
+        stats.firstMoveMaxMs = std::max(stats.firstMoveMaxMs, first->latencyMs);
+        stats.firstMoveMeanMs += (first->latencyMs - stats.firstMoveMeanMs) / stats.firstMovesAfterIdle;
+    }
+
+    void NoteControllerResult(const HttpResult& result)
+    {
+        if (result.timedOut)
+            ++requestTimeouts_;
+        if (SUCCEEDED(result.hr) && result.response.status != 0 && result.http2 != controllerHttp2_)
+        {
+            controllerHttp2_ = result.http2;
+            AppendLogLine(controllerHttp2_ ? "Controller protocol: HTTP/2" : "Controller protocol: HTTP/1.1");
+        }
+        if (!result.newConnection)
+            return;
+        std::scoped_lock lock(statsMutex_);
+        ++connectionStats_.handshakes;
+    }
+
+    // Opens or refreshes the pooled controller connection with a request
+    // that has no body, so the next move skips the handshakes.
+    Task<void> WarmConnection()
+    {
+        if (std::chrono::steady_clock::now() - lastRequestAt_ < kWarmWindow || !co_await EnsureLogin())
+            co_return;
+        // Logging in may just have connected.
+        if (std::chrono::steady_clock::now() - lastRequestAt_ < kWarmWindow)
+            co_return;
+
+        if (!breaker_.Admit(std::chrono::steady_clock::now()))
+            co_return;
+        lastRequestAt_ = std::chrono::steady_clock::now();
+        HttpRequest request;
+        request.method = L"HEAD";
+        request.path = L"/";
+        request.timeouts = UniformHttpTimeouts(kWarmTimeoutMs);
+        request.cancellation = shutdownCancel_;
+        request.allowHttp2 = useHttp2_;
+        const HttpResult result = co_await SendHttpRequestAsync(reactor_, connection_, std::move(request));
+        NoteControllerResult(result);
+        NoteBreakerResult(result, true);
+    }
+
+    // Flows treat a refused request like a cancelled one: no status, since
+    // the breaker's own status explains it.
+    static HttpResult RefusedByBreaker()
+    {
+        HttpResult result;
+        result.hr = E_ABORT;
+        result.errorText = L"Controller offline";
+        result.cancelled = true;
+        return result;
+    }
+
+    void NoteBreakerResult(const HttpResult& result, bool countSuccess)
+    {
+        if (result.cancelled)
+            breaker_.RecordAbandoned();
+        else if (FAILED(result.hr) || result.response.status >= 500)
+            NoteBreakerFailure(false);
+        else if (countSuccess)
+            NoteBreakerSuccess();
+    }
+
+    void NoteBreakerSuccess()
+    {
+        if (!breaker_.RecordSuccess())
+            return;
+        AppendLogLine("Controller breaker closed");
+        breakerChanged_.NotifyAll();
+    }
+
+    void NoteBreakerFailure(bool openNow)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (!breaker_.RecordFailure(now, openNow))
+            return;
+
+        const long long delayMs =
+            std::chrono::duration_cast<std::chrono::milliseconds>(breaker_.NextProbe() - now).count();
+        char line[96] = {};
+        snprintf(line, sizeof(line), "Controller breaker open after %u failures; next probe in %lld ms",
+            breaker_.Failures(), delayMs);
+        AppendLogLine(line);
+        breakerChanged_.NotifyAll();
+    }
+
+    // Shows the time to the next probe while the breaker is open, and
+    // starts the probe, a list refresh, once it is due.
+    Task<void> BreakerLoop()
     {
+        while (!stopping_)
         {
-            std::scoped_lock lock(mutex_);
-            latestState_ = state;
-            hasState_ = true;
+            const auto now = std::chrono::steady_clock::now();
+            switch (breaker_.GetState())
+            {
+            case CircuitBreaker::State::Closed:
+                co_await breakerChanged_.Wait();
+                break;
+
+            case CircuitBreaker::State::HalfOpen:
+                SetStatus(L"Controller unreachable; retrying");
+                co_await breakerChanged_.Wait();
+                break;
+
+            case CircuitBreaker::State::Open:
+            {
+                const auto remaining = breaker_.NextProbe() - now;
+                if (remaining <= std::chrono::steady_clock::duration::zero())
+                {
+                    RequestFlow(listRefresh_, &NetworkWorker::RefreshCameraList);
+                    // Re-checked in a second in case nothing went out.
+                    co_await breakerChanged_.WaitUntil(now + std::chrono::seconds(1));
+                    break;
+                }
+
+                const auto seconds = std::chrono::ceil<std::chrono::seconds>(remaining);
+                const std::wstring status =
+                    L"Controller unreachable; next try in " + std::to_wstring(seconds.count()) + L" s";
+                SetStatus(status.c_str());
+                // Wakes when the whole seconds shown tick down.
+                co_await breakerChanged_.WaitUntil(breaker_.NextProbe() - (seconds - std::chrono::seconds(1)));
+                break;
+            }
+            }
         }
-        cv_.notify_all();
     }
 
-    void SubmitReturnHomeSetting(bool disabled)
+    Task<void> KeepAliveLoop()
     {
+        while (!stopping_)
         {
-            std::scoped_lock lock(mutex_);
-            returnHomeDisabled_ = disabled;
-            hasReturnHomeSetting_ = true;
+            const auto now = std::chrono::steady_clock::now();
+            auto due = lastRequestAt_ + kKeepAliveInterval;
+            if (!loggedIn_ || now >= due)
+            {
+                if (loggedIn_)
+                    RequestFlow(warmUp_, &NetworkWorker::WarmConnection);
+                due = now + kKeepAliveInterval;
+            }
+            co_await keepAliveReady_.WaitUntil(due);
         }
-        cv_.notify_all();
     }
 
-    std::wstring GetStatus()
+    // Cameras configured for VISCA or ONVIF go straight to the camera; the
+    // rest through the controller. Resolved once per camera until the
+    // configuration changes.
+    CameraDriver& DriverFor(const std::string& cameraId)
     {
-        std::scoped_lock lock(statusMutex_);
-        return status_;
+        auto it = cameraDrivers_.find(cameraId);
+        if (it != cameraDrivers_.end())
+            return *it->second;
+
+        CameraDriver* driver = &protectDriver_;
+        const std::wstring wideId = Utf8ToWide(cameraId);
+        const std::wstring viscaAddress = TrimWide(ReadRegistryString(kRegistryViscaCamerasSubkey, wideId.c_str()));
+        const std::wstring onvifSubkey = std::wstring(kRegistryOnvifCamerasSubkey) + L"\\" + wideId;
+        const std::wstring onvifAddress = TrimWide(ReadRegistryString(onvifSubkey.c_str(), L"Address"));
+        if (!viscaAddress.empty())
+        {
+            std::wstring host;
+            INTERNET_PORT port = kViscaDefaultPort;
+            ApplyHostAndPort(viscaAddress, &host, &port);
+            if (viscaDriver_.AddCamera(cameraId, host, port))
+                driver = &viscaDriver_;
+        }
+        else if (!onvifAddress.empty())
+        {
+            OnvifCameraConfig config;
+            DWORD useTls = 0;
+            ReadRegistryDword(onvifSubkey.c_str(), L"Use TLS", &useTls);
+            config.secure = useTls != 0;
+            config.port = config.secure ? INTERNET_DEFAULT_HTTPS_PORT : INTERNET_DEFAULT_HTTP_PORT;
+            ApplyHostAndPort(onvifAddress, &config.host, &config.port);
+            config.username = WideToUtf8(TrimWide(ReadRegistryString(onvifSubkey.c_str(), L"Username")));
+            config.password = WideToUtf8(ReadRegistryString(onvifSubkey.c_str(), L"Password"));
+            const std::wstring ptzPath = TrimWide(ReadRegistryString(onvifSubkey.c_str(), L"PTZ Path"));
+            const std::wstring mediaPath = TrimWide(ReadRegistryString(onvifSubkey.c_str(), L"Media Path"));
+            if (!ptzPath.empty())
+                config.ptzPath = ptzPath;
+            if (!mediaPath.empty())
+                config.mediaPath = mediaPath;
+            if (onvifDriver_.AddCamera(cameraId, config))
+                driver = &onvifDriver_;
+        }
+        cameraDrivers_[cameraId] = driver;
+        return *driver;
     }
 
-    bool ConsumeReturnHomeSettingUpdate(bool* disabled)
+    void RecordMoveLatency(const CameraDriver& driver, double latencyMs)
     {
-        std::scoped_lock lock(returnHomeStateMutex_);
-        if (!hasReturnHomeSettingUpdate_)
-            return false;
-        hasReturnHomeSettingUpdate_ = false;
-        if (disabled)
-            *disabled = returnHomeDisabledState_;
-        return true;
+        MoveLatencyStats& stats = moveLatency_[driver.Name()];
+        ++stats.acknowledged;
+        stats.maxMs = std::max(stats.maxMs, latencyMs);
+        stats.meanMs += (latencyMs - stats.meanMs) / stats.acknowledged;
     }
 
-    void RecordSecureFailure(DWORD flags)
+    uint64_t LastStopSequence(const std::string& cameraId) const
     {
-        std::scoped_lock lock(secureFailureMutex_);
-        lastSecureFailureFlags_ = flags;
-        hasSecureFailureFlags_ = true;
+        auto it = lastStopSequence_.find(cameraId);
+        return it == lastStopSequence_.end() ? 0 : it->second;
     }
 
-    std::wstring ConsumeSecureFailureFlags()
+    void QueueStop(const std::string& cameraId)
     {
-        std::scoped_lock lock(secureFailureMutex_);
-        if (!hasSecureFailureFlags_)
-            return L"";
-        hasSecureFailureFlags_ = false;
-        return DescribeSecureFailureFlags(lastSecureFailureFlags_);
+        const auto now = std::chrono::steady_clock::now();
+        PendingStop& stop = pendingStops_[cameraId];
+        stop = {};
+        stop.sequence = ++stopSequence_;
+        stop.submittedAt = now;
+        stop.nextAttempt = now;
+        lastStopSequence_[cameraId] = stop.sequence;
+        stopReady_.NotifyAll();
     }
 
-    void NotifyConfigChanged()
+    // A newer move supersedes a stop that has not been acknowledged yet.
+    void CancelStop(const std::string& cameraId)
     {
-        {
-            std::scoped_lock lock(mutex_);
-            configDirty_ = true;
-        }
-        cv_.notify_all();
+        pendingStops_.erase(cameraId);
     }
 
-    void RequestCameraListRefresh()
+    // Re-sends the camera's latest stop unless one is already queued.
+    void QueueStopResend(const std::string& cameraId, std::chrono::steady_clock::time_point now)
     {
-        {
-            std::scoped_lock lock(mutex_);
-            needsCameraListRefresh_ = true;
-        }
-        cv_.notify_all();
+        if (pendingStops_.find(cameraId) != pendingStops_.end())
+            return;
+
+        PendingStop& stop = pendingStops_[cameraId];
+        stop.sequence = LastStopSequence(cameraId);
+        stop.submittedAt = now;
+        stop.nextAttempt = now;
+        std::scoped_lock lock(statsMutex_);
+        ++stopStats_.watchdogResends;
     }
 
-    bool ConsumeCameraListUpdate(std::vector<CameraInfo>* cameras)
+    std::shared_ptr<CancellationSource> BeginMoveInFlight(const std::string& cameraId)
     {
-        std::scoped_lock lock(mutex_);
-        if (!hasCameraListUpdate_)
-            return false;
-        hasCameraListUpdate_ = false;
-        if (cameras)
-            *cameras = cameraList_;
-        return true;
+        const auto now = std::chrono::steady_clock::now();
+        MoveInFlight& move = movesInFlight_[cameraId];
+        move.stopSequence = LastStopSequence(cameraId);
+        move.startedAt = now;
+        move.lastWatchdogStop = now;
+        move.cancellation = std::make_shared<CancellationSource>();
+        stopReady_.NotifyAll();
+        return move.cancellation;
     }
 
-    void SetSelectedCameraId(const std::wstring& cameraId)
+    void EndMoveInFlight(const std::string& cameraId)
     {
-        std::scoped_lock lock(mutex_);
-        if (selectedCameraId_ == cameraId)
+        auto it = movesInFlight_.find(cameraId);
+        if (it == movesInFlight_.end())
             return;
-        selectedCameraId_ = cameraId;
-        needsReturnHomeQuery_ = true;
-        returnHomeStateKnown_ = false;
+
+        // A stop submitted while this move was in flight may have been
+        // applied first; send it again so it is the last word.
+        if (LastStopSequence(cameraId) > it->second.stopSequence)
+            QueueStopResend(cameraId, std::chrono::steady_clock::now());
+        movesInFlight_.erase(it);
+        stopReady_.NotifyAll();
     }
 
-private:
-    void Run()
+    void QueueWatchdogStops(std::chrono::steady_clock::time_point now)
     {
-        std::unique_lock lock(mutex_);
-        auto nextSend = std::chrono::steady_clock::now() + kSendInterval;
-
-        for (;;)
+        for (auto& [cameraId, move] : movesInFlight_)
         {
-            cv_.wait_until(lock, nextSend, [&]() {
-                return stopRequested_ || hasState_ || hasReturnHomeSetting_ || needsReturnHomeQuery_ ||
-                    needsCameraListRefresh_ || configDirty_;
-            });
-            if (stopRequested_)
-                break;
-
-            if (!hasState_ && !hasReturnHomeSetting_ && !needsReturnHomeQuery_ &&
-                !needsCameraListRefresh_ && !configDirty_)
-            {
-                nextSend = std::chrono::steady_clock::now() + kSendInterval;
+            if (LastStopSequence(cameraId) <= move.stopSequence)
                 continue;
-            }
-
-            const bool sendReturnHome = hasReturnHomeSetting_;
-            const bool returnHomeDisabled = returnHomeDisabled_;
-            hasReturnHomeSetting_ = false;
-            const bool refreshCameraList = needsCameraListRefresh_;
-            needsCameraListRefresh_ = false;
-            const std::wstring selectedCameraId = selectedCameraId_;
-            const bool configDirty = configDirty_;
-            configDirty_ = false;
-
-            JoystickState snapshot = latestState_;
-            const bool sendMove = hasState_;
-            hasState_ = false;
-            const bool queryReturnHome = needsReturnHomeQuery_ ||
-                (!returnHomeStateKnown_ && (sendMove || sendReturnHome));
-            needsReturnHomeQuery_ = false;
-            lock.unlock();
-
-            if (configDirty)
-            {
-                CloseHandles();
-                ResetAuth();
-                lock.lock();
-                nextSend = std::chrono::steady_clock::now() + kSendInterval;
+            if (now - move.startedAt < kMoveStallTimeout || now - move.lastWatchdogStop < kMoveStallTimeout)
                 continue;
-            }
-
-            const bool hasCameraSelection = !selectedCameraId.empty();
-            std::wstring cameraPath;
-            std::wstring movePath;
-            if (hasCameraSelection)
-            {
-                const NetworkConfig& config = GetNetworkConfig();
-                cameraPath = config.cameraBasePath + selectedCameraId;
-                movePath = cameraPath + config.cameraMoveSuffix;
-            }
 
-            HandleCameraListRefresh(refreshCameraList);
-            HandleReturnHomeQuery(queryReturnHome, hasCameraSelection, cameraPath);
-            HandleReturnHomeUpdate(
-                sendReturnHome, returnHomeDisabled, hasCameraSelection, cameraPath);
-            HandleMove(sendMove, snapshot, hasCameraSelection, movePath);
-
-            lock.lock();
-            nextSend = std::chrono::steady_clock::now() + kSendInterval;
+            move.lastWatchdogStop = now;
+            QueueStopResend(cameraId, now);
         }
     }
 
-    bool EnsureCameraSelected(bool hasCameraSelection)
+    // A newer move for a camera abandons the one in flight at once, so the
+    // round ends and the newer one goes out next.
+    void SupersedeMoveInFlight(const std::string& cameraId)
     {
-        if (hasCameraSelection)
-            return true;
+        auto it = movesInFlight_.find(cameraId);
+        if (it == movesInFlight_.end() || it->second.cancellation->IsCancelled())
+            return;
 
-        SetStatus(L"No camera selected");
-        return false;
+        ++movesSuperseded_;
+        AppendLogLine("Move superseded: " + cameraId);
+        it->second.cancellation->Cancel();
     }
 
-    static bool IsHttpSuccess(DWORD status)
+    // Reactor side of Submit() while the move loop is busy. The sample is
+    // taken here, so the loop is notified in case it has since gone idle.
+    void SupersedeSelectedMove()
     {
-        return status >= 200 && status < 300;
+        TakeSelectedMove();
+        if (!hasState_)
+            return;
+        if (!selectedCameraId_.empty() && pendingCameraMoves_.find(selectedCameraId_) == pendingCameraMoves_.end())
+            SupersedeMoveInFlight(selectedCameraId_);
+        moveReady_.NotifyAll();
     }
 
-    bool HandleUnauthorizedStatus(const HttpResponse& response)
+    // The fallback for a move with nothing newer behind it: stalled past
+    // kMoveStallTimeout it is stale, and is abandoned to free its camera.
+    void CancelStalledMoves(std::chrono::steady_clock::time_point now)
     {
-        if (response.status != 401 && response.status != 403)
-            return false;
+        for (auto& [cameraId, move] : movesInFlight_)
+        {
+            if (now - move.startedAt < kMoveStallTimeout || move.cancellation->IsCancelled())
+                continue;
 
-        SetStatusHttp(L"Unauthorized", response.status);
-        ResetAuth();
-        return true;
+            ++movesStalled_;
+            AppendLogLine("Move abandoned after stalling: " + cameraId);
+            move.cancellation->Cancel();
+        }
     }
 
-    void HandleCameraListRefresh(bool refreshCameraList)
+    void LogTimeoutStats()
     {
-        if (!refreshCameraList || !EnsureLogin())
-            return;
-
-        HttpResponse response = {};
-        DWORD error = 0;
-        std::wstring errorText;
-        std::string responseBody;
-        const HRESULT hr = SendJsonRequestWithReauth(
-            L"GET", GetNetworkConfig().cameraListPath, "", &response, &error, &errorText, &responseBody);
-        if (FAILED(hr))
+        const TimeoutStats stats = GetTimeoutStats();
+        if (stats.requests == 0 && stats.moves == 0 && stats.stops == 0 && stats.movesSuperseded == 0 &&
+            stats.movesStalled == 0)
         {
-            SetStatusError(L"Camera list failed", error, errorText);
             return;
         }
 
-        SetStatusHttp(L"Camera list", response.status);
-        if (HandleUnauthorizedStatus(response) || !IsHttpSuccess(response.status))
-            return;
+        char line[192] = {};
+        snprintf(line, sizeof(line),
+            "Timeouts: %u controller requests, %u moves, %u stops; moves abandoned in flight: %u superseded, "
+            "%u stalled",
+            stats.requests, stats.moves, stats.stops, stats.movesSuperseded, stats.movesStalled);
+        AppendLogLine(line);
+    }
 
-        std::vector<CameraInfo> cameras;
-        if (!JsonUtils::TryParseCameraList(responseBody, &cameras))
-        {
-            AppendLogLine(L"Camera list parse failed");
+    void LogMoveDeadlineStats()
+    {
+        const MoveDeadlineStats stats = GetMoveDeadlineStats();
+        if (stats.sent == 0 && stats.dropped == 0)
             return;
-        }
 
-        AppendLogLine(L"Camera list parsed: " + std::to_wstring(cameras.size()));
-        std::scoped_lock listLock(mutex_);
-        cameraList_ = std::move(cameras);
-        hasCameraListUpdate_ = true;
+        char line[128] = {};
+        snprintf(line, sizeof(line), "Moves: %u sent, %u dropped as stale, %u acknowledged late",
+            stats.sent, stats.dropped, stats.late);
+        AppendLogLine(line);
     }
 
-    void HandleReturnHomeQuery(bool queryReturnHome,
-        bool hasCameraSelection,
-        const std::wstring& cameraPath)
+    void LogMoveLatencyStats()
     {
-        if (!queryReturnHome)
-            return;
-        if (!EnsureCameraSelected(hasCameraSelection) || !EnsureLogin())
-            return;
-
-        HttpResponse response = {};
-        DWORD error = 0;
-        std::wstring errorText;
-        std::string responseBody;
-        const HRESULT hr = SendJsonRequestWithReauth(
-            L"GET", cameraPath, "", &response, &error, &errorText, &responseBody);
-        if (FAILED(hr))
+        for (const auto& [driver, stats] : moveLatency_)
         {
-            SetStatusError(L"Return home query failed", error, errorText);
-            return;
+            char line[128] = {};
+            snprintf(line, sizeof(line), "Move latency (%s): %u acknowledged, mean %.1f ms, max %.1f ms",
+                driver.c_str(), stats.acknowledged, stats.meanMs, stats.maxMs);
+            AppendLogLine(line);
         }
+    }
 
-        SetStatusHttp(L"Return home query", response.status);
-        if (HandleUnauthorizedStatus(response) || !IsHttpSuccess(response.status))
+    void LogConnectionStats()
+    {
+        const ConnectionStats stats = GetConnectionStats();
+        if (stats.handshakes == 0 && stats.firstMovesAfterIdle == 0)
             return;
 
-        bool disabled = false;
-        if (!JsonUtils::TryParseReturnHomeDisabled(responseBody, &disabled))
-        {
-            AppendLogLine(L"Return home parse failed");
+        char line[192] = {};
+        snprintf(line, sizeof(line),
+            "Controller connections: %u opened (%.1f/h); first move after idle: %u, mean %.1f ms, "
+            "max %.1f ms, %u cold",
+            stats.handshakes, stats.handshakesPerHour, stats.firstMovesAfterIdle, stats.firstMoveMeanMs,
+            stats.firstMoveMaxMs, stats.coldFirstMoves);
+        AppendLogLine(line);
+    }
+
+    void LogStopLatencyStats()
+    {
+        const StopLatencyStats stats = GetStopLatencyStats();
+        if (stats.acknowledged == 0)
             return;
-        }
 
-        std::wstring parsedLine = L"Return home parsed: ";
-        parsedLine += disabled ? L"disabled" : L"enabled";
-        AppendLogLine(parsedLine);
-        {
-            std::scoped_lock stateLock(returnHomeStateMutex_);
-            returnHomeDisabledState_ = disabled;
-            hasReturnHomeSettingUpdate_ = true;
-        }
+        char line[160] = {};
+        snprintf(line, sizeof(line),
+            "Stop latency: %u acknowledged, mean %.1f ms, max %.1f ms, %u retries, %u re-sent",
+            stats.acknowledged, stats.meanMs, stats.maxMs, stats.retries, stats.watchdogResends);
+        AppendLogLine(line);
+    }
+
+    // Sends due stops, each as its own request so a hung move or another
+    // camera's stop cannot hold one up, and runs the watchdog.
+    Task<void> StopLane()
+    {
+        while (!stopping_)
         {
-            std::scoped_lock stateLock(mutex_);
-            returnHomeStateKnown_ = true;
+            const auto now = std::chrono::steady_clock::now();
+            QueueWatchdogStops(now);
+            CancelStalledMoves(now);
+
+            auto wakeAt = now + kMoveStallTimeout;
+            for (auto& [cameraId, stop] : pendingStops_)
+            {
+                if (stop.sending)
+                    continue;
+                if (stop.nextAttempt <= now)
+                {
+                    stop.sending = true;
+                    reactor_.Spawn(SendStop(cameraId, stop.sequence));
+                }
+                else
+                {
+                    wakeAt = std::min(wakeAt, stop.nextAttempt);
+                }
+            }
+
+            if (pendingStops_.empty() && movesInFlight_.empty())
+                co_await stopReady_.Wait();
+            else
+                co_await stopReady_.WaitUntil(wakeAt);
         }
     }
 
-    void HandleReturnHomeUpdate(bool sendReturnHome,
-        bool returnHomeDisabled,
-        bool hasCameraSelection,
-        const std::wstring& cameraPath)
+    void CompleteStopAttempt(const std::string& cameraId, uint64_t sequence, bool acknowledged)
     {
-        if (!sendReturnHome)
-            return;
-        if (!EnsureCameraSelected(hasCameraSelection) || !EnsureLogin())
+        auto it = pendingStops_.find(cameraId);
+        if (it == pendingStops_.end() || it->second.sequence != sequence)
             return;
 
-        const std::string payload = BuildReturnHomePayload(returnHomeDisabled);
-        HttpResponse response = {};
-        DWORD error = 0;
-        std::wstring errorText;
-        const HRESULT hr = SendJsonRequestWithReauth(
-            L"PATCH", cameraPath, payload, &response, &error, &errorText, nullptr);
-        if (FAILED(hr))
+        PendingStop& stop = it->second;
+        stop.sending = false;
+        ++stop.attempts;
+        const auto now = std::chrono::steady_clock::now();
+        std::scoped_lock lock(statsMutex_);
+        if (!acknowledged)
         {
-            SetStatusError(L"Return home update failed", error, errorText);
+            ++stopStats_.retries;
+            const uint32_t doublings = std::min<uint32_t>(stop.attempts - 1, 5);
+            stop.nextAttempt = now + std::min<std::chrono::steady_clock::duration>(
+                kStopRetryInitial * (1u << doublings), kStopRetryMax);
             return;
         }
 
-        SetStatusHttp(L"Return home updated", response.status);
-        (void)HandleUnauthorizedStatus(response);
+        const double latencyMs = std::chrono::duration<double, std::milli>(now - stop.submittedAt).count();
+        ++stopStats_.acknowledged;
+        stopStats_.lastMs = latencyMs;
+        stopStats_.maxMs = std::max(stopStats_.maxMs, latencyMs);
+        stopStats_.meanMs += (latencyMs - stopStats_.meanMs) / stopStats_.acknowledged;
+
+        char line[128] = {};
+        snprintf(line, sizeof(line), " in %.1f ms (%u attempts)", latencyMs, stop.attempts);
+        AppendLogLine("Stop acknowledged: " + cameraId + line);
+        pendingStops_.erase(it);
     }
 
-    void HandleMove(bool sendMove,
-        const JoystickState& snapshot,
-        bool hasCameraSelection,
-        const std::wstring& movePath)
+    Task<void> SendStop(std::string cameraId, uint64_t sequence)
     {
-        if (!sendMove)
-            return;
-        if (!EnsureCameraSelected(hasCameraSelection) || !EnsureLogin())
-            return;
-
-        const std::string payload = BuildMovePayload(snapshot);
-        HttpResponse response = {};
-        DWORD error = 0;
-        std::wstring errorText;
-        const HRESULT hr = SendJsonRequestWithReauth(
-            L"POST", movePath, payload, &response, &error, &errorText, nullptr);
-        if (FAILED(hr))
+        bool acknowledged = false;
+        CameraDriver& driver = DriverFor(cameraId);
+        if (loggedIn_ || &driver != &protectDriver_)
         {
-            SetStatusError(L"Move failed", error, errorText);
-            return;
+            const CameraCommandResult result =
+                co_await driver.SendMove(cameraId, JoystickState{}, kStopTimeoutMs, nullptr);
+            if (result.timedOut)
+                ++stopTimeouts_;
+            // A list refresh re-authenticates; the retry then goes through.
+            if (SUCCEEDED(result.hr) && (result.httpStatus == 401 || result.httpStatus == 403))
+                RequestFlow(listRefresh_, &NetworkWorker::RefreshCameraList);
+            else
+                acknowledged = SUCCEEDED(result.hr) && result.acknowledged;
         }
-
-        SetStatusHttp(L"Move", response.status);
-        (void)HandleUnauthorizedStatus(response);
+        CompleteStopAttempt(cameraId, sequence, acknowledged);
+        stopReady_.NotifyAll();
     }
 
-    void EnsureSession()
+    bool EnsureSession()
     {
         if (!session_)
+            session_ = OpenAsyncHttpSession();
+
+        // A new address needs a new connection handle; the session and the
+        // connections it pools to the old address are kept.
+        const NetworkConfig& config = GetNetworkConfig();
+        if (connection_ && (connectedHost_ != config.host || connectedPort_ != config.port))
         {
-            session_ = WinHttpOpen(
-                L"JoystickTesting/1.0",
-                WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-                WINHTTP_NO_PROXY_NAME,
-                WINHTTP_NO_PROXY_BYPASS,
-                0);
-            if (session_)
-            {
-                WinHttpSetStatusCallback(
-                    session_,
-                    WinHttpStatusCallback,
-                    WINHTTP_CALLBACK_FLAG_SECURE_FAILURE,
-                    0);
-            }
+            WinHttpCloseHandle(connection_);
+            connection_ = nullptr;
         }
-
         if (session_ && !connection_)
         {
-            const NetworkConfig& config = GetNetworkConfig();
             connection_ = WinHttpConnect(session_, config.host.c_str(), config.port, 0);
+            connectedHost_ = config.host;
+            connectedPort_ = config.port;
         }
+        return session_ && connection_;
     }
 
-    bool EnsureLogin()
+    // Single-flight: flows that need a session while one login is running
+    // wait for its outcome instead of starting their own.
+    Task<bool> EnsureLogin()
     {
+        if (loginInProgress_)
+        {
+            while (loginInProgress_)
+                co_await loginDone_.Wait();
+            co_return loggedIn_;
+        }
         if (loggedIn_)
-            return true;
+            co_return true;
 
+        loginInProgress_ = true;
+        const bool loggedIn = co_await Login();
+        loginInProgress_ = false;
+        loginDone_.NotifyAll();
+        co_return loggedIn;
+    }
+
+    Task<bool> Login()
+    {
         NetworkConfig& config = GetNetworkConfig();
         if (!configLoaded_ && !LoadConfigFromRegistry(config))
         {
             SetStatus(L"Controller address missing");
-            return false;
+            co_return false;
         }
         configLoaded_ = true;
 
         useApiKey_ = config.useApiKey;
         apiKey_ = config.apiKey;
+        useHttp2_ = config.useHttp2;
+        RefreshAuthHeaders();
 
         if (useApiKey_)
         {
             if (apiKey_.empty())
             {
                 SetStatus(L"API key missing");
-                return false;
+                co_return false;
             }
         }
         else if (config.username.empty() || config.password.empty())
         {
             SetStatus(L"Credentials missing");
-            return false;
+            co_return false;
         }
 
-        EnsureSession();
-        if (!session_ || !connection_)
+        if (!EnsureSession())
         {
             SetStatus(L"Network init failed");
-            return false;
+            co_return false;
         }
 
         if (useApiKey_)
         {
             loggedIn_ = true;
+            PublishSession();
             SetStatus(L"Using API key");
-            return true;
+            co_return true;
         }
 
-        HttpResponse response = {};
-        const std::string payload = BuildLoginPayload(config);
+        // The breaker's status stands until its next probe.
+        if (!breaker_.WouldAdmit(std::chrono::steady_clock::now()))
+            co_return false;
+
+        ScopedStartupPhase phase(L"Login");
         SetStatus(L"Logging in");
-        DWORD error = 0;
-        std::wstring errorText;
-        if (FAILED(SendJsonRequest(connection_, L"POST", config.loginPath, payload, L"", L"", "", &response,
-            &error, &errorText, nullptr, this)))
+        const uint64_t generation = authGeneration_;
+        const HttpResult result = co_await SendRequest(
+            L"POST", config.loginPath, BuildLoginPayload(config), kLoginTimeouts, false, shutdownCancel_);
+        // Reconfigured while the login was in flight; its session is moot.
+        if (generation != authGeneration_ || result.cancelled)
+            co_return false;
+        if (FAILED(result.hr))
         {
-            SetStatusError(L"Login failed", error, errorText);
-            return false;
+            SetStatusError(L"Login failed", result.error, result.errorText);
+            co_return false;
         }
 
-        if (response.status >= 200 && response.status < 300)
+        const HttpResponse& response = result.response;
+        if (IsHttpSuccess(response.status))
         {
             if (!response.setCookieHeader.empty())
                 cookieHeader_ = response.setCookieHeader;
             if (!response.csrfToken.empty())
                 csrfToken_ = response.csrfToken;
+            RefreshAuthHeaders();
             loggedIn_ = !cookieHeader_.empty() || !csrfToken_.empty();
             if (loggedIn_)
+            {
+                NoteBreakerSuccess();
+                PublishSession();
                 SetStatusHttp(L"Logged in", response.status);
+            }
             else
                 SetStatusHttp(L"Login missing cookies", response.status);
         }
@@ -764,83 +1795,144 @@ private:
         {
             SetStatusHttp(L"Login failed", response.status);
         }
+        // Rejected credentials stay rejected until the settings change; the
+        // breaker backs the retries off.
+        if (!loggedIn_)
+            NoteBreakerFailure(true);
 
-        return loggedIn_;
+        co_return loggedIn_;
     }
 
     void ResetAuth()
     {
+        {
+            std::scoped_lock lock(sessionMutex_);
+            sessionPublished_ = false;
+        }
+        ++authGeneration_;
         loggedIn_ = false;
         cookieHeader_.clear();
         csrfToken_.clear();
         apiKey_.clear();
         useApiKey_ = false;
+        authHeaders_.clear();
         configLoaded_ = false;
-        needsReturnHomeQuery_ = true;
         returnHomeStateKnown_ = false;
-        needsCameraListRefresh_ = true;
+        RequestFlow(returnHomeQuery_, &NetworkWorker::QueryReturnHome);
+        RequestFlow(listRefresh_, &NetworkWorker::RefreshCameraList);
+    }
+
+    // Leaves the selected camera returning home on its own again.
+    Task<void> SendReturnHomeOnStop(std::string cameraId)
+    {
+        if (!co_await EnsureLogin())
+            co_return;
+
+        // Sent after the shutdown cancellation, and bounded by its timeouts.
+        co_await SendRequestWithReauth(L"PATCH",
+            GetNetworkConfig().cameraBasePath + cameraId, BuildReturnHomePayload(false), kSettingsTimeouts, nullptr);
+    }
+
+    // Built once per login rather than per request. Sent byte-identical each
+    // time, they cost one HPACK table reference per request on HTTP/2.
+    void RefreshAuthHeaders()
+    {
+        authHeaders_ = BuildAuthHeaders(cookieHeader_, csrfToken_, useApiKey_ ? apiKey_ : L"");
     }
 
-    void SendReturnHomeOnStop()
+    Task<HttpResult> SendRequest(std::wstring method,
+        std::string path,
+        std::string payload,
+        HttpTimeouts timeouts,
+        bool withAuth,
+        std::shared_ptr<CancellationSource> cancellation)
     {
-        std::wstring cameraPath;
+        HttpRequest request;
+        request.method = method;
+        request.path = Utf8ToWide(path);
+        request.headers = L"Content-Type: application/json\r\n";
+        if (withAuth)
+            request.headers += authHeaders_;
+        request.timeouts = timeouts;
+        request.cancellation = std::move(cancellation);
+        request.allowHttp2 = useHttp2_;
+
+        if (!breaker_.Admit(std::chrono::steady_clock::now()))
+            co_return RefusedByBreaker();
+
         {
-            std::scoped_lock lock(mutex_);
-            if (selectedCameraId_.empty())
-                return;
-            const NetworkConfig& config = GetNetworkConfig();
-            cameraPath = config.cameraBasePath + selectedCameraId_;
+            std::string logLine = WideToUtf8(method) + " " + path;
+            if (!payload.empty())
+            {
+                logLine += " payload=";
+                logLine += RedactPassword(payload);
+            }
+            AppendLogLine(logLine);
         }
 
-        if (!EnsureLogin())
-            return;
+        request.payload = std::move(payload);
+        lastRequestAt_ = std::chrono::steady_clock::now();
+        HttpResult result = co_await SendHttpRequestAsync(reactor_, connection_, std::move(request));
+        NoteControllerResult(result);
+        // A login's answer is judged by Login().
+        NoteBreakerResult(result, withAuth);
+        if (result.cancelled)
+        {
+            AppendLogLine("Cancelled " + WideToUtf8(method) + " " + path);
+            co_return result;
+        }
+
+        if (result.error == ERROR_WINHTTP_SECURE_FAILURE && result.secureFailureFlags != 0)
+        {
+            if (!result.errorText.empty())
+                result.errorText += L" | ";
+            result.errorText += L"TLS flags: ";
+            result.errorText += DescribeSecureFailureFlags(result.secureFailureFlags);
+        }
 
-        const std::string payload = BuildReturnHomePayload(false);
-        HttpResponse response = {};
-        DWORD error = 0;
-        std::wstring errorText;
-        SendJsonRequestWithReauth(L"PATCH", cameraPath, payload,
-            &response, &error, &errorText, nullptr);
+        std::string line = "HTTP " + std::to_string(result.response.status) + " for " + path;
+        if (!result.body.empty())
+        {
+            line += " body=";
+            line += result.body;
+        }
+        AppendLogLine(line);
+        co_return result;
     }
 
-    HRESULT SendJsonRequestWithReauth(const wchar_t* method,
-        const std::wstring& path,
-        const std::string& payload,
-        HttpResponse* response,
-        DWORD* outWin32Error,
-        std::wstring* outErrorText,
-        std::string* outResponseBody)
+    Task<HttpResult> SendRequestWithReauth(std::wstring method,
+        std::string path,
+        std::string payload,
+        HttpTimeouts timeouts,
+        std::shared_ptr<CancellationSource> cancellation)
     {
-        static const std::string kEmptyApiKey;
-        const std::string& apiKey = useApiKey_ ? apiKey_ : kEmptyApiKey;
-        HRESULT hr = SendJsonRequest(connection_, method, path, payload,
-            cookieHeader_, csrfToken_, apiKey, response, outWin32Error,
-            outErrorText, outResponseBody, this);
-        if (FAILED(hr))
-            return hr;
+        const uint64_t generation = authGeneration_;
+        HttpResult result = co_await SendRequest(method, path, payload, timeouts, true, cancellation);
+        if (FAILED(result.hr))
+            co_return result;
 
-        if (!useApiKey_ && response && (response->status == 401 || response->status == 403))
+        if (!useApiKey_ && (result.response.status == 401 || result.response.status == 403))
         {
-            ResetAuth();
-            if (!EnsureLogin())
+            // Requests rejected together share one re-login.
+            if (generation == authGeneration_)
+                ResetAuth();
+            if (!co_await EnsureLogin())
             {
-                if (outWin32Error)
-                    *outWin32Error = 0;
-                if (outErrorText)
-                    *outErrorText = L"Re-login failed";
-                return E_FAIL;
+                result.hr = E_FAIL;
+                result.error = 0;
+                result.errorText = L"Re-login failed";
+                co_return result;
             }
 
-            hr = SendJsonRequest(connection_, method, path, payload,
-                cookieHeader_, csrfToken_, apiKey, response, outWin32Error,
-                outErrorText, outResponseBody, this);
+            result = co_await SendRequest(method, path, payload, timeouts, true, cancellation);
         }
 
-        return hr;
+        co_return result;
     }
 
     void CloseHandles()
     {
+        // Requests still in flight keep their own handles alive.
         if (connection_)
         {
             WinHttpCloseHandle(connection_);
@@ -853,42 +1945,110 @@ private:
         }
     }
 
-    std::mutex mutex_;
-    std::condition_variable cv_;
-    std::thread worker_;
+    NetworkReactor reactor_;
     bool running_ = false;
-    bool stopRequested_ = false;
+
+    // Input thread to reactor, lock-free.
+    LatestValueMailbox<SelectedMove> selectedMoves_;
+    std::atomic<bool> moveLoopIdle_ = false;
+    // Bumped on the reactor at each selection change, read at capture.
+    std::atomic<uint64_t> selectionGeneration_ = 0;
+    ReactorSignal moveSignal_{ reactor_, [this]() { moveReady_.NotifyAll(); } };
+    ReactorSignal supersedeSignal_{ reactor_, [this]() { SupersedeSelectedMove(); } };
+
+    // Reactor thread only.
+    bool stopping_ = false;
+    AsyncCondition moveReady_{ reactor_ };
     bool hasState_ = false;
-    JoystickState latestState_ = {};
-    bool hasReturnHomeSetting_ = false;
+    TimedJoystickState latestState_;
+    std::map<std::string, TimedJoystickState> pendingCameraMoves_;
+    std::string selectedCameraId_;
     bool returnHomeDisabled_ = false;
-    bool needsReturnHomeQuery_ = true;
     bool returnHomeStateKnown_ = false;
-    bool needsCameraListRefresh_ = true;
-    bool configDirty_ = false;
-    bool hasCameraListUpdate_ = false;
-    std::vector<CameraInfo> cameraList_;
-    std::wstring selectedCameraId_;
+    CoalescedFlow listRefresh_;
+    CoalescedFlow returnHomeQuery_;
+    CoalescedFlow returnHomeUpdate_;
+    CoalescedFlow warmUp_;
+    AsyncCondition keepAliveReady_{ reactor_ };
+    CircuitBreaker breaker_;
+    AsyncCondition breakerChanged_{ reactor_ };
+    std::chrono::steady_clock::time_point lastRequestAt_;
+    std::chrono::steady_clock::time_point lastMoveAt_;
+    // Replaced, never modified, once handed to the UI.
+    // Handles stay valid across Stop() and Start(), so the catalog is never
+    // cleared; it only grows with IDs and names not seen before.
+    CameraCatalog catalog_;
+    std::shared_ptr<const CameraCatalogSnapshot> cameraList_;
 
     HINTERNET session_ = nullptr;
     HINTERNET connection_ = nullptr;
+    // Cancelled, and replaced, when shutdown begins.
+    std::shared_ptr<CancellationSource> shutdownCancel_ = std::make_shared<CancellationSource>();
+    std::wstring connectedHost_;
+    INTERNET_PORT connectedPort_ = 0;
     bool loggedIn_ = false;
+    bool loginInProgress_ = false;
+    AsyncCondition loginDone_{ reactor_ };
+    // Bumped by every ResetAuth, so late results of an older session are
+    // told apart.
+    uint64_t authGeneration_ = 0;
     std::wstring cookieHeader_;
     std::wstring csrfToken_;
-    std::string apiKey_;
+    // Cookie, CSRF token and API key header lines for the current login.
+    std::wstring authHeaders_;
+    bool useHttp2_ = false;
+    // Protocol of the last controller response, logged when it changes.
+    bool controllerHttp2_ = false;
+    std::wstring apiKey_;
     bool useApiKey_ = false;
     bool configLoaded_ = false;
 
+    // Per-camera settings filled from the list, pushed events and a bounded
+    // background prefetch, so selecting a camera needs no blocking GET.
+    std::map<std::string, CameraSettings> settingsCache_;
+    std::deque<std::string> prefetchQueue_;
+    AsyncCondition prefetchReady_{ reactor_ };
+
+    AsyncCondition stopReady_{ reactor_ };
+    uint64_t stopSequence_ = 0;
+    std::map<std::string, uint64_t> lastStopSequence_;
+    std::map<std::string, PendingStop> pendingStops_;
+    std::map<std::string, MoveInFlight> movesInFlight_;
+
+    ProtectCameraDriver protectDriver_{ [this](std::string path, std::string payload, DWORD timeoutMs,
+        std::shared_ptr<CancellationSource> cancellation)
+        {
+            return SendRequest(L"POST", std::move(path), std::move(payload),
+                timeoutMs != 0 ? UniformHttpTimeouts(timeoutMs) : kMoveTimeouts, true, std::move(cancellation));
+        } };
+    ViscaCameraDriver viscaDriver_{ reactor_ };
+    OnvifCameraDriver onvifDriver_{ reactor_ };
+    std::map<std::string, CameraDriver*> cameraDrivers_;
+    std::map<std::string, MoveLatencyStats> moveLatency_;
+
+    // Read from other threads.
+    std::atomic<uint32_t> movesSent_ = 0;
+    std::atomic<uint32_t> requestTimeouts_ = 0;
+    std::atomic<uint32_t> moveTimeouts_ = 0;
+    std::atomic<uint32_t> stopTimeouts_ = 0;
+    std::atomic<uint32_t> movesSuperseded_ = 0;
+    std::atomic<uint32_t> movesStalled_ = 0;
+    std::atomic<uint32_t> movesDropped_ = 0;
+    std::atomic<uint32_t> movesLate_ = 0;
+
+    std::mutex statsMutex_;
+    StopLatencyStats stopStats_;
+    ConnectionStats connectionStats_;
+    std::chrono::steady_clock::time_point statsStartedAt_;
+
+    // Set from the UI thread while the reactor is stopped, otherwise from
+    // the reactor; only used to skip unchanged text.
     std::mutex statusMutex_;
     std::wstring status_ = L"Idle";
 
-    std::mutex returnHomeStateMutex_;
-    bool hasReturnHomeSettingUpdate_ = false;
-    bool returnHomeDisabledState_ = false;
-
-    std::mutex secureFailureMutex_;
-    DWORD lastSecureFailureFlags_ = 0;
-    bool hasSecureFailureFlags_ = false;
+    std::mutex sessionMutex_;
+    CameraEventStreamEndpoint eventStreamEndpoint_;
+    bool sessionPublished_ = false;
 
     void SetStatusHttp(const wchar_t* prefix, DWORD status)
     {
@@ -901,6 +2061,7 @@ private:
 
     void SetStatusError(const wchar_t* prefix, DWORD error, const std::wstring& errorText)
     {
+        RecordFlightEvent(FlightEventType::Error, std::wstring_view(prefix ? prefix : L""), static_cast<int32_t>(error));
         std::wstring message = prefix ? prefix : L"";
         message += L" (error ";
         message += std::to_wstring(error);
@@ -915,237 +2076,32 @@ private:
 
     void SetStatus(const wchar_t* text)
     {
-        std::scoped_lock lock(statusMutex_);
-        status_ = text ? text : L"";
-    }
-};
-
-HRESULT SendJsonRequest(HINTERNET connection,
-    const wchar_t* method,
-    const std::wstring& path,
-    const std::string& payload,
-    const std::wstring& cookieHeader,
-    const std::wstring& csrfToken,
-    const std::string& apiKey,
-    HttpResponse* response,
-    DWORD* outWin32Error,
-    std::wstring* outErrorText,
-    std::string* outResponseBody,
-    NetworkWorker* statusContext)
-{
-    HRESULT hr = S_OK;
-    DWORD bytesAvailable = 0;
-    std::string responseBody;
-
-    if (outWin32Error)
-        *outWin32Error = 0;
-    if (outErrorText)
-        outErrorText->clear();
-
-    const wchar_t* requestMethod = method && *method ? method : L"POST";
-    HINTERNET hRequest = WinHttpOpenRequest(
-        connection,
-        requestMethod,
-        path.c_str(),
-        nullptr,
-        WINHTTP_NO_REFERER,
-        WINHTTP_DEFAULT_ACCEPT_TYPES,
-        WINHTTP_FLAG_SECURE);
-
-    if (!hRequest)
-    {
-        const DWORD error = GetLastError();
-        if (outWin32Error)
-            *outWin32Error = error;
-        if (outErrorText)
-            *outErrorText = FormatWin32Error(error);
-        return E_FAIL;
-    }
-
-    if (statusContext)
-    {
-        DWORD_PTR contextValue = reinterpret_cast<DWORD_PTR>(statusContext);
-        WinHttpSetOption(hRequest, WINHTTP_OPTION_CONTEXT_VALUE, &contextValue, sizeof(contextValue));
-        statusContext->ConsumeSecureFailureFlags();
-    }
-
-    auto captureRequestError = [&](DWORD error, const wchar_t* action)
-    {
-        hr = E_FAIL;
-        if (outWin32Error)
-            *outWin32Error = error;
-        if (outErrorText)
-            *outErrorText = FormatWin32Error(error);
-
-        std::wstring logLine = action ? action : L"WinHTTP call";
-        logLine += L" failed: ";
-        logLine += std::to_wstring(error);
-        const std::wstring formatted = FormatWin32Error(error);
-        if (!formatted.empty())
-        {
-            logLine += L" ";
-            logLine += formatted;
-        }
-        AppendLogLine(logLine);
-
-        if (error == ERROR_WINHTTP_SECURE_FAILURE && statusContext && outErrorText)
-        {
-            const std::wstring flags = statusContext->ConsumeSecureFailureFlags();
-            if (!flags.empty())
-            {
-                if (!outErrorText->empty())
-                    *outErrorText += L" | ";
-                *outErrorText += L"TLS flags: ";
-                *outErrorText += flags;
-            }
-        }
-    };
-
-    std::wstring headers = L"Content-Type: application/json\r\n";
-    if (!csrfToken.empty())
-    {
-        headers += L"X-CSRF-Token: ";
-        headers += csrfToken;
-        headers += L"\r\n";
-    }
-    if (!cookieHeader.empty())
-    {
-        headers += L"Cookie: ";
-        headers += cookieHeader;
-        headers += L"\r\n";
-    }
-    if (!apiKey.empty())
-    {
-        headers += L"X-API-Key: ";
-        headers += Utf8ToWide(apiKey);
-        headers += L"\r\n";
-    }
-
-    const bool hasPayload = !payload.empty();
-    LPVOID payloadData = hasPayload ? (LPVOID)payload.data() : nullptr;
-    const DWORD payloadSize = hasPayload ? static_cast<DWORD>(payload.size()) : 0;
-    BOOL results = WinHttpSendRequest(
-        hRequest,
-        headers.c_str(),
-        -1L,
-        payloadData,
-        payloadSize,
-        payloadSize,
-        0);
-
-    {
-        std::wstring logLine = std::wstring(requestMethod) + L" " + path;
-        if (hasPayload)
-        {
-            logLine += L" payload=";
-            logLine += RedactPassword(payload);
-        }
-        AppendLogLine(logLine);
-    }
-
-    if (!results)
-    {
-        captureRequestError(GetLastError(), L"SendRequest");
-        goto cleanup;
-    }
-
-    results = WinHttpReceiveResponse(hRequest, nullptr);
-    if (!results)
-    {
-        captureRequestError(GetLastError(), L"ReceiveResponse");
-        goto cleanup;
-    }
-
-    if (response)
-    {
-        DWORD statusSize = sizeof(response->status);
-        WinHttpQueryHeaders(hRequest,
-            WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
-            WINHTTP_HEADER_NAME_BY_INDEX,
-            &response->status,
-            &statusSize,
-            nullptr);
-
-        response->setCookieHeader.clear();
-        response->csrfToken.clear();
-
-        const auto cookies = ReadSetCookieHeaders(hRequest);
-        if (!cookies.empty())
-            response->setCookieHeader = JoinCookies(cookies);
-
-        response->csrfToken = ReadHeaderValue(hRequest, WINHTTP_QUERY_CUSTOM, L"X-CSRF-Token");
-    }
-
-    do
-    {
-        bytesAvailable = 0;
-        if (!WinHttpQueryDataAvailable(hRequest, &bytesAvailable))
-        {
-            captureRequestError(GetLastError(), L"QueryDataAvailable");
-            goto cleanup;
-        }
-
-        if (bytesAvailable == 0)
-            break;
-
-        std::string buffer(bytesAvailable, '\0');
-        DWORD bytesRead = 0;
-
-        if (!WinHttpReadData(
-            hRequest,
-            &buffer[0],
-            bytesAvailable,
-            &bytesRead))
-        {
-            captureRequestError(GetLastError(), L"ReadData");
-            goto cleanup;
-        }
-        if (bytesRead > 0)
-            responseBody.append(buffer.data(), bytesRead);
-    } while (bytesAvailable > 0);
-
-cleanup:
-    WinHttpCloseHandle(hRequest);
-    if (response)
-    {
-        std::wstring line = L"HTTP " + std::to_wstring(response->status) + L" for " + path;
-        if (!responseBody.empty())
+        NetworkEvent event;
         {
-            line += L" body=";
-            line += Utf8ToWide(responseBody);
+            std::scoped_lock lock(statusMutex_);
+            const wchar_t* value = text ? text : L"";
+            if (status_ == value)
+                return;
+            status_ = value;
+            event.type = NetworkEventType::Status;
+            event.status = std::make_shared<const std::wstring>(status_);
         }
-        AppendLogLine(line);
+        RecordFlightEvent(FlightEventType::Status, *event.status);
+        GetNetworkEventQueue().Push(std::move(event));
     }
-    if (outResponseBody)
-        *outResponseBody = std::move(responseBody);
-    return hr;
-}
-
-void CALLBACK WinHttpStatusCallback(
-    HINTERNET,
-    DWORD_PTR context,
-    DWORD status,
-    LPVOID statusInfo,
-    DWORD statusInfoLength)
-{
-    if (status != WINHTTP_CALLBACK_STATUS_SECURE_FAILURE)
-        return;
-    if (!statusInfo || statusInfoLength < sizeof(DWORD))
-        return;
-
-    auto* worker = reinterpret_cast<NetworkWorker*>(context);
-    if (!worker)
-        return;
-
-    const DWORD flags = *reinterpret_cast<DWORD*>(statusInfo);
-    worker->RecordSecureFailure(flags);
-}
+};
 
 NetworkWorker& GetWorker()
 {
     static NetworkWorker worker;
     return worker;
 }
+
+void RecordSubmittedState(std::string_view cameraId, const JoystickState& state)
+{
+    RecordFlightEvent(FlightEventType::StateSubmitted, cameraId, static_cast<int32_t>(std::lround(state.x * 1000)),
+        static_cast<int32_t>(std::lround(state.y * 1000)), static_cast<int32_t>(std::lround(state.z * 1000)));
+}
 }
 
 void StartNetworkWorker()
@@ -1160,37 +2116,61 @@ void StopNetworkWorker()
 
 void SubmitJoystickState(const JoystickState& state)
 {
+    RecordSubmittedState({}, state);
     GetWorker().Submit(state);
 }
 
-void SubmitReturnHomeSetting(bool disabled)
+void SubmitCameraJoystickState(const std::string& cameraId, const JoystickState& state)
 {
-    GetWorker().SubmitReturnHomeSetting(disabled);
+    RecordSubmittedState(cameraId, state);
+    GetWorker().SubmitForCamera(cameraId, state);
 }
 
-bool ConsumeReturnHomeSettingUpdate(bool* disabled)
+void SubmitJoystickStop()
 {
-    return GetWorker().ConsumeReturnHomeSettingUpdate(disabled);
+    RecordFlightEvent(FlightEventType::StopSubmitted);
+    GetWorker().SubmitStop();
 }
 
-std::wstring GetNetworkStatusText()
+void SubmitCameraJoystickStop(const std::string& cameraId)
 {
-    return GetWorker().GetStatus();
+    RecordFlightEvent(FlightEventType::StopSubmitted, cameraId);
+    GetWorker().SubmitStopForCamera(cameraId);
 }
 
-void RequestCameraListRefresh()
+StopLatencyStats GetStopLatencyStats()
 {
-    GetWorker().RequestCameraListRefresh();
+    return GetWorker().GetStopLatencyStats();
+}
+
+MoveDeadlineStats GetMoveDeadlineStats()
+{
+    return GetWorker().GetMoveDeadlineStats();
+}
+
+ConnectionStats GetConnectionStats()
+{
+    return GetWorker().GetConnectionStats();
 }
 
-bool ConsumeCameraListUpdate(std::vector<CameraInfo>* cameras)
+TimeoutStats GetTimeoutStats()
 {
-    return GetWorker().ConsumeCameraListUpdate(cameras);
+    return GetWorker().GetTimeoutStats();
 }
 
-void SelectCameraId(const std::wstring& cameraId)
+void SubmitReturnHomeSetting(bool disabled)
+{
+    GetWorker().SubmitReturnHomeSetting(disabled);
+}
+
+void RequestCameraListRefresh()
+{
+    GetWorker().RequestCameraListRefresh();
+}
+
+void SelectCamera(CameraHandle camera)
 {
-    GetWorker().SetSelectedCameraId(cameraId);
+    GetWorker().SetSelectedCamera(camera);
 }
 
 void NotifyNetworkConfigChanged()
@@ -1198,6 +2178,16 @@ void NotifyNetworkConfigChanged()
     GetWorker().NotifyConfigChanged();
 }
 
+void SetNetworkEventNotifier(std::function<void()> notifier)
+{
+    GetNetworkEventQueue().SetNotifier(std::move(notifier));
+}
+
+bool DrainNetworkEvents(std::vector<NetworkEvent>* events)
+{
+    return GetNetworkEventQueue().Drain(events);
+}
+
 bool GetInvertYSetting()
 {
     DWORD value = 0;
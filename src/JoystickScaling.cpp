@@ -0,0 +1,36 @@
+#include "JoystickScaling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double kDeadzoneMagnitude = 20.0; // Raw axis magnitude threshold.
+constexpr double kAxisMaxMagnitude = 255.0;
+constexpr double kOutputMaxMagnitude = 750.0;
+constexpr double kTwistDeadzone = 10.0;
+}
+
+bool ScaleJoystickAxes(double x, double y, double z, bool invertY, JoystickState* outState)
+{
+    if (std::abs(z) <= kTwistDeadzone)
+        z = 0.0;
+    const double magnitude = std::sqrt((x * x) + (y * y) + (z * z));
+    const double maxMagnitude = kAxisMaxMagnitude;
+
+    *outState = {};
+    if (magnitude < kDeadzoneMagnitude || magnitude <= 0.0)
+        return false;
+
+    const double invMagnitude = 1.0 / magnitude;
+    const double scaledMagnitude = std::clamp(
+        (magnitude - kDeadzoneMagnitude) / (maxMagnitude - kDeadzoneMagnitude),
+        0.0,
+        1.0);
+    const double outputScale = scaledMagnitude * kOutputMaxMagnitude;
+    const double ySign = invertY ? -1.0 : 1.0;
+
+    outState->x = x * invMagnitude * outputScale;
+    outState->y = y * invMagnitude * outputScale * ySign;
+    outState->z = z * invMagnitude * outputScale;
+    return true;
+}
@@ -1,499 +1,775 @@
 #include "JsonUtils.h"
 
-#include "StringUtils.h"
-
-#include <cctype>
-#include <cstdlib>
-#include <string_view>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
 #include <utility>
 
 namespace
 {
-bool TryExtractJsonObjectRange(const std::string& body,
-    const std::string& key,
-    size_t* outStart,
-    size_t* outEnd)
-{
-    size_t pos = body.find(key);
-    if (pos == std::string::npos)
-        return false;
+using JsonUtils::JsonKind;
+using JsonUtils::JsonValue;
 
-    pos = body.find(':', pos + key.size());
-    if (pos == std::string::npos)
-        return false;
+constexpr uint32_t kFnvOffsetBasis = 2166136261u;
+constexpr uint32_t kFnvPrime = 16777619u;
+constexpr uint32_t kSeedAttemptsPerSize = 64;
+constexpr size_t kMaxArrayIndexDigits = 20;
 
-    ++pos;
-    while (pos < body.size() && std::isspace(static_cast<unsigned char>(body[pos])))
-        ++pos;
+uint32_t HashKey(std::string_view key, uint32_t seed)
+{
+    uint32_t hash = kFnvOffsetBasis ^ (seed * 0x9E3779B9u);
+    for (const char ch : key)
+    {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= kFnvPrime;
+    }
+    return hash ^ (hash >> 15);
+}
 
-    if (pos >= body.size() || body[pos] != '{')
-        return false;
+bool IsJsonSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
 
-    bool inString = false;
-    bool escape = false;
-    int depth = 0;
-    for (size_t i = pos; i < body.size(); ++i)
+// Moves |pos| past whitespace; false at the end of |body|.
+bool SkipJsonSpace(std::string_view body, size_t* pos)
+{
+    while (*pos < body.size() && IsJsonSpace(body[*pos]))
+        ++*pos;
+    return *pos < body.size();
+}
+
+// "~1" is '/' and "~0" is '~' inside a JSON pointer segment.
+std::string UnescapePointerSegment(std::string_view segment)
+{
+    std::string key;
+    key.reserve(segment.size());
+    for (size_t i = 0; i < segment.size(); ++i)
     {
-        const char ch = body[i];
-        if (inString)
+        if (segment[i] == '~' && i + 1 < segment.size() && (segment[i + 1] == '0' || segment[i + 1] == '1'))
         {
-            if (escape)
-            {
-                escape = false;
-            }
-            else if (ch == '\\')
-            {
-                escape = true;
-            }
-            else if (ch == '"')
-            {
-                inString = false;
-            }
+            key.push_back(segment[i + 1] == '0' ? '~' : '/');
+            ++i;
             continue;
         }
+        key.push_back(segment[i]);
+    }
+    return key;
+}
 
-        if (ch == '"')
+using StopTable = std::array<bool, 256>;
+
+constexpr StopTable MakeStopTable(std::string_view stops)
+{
+    StopTable table = {};
+    for (const char ch : stops)
+        table[static_cast<unsigned char>(ch)] = true;
+    return table;
+}
+
+constexpr StopTable kStringStops = MakeStopTable("\"\\");
+constexpr StopTable kContainerStops = MakeStopTable("\"{}[]");
+constexpr StopTable kScalarStops = MakeStopTable(",}] \t\r\n");
+
+// find_first_of() without its per-byte search of the set.
+size_t FindStop(std::string_view body, size_t pos, const StopTable& stops)
+{
+    for (; pos < body.size(); ++pos)
+    {
+        if (stops[static_cast<unsigned char>(body[pos])])
+            return pos;
+    }
+    return std::string_view::npos;
+}
+
+// Returns the offset of the quote closing a string whose contents start at
+// |pos|, or npos.
+size_t FindStringEnd(std::string_view body, size_t pos, bool* outHasEscapes)
+{
+    bool hasEscapes = false;
+    for (;;)
+    {
+        const size_t stop = FindStop(body, pos, kStringStops);
+        if (stop == std::string_view::npos)
+            return stop;
+        if (body[stop] == '"')
         {
-            inString = true;
-            continue;
+            if (outHasEscapes)
+                *outHasEscapes = hasEscapes;
+            return stop;
         }
+        hasEscapes = true;
+        pos = stop + 2;
+    }
+}
+
+// Returns the offset just past the object or array opening at |pos|, or npos.
+size_t SkipContainer(std::string_view body, size_t pos)
+{
+    int depth = 0;
+    for (;;)
+    {
+        pos = FindStop(body, pos, kContainerStops);
+        if (pos == std::string_view::npos)
+            return pos;
 
-        if (ch == '{')
+        const char ch = body[pos];
+        if (ch == '"')
+        {
+            pos = FindStringEnd(body, pos + 1, nullptr);
+            if (pos == std::string_view::npos)
+                return pos;
+        }
+        else if (ch == '{' || ch == '[')
         {
-            if (depth == 0 && outStart)
-                *outStart = i;
             ++depth;
-            continue;
         }
-
-        if (ch == '}')
+        else if (--depth == 0)
         {
-            --depth;
-            if (depth == 0)
-            {
-                if (outEnd)
-                    *outEnd = i;
-                return true;
-            }
+            return pos + 1;
         }
+        ++pos;
     }
-
-    return false;
 }
 
-bool TryParseReturnHomeDisabledFromRange(const std::string& body,
-    size_t start,
-    size_t end,
-    bool* outDisabled)
+bool TryParseHex4(std::string_view text, size_t pos, char32_t* outValue)
 {
-    if (start >= body.size() || end <= start || end >= body.size())
-        return false;
-
-    const std::string_view view(body.data() + start, end - start + 1);
-    const std::string key = "\"returnHomeAfterInactivityMs\"";
-    size_t pos = view.find(key);
-    if (pos == std::string::npos)
+    if (pos + 4 > text.size())
         return false;
 
-    pos = view.find(':', pos + key.size());
-    if (pos == std::string::npos)
-        return false;
-
-    ++pos;
-    while (pos < view.size() && std::isspace(static_cast<unsigned char>(view[pos])))
-        ++pos;
+    char32_t value = 0;
+    for (size_t i = pos; i < pos + 4; ++i)
+    {
+        const char hex = text[i];
+        value <<= 4;
+        if (hex >= '0' && hex <= '9')
+            value += static_cast<char32_t>(hex - '0');
+        else if (hex >= 'A' && hex <= 'F')
+            value += static_cast<char32_t>(hex - 'A' + 10);
+        else if (hex >= 'a' && hex <= 'f')
+            value += static_cast<char32_t>(hex - 'a' + 10);
+        else
+            return false;
+    }
 
-    if (pos >= view.size())
-        return false;
+    *outValue = value;
+    return true;
+}
 
-    if (view.compare(pos, 4, "null") == 0 || view.compare(pos, 4, "NULL") == 0)
+void AppendUtf8(char32_t codePoint, std::string* out)
+{
+    if (codePoint < 0x80)
     {
-        if (outDisabled)
-            *outDisabled = true;
-        return true;
+        out->push_back(static_cast<char>(codePoint));
+        return;
+    }
+    if (codePoint < 0x800)
+    {
+        out->push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+    }
+    else if (codePoint < 0x10000)
+    {
+        out->push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+        out->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+    }
+    else
+    {
+        out->push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+        out->push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
     }
+    out->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+}
 
-    if (view[pos] == '"')
+bool TryParseReturnHomeValue(const JsonValue& value, bool* outDisabled)
+{
+    // Some firmware writes the null bare in upper case, or quoted.
+    bool disabled = false;
+    if (value.kind == JsonKind::Null || (value.kind != JsonKind::Missing && value.text == "NULL") ||
+        (value.kind == JsonKind::String && value.text == "null"))
     {
-        ++pos;
-        const size_t endQuote = view.find('"', pos);
-        if (endQuote == std::string::npos)
+        disabled = true;
+    }
+    else
+    {
+        int64_t inactivityMs = 0;
+        if (!JsonUtils::TryGetInt64(value, &inactivityMs))
             return false;
+        disabled = (inactivityMs <= 0);
+    }
 
-        const std::string value(view.substr(pos, endQuote - pos));
-        if (value == "null" || value == "NULL")
-        {
-            if (outDisabled)
-                *outDisabled = true;
-            return true;
-        }
+    if (outDisabled)
+        *outDisabled = disabled;
+    return true;
+}
 
-        char* endPtr = nullptr;
-        const long long parsed = std::strtoll(value.c_str(), &endPtr, 10);
-        if (endPtr == value.c_str() || *endPtr != '\0')
-            return false;
+// Field order matches the paths passed to the query below.
+enum CameraField : size_t
+{
+    kCameraId,
+    kCameraName,
+    kCameraState,
+    kCameraReturnHome,
+    kCameraFieldCount,
+};
+
+const JsonUtils::JsonPathQuery& CameraQuery()
+{
+    static const JsonUtils::JsonPathQuery query{
+        "/id", "/name", "/state", "/ptz/returnHomeAfterInactivityMs" };
+    return query;
+}
 
-        if (outDisabled)
-            *outDisabled = (parsed <= 0);
-        return true;
-    }
+enum DeviceEventField : size_t
+{
+    kEventType,
+    kEventId,
+    kEventModelKey,
+    kEventName,
+    kEventState,
+    kEventReturnHome,
+    kEventFieldCount,
+};
+
+const JsonUtils::JsonPathQuery& DeviceEventQuery()
+{
+    static const JsonUtils::JsonPathQuery query{
+        "/type", "/item/id", "/item/modelKey", "/item/name", "/item/state",
+        "/item/ptz/returnHomeAfterInactivityMs" };
+    return query;
+}
 
-    const char* startPtr = view.data() + pos;
-    char* endPtr = nullptr;
-    const long long parsed = std::strtoll(startPtr, &endPtr, 10);
-    if (endPtr == startPtr)
+// Reads a string field; other kinds leave |outValue| untouched.
+bool ReadString(const JsonValue& value, std::string* outValue)
+{
+    if (value.kind != JsonKind::String)
         return false;
-
-    if (outDisabled)
-        *outDisabled = (parsed <= 0);
+    *outValue = JsonUtils::DecodeString(value);
     return true;
 }
 
-bool TryParseJsonString(const std::string& body,
-    size_t start,
-    size_t end,
-    size_t* outNext,
-    std::string* outValue)
+bool TryParseCameraInfo(std::span<const JsonValue> values, CameraInfo* outCamera)
 {
-    if (start > end || body[start] != '"')
+    std::string id;
+    if (!ReadString(values[kCameraId], &id) || id.empty())
         return false;
 
-    std::string value;
-    bool escape = false;
-    for (size_t i = start + 1; i <= end; ++i)
+    if (outCamera)
     {
-        const char ch = body[i];
-        if (escape)
+        std::string name;
+        ReadString(values[kCameraName], &name);
+        outCamera->name = name.empty() ? id : std::move(name);
+        outCamera->id = std::move(id);
+        outCamera->state.clear();
+        ReadString(values[kCameraState], &outCamera->state);
+        outCamera->returnHomeDisabled = false;
+        outCamera->hasReturnHome =
+            TryParseReturnHomeValue(values[kCameraReturnHome], &outCamera->returnHomeDisabled);
+    }
+
+    return true;
+}
+}
+
+namespace JsonUtils
+{
+struct JsonPathQuery::WalkState
+{
+    std::string_view body;
+    size_t pos = 0;
+    std::span<JsonValue> values;
+    // Paths still unresolved; the walk stops as soon as this reaches zero,
+    // unless it has to find where the value ends.
+    size_t remaining = 0;
+    bool wholeValue = false;
+
+    bool Done() const { return remaining == 0 && !wholeValue; }
+};
+
+JsonPathQuery::JsonPathQuery(std::initializer_list<std::string_view> paths)
+    : nodes_(1)
+{
+    for (const std::string_view path : paths)
+        AddPath(path, static_cast<uint32_t>(pathCount_++));
+    BuildHashes();
+}
+
+void JsonPathQuery::AddPath(std::string_view path, uint32_t valueIndex)
+{
+    uint32_t nodeIndex = 0;
+    if (!path.empty())
+    {
+        if (path.front() == '/')
+            path.remove_prefix(1);
+        for (;;)
         {
-            switch (ch)
+            const size_t slash = path.find('/');
+            std::string key = UnescapePointerSegment(path.substr(0, slash));
+
+            uint32_t childIndex = kNone;
+            for (const uint32_t child : nodes_[nodeIndex].children)
             {
-                case '"': value.push_back('"'); break;
-                case '\\': value.push_back('\\'); break;
-                case '/': value.push_back('/'); break;
-                case 'b': value.push_back('\b'); break;
-                case 'f': value.push_back('\f'); break;
-                case 'n': value.push_back('\n'); break;
-                case 'r': value.push_back('\r'); break;
-                case 't': value.push_back('\t'); break;
-                case 'u':
+                if (nodes_[child].key == key)
                 {
-                    if (i + 4 > end)
-                        return false;
-                    unsigned int codePoint = 0;
-                    for (size_t j = 0; j < 4; ++j)
-                    {
-                        const char hex = body[i + 1 + j];
-                        codePoint <<= 4;
-                        if (hex >= '0' && hex <= '9')
-                            codePoint += static_cast<unsigned int>(hex - '0');
-                        else if (hex >= 'A' && hex <= 'F')
-                            codePoint += static_cast<unsigned int>(hex - 'A' + 10);
-                        else if (hex >= 'a' && hex <= 'f')
-                            codePoint += static_cast<unsigned int>(hex - 'a' + 10);
-                        else
-                            return false;
-                    }
-                    if (codePoint <= 0x7F)
-                        value.push_back(static_cast<char>(codePoint));
-                    else
-                        value.push_back('?');
-                    i += 4;
+                    childIndex = child;
                     break;
                 }
-                default:
-                    value.push_back(ch);
-                    break;
             }
-            escape = false;
-            continue;
-        }
-
-        if (ch == '\\')
-        {
-            escape = true;
-            continue;
-        }
+            if (childIndex == kNone)
+            {
+                childIndex = static_cast<uint32_t>(nodes_.size());
+                nodes_[nodeIndex].children.push_back(childIndex);
+                Node child;
+                child.key = std::move(key);
+                nodes_.push_back(std::move(child));
+            }
 
-        if (ch == '"')
-        {
-            if (outNext)
-                *outNext = i + 1;
-            if (outValue)
-                *outValue = value;
-            return true;
+            nodeIndex = childIndex;
+            if (slash == std::string_view::npos)
+                break;
+            path.remove_prefix(slash + 1);
         }
-
-        value.push_back(ch);
     }
 
-    return false;
+    nodes_[nodeIndex].valueIndex = valueIndex;
 }
 
-bool SkipJsonValue(const std::string& body, size_t start, size_t end, size_t* outNext)
+// Searches seeds until every child key lands in its own slot, growing the
+// table when a size runs out of seeds. Tables hold a handful of keys, so this
+// settles almost immediately.
+void JsonPathQuery::BuildHashes()
 {
-    if (start > end)
-        return false;
-
-    const char first = body[start];
-    if (first == '"')
-        return TryParseJsonString(body, start, end, outNext, nullptr);
-
-    if (first == '{' || first == '[')
+    for (Node& node : nodes_)
     {
-        const char open = first;
-        const char close = (first == '{') ? '}' : ']';
-        int depth = 0;
-        bool inString = false;
-        bool escape = false;
-        for (size_t i = start; i <= end; ++i)
+        if (node.children.empty())
+            continue;
+
+        bool found = false;
+        for (size_t tableSize = std::bit_ceil(node.children.size() * 2); !found; tableSize *= 2)
         {
-            const char ch = body[i];
-            if (inString)
+            const uint32_t mask = static_cast<uint32_t>(tableSize - 1);
+            for (uint32_t seed = 0; seed < kSeedAttemptsPerSize && !found; ++seed)
             {
-                if (escape)
+                std::vector<uint32_t> slots(tableSize, 0);
+                found = true;
+                for (const uint32_t child : node.children)
                 {
-                    escape = false;
-                }
-                else if (ch == '\\')
-                {
-                    escape = true;
+                    uint32_t& slot = slots[HashKey(nodes_[child].key, seed) & mask];
+                    if (slot != 0)
+                    {
+                        found = false;
+                        break;
+                    }
+                    slot = child + 1;
                 }
-                else if (ch == '"')
+                if (found)
                 {
-                    inString = false;
+                    node.seed = seed;
+                    node.slots = std::move(slots);
                 }
-                continue;
             }
+        }
+    }
+}
 
-            if (ch == '"')
-            {
-                inString = true;
-                continue;
-            }
+uint32_t JsonPathQuery::FindChild(const Node& node, std::string_view key) const
+{
+    if (node.slots.empty())
+        return kNone;
+
+    const uint32_t mask = static_cast<uint32_t>(node.slots.size() - 1);
+    const uint32_t slot = node.slots[HashKey(key, node.seed) & mask];
+    if (slot == 0)
+        return kNone;
+    const uint32_t child = slot - 1;
+    return nodes_[child].key == key ? child : kNone;
+}
 
-            if (ch == open)
-            {
-                ++depth;
-                continue;
-            }
+bool JsonPathQuery::Extract(std::string_view body, std::span<JsonValue> values) const
+{
+    if (values.size() < pathCount_)
+        return false;
 
-            if (ch == close)
-            {
-                --depth;
-                if (depth == 0)
-                {
-                    if (outNext)
-                        *outNext = i + 1;
-                    return true;
-                }
-            }
-        }
+    std::fill(values.begin(), values.end(), JsonValue{});
+    if (pathCount_ == 0)
+        return true;
 
-        return false;
-    }
+    WalkState state;
+    state.body = body;
+    state.values = values;
+    state.remaining = pathCount_;
+    return WalkValue(state, 0);
+}
 
-    size_t pos = start;
-    for (; pos <= end; ++pos)
-    {
-        const char ch = body[pos];
-        if (ch == ',' || ch == '}' || ch == ']')
-            break;
-    }
+bool JsonPathQuery::Extract(std::string_view body, size_t* pos, std::span<JsonValue> values) const
+{
+    if (values.size() < pathCount_)
+        return false;
 
-    if (outNext)
-        *outNext = pos;
+    std::fill(values.begin(), values.end(), JsonValue{});
+    WalkState state;
+    state.body = body;
+    state.pos = *pos;
+    state.values = values;
+    state.remaining = pathCount_;
+    state.wholeValue = true;
+    if (!WalkValue(state, 0))
+        return false;
+    *pos = state.pos;
     return true;
 }
 
-bool TryExtractNextJsonObjectRange(const std::string& body,
-    size_t searchStart,
-    size_t* outStart,
-    size_t* outEnd)
+// |nodeIndex| is kNone for values off every path; those are only skipped.
+bool JsonPathQuery::WalkValue(WalkState& state, uint32_t nodeIndex) const
 {
-    bool inString = false;
-    bool escape = false;
-    int depth = 0;
-    size_t objectStart = std::string::npos;
+    const std::string_view body = state.body;
+    while (state.pos < body.size() && IsJsonSpace(body[state.pos]))
+        ++state.pos;
+    if (state.pos >= body.size())
+        return false;
 
-    for (size_t i = searchStart; i < body.size(); ++i)
+    const Node* node = (nodeIndex == kNone) ? nullptr : &nodes_[nodeIndex];
+    const size_t start = state.pos;
+    const char first = body[start];
+    JsonValue value;
+    if (first == '{' || first == '[')
     {
-        const char ch = body[i];
-        if (inString)
+        value.kind = (first == '{') ? JsonKind::Object : JsonKind::Array;
+        if (node && !node->children.empty())
         {
-            if (escape)
-            {
-                escape = false;
-            }
-            else if (ch == '\\')
-            {
-                escape = true;
-            }
-            else if (ch == '"')
-            {
-                inString = false;
-            }
-            continue;
+            const bool walked = (first == '{') ? WalkObject(state, *node) : WalkArray(state, *node);
+            if (!walked)
+                return false;
+            if (state.Done())
+                return true;
         }
-
-        if (ch == '"')
+        else
         {
-            inString = true;
-            continue;
+            state.pos = SkipContainer(body, start);
+            if (state.pos == std::string_view::npos)
+                return false;
         }
+        value.text = body.substr(start, state.pos - start);
+    }
+    else if (first == '"')
+    {
+        const size_t end = FindStringEnd(body, start + 1, &value.hasEscapes);
+        if (end == std::string_view::npos)
+            return false;
+        value.kind = JsonKind::String;
+        value.text = body.substr(start + 1, end - start - 1);
+        state.pos = end + 1;
+    }
+    else
+    {
+        size_t end = FindStop(body, start, kScalarStops);
+        if (end == std::string_view::npos)
+            end = body.size();
+        if (end == start)
+            return false;
+        if (first == 'n')
+            value.kind = JsonKind::Null;
+        else if (first == 't' || first == 'f')
+            value.kind = JsonKind::Bool;
+        else
+            value.kind = JsonKind::Number;
+        value.text = body.substr(start, end - start);
+        state.pos = end;
+    }
 
-        if (ch == '{')
-        {
-            if (depth == 0)
-                objectStart = i;
-            ++depth;
-            continue;
-        }
+    if (node && node->valueIndex != kNone && state.values[node->valueIndex].kind == JsonKind::Missing)
+    {
+        state.values[node->valueIndex] = value;
+        --state.remaining;
+    }
+    return true;
+}
 
-        if (ch == '}')
-        {
-            if (depth == 0)
-                continue;
-            --depth;
-            if (depth == 0 && objectStart != std::string::npos)
-            {
-                if (outStart)
-                    *outStart = objectStart;
-                if (outEnd)
-                    *outEnd = i;
-                return true;
-            }
-        }
+bool JsonPathQuery::WalkObject(WalkState& state, const Node& node) const
+{
+    const std::string_view body = state.body;
+    auto skipSpace = [&]() {
+        while (state.pos < body.size() && IsJsonSpace(body[state.pos]))
+            ++state.pos;
+        return state.pos < body.size();
+    };
+
+    ++state.pos;
+    if (!skipSpace())
+        return false;
+    if (body[state.pos] == '}')
+    {
+        ++state.pos;
+        return true;
     }
 
-    return false;
+    for (;;)
+    {
+        if (!skipSpace() || body[state.pos] != '"')
+            return false;
+        const size_t keyEnd = FindStringEnd(body, state.pos + 1, nullptr);
+        if (keyEnd == std::string_view::npos)
+            return false;
+        const std::string_view key = body.substr(state.pos + 1, keyEnd - state.pos - 1);
+        state.pos = keyEnd + 1;
+
+        if (!skipSpace() || body[state.pos] != ':')
+            return false;
+        ++state.pos;
+        if (!WalkValue(state, FindChild(node, key)))
+            return false;
+        if (state.Done())
+            return true;
+
+        if (!skipSpace())
+            return false;
+        const char separator = body[state.pos++];
+        if (separator == '}')
+            return true;
+        if (separator != ',')
+            return false;
+    }
 }
 
-bool TryParseCameraInfo(const std::string& body,
-    size_t start,
-    size_t end,
-    CameraInfo* outCamera)
+bool JsonPathQuery::WalkArray(WalkState& state, const Node& node) const
 {
-    if (start >= body.size() || end >= body.size() || start >= end)
+    const std::string_view body = state.body;
+    auto skipSpace = [&]() {
+        while (state.pos < body.size() && IsJsonSpace(body[state.pos]))
+            ++state.pos;
+        return state.pos < body.size();
+    };
+
+    ++state.pos;
+    if (!skipSpace())
         return false;
+    if (body[state.pos] == ']')
+    {
+        ++state.pos;
+        return true;
+    }
 
-    if (body[start] != '{')
-        return false;
+    for (size_t index = 0;; ++index)
+    {
+        char digits[kMaxArrayIndexDigits];
+        const auto converted = std::to_chars(digits, digits + sizeof(digits), index);
+        const std::string_view key(digits, static_cast<size_t>(converted.ptr - digits));
+        if (!WalkValue(state, FindChild(node, key)))
+            return false;
+        if (state.Done())
+            return true;
 
-    size_t pos = start + 1;
-    std::string id;
-    std::string name;
-    std::string state;
+        if (!skipSpace())
+            return false;
+        const char separator = body[state.pos++];
+        if (separator == ']')
+            return true;
+        if (separator != ',')
+            return false;
+    }
+}
 
-    while (pos <= end)
+bool TryGetInt64(const JsonValue& value, int64_t* outValue)
+{
+    const char* begin = value.text.data();
+    const char* end = begin + value.text.size();
+    int64_t parsed = 0;
+    if (value.kind == JsonKind::Number)
+    {
+        // A fractional part or exponent is dropped.
+        const auto result = std::from_chars(begin, end, parsed);
+        if (result.ec != std::errc() || result.ptr == begin)
+            return false;
+    }
+    else if (value.kind == JsonKind::String && !value.hasEscapes)
     {
-        while (pos <= end && (std::isspace(static_cast<unsigned char>(body[pos])) || body[pos] == ','))
-            ++pos;
+        const auto result = std::from_chars(begin, end, parsed);
+        if (result.ec != std::errc() || result.ptr != end || begin == end)
+            return false;
+    }
+    else
+    {
+        return false;
+    }
 
-        if (pos > end || body[pos] == '}')
-            break;
+    if (outValue)
+        *outValue = parsed;
+    return true;
+}
 
-        if (body[pos] != '"')
+std::string DecodeString(const JsonValue& value)
+{
+    if (value.kind != JsonKind::String)
+        return {};
+    if (!value.hasEscapes)
+        return std::string(value.text);
+
+    const std::string_view text = value.text;
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        const char ch = text[i];
+        if (ch != '\\' || i + 1 >= text.size())
         {
-            ++pos;
+            decoded.push_back(ch);
             continue;
         }
 
-        std::string key;
-        size_t nextPos = pos;
-        if (!TryParseJsonString(body, pos, end, &nextPos, &key))
-            return false;
-
-        pos = nextPos;
-        while (pos <= end && std::isspace(static_cast<unsigned char>(body[pos])))
-            ++pos;
-        if (pos > end || body[pos] != ':')
-            return false;
-        ++pos;
-        while (pos <= end && std::isspace(static_cast<unsigned char>(body[pos])))
-            ++pos;
-        if (pos > end)
-            return false;
-
-        if (key == "id" || key == "name" || key == "state")
+        const char escaped = text[++i];
+        switch (escaped)
         {
-            if (body[pos] == '"')
+            case 'b': decoded.push_back('\b'); break;
+            case 'f': decoded.push_back('\f'); break;
+            case 'n': decoded.push_back('\n'); break;
+            case 'r': decoded.push_back('\r'); break;
+            case 't': decoded.push_back('\t'); break;
+            case 'u':
             {
-                std::string value;
-                if (!TryParseJsonString(body, pos, end, &nextPos, &value))
-                    return false;
-                if (key == "id")
-                    id = std::move(value);
-                else if (key == "name")
-                    name = std::move(value);
-                else if (key == "state")
-                    state = std::move(value);
-                pos = nextPos;
-            }
-            else
-            {
-                if (!SkipJsonValue(body, pos, end, &nextPos))
-                    return false;
-                pos = nextPos;
+                char32_t codePoint = 0;
+                if (!TryParseHex4(text, i + 1, &codePoint))
+                {
+                    decoded.push_back('?');
+                    break;
+                }
+                i += 4;
+
+                // Surrogate pairs arrive as two escapes.
+                char32_t low = 0;
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF &&
+                    i + 2 < text.size() && text[i + 1] == '\\' && text[i + 2] == 'u' &&
+                    TryParseHex4(text, i + 3, &low) && low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                else if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+                {
+                    codePoint = 0xFFFD;
+                }
+                AppendUtf8(codePoint, &decoded);
+                break;
             }
-        }
-        else
-        {
-            if (!SkipJsonValue(body, pos, end, &nextPos))
-                return false;
-            pos = nextPos;
+            default:
+                decoded.push_back(escaped);
+                break;
         }
     }
 
-    if (id.empty())
-        return false;
-
-    if (outCamera)
-    {
-        outCamera->id = Utf8ToWide(id);
-        outCamera->name = Utf8ToWide(name.empty() ? id : name);
-        outCamera->state = Utf8ToWide(state);
-    }
-
-    return true;
-}
+    return decoded;
 }
 
-namespace JsonUtils
-{
-bool TryParseReturnHomeDisabled(const std::string& body, bool* outDisabled)
+std::string BuildMovePayload(const JoystickState& state)
 {
-    if (body.empty())
-        return false;
+    return "{"
+        "\"type\":\"continuous\","
+        "\"payload\":{"
+        "\"x\":" + std::to_string(static_cast<int>(state.x)) + ","
+        "\"y\":" + std::to_string(static_cast<int>(state.y)) + ","
+        "\"z\":" + std::to_string(static_cast<int>(state.z)) +
+        "}}";
+}
 
-    size_t start = 0;
-    size_t end = 0;
-    if (TryExtractJsonObjectRange(body, "\"ptz\"", &start, &end) &&
-        TryParseReturnHomeDisabledFromRange(body, start, end, outDisabled))
+JsonValue FindMember(std::string_view body, std::string_view key)
+{
+    static const JsonPathQuery root{ "" };
+    size_t pos = 0;
+    for (;;)
     {
-        return true;
+        const size_t open = body.find('"', pos);
+        if (open == std::string_view::npos)
+            return {};
+        const size_t close = FindStringEnd(body, open + 1, nullptr);
+        if (close == std::string_view::npos)
+            return {};
+
+        // Only a string followed by a colon is a key; values are skipped
+        // whole, so text inside them never matches.
+        pos = close + 1;
+        if (!SkipJsonSpace(body, &pos) || body[pos] != ':' || body.substr(open + 1, close - open - 1) != key)
+            continue;
+        ++pos;
+        JsonValue value;
+        if (!root.Extract(body, &pos, std::span<JsonValue>(&value, 1)))
+            return {};
+        return value;
     }
+}
 
-    return TryParseReturnHomeDisabledFromRange(body, 0, body.size() - 1, outDisabled);
+bool TryParseReturnHomeDisabled(std::string_view body, bool* outDisabled)
+{
+    // Camera documents nest the setting under "ptz"; PATCH echoes and
+    // older firmware put it elsewhere, so take the first one anywhere.
+    return TryParseReturnHomeValue(FindMember(body, "returnHomeAfterInactivityMs"), outDisabled);
 }
 
-bool TryParseCameraList(const std::string& body, std::vector<CameraInfo>* cameras)
+bool TryParseCameraList(std::string_view body, std::vector<CameraInfo>* cameras)
 {
     if (!cameras)
         return false;
 
     cameras->clear();
 
-    size_t searchStart = 0;
-    size_t objStart = 0;
-    size_t objEnd = 0;
-    while (TryExtractNextJsonObjectRange(body, searchStart, &objStart, &objEnd))
+    // One walk over the root array: each element is queried where it lies
+    // and the walk carries on from where it ended.
+    size_t pos = 0;
+    if (!SkipJsonSpace(body, &pos) || body[pos] != '[')
+        return false;
+    ++pos;
+    if (!SkipJsonSpace(body, &pos))
+        return false;
+    if (body[pos] == ']')
+        return true;
+
+    for (;;)
     {
+        JsonValue values[kCameraFieldCount];
+        if (!CameraQuery().Extract(body, &pos, values))
+            return false;
         CameraInfo camera;
-        if (TryParseCameraInfo(body, objStart, objEnd, &camera))
+        if (TryParseCameraInfo(values, &camera))
             cameras->push_back(std::move(camera));
-        searchStart = objEnd + 1;
+
+        if (!SkipJsonSpace(body, &pos))
+            return false;
+        const char separator = body[pos++];
+        if (separator == ']')
+            return true;
+        if (separator != ',')
+            return false;
     }
+}
 
+bool TryParseDeviceEvent(std::string_view body, DeviceEvent* outEvent)
+{
+    if (!outEvent || body.empty())
+        return false;
+
+    *outEvent = {};
+    JsonValue values[kEventFieldCount];
+    if (!DeviceEventQuery().Extract(body, values))
+        return false;
+
+    const std::string_view type = values[kEventType].text;
+    if (values[kEventType].kind != JsonKind::String)
+        return false;
+    if (type == "add")
+        outEvent->type = DeviceEventType::Add;
+    else if (type == "update")
+        outEvent->type = DeviceEventType::Update;
+    else if (type == "remove")
+        outEvent->type = DeviceEventType::Remove;
+    else
+        return false;
+
+    CameraInfo& camera = outEvent->camera;
+    if (!ReadString(values[kEventId], &camera.id) || camera.id.empty())
+        return false;
+    ReadString(values[kEventModelKey], &outEvent->modelKey);
+    outEvent->hasName = ReadString(values[kEventName], &camera.name);
+    outEvent->hasState = ReadString(values[kEventState], &camera.state);
+    camera.hasReturnHome = TryParseReturnHomeValue(values[kEventReturnHome], &camera.returnHomeDisabled);
     return true;
 }
 }
@@ -1,13 +1,15 @@
 #include "LogUtils.h"
 
 #include "RegistryUtils.h"
+#include "StringUtils.h"
+#include "TaskPool.h"
 
 #include <Windows.h>
 
 #include <cstdio>
-#include <iomanip>
 #include <mutex>
-#include <sstream>
+#include <string>
+#include <vector>
 
 namespace {
 constexpr wchar_t kRegistrySubkey[] = L"SOFTWARE\\JoystickTesting";
@@ -20,6 +22,10 @@ struct LogState
     bool debugEnabled = false;
     bool consoleReady = false;
     HWND anchorWindow = nullptr;
+    // Console writes go out on the task pool; one flush runs at a time so
+    // lines keep their order.
+    std::vector<std::string> pendingLines;
+    bool flushScheduled = false;
 };
 
 LogState& GetLogState()
@@ -58,6 +64,7 @@ void EnsureLoggingInitialized(LogState& state)
             FILE* outFile = nullptr;
             if (freopen_s(&outFile, "CONOUT$", "w", stdout) == 0)
             {
+                SetConsoleOutputCP(CP_UTF8);
                 setvbuf(stdout, nullptr, _IONBF, 0);
                 state.consoleReady = true;
                 PositionConsoleWindow(state);
@@ -66,20 +73,56 @@ void EnsureLoggingInitialized(LogState& state)
     }
 }
 
-std::wstring BuildTimestampedLine(const std::wstring& line)
+std::string BuildTimestampedLine(std::string_view line)
 {
     SYSTEMTIME st = {};
     GetLocalTime(&st);
-    std::wostringstream stream;
-    stream << L"["
-           << st.wYear << L"-"
-           << std::setw(2) << std::setfill(L'0') << st.wMonth << L"-"
-           << std::setw(2) << std::setfill(L'0') << st.wDay << L" "
-           << std::setw(2) << std::setfill(L'0') << st.wHour << L":"
-           << std::setw(2) << std::setfill(L'0') << st.wMinute << L":"
-           << std::setw(2) << std::setfill(L'0') << st.wSecond
-           << L"] " << line;
-    return stream.str();
+    char prefix[32] = {};
+    const int length = snprintf(prefix, sizeof(prefix), "[%u-%02u-%02u %02u:%02u:%02u] ",
+        st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+
+    std::string timestamped(prefix, length > 0 ? static_cast<size_t>(length) : 0);
+    timestamped += line;
+    timestamped += "\r\n";
+    return timestamped;
+}
+
+void WriteConsoleText(const std::string& text)
+{
+    HANDLE outputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (!outputHandle || outputHandle == INVALID_HANDLE_VALUE)
+        return;
+
+    DWORD written = 0;
+    WriteFile(outputHandle, text.data(), static_cast<DWORD>(text.size()), &written, nullptr);
+}
+
+std::string JoinLines(std::vector<std::string>* lines)
+{
+    std::string text;
+    for (const auto& line : *lines)
+        text += line;
+    lines->clear();
+    return text;
+}
+
+void FlushLogLines()
+{
+    LogState& state = GetLogState();
+    for (;;)
+    {
+        std::string text;
+        {
+            std::scoped_lock lock(state.mutex);
+            if (state.pendingLines.empty())
+            {
+                state.flushScheduled = false;
+                return;
+            }
+            text = JoinLines(&state.pendingLines);
+        }
+        WriteConsoleText(text);
+    }
 }
 }
 
@@ -93,7 +136,7 @@ void SetLogAnchorWindow(HWND window)
         PositionConsoleWindow(state);
 }
 
-void AppendLogLine(const std::wstring& line)
+void AppendLogLine(std::string_view line)
 {
     LogState& state = GetLogState();
     std::scoped_lock lock(state.mutex);
@@ -102,13 +145,17 @@ void AppendLogLine(const std::wstring& line)
     if (!state.debugEnabled || !state.consoleReady)
         return;
 
-    const std::wstring timestamped = BuildTimestampedLine(line);
-    HANDLE outputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (!outputHandle || outputHandle == INVALID_HANDLE_VALUE)
+    state.pendingLines.push_back(BuildTimestampedLine(line));
+    if (state.flushScheduled)
         return;
 
-    DWORD written = 0;
-    WriteConsoleW(outputHandle, timestamped.c_str(),
-        static_cast<DWORD>(timestamped.size()), &written, nullptr);
-    WriteConsoleW(outputHandle, L"\r\n", 2, &written, nullptr);
+    // Without the pool (startup, shutdown) the caller writes the backlog.
+    state.flushScheduled = SubmitPoolTask(FlushLogLines);
+    if (!state.flushScheduled)
+        WriteConsoleText(JoinLines(&state.pendingLines));
+}
+
+void AppendLogLine(const std::wstring& line)
+{
+    AppendLogLine(WideToUtf8(line));
 }
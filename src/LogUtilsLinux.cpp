@@ -0,0 +1,77 @@
+#include "LogUtils.h"
+
+#include "StringUtils.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+
+// The Linux side of LogUtils.cpp, for the portable code built outside the
+// Win32 app: the JOYSTICK_DEBUG environment variable stands in for the Debug
+// registry value, and lines go to stderr as they are logged.
+namespace {
+struct LogState
+{
+    std::mutex mutex;
+    bool initialized = false;
+    bool debugEnabled = false;
+};
+
+LogState& GetLogState()
+{
+    static LogState state;
+    return state;
+}
+
+void EnsureLoggingInitialized(LogState& state)
+{
+    if (state.initialized)
+        return;
+
+    state.initialized = true;
+    const char* value = getenv("JOYSTICK_DEBUG");
+    state.debugEnabled = value && strcmp(value, "1") == 0;
+}
+
+std::string BuildTimestampedLine(std::string_view line)
+{
+    const time_t now = time(nullptr);
+    tm local = {};
+    localtime_r(&now, &local);
+    char prefix[32] = {};
+    const size_t length = strftime(prefix, sizeof(prefix), "[%Y-%m-%d %H:%M:%S] ", &local);
+
+    std::string timestamped(prefix, length);
+    timestamped += line;
+    timestamped += '\n';
+    return timestamped;
+}
+}
+
+void SetLogAnchorWindow(HWND window)
+{
+    (void)window;
+}
+
+void AppendLogLine(std::string_view line)
+{
+    LogState& state = GetLogState();
+    std::scoped_lock lock(state.mutex);
+    EnsureLoggingInitialized(state);
+
+    if (!state.debugEnabled)
+        return;
+
+    const std::string text = BuildTimestampedLine(line);
+    (void)write(STDERR_FILENO, text.data(), text.size());
+}
+
+void AppendLogLine(const std::wstring& line)
+{
+    AppendLogLine(WideToUtf8(line));
+}
@@ -0,0 +1,95 @@
+#include "NetworkEvents.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+bool ContainsCamera(const std::vector<CameraHandle>& cameras, CameraHandle camera)
+{
+    return std::find(cameras.begin(), cameras.end(), camera) != cameras.end();
+}
+}
+
+std::shared_ptr<const CameraListPatch> MergeCameraListPatches(const CameraListPatch& older,
+    const CameraListPatch& newer)
+{
+    auto merged = std::make_shared<CameraListPatch>(newer);
+    for (const CameraHandle camera : older.changed)
+    {
+        if (!ContainsCamera(newer.removed, camera) && !ContainsCamera(newer.changed, camera))
+            merged->changed.push_back(camera);
+    }
+    for (const CameraHandle camera : older.removed)
+    {
+        if (!ContainsCamera(merged->removed, camera) && !ContainsCamera(newer.changed, camera))
+            merged->removed.push_back(camera);
+    }
+    return merged;
+}
+
+void NetworkEventQueue::SetNotifier(std::function<void()> notifier)
+{
+    std::function<void()> wake;
+    {
+        std::scoped_lock lock(mutex_);
+        notifier_ = std::move(notifier);
+        notified_ = notifier_ && !events_.empty();
+        if (notified_)
+            wake = notifier_;
+    }
+    if (wake)
+        wake();
+}
+
+void NetworkEventQueue::Push(NetworkEvent event)
+{
+    std::function<void()> wake;
+    {
+        std::scoped_lock lock(mutex_);
+        Coalesce(&event);
+        events_.push_back(std::move(event));
+        if (notifier_ && !notified_)
+        {
+            notified_ = true;
+            wake = notifier_;
+        }
+    }
+    if (wake)
+        wake();
+}
+
+bool NetworkEventQueue::Drain(std::vector<NetworkEvent>* events)
+{
+    std::scoped_lock lock(mutex_);
+    notified_ = false;
+    if (events_.empty())
+        return false;
+    events->assign(std::make_move_iterator(events_.begin()), std::make_move_iterator(events_.end()));
+    events_.clear();
+    return true;
+}
+
+void NetworkEventQueue::Coalesce(NetworkEvent* event)
+{
+    if (event->type == NetworkEventType::CameraListPatched)
+    {
+        // A queued patch always follows any queued full list.
+        auto it = std::find_if(events_.begin(), events_.end(),
+            [](const NetworkEvent& queued) { return queued.type == NetworkEventType::CameraListPatched; });
+        if (it != events_.end())
+        {
+            event->patch = MergeCameraListPatches(*it->patch, *event->patch);
+            events_.erase(it);
+        }
+        return;
+    }
+
+    // A full list also supersedes the patches queued before it.
+    const bool replacesList = event->type == NetworkEventType::CameraListReplaced;
+    events_.erase(std::remove_if(events_.begin(), events_.end(),
+        [&](const NetworkEvent& queued)
+        {
+            return queued.type == event->type ||
+                (replacesList && queued.type == NetworkEventType::CameraListPatched);
+        }), events_.end());
+}
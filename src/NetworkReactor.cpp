@@ -0,0 +1,223 @@
+#include "NetworkReactor.h"
+
+#include "PipelineTrace.h"
+
+#include <algorithm>
+
+bool NetworkReactor::Start()
+{
+    if (thread_.joinable())
+        return true;
+    if (!poller_.IsValid())
+        return false;
+
+    {
+        std::scoped_lock lock(mutex_);
+        stopRequested_ = false;
+    }
+    thread_ = std::thread(&NetworkReactor::Run, this);
+    return true;
+}
+
+void NetworkReactor::Stop()
+{
+    if (!thread_.joinable())
+        return;
+
+    {
+        std::scoped_lock lock(mutex_);
+        stopRequested_ = true;
+    }
+    poller_.Wake();
+    thread_.join();
+    threadId_ = {};
+
+    // Anything still parked belongs to a task that no longer exists.
+    ready_.clear();
+    timers_ = {};
+}
+
+void NetworkReactor::Post(std::function<void()> work)
+{
+    {
+        std::scoped_lock lock(mutex_);
+        posted_.push_back(std::move(work));
+    }
+    poller_.Wake();
+}
+
+void NetworkReactor::Wake()
+{
+    poller_.Wake();
+}
+
+bool NetworkReactor::IsReactorThread() const
+{
+    return std::this_thread::get_id() == threadId_;
+}
+
+void NetworkReactor::Spawn(Task<void> task)
+{
+    ++liveTasks_;
+    RunDetached(std::move(task));
+}
+
+NetworkReactor::SleepAwaiter NetworkReactor::SleepUntil(Clock::time_point deadline)
+{
+    return SleepAwaiter(*this, deadline);
+}
+
+NetworkReactor::SleepAwaiter NetworkReactor::SleepFor(Clock::duration duration)
+{
+    return SleepAwaiter(*this, Clock::now() + duration);
+}
+
+void NetworkReactor::AddTimer(Clock::time_point deadline, std::shared_ptr<ReactorWaiter> waiter)
+{
+    timers_.push(Timer{ deadline, ++timerSequence_, std::move(waiter) });
+}
+
+void NetworkReactor::Resume(std::shared_ptr<ReactorWaiter> waiter)
+{
+    if (waiter->resumed)
+        return;
+    waiter->resumed = true;
+    ready_.push_back(std::move(waiter));
+}
+
+DetachedTask NetworkReactor::RunDetached(Task<void> task)
+{
+    co_await task;
+    --liveTasks_;
+}
+
+void NetworkReactor::Run()
+{
+    threadId_ = std::this_thread::get_id();
+    SetTraceThreadName("Network");
+    for (;;)
+    {
+        RunPosted();
+        RunSignals();
+        RunDueTimers();
+        RunReady();
+
+        {
+            std::scoped_lock lock(mutex_);
+            // Posted work may be what lets the tasks finish, so it runs first.
+            if (stopRequested_ && liveTasks_ == 0 && posted_.empty())
+                break;
+            if (!posted_.empty())
+                continue;
+        }
+
+        poller_.Wait(ready_.empty() ? NextTimeoutMs() : 0);
+    }
+}
+
+void NetworkReactor::RunPosted()
+{
+    std::vector<std::function<void()>> work;
+    {
+        std::scoped_lock lock(mutex_);
+        work.swap(posted_);
+    }
+    for (auto& item : work)
+        item();
+}
+
+void NetworkReactor::RunSignals()
+{
+    for (ReactorSignal* signal : signals_)
+    {
+        if (signal->raised_.exchange(false, std::memory_order_acq_rel))
+            signal->handler_();
+    }
+}
+
+void NetworkReactor::RunReady()
+{
+    // Resumed coroutines may park or resume others; those run next pass.
+    std::deque<std::shared_ptr<ReactorWaiter>> ready;
+    ready.swap(ready_);
+    for (const auto& waiter : ready)
+        waiter->handle.resume();
+}
+
+void NetworkReactor::RunDueTimers()
+{
+    const auto now = Clock::now();
+    while (!timers_.empty() && timers_.top().deadline <= now)
+    {
+        std::shared_ptr<ReactorWaiter> waiter = timers_.top().waiter;
+        timers_.pop();
+        Resume(std::move(waiter));
+    }
+}
+
+int NetworkReactor::NextTimeoutMs() const
+{
+    if (timers_.empty())
+        return -1;
+
+    const auto remaining = timers_.top().deadline - Clock::now();
+    if (remaining <= Clock::duration::zero())
+        return 0;
+
+    // Round up so the wait never ends just short of the deadline.
+    const auto ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+    return static_cast<int>(std::min<long long>(ms, INT32_MAX));
+}
+
+ReactorSignal::ReactorSignal(NetworkReactor& reactor, std::function<void()> handler)
+    : reactor_(reactor),
+      handler_(std::move(handler))
+{
+    reactor_.signals_.push_back(this);
+}
+
+void ReactorSignal::Raise()
+{
+    if (!raised_.exchange(true, std::memory_order_acq_rel))
+        reactor_.Wake();
+}
+
+void AsyncCondition::Park(std::coroutine_handle<> handle,
+    std::optional<NetworkReactor::Clock::time_point> deadline)
+{
+    // Waiters that timed out stay listed until now; drop them.
+    std::erase_if(waiters_, [](const auto& waiter) { return waiter->resumed; });
+
+    auto waiter = std::make_shared<ReactorWaiter>();
+    waiter->handle = handle;
+    waiters_.push_back(waiter);
+    if (deadline)
+        reactor_.AddTimer(*deadline, std::move(waiter));
+}
+
+void AsyncCondition::NotifyAll()
+{
+    std::vector<std::shared_ptr<ReactorWaiter>> waiters;
+    waiters.swap(waiters_);
+    for (auto& waiter : waiters)
+        reactor_.Resume(std::move(waiter));
+}
+
+void TaskGroup::Spawn(Task<void> task)
+{
+    ++pending_;
+    Run(std::move(task));
+}
+
+Task<void> TaskGroup::Join()
+{
+    while (pending_ > 0)
+        co_await done_.Wait();
+}
+
+DetachedTask TaskGroup::Run(Task<void> task)
+{
+    co_await task;
+    if (--pending_ == 0)
+        done_.NotifyAll();
+}
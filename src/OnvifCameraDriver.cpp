@@ -0,0 +1,244 @@
+#include "OnvifCameraDriver.h"
+
+#include "LogUtils.h"
+#include "PipelineTrace.h"
+#include "StringUtils.h"
+
+#include <bcrypt.h>
+
+#include <cstdio>
+
+namespace {
+// Cameras reject a Created time too far from their clock; renew well
+// before the usual five-minute window.
+constexpr auto kSecurityLifetime = std::chrono::seconds(60);
+constexpr DWORD kDefaultTimeoutMs = 2000;
+constexpr size_t kNonceSize = 16;
+
+constexpr wchar_t kContinuousMoveHeaders[] =
+    L"Content-Type: application/soap+xml; charset=utf-8; "
+    L"action=\"http://www.onvif.org/ver20/ptz/wsdl/ContinuousMove\"\r\n";
+constexpr wchar_t kStopHeaders[] =
+    L"Content-Type: application/soap+xml; charset=utf-8; "
+    L"action=\"http://www.onvif.org/ver20/ptz/wsdl/Stop\"\r\n";
+constexpr wchar_t kGetProfilesHeaders[] =
+    L"Content-Type: application/soap+xml; charset=utf-8; "
+    L"action=\"http://www.onvif.org/ver10/media/wsdl/GetProfiles\"\r\n";
+
+std::string FormatUtcNow()
+{
+    SYSTEMTIME now = {};
+    GetSystemTime(&now);
+    char text[32] = {};
+    snprintf(text, sizeof(text), "%04u-%02u-%02uT%02u:%02u:%02uZ",
+        now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond);
+    return text;
+}
+
+bool IsHttpSuccess(DWORD status)
+{
+    return status >= 200 && status < 300;
+}
+
+// The camera's HTTP status and SOAP fault only go into the text:
+// CameraCommandResult's httpStatus is the controller's.
+void CopyFailure(const HttpResult& sent, const wchar_t* action, CameraCommandResult* result)
+{
+    result->hr = FAILED(sent.hr) ? sent.hr : E_FAIL;
+    result->error = sent.error;
+    result->timedOut = sent.timedOut;
+    result->cancelled = sent.cancelled;
+    result->errorText = action;
+    if (!sent.errorText.empty())
+    {
+        result->errorText += L": ";
+        result->errorText += sent.errorText;
+    }
+    else if (sent.response.status != 0)
+    {
+        result->errorText += L": HTTP " + std::to_wstring(sent.response.status);
+        OnvifFault fault;
+        if (TryParseOnvifFault(sent.body, &fault))
+        {
+            result->errorText += L", " + Utf8ToWide(fault.code);
+            if (!fault.reason.empty())
+                result->errorText += L" (" + Utf8ToWide(fault.reason) + L")";
+        }
+    }
+}
+}
+
+OnvifCameraDriver::OnvifCameraDriver(NetworkReactor& reactor)
+    : reactor_(reactor)
+{
+}
+
+OnvifCameraDriver::~OnvifCameraDriver()
+{
+    Close();
+}
+
+void OnvifCameraDriver::Close()
+{
+    // Requests still in flight keep their own handles alive.
+    for (auto& [cameraId, camera] : cameras_)
+    {
+        if (camera->connection)
+            WinHttpCloseHandle(camera->connection);
+    }
+    cameras_.clear();
+    if (session_)
+    {
+        WinHttpCloseHandle(session_);
+        session_ = nullptr;
+    }
+}
+
+bool OnvifCameraDriver::AddCamera(const std::string& cameraId, const OnvifCameraConfig& config)
+{
+    if (!session_)
+        session_ = OpenAsyncHttpSession();
+    if (!session_)
+        return false;
+
+    HINTERNET connection = WinHttpConnect(session_, config.host.c_str(), config.port, 0);
+    if (!connection)
+    {
+        AppendLogLine("ONVIF: connect failed for " + cameraId + ": " + std::to_string(GetLastError()));
+        return false;
+    }
+
+    // Updated in place: a move in flight may still hold the old entry.
+    std::unique_ptr<Camera>& slot = cameras_[cameraId];
+    if (!slot)
+        slot = std::make_unique<Camera>();
+    Camera& camera = *slot;
+    if (camera.connection)
+        WinHttpCloseHandle(camera.connection);
+    camera = Camera();
+    camera.config = config;
+    camera.connection = connection;
+    AppendLogLine("ONVIF: " + cameraId + " at " + WideToUtf8(config.host) + ":" + std::to_string(config.port));
+    return true;
+}
+
+bool OnvifCameraDriver::RefreshSecurity(Camera& camera)
+{
+    camera.securityExpiresAt = std::chrono::steady_clock::now() + kSecurityLifetime;
+    if (camera.config.username.empty())
+    {
+        camera.securityHeader.clear();
+        BuildEnvelopes(camera);
+        return true;
+    }
+
+    uint8_t nonce[kNonceSize] = {};
+    if (!BCRYPT_SUCCESS(BCryptGenRandom(nullptr, nonce, sizeof(nonce), BCRYPT_USE_SYSTEM_PREFERRED_RNG)))
+        return false;
+
+    const std::string created = FormatUtcNow();
+    const std::string digest = ComputeOnvifPasswordDigest(
+        std::string_view(reinterpret_cast<const char*>(nonce), sizeof(nonce)), created, camera.config.password);
+    camera.securityHeader = BuildOnvifSecurityHeader(camera.config.username,
+        EncodeBase64(nonce, sizeof(nonce)), created, digest);
+    BuildEnvelopes(camera);
+    return true;
+}
+
+void OnvifCameraDriver::BuildEnvelopes(Camera& camera)
+{
+    if (camera.profileToken.empty())
+        return;
+    camera.move.Build(camera.securityHeader, camera.profileToken);
+    camera.stop = BuildOnvifStopEnvelope(camera.securityHeader, camera.profileToken);
+}
+
+Task<bool> OnvifCameraDriver::Prepare(Camera* camera, DWORD timeoutMs,
+    std::shared_ptr<CancellationSource> cancellation, CameraCommandResult* result)
+{
+    if (std::chrono::steady_clock::now() >= camera->securityExpiresAt && !RefreshSecurity(*camera))
+    {
+        result->hr = E_FAIL;
+        result->errorText = L"ONVIF digest failed";
+        co_return false;
+    }
+    if (!camera->profileToken.empty())
+        co_return true;
+
+    const HttpResult sent = co_await Post(camera, camera->config.mediaPath, kGetProfilesHeaders,
+        BuildOnvifGetProfilesEnvelope(camera->securityHeader), timeoutMs, cancellation);
+    std::string token;
+    if (FAILED(sent.hr) || !IsHttpSuccess(sent.response.status) || !TryParseOnvifProfileToken(sent.body, &token))
+    {
+        CopyFailure(sent, L"ONVIF GetProfiles failed", result);
+        camera->securityExpiresAt = {};
+        co_return false;
+    }
+
+    // Another move may have loaded it meanwhile; the answer is the same.
+    if (camera->profileToken.empty())
+    {
+        AppendLogLine("ONVIF profile: " + token);
+        camera->profileToken = token;
+        BuildEnvelopes(*camera);
+    }
+    co_return true;
+}
+
+Task<HttpResult> OnvifCameraDriver::Post(Camera* camera, std::wstring path, const wchar_t* headers,
+    std::string envelope, DWORD timeoutMs, std::shared_ptr<CancellationSource> cancellation)
+{
+    HttpRequest request;
+    request.method = L"POST";
+    request.path = std::move(path);
+    request.payload = std::move(envelope);
+    request.headers = headers;
+    request.timeouts = UniformHttpTimeouts(timeoutMs != 0 ? timeoutMs : kDefaultTimeoutMs);
+    request.cancellation = std::move(cancellation);
+    request.secure = camera->config.secure;
+    co_return co_await SendHttpRequestAsync(reactor_, camera->connection, std::move(request));
+}
+
+Task<CameraCommandResult> OnvifCameraDriver::SendMove(std::string cameraId, JoystickState state, DWORD timeoutMs,
+    std::shared_ptr<CancellationSource> cancellation)
+{
+    CameraCommandResult result;
+    const auto it = cameras_.find(cameraId);
+    if (it == cameras_.end())
+    {
+        result.hr = E_FAIL;
+        result.errorText = L"ONVIF camera not configured";
+        co_return result;
+    }
+
+    Camera* camera = it->second.get();
+    if (!co_await Prepare(camera, timeoutMs, cancellation, &result))
+        co_return result;
+
+    // The request takes its own copy of the patched envelope.
+    const bool stop = state.x == 0.0 && state.y == 0.0 && state.z == 0.0;
+    std::string envelope;
+    if (stop)
+    {
+        envelope = camera->stop;
+    }
+    else
+    {
+        ScopedTraceSpan span(TraceStage::Serialize);
+        envelope = camera->move.Serialize(state);
+    }
+    const HttpResult sent = co_await Post(camera, camera->config.ptzPath,
+        stop ? kStopHeaders : kContinuousMoveHeaders, std::move(envelope), timeoutMs, cancellation);
+
+    if (FAILED(sent.hr) || !IsHttpSuccess(sent.response.status))
+    {
+        CopyFailure(sent, stop ? L"ONVIF Stop failed" : L"ONVIF ContinuousMove failed", &result);
+        // Most often a rejected digest; the next command signs afresh.
+        if (!sent.cancelled)
+            camera->securityExpiresAt = {};
+        co_return result;
+    }
+    result.acknowledged = true;
+    result.newConnection = sent.newConnection;
+    co_return result;
+}
@@ -0,0 +1,316 @@
+#include "OnvifSoap.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+constexpr double kStateMaxMagnitude = 750.0;
+// "+0.0000": sign, digit, point and four decimals.
+constexpr size_t kVelocityWidth = 7;
+constexpr char kVelocityPlaceholder[] = "+0.0000";
+
+constexpr char kEnvelopeStart[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\""
+    " xmlns:tptz=\"http://www.onvif.org/ver20/ptz/wsdl\""
+    " xmlns:trt=\"http://www.onvif.org/ver10/media/wsdl\""
+    " xmlns:tt=\"http://www.onvif.org/ver10/schema\">"
+    "<s:Header>";
+constexpr char kBodyStart[] = "</s:Header><s:Body>";
+constexpr char kEnvelopeEnd[] = "</s:Body></s:Envelope>";
+
+std::string EscapeXml(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (const char ch : value)
+    {
+        switch (ch)
+        {
+        case '&':
+            escaped += "&amp;";
+            break;
+        case '<':
+            escaped += "&lt;";
+            break;
+        case '>':
+            escaped += "&gt;";
+            break;
+        case '"':
+            escaped += "&quot;";
+            break;
+        default:
+            escaped += ch;
+            break;
+        }
+    }
+    return escaped;
+}
+
+std::string WrapEnvelope(const std::string& securityHeader, const std::string& body)
+{
+    return kEnvelopeStart + securityHeader + kBodyStart + body + kEnvelopeEnd;
+}
+
+void WriteVelocity(std::string& envelope, size_t offset, double value)
+{
+    // NaN would print as "+nan", shorter than the field.
+    if (std::isnan(value))
+        value = 0.0;
+    // Rounded first so that nothing prints as "-0.0000".
+    const double clamped = std::clamp(value / kStateMaxMagnitude, -1.0, 1.0);
+    const double rounded = std::round(clamped * 10000.0) / 10000.0 + 0.0;
+    char text[kVelocityWidth + 1] = {};
+    snprintf(text, sizeof(text), "%+.4f", rounded);
+    std::memcpy(&envelope[offset], text, kVelocityWidth);
+}
+
+// The text of the first element named |localName|, with any namespace
+// prefix, at or after |pos|; |pos| is left past its end tag.
+bool TryFindElementText(const std::string& document, std::string_view localName, size_t* pos, std::string* text)
+{
+    while ((*pos = document.find(localName, *pos)) != std::string::npos)
+    {
+        const size_t nameStart = *pos;
+        *pos += localName.size();
+        if (nameStart == 0 || (document[nameStart - 1] != '<' && document[nameStart - 1] != ':'))
+            continue;
+        if (*pos >= document.size() || (document[*pos] != '>' && document[*pos] != ' '))
+            continue;
+
+        // Back to the '<' to tell a start tag from an end tag.
+        const size_t tagStart = document.rfind('<', nameStart);
+        if (tagStart == std::string::npos || document[tagStart + 1] == '/')
+            continue;
+        const size_t textStart = document.find('>', *pos);
+        if (textStart == std::string::npos || document[textStart - 1] == '/')
+            continue;
+        const size_t textEnd = document.find('<', textStart + 1);
+        if (textEnd == std::string::npos)
+            return false;
+        *text = document.substr(textStart + 1, textEnd - textStart - 1);
+        *pos = textEnd;
+        return true;
+    }
+    return false;
+}
+
+std::string TrimXmlSpace(const std::string& text)
+{
+    const size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos)
+        return {};
+    return text.substr(start, text.find_last_not_of(" \t\r\n") - start + 1);
+}
+}
+
+void OnvifMoveTemplate::Build(const std::string& securityHeader, const std::string& profileToken)
+{
+    envelope_ = WrapEnvelope(securityHeader,
+        "<tptz:ContinuousMove><tptz:ProfileToken>" + EscapeXml(profileToken) + "</tptz:ProfileToken>"
+        "<tptz:Velocity><tt:PanTilt x=\"" + kVelocityPlaceholder + "\" y=\"" + kVelocityPlaceholder + "\"/>"
+        "<tt:Zoom x=\"" + kVelocityPlaceholder + "\"/></tptz:Velocity></tptz:ContinuousMove>");
+
+    const size_t velocity = envelope_.find("<tptz:Velocity>");
+    panOffset_ = envelope_.find(kVelocityPlaceholder, velocity);
+    tiltOffset_ = envelope_.find(kVelocityPlaceholder, panOffset_ + kVelocityWidth);
+    zoomOffset_ = envelope_.find(kVelocityPlaceholder, tiltOffset_ + kVelocityWidth);
+}
+
+const std::string& OnvifMoveTemplate::Serialize(const JoystickState& state)
+{
+    WriteVelocity(envelope_, panOffset_, state.x);
+    WriteVelocity(envelope_, tiltOffset_, -state.y);
+    WriteVelocity(envelope_, zoomOffset_, state.z);
+    return envelope_;
+}
+
+std::string BuildOnvifStopEnvelope(const std::string& securityHeader, const std::string& profileToken)
+{
+    return WrapEnvelope(securityHeader,
+        "<tptz:Stop><tptz:ProfileToken>" + EscapeXml(profileToken) + "</tptz:ProfileToken>"
+        "<tptz:PanTilt>true</tptz:PanTilt><tptz:Zoom>true</tptz:Zoom></tptz:Stop>");
+}
+
+std::string BuildOnvifGetProfilesEnvelope(const std::string& securityHeader)
+{
+    return WrapEnvelope(securityHeader, "<trt:GetProfiles/>");
+}
+
+std::string BuildOnvifSecurityHeader(const std::string& username,
+    const std::string& nonce,
+    const std::string& created,
+    const std::string& digest)
+{
+    return "<wsse:Security s:mustUnderstand=\"1\""
+        " xmlns:wsse=\"http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-secext-1.0.xsd\""
+        " xmlns:wsu=\"http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-utility-1.0.xsd\">"
+        "<wsse:UsernameToken><wsse:Username>" + EscapeXml(username) + "</wsse:Username>"
+        "<wsse:Password Type=\"http://docs.oasis-open.org/wss/2004/01/"
+        "oasis-200401-wss-username-token-profile-1.0#PasswordDigest\">" + digest + "</wsse:Password>"
+        "<wsse:Nonce EncodingType=\"http://docs.oasis-open.org/wss/2004/01/"
+        "oasis-200401-wss-soap-message-security-1.0#Base64Binary\">" + nonce + "</wsse:Nonce>"
+        "<wsu:Created>" + created + "</wsu:Created></wsse:UsernameToken></wsse:Security>";
+}
+
+bool TryParseOnvifProfileToken(const std::string& response, std::string* token)
+{
+    // Namespace prefixes differ between vendors; match the local name.
+    size_t pos = 0;
+    while ((pos = response.find("Profiles", pos)) != std::string::npos)
+    {
+        const bool isElement = pos > 0 && (response[pos - 1] == ':' || response[pos - 1] == '<');
+        const size_t tagEnd = response.find('>', pos);
+        pos += 8;
+        if (!isElement || tagEnd == std::string::npos)
+            continue;
+
+        const size_t attribute = response.find("token=\"", pos);
+        if (attribute == std::string::npos || attribute > tagEnd)
+            continue;
+        const size_t valueStart = attribute + 7;
+        const size_t valueEnd = response.find('"', valueStart);
+        if (valueEnd == std::string::npos || valueEnd == valueStart)
+            return false;
+        *token = response.substr(valueStart, valueEnd - valueStart);
+        return true;
+    }
+    return false;
+}
+
+std::string EncodeBase64(const uint8_t* data, size_t size)
+{
+    static constexpr char kAlphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string encoded;
+    encoded.reserve(((size + 2) / 3) * 4);
+    for (size_t i = 0; i < size; i += 3)
+    {
+        const uint32_t chunk = (static_cast<uint32_t>(data[i]) << 16) |
+            (i + 1 < size ? static_cast<uint32_t>(data[i + 1]) << 8 : 0) |
+            (i + 2 < size ? static_cast<uint32_t>(data[i + 2]) : 0);
+        encoded += kAlphabet[(chunk >> 18) & 0x3F];
+        encoded += kAlphabet[(chunk >> 12) & 0x3F];
+        encoded += i + 1 < size ? kAlphabet[(chunk >> 6) & 0x3F] : '=';
+        encoded += i + 2 < size ? kAlphabet[chunk & 0x3F] : '=';
+    }
+    return encoded;
+}
+
+std::string ComputeOnvifPasswordDigest(std::string_view nonce, std::string_view created, std::string_view password)
+{
+    std::string input;
+    input.reserve(nonce.size() + created.size() + password.size());
+    input.append(nonce).append(created).append(password);
+    const std::array<uint8_t, 20> digest = ComputeSha1(input);
+    return EncodeBase64(digest.data(), digest.size());
+}
+
+bool TryParseOnvifFault(const std::string& response, OnvifFault* fault)
+{
+    size_t pos = 0;
+    std::string text;
+    if (!TryFindElementText(response, "Fault", &pos, &text))
+        return false;
+
+    // Code, then nested Subcodes, each with a Value; the last is the most
+    // specific. The Reason follows the Code.
+    OnvifFault parsed;
+    const size_t reasonStart = response.find("Reason", pos);
+    size_t valuePos = pos;
+    while (TryFindElementText(response, "Value", &valuePos, &text) &&
+        (reasonStart == std::string::npos || valuePos < reasonStart))
+    {
+        parsed.code = TrimXmlSpace(text);
+    }
+    size_t textPos = reasonStart == std::string::npos ? pos : reasonStart;
+    if (TryFindElementText(response, "Text", &textPos, &text))
+        parsed.reason = TrimXmlSpace(text);
+
+    if (fault)
+        *fault = std::move(parsed);
+    return true;
+}
+
+// FIPS 180-4. Only the WS-Security digest and the WebSocket handshake need
+// SHA-1, so it is done here rather than through a platform crypto API.
+std::array<uint8_t, 20> ComputeSha1(std::string_view data)
+{
+    uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    const uint64_t bitLength = static_cast<uint64_t>(data.size()) * 8;
+
+    // The message, a 0x80 byte, zeros to 56 mod 64, then the bit length.
+    std::string padded(data);
+    padded += static_cast<char>(0x80);
+    padded.append((55 - data.size() % 64 + 64) % 64, '\0');
+    for (int shift = 56; shift >= 0; shift -= 8)
+        padded += static_cast<char>((bitLength >> shift) & 0xFF);
+
+    for (size_t block = 0; block < padded.size(); block += 64)
+    {
+        uint32_t w[80] = {};
+        for (size_t i = 0; i < 16; ++i)
+        {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(padded.data() + block + i * 4);
+            w[i] = (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+                (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+        }
+        for (size_t i = 16; i < 80; ++i)
+            w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        uint32_t e = state[4];
+        for (size_t i = 0; i < 80; ++i)
+        {
+            uint32_t f = 0;
+            uint32_t k = 0;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            const uint32_t next = std::rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = std::rotl(b, 30);
+            b = a;
+            a = next;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+
+    std::array<uint8_t, 20> digest = {};
+    for (size_t i = 0; i < 5; ++i)
+    {
+        digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+    return digest;
+}
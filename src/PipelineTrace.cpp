@@ -0,0 +1,329 @@
+#include "PipelineTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace {
+// Per thread: 4096 spans, 128 KiB; over two minutes of a 30 Hz stick.
+constexpr size_t kRingSize = 4096;
+// Threads past this many record nothing.
+constexpr size_t kMaxThreads = 64;
+
+struct TraceRecord
+{
+    // Written by the owning thread, read by exports while it writes on.
+    std::atomic<uint64_t> start{ 0 };
+    std::atomic<uint64_t> end{ 0 };
+    std::atomic<uint64_t> id{ 0 };
+    std::atomic<uint32_t> stage{ 0 };
+    // The span's index plus one, truncated; 0 while the others are written,
+    // so an export can tell a torn copy.
+    std::atomic<uint32_t> sequence{ 0 };
+};
+static_assert(sizeof(TraceRecord) == 32);
+
+struct ThreadTrace
+{
+    uint32_t tid = 0;
+    // Guarded by the registry's mutex.
+    std::string name;
+    // Spans ever recorded; the newest kRingSize are kept.
+    std::atomic<uint64_t> written{ 0 };
+    TraceRecord records[kRingSize];
+};
+
+// Rings outlive their threads, so spans of a thread that has exited can
+// still be exported.
+struct TraceRegistry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadTrace>> threads;
+};
+
+TraceRegistry& GetRegistry()
+{
+    static TraceRegistry registry;
+    return registry;
+}
+
+std::atomic<uint64_t> g_nextTraceId{ 0 };
+
+// nullptr once kMaxThreads rings exist.
+ThreadTrace* CurrentThreadTrace()
+{
+    thread_local ThreadTrace* trace = nullptr;
+    thread_local bool attempted = false;
+    if (attempted)
+        return trace;
+
+    attempted = true;
+    TraceRegistry& registry = GetRegistry();
+    std::scoped_lock lock(registry.mutex);
+    if (registry.threads.size() >= kMaxThreads)
+        return nullptr;
+    registry.threads.push_back(std::make_unique<ThreadTrace>());
+    trace = registry.threads.back().get();
+    trace->tid = static_cast<uint32_t>(registry.threads.size());
+    return trace;
+}
+
+struct ExportedSpan
+{
+    uint32_t sequence = 0;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint64_t id = 0;
+    TraceStage stage = TraceStage::Poll;
+};
+
+const char* StageName(TraceStage stage)
+{
+    switch (stage)
+    {
+    case TraceStage::Poll:
+        return "Poll";
+    case TraceStage::Filter:
+        return "Filter";
+    case TraceStage::Submit:
+        return "Submit";
+    case TraceStage::WorkerWakeup:
+        return "Worker wakeup";
+    case TraceStage::Serialize:
+        return "Serialize";
+    case TraceStage::Request:
+        return "Request";
+    case TraceStage::Connect:
+        return "Connect";
+    case TraceStage::Send:
+        return "Send";
+    case TraceStage::FirstByte:
+        return "First byte";
+    case TraceStage::Read:
+        return "Read";
+    case TraceStage::Parse:
+        return "Parse";
+    case TraceStage::UiUpdate:
+        return "UI update";
+    }
+    return "Span";
+}
+
+// Emitted as async events, each id on a track of its own, since they
+// overlap the thread's other spans.
+bool IsKeyedStage(TraceStage stage)
+{
+    switch (stage)
+    {
+    case TraceStage::WorkerWakeup:
+    case TraceStage::Request:
+    case TraceStage::Connect:
+    case TraceStage::Send:
+    case TraceStage::FirstByte:
+    case TraceStage::Read:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// The ring's retained spans. The thread overwrites them oldest first, as
+// the copy reads them, so those it reached during the copy form a prefix:
+// each slot's stamp is checked again afterwards, and the prefix whose stamp
+// changed is left out.
+std::vector<ExportedSpan> CopySpans(const ThreadTrace& trace)
+{
+    const uint64_t written = trace.written.load(std::memory_order_acquire);
+    const uint64_t first = written > kRingSize ? written - kRingSize : 0;
+    std::vector<ExportedSpan> spans;
+    spans.reserve(static_cast<size_t>(written - first));
+    for (uint64_t i = first; i < written; ++i)
+    {
+        const TraceRecord& record = trace.records[i % kRingSize];
+        ExportedSpan span;
+        span.sequence = record.sequence.load(std::memory_order_acquire);
+        span.start = record.start.load(std::memory_order_relaxed);
+        span.end = record.end.load(std::memory_order_relaxed);
+        span.id = record.id.load(std::memory_order_relaxed);
+        span.stage = static_cast<TraceStage>(record.stage.load(std::memory_order_relaxed));
+        spans.push_back(span);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    size_t stale = 0;
+    for (; stale < spans.size(); ++stale)
+    {
+        const uint64_t index = first + stale;
+        const uint32_t expected = static_cast<uint32_t>(index + 1);
+        if (spans[stale].sequence == expected &&
+            trace.records[index % kRingSize].sequence.load(std::memory_order_relaxed) == expected)
+        {
+            break;
+        }
+    }
+    spans.erase(spans.begin(), spans.begin() + static_cast<ptrdiff_t>(stale));
+    return spans;
+}
+
+void AppendJsonString(std::string_view text, std::string* out)
+{
+    out->push_back('"');
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out->push_back('\\');
+            out->push_back(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8] = {};
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            *out += escaped;
+        }
+        else
+        {
+            out->push_back(c);
+        }
+    }
+    out->push_back('"');
+}
+
+void AppendMicroseconds(uint64_t ns, std::string* out)
+{
+    char text[32] = {};
+    snprintf(text, sizeof(text), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000),
+        static_cast<unsigned long long>(ns % 1000));
+    *out += text;
+}
+
+void AppendEvent(const char* phase, const ExportedSpan& span, uint32_t tid, uint64_t ts, std::string* out)
+{
+    *out += ",\n{\"name\":\"";
+    *out += StageName(span.stage);
+    *out += "\",\"cat\":\"pipeline\",\"ph\":\"";
+    *out += phase;
+    *out += "\",\"pid\":1,\"tid\":";
+    *out += std::to_string(tid);
+    *out += ",\"ts\":";
+    AppendMicroseconds(ts, out);
+    if (phase[0] == 'X')
+    {
+        *out += ",\"dur\":";
+        AppendMicroseconds(span.end - span.start, out);
+    }
+    if (span.id != 0)
+    {
+        if (phase[0] != 'X')
+        {
+            *out += ",\"id\":";
+            *out += std::to_string(span.id);
+        }
+        *out += ",\"args\":{\"id\":";
+        *out += std::to_string(span.id);
+        *out += "}";
+    }
+    *out += "}";
+}
+}
+
+uint64_t TraceNow()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t NextTraceId()
+{
+    return g_nextTraceId.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void RecordTraceSpan(TraceStage stage, uint64_t startNs, uint64_t endNs, uint64_t id)
+{
+    ThreadTrace* trace = CurrentThreadTrace();
+    if (!trace)
+        return;
+
+    const uint64_t index = trace->written.load(std::memory_order_relaxed);
+    TraceRecord& record = trace->records[index % kRingSize];
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.start.store(startNs, std::memory_order_relaxed);
+    record.end.store(std::max(startNs, endNs), std::memory_order_relaxed);
+    record.id.store(id, std::memory_order_relaxed);
+    record.stage.store(static_cast<uint32_t>(stage), std::memory_order_relaxed);
+    record.sequence.store(static_cast<uint32_t>(index + 1), std::memory_order_release);
+    trace->written.store(index + 1, std::memory_order_release);
+}
+
+void SetTraceThreadName(const char* name)
+{
+    ThreadTrace* trace = CurrentThreadTrace();
+    if (!trace)
+        return;
+
+    std::scoped_lock lock(GetRegistry().mutex);
+    trace->name = name;
+}
+
+std::string ExportChromeTrace()
+{
+    struct ThreadSpans
+    {
+        uint32_t tid = 0;
+        std::string name;
+        std::vector<ExportedSpan> spans;
+    };
+
+    std::vector<ThreadSpans> threads;
+    {
+        TraceRegistry& registry = GetRegistry();
+        std::scoped_lock lock(registry.mutex);
+        for (const auto& trace : registry.threads)
+            threads.push_back({ trace->tid, trace->name, CopySpans(*trace) });
+    }
+
+    // Timestamps count from the oldest span kept.
+    uint64_t origin = UINT64_MAX;
+    for (const auto& thread : threads)
+    {
+        for (const auto& span : thread.spans)
+            origin = std::min(origin, span.start);
+    }
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"JoystickTesting\"}}";
+    for (const auto& thread : threads)
+    {
+        if (!thread.name.empty())
+        {
+            out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+            out += std::to_string(thread.tid);
+            out += ",\"args\":{\"name\":";
+            AppendJsonString(thread.name, &out);
+            out += "}}";
+        }
+
+        for (const auto& span : thread.spans)
+        {
+            if (IsKeyedStage(span.stage))
+            {
+                AppendEvent("b", span, thread.tid, span.start - origin, &out);
+                AppendEvent("e", span, thread.tid, span.end - origin, &out);
+            }
+            else
+            {
+                AppendEvent("X", span, thread.tid, span.start - origin, &out);
+            }
+        }
+    }
+    out += "\n]}\n";
+    return out;
+}
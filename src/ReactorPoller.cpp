@@ -0,0 +1,33 @@
+#include "NetworkReactor.h"
+
+#include <Windows.h>
+
+ReactorPoller::ReactorPoller()
+    : port_(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1))
+{
+}
+
+ReactorPoller::~ReactorPoller()
+{
+    if (port_)
+        CloseHandle(static_cast<HANDLE>(port_));
+}
+
+bool ReactorPoller::IsValid() const
+{
+    return port_ != nullptr;
+}
+
+void ReactorPoller::Wait(int timeoutMs)
+{
+    // Every wake is a null completion packet; take them all in one call.
+    OVERLAPPED_ENTRY entries[16] = {};
+    ULONG removed = 0;
+    GetQueuedCompletionStatusEx(static_cast<HANDLE>(port_), entries, ARRAYSIZE(entries), &removed,
+        timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs), FALSE);
+}
+
+void ReactorPoller::Wake()
+{
+    PostQueuedCompletionStatus(static_cast<HANDLE>(port_), 0, 0, nullptr);
+}
@@ -0,0 +1,50 @@
+#include "NetworkReactor.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+ReactorPoller::ReactorPoller()
+    : epollFd_(epoll_create1(EPOLL_CLOEXEC)),
+      wakeFd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+    if (epollFd_ < 0 || wakeFd_ < 0)
+        return;
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+}
+
+ReactorPoller::~ReactorPoller()
+{
+    if (wakeFd_ >= 0)
+        close(wakeFd_);
+    if (epollFd_ >= 0)
+        close(epollFd_);
+}
+
+bool ReactorPoller::IsValid() const
+{
+    return epollFd_ >= 0 && wakeFd_ >= 0;
+}
+
+void ReactorPoller::Wait(int timeoutMs)
+{
+    epoll_event event = {};
+    if (epoll_wait(epollFd_, &event, 1, timeoutMs) > 0)
+    {
+        // Reading resets the counter, however many wakes were posted.
+        uint64_t count = 0;
+        [[maybe_unused]] const ssize_t bytes = read(wakeFd_, &count, sizeof(count));
+    }
+}
+
+void ReactorPoller::Wake()
+{
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t bytes = write(wakeFd_, &one, sizeof(one));
+}
@@ -0,0 +1,127 @@
+#include "StartupTrace.h"
+
+#include "LogUtils.h"
+
+#include <cwchar>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+struct StartupTraceState
+{
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::vector<std::wstring> recordedPhases;
+    double timeToFirstMoveMs = -1.0;
+};
+
+StartupTraceState& GetStartupTraceState()
+{
+    static StartupTraceState state;
+    return state;
+}
+
+double ElapsedMs(std::chrono::steady_clock::time_point from,
+    std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+std::wstring FormatMs(double value)
+{
+    wchar_t buffer[32] = {};
+    swprintf(buffer, sizeof(buffer) / sizeof(buffer[0]), L"%.1f ms", value);
+    return buffer;
+}
+
+bool TryClaimPhase(StartupTraceState& state, const wchar_t* phase)
+{
+    for (const auto& recorded : state.recordedPhases)
+    {
+        if (recorded == phase)
+            return false;
+    }
+
+    state.recordedPhases.emplace_back(phase);
+    return true;
+}
+}
+
+void BeginStartupTrace()
+{
+    StartupTraceState& state = GetStartupTraceState();
+    std::scoped_lock lock(state.mutex);
+    state.origin = std::chrono::steady_clock::now();
+    state.recordedPhases.clear();
+    state.timeToFirstMoveMs = -1.0;
+}
+
+void RecordStartupPhase(const wchar_t* phase,
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end)
+{
+    if (!phase)
+        return;
+
+    StartupTraceState& state = GetStartupTraceState();
+    std::wstring line;
+    {
+        std::scoped_lock lock(state.mutex);
+        if (state.timeToFirstMoveMs >= 0.0 || !TryClaimPhase(state, phase))
+            return;
+
+        line = L"Startup: ";
+        line += phase;
+        line += L" ";
+        line += FormatMs(ElapsedMs(start, end));
+        line += L" (+";
+        line += FormatMs(ElapsedMs(state.origin, start));
+        line += L" to +";
+        line += FormatMs(ElapsedMs(state.origin, end));
+        line += L")";
+    }
+    AppendLogLine(line);
+}
+
+void MarkStartupMilestone(const wchar_t* milestone)
+{
+    if (!milestone)
+        return;
+
+    StartupTraceState& state = GetStartupTraceState();
+    std::wstring line;
+    {
+        std::scoped_lock lock(state.mutex);
+        if (state.timeToFirstMoveMs >= 0.0 || !TryClaimPhase(state, milestone))
+            return;
+
+        line = L"Startup: ";
+        line += milestone;
+        line += L" at +";
+        line += FormatMs(ElapsedMs(state.origin, std::chrono::steady_clock::now()));
+    }
+    AppendLogLine(line);
+}
+
+void MarkFirstMoveSent()
+{
+    StartupTraceState& state = GetStartupTraceState();
+    double elapsed = 0.0;
+    {
+        std::scoped_lock lock(state.mutex);
+        if (state.timeToFirstMoveMs >= 0.0)
+            return;
+
+        elapsed = ElapsedMs(state.origin, std::chrono::steady_clock::now());
+        state.timeToFirstMoveMs = elapsed;
+    }
+    AppendLogLine(L"Startup: time to first move " + FormatMs(elapsed));
+}
+
+double GetTimeToFirstMoveMs()
+{
+    StartupTraceState& state = GetStartupTraceState();
+    std::scoped_lock lock(state.mutex);
+    return state.timeToFirstMoveMs;
+}
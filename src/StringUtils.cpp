@@ -1,41 +1,318 @@
 #include "StringUtils.h"
 
-#include <Windows.h>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
 
-std::wstring Utf8ToWide(const std::string& value)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STRINGUTILS_HAS_SSE2 1
+#endif
+
+namespace {
+constexpr char32_t kReplacementChar = 0xFFFD;
+constexpr bool kWideIsUtf16 = sizeof(wchar_t) == 2;
+
+// Copies the leading ASCII run of |in| into |out| and returns its length.
+// Most traffic (IDs, paths, JSON keys) is pure ASCII, so this covers whole
+// strings in 16-byte steps.
+size_t WidenAsciiRun(const char* in, size_t size, wchar_t* out)
+{
+    size_t i = 0;
+#if defined(STRINGUTILS_HAS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const int highBits = _mm_movemask_epi8(bytes);
+        if (highBits != 0)
+        {
+            const size_t run = static_cast<size_t>(std::countr_zero(static_cast<unsigned>(highBits)));
+            for (size_t j = 0; j < run; ++j)
+                out[i + j] = static_cast<wchar_t>(in[i + j]);
+            return i + run;
+        }
+
+        const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        if constexpr (kWideIsUtf16)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), high);
+        }
+        else
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi16(low, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_unpackhi_epi16(low, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpacklo_epi16(high, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 12), _mm_unpackhi_epi16(high, zero));
+        }
+    }
+#else
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, in + i, sizeof(word));
+        if (word & 0x8080808080808080ull)
+            break;
+        for (size_t j = 0; j < 8; ++j)
+            out[i + j] = static_cast<wchar_t>(in[i + j]);
+    }
+#endif
+
+    while (i < size && static_cast<unsigned char>(in[i]) < 0x80)
+    {
+        out[i] = static_cast<wchar_t>(in[i]);
+        ++i;
+    }
+    return i;
+}
+
+size_t NarrowAsciiRun(const wchar_t* in, size_t size, char* out)
+{
+    size_t i = 0;
+#if defined(STRINGUTILS_HAS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    if constexpr (kWideIsUtf16)
+    {
+        const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+        for (; i + 8 <= size; i += 8)
+        {
+            const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            const __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(units, nonAscii), zero);
+            if (_mm_movemask_epi8(ascii) != 0xFFFF)
+                break;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(units, units));
+        }
+    }
+    else
+    {
+        const __m128i nonAscii = _mm_set1_epi32(static_cast<int>(0xFFFFFF80u));
+        for (; i + 8 <= size; i += 8)
+        {
+            const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 4));
+            const __m128i bits = _mm_or_si128(_mm_and_si128(first, nonAscii), _mm_and_si128(second, nonAscii));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(bits, zero)) != 0xFFFF)
+                break;
+            const __m128i units = _mm_packs_epi32(first, second);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(units, units));
+        }
+    }
+#endif
+
+    while (i < size && static_cast<uint32_t>(in[i]) < 0x80)
+    {
+        out[i] = static_cast<char>(in[i]);
+        ++i;
+    }
+    return i;
+}
+
+bool IsContinuation(unsigned char byte)
+{
+    return (byte & 0xC0) == 0x80;
+}
+
+// Decodes one multi-byte sequence starting at |in|. On malformed input the
+// lead byte is consumed and U+FFFD returned.
+char32_t DecodeUtf8Sequence(const unsigned char* in, size_t size, size_t* outLength)
+{
+    const unsigned char lead = in[0];
+    size_t length = 0;
+    char32_t codePoint = 0;
+    char32_t minimum = 0;
+    if (lead >= 0xC2 && lead <= 0xDF)
+    {
+        length = 2;
+        codePoint = lead & 0x1F;
+        minimum = 0x80;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        length = 3;
+        codePoint = lead & 0x0F;
+        minimum = 0x800;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        length = 4;
+        codePoint = lead & 0x07;
+        minimum = 0x10000;
+    }
+
+    *outLength = 1;
+    if (length == 0 || length > size)
+        return kReplacementChar;
+
+    for (size_t i = 1; i < length; ++i)
+    {
+        if (!IsContinuation(in[i]))
+            return kReplacementChar;
+        codePoint = (codePoint << 6) | (in[i] & 0x3F);
+    }
+
+    if (codePoint < minimum || codePoint > 0x10FFFF ||
+        (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+    {
+        return kReplacementChar;
+    }
+
+    *outLength = length;
+    return codePoint;
+}
+
+wchar_t* AppendCodePoint(char32_t codePoint, wchar_t* out)
+{
+    if (kWideIsUtf16 && codePoint >= 0x10000)
+    {
+        codePoint -= 0x10000;
+        *out++ = static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+        *out++ = static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        return out;
+    }
+
+    *out++ = static_cast<wchar_t>(codePoint);
+    return out;
+}
+
+char* AppendUtf8(char32_t codePoint, char* out)
+{
+    if (codePoint < 0x80)
+    {
+        *out++ = static_cast<char>(codePoint);
+        return out;
+    }
+    if (codePoint < 0x800)
+    {
+        *out++ = static_cast<char>(0xC0 | (codePoint >> 6));
+    }
+    else if (codePoint < 0x10000)
+    {
+        *out++ = static_cast<char>(0xE0 | (codePoint >> 12));
+        *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    }
+    else
+    {
+        *out++ = static_cast<char>(0xF0 | (codePoint >> 18));
+        *out++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    }
+    *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+    return out;
+}
+
+// Reads one code point starting at a non-ASCII unit; unpaired surrogates
+// become U+FFFD.
+char32_t DecodeWideUnit(const wchar_t* in, size_t size, size_t* outLength)
+{
+    const char32_t unit = static_cast<char32_t>(in[0]);
+    *outLength = 1;
+    if (unit > 0x10FFFF)
+        return kReplacementChar;
+    if (unit < 0xD800 || unit > 0xDFFF)
+        return unit;
+    if (!kWideIsUtf16 || unit > 0xDBFF || size < 2)
+        return kReplacementChar;
+
+    const char32_t low = static_cast<char32_t>(in[1]);
+    if (low < 0xDC00 || low > 0xDFFF)
+        return kReplacementChar;
+
+    *outLength = 2;
+    return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+}
+}
+
+std::wstring Utf8ToWide(std::string_view value)
 {
     if (value.empty())
         return L"";
 
-    const int size = MultiByteToWideChar(CP_UTF8, 0, value.c_str(),
-        static_cast<int>(value.size()), nullptr, 0);
-    if (size <= 0)
-        return L"";
+    // Every byte yields at most one wchar_t, and a 4-byte sequence at most
+    // two, so the input length bounds the output.
+    std::wstring output(value.size(), L'\0');
+    const char* in = value.data();
+    const size_t size = value.size();
+    wchar_t* out = output.data();
+    size_t pos = 0;
+    while (pos < size)
+    {
+        const size_t run = WidenAsciiRun(in + pos, size - pos, out);
+        pos += run;
+        out += run;
+        if (pos >= size)
+            break;
 
-    std::wstring output;
-    output.resize(size);
-    MultiByteToWideChar(CP_UTF8, 0, value.c_str(),
-        static_cast<int>(value.size()), output.data(), size);
+        size_t length = 0;
+        const char32_t codePoint = DecodeUtf8Sequence(
+            reinterpret_cast<const unsigned char*>(in + pos), size - pos, &length);
+        out = AppendCodePoint(codePoint, out);
+        pos += length;
+    }
+
+    output.resize(static_cast<size_t>(out - output.data()));
     return output;
 }
 
-std::string WideToUtf8(const std::wstring& value)
+std::string WideToUtf8(std::wstring_view value)
 {
     if (value.empty())
         return {};
 
-    const int size = WideCharToMultiByte(CP_UTF8, 0, value.c_str(),
-        static_cast<int>(value.size()), nullptr, 0, nullptr, nullptr);
-    if (size <= 0)
-        return {};
+    // A UTF-16 unit needs at most three bytes (pairs need four for two
+    // units); a UTF-32 unit at most four.
+    std::string output(value.size() * (kWideIsUtf16 ? 3 : 4), '\0');
+    const wchar_t* in = value.data();
+    const size_t size = value.size();
+    char* out = output.data();
+    size_t pos = 0;
+    while (pos < size)
+    {
+        const size_t run = NarrowAsciiRun(in + pos, size - pos, out);
+        pos += run;
+        out += run;
+        if (pos >= size)
+            break;
 
-    std::string output;
-    output.resize(size);
-    WideCharToMultiByte(CP_UTF8, 0, value.c_str(),
-        static_cast<int>(value.size()), output.data(), size, nullptr, nullptr);
+        size_t length = 0;
+        const char32_t codePoint = DecodeWideUnit(in + pos, size - pos, &length);
+        out = AppendUtf8(codePoint, out);
+        pos += length;
+    }
+
+    output.resize(static_cast<size_t>(out - output.data()));
     return output;
 }
 
+size_t WideToUtf8Prefix(std::wstring_view value, char* out, size_t capacity)
+{
+    const wchar_t* in = value.data();
+    const size_t size = value.size();
+    size_t written = 0;
+    size_t pos = 0;
+    while (pos < size && written < capacity)
+    {
+        const size_t run = NarrowAsciiRun(in + pos, std::min(size - pos, capacity - written), out + written);
+        pos += run;
+        written += run;
+        if (pos >= size || written >= capacity)
+            break;
+
+        size_t length = 0;
+        const char32_t codePoint = DecodeWideUnit(in + pos, size - pos, &length);
+        char encoded[4];
+        const size_t bytes = static_cast<size_t>(AppendUtf8(codePoint, encoded) - encoded);
+        if (bytes > capacity - written)
+            break;
+        std::memcpy(out + written, encoded, bytes);
+        written += bytes;
+        pos += length;
+    }
+    return written;
+}
+
 std::wstring TrimWide(const std::wstring& value)
 {
     if (value.empty())
@@ -0,0 +1,228 @@
+#include "TaskPool.h"
+
+#include "LogUtils.h"
+#include "PipelineTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+
+namespace {
+constexpr size_t kMaxPoolThreads = 4;
+constexpr size_t kNoWorker = SIZE_MAX;
+
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+    size_t maxDepth = 0;
+    uint64_t executed = 0;
+    uint64_t stolen = 0;
+};
+
+struct TaskPoolState
+{
+    // Shared by submitters, exclusive while the pool starts or stops, so no
+    // task is queued after the workers have drained.
+    std::shared_mutex lifecycleMutex;
+    bool running = false;
+
+    std::mutex idleMutex;
+    std::condition_variable idleCv;
+    bool stopRequested = false;
+    std::atomic<size_t> pending = 0;
+    std::atomic<size_t> nextQueue = 0;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+};
+
+TaskPoolState& GetPoolState()
+{
+    static TaskPoolState state;
+    return state;
+}
+
+thread_local size_t t_workerIndex = kNoWorker;
+
+bool PopOwnTask(WorkQueue& queue, std::function<void()>* task)
+{
+    std::scoped_lock lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    *task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool StealTask(WorkQueue& victim, std::function<void()>* task)
+{
+    std::scoped_lock lock(victim.mutex);
+    if (victim.tasks.empty())
+        return false;
+    *task = std::move(victim.tasks.front());
+    victim.tasks.pop_front();
+    return true;
+}
+
+bool TakeTask(TaskPoolState& state, size_t index, std::function<void()>* task)
+{
+    WorkQueue& own = *state.queues[index];
+    if (PopOwnTask(own, task))
+        return true;
+
+    const size_t count = state.queues.size();
+    for (size_t offset = 1; offset < count; ++offset)
+    {
+        if (StealTask(*state.queues[(index + offset) % count], task))
+        {
+            std::scoped_lock lock(own.mutex);
+            ++own.stolen;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RunWorker(size_t index)
+{
+    TaskPoolState& state = GetPoolState();
+    t_workerIndex = index;
+    SetTraceThreadName(("Task pool " + std::to_string(index)).c_str());
+    WorkQueue& own = *state.queues[index];
+
+    for (;;)
+    {
+        std::function<void()> task;
+        if (TakeTask(state, index, &task))
+        {
+            --state.pending;
+            task();
+            std::scoped_lock lock(own.mutex);
+            ++own.executed;
+            continue;
+        }
+
+        std::unique_lock lock(state.idleMutex);
+        state.idleCv.wait(lock, [&]() { return state.stopRequested || state.pending > 0; });
+        if (state.stopRequested && state.pending == 0)
+            break;
+    }
+    t_workerIndex = kNoWorker;
+}
+
+void LogPoolStats(const std::vector<TaskPoolQueueStats>& stats)
+{
+    for (size_t i = 0; i < stats.size(); ++i)
+        AppendLogLine(DescribeTaskPoolQueue(i, stats[i]));
+}
+}
+
+void StartTaskPool(size_t threadCount)
+{
+    TaskPoolState& state = GetPoolState();
+    std::unique_lock lifecycleLock(state.lifecycleMutex);
+    if (state.running)
+        return;
+
+    if (threadCount == 0)
+    {
+        const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 2);
+        // Leave a core to the UI and input threads.
+        threadCount = std::min(hardwareThreads - 1, kMaxPoolThreads);
+    }
+
+    state.stopRequested = false;
+    state.pending = 0;
+    state.queues.clear();
+    for (size_t i = 0; i < threadCount; ++i)
+        state.queues.push_back(std::make_unique<WorkQueue>());
+    for (size_t i = 0; i < threadCount; ++i)
+        state.threads.emplace_back(RunWorker, i);
+    state.running = true;
+}
+
+void StopTaskPool()
+{
+    TaskPoolState& state = GetPoolState();
+    {
+        std::unique_lock lifecycleLock(state.lifecycleMutex);
+        if (!state.running)
+            return;
+        state.running = false;
+    }
+    {
+        std::scoped_lock lock(state.idleMutex);
+        state.stopRequested = true;
+    }
+    state.idleCv.notify_all();
+    for (auto& thread : state.threads)
+        thread.join();
+    state.threads.clear();
+
+    LogPoolStats(GetTaskPoolStats());
+    std::unique_lock lifecycleLock(state.lifecycleMutex);
+    state.queues.clear();
+}
+
+bool SubmitPoolTask(std::function<void()> task)
+{
+    TaskPoolState& state = GetPoolState();
+    std::shared_lock lifecycleLock(state.lifecycleMutex);
+    if (!state.running)
+        return false;
+
+    // Work spawned by a task stays with its worker; the rest is spread.
+    size_t index = t_workerIndex;
+    if (index == kNoWorker)
+        index = state.nextQueue.fetch_add(1, std::memory_order_relaxed) % state.queues.size();
+
+    // Counted before it is queued, so a worker never takes it uncounted.
+    {
+        std::scoped_lock lock(state.idleMutex);
+        ++state.pending;
+    }
+    WorkQueue& queue = *state.queues[index];
+    {
+        std::scoped_lock lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        queue.maxDepth = std::max(queue.maxDepth, queue.tasks.size());
+    }
+    state.idleCv.notify_one();
+    return true;
+}
+
+std::vector<TaskPoolQueueStats> GetTaskPoolStats()
+{
+    TaskPoolState& state = GetPoolState();
+    std::shared_lock lifecycleLock(state.lifecycleMutex);
+    std::vector<TaskPoolQueueStats> stats;
+    stats.reserve(state.queues.size());
+    for (const auto& queue : state.queues)
+    {
+        std::scoped_lock lock(queue->mutex);
+        TaskPoolQueueStats entry;
+        entry.depth = queue->tasks.size();
+        entry.maxDepth = queue->maxDepth;
+        entry.executed = queue->executed;
+        entry.stolen = queue->stolen;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+std::string DescribeTaskPoolQueue(size_t index, const TaskPoolQueueStats& stats)
+{
+    char line[160] = {};
+    snprintf(line, sizeof(line), "Task pool queue %zu: %llu run, %llu stolen, depth %zu, max depth %zu",
+        index, static_cast<unsigned long long>(stats.executed),
+        static_cast<unsigned long long>(stats.stolen), stats.depth, stats.maxDepth);
+    return line;
+}
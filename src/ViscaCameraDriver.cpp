@@ -0,0 +1,288 @@
+// Winsock has to come before the first Windows.h.
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include "ViscaCameraDriver.h"
+
+#include "AsyncHttp.h"
+#include "LogUtils.h"
+#include "StringUtils.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+// Cameras on the LAN ACK within a few milliseconds.
+constexpr DWORD kDefaultReplyTimeoutMs = 500;
+constexpr int kReceiveBufferSize = 64;
+
+uint64_t MakeEndpointKey(uint32_t address, uint16_t port)
+{
+    return (static_cast<uint64_t>(address) << 16) | port;
+}
+
+std::string DescribeViscaError(uint8_t errorCode)
+{
+    switch (errorCode)
+    {
+    case 0x02:
+        return "syntax error";
+    case 0x03:
+        return "command buffer full";
+    case 0x41:
+        return "command not executable";
+    default:
+        return "error " + std::to_string(errorCode);
+    }
+}
+}
+
+ViscaCameraDriver::ViscaCameraDriver(NetworkReactor& reactor)
+    : reactor_(reactor)
+{
+}
+
+ViscaCameraDriver::~ViscaCameraDriver()
+{
+    Close();
+}
+
+bool ViscaCameraDriver::Open()
+{
+    if (open_)
+        return true;
+
+    WSADATA data = {};
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        AppendLogLine("VISCA: Winsock unavailable");
+        return false;
+    }
+
+    const SOCKET udp = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (udp == INVALID_SOCKET)
+    {
+        AppendLogLine("VISCA: socket failed: " + std::to_string(WSAGetLastError()));
+        WSACleanup();
+        return false;
+    }
+
+    // Replies come back to whatever port the system picks.
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(udp, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) == SOCKET_ERROR)
+    {
+        AppendLogLine("VISCA: bind failed: " + std::to_string(WSAGetLastError()));
+        closesocket(udp);
+        WSACleanup();
+        return false;
+    }
+
+    socket_ = static_cast<uintptr_t>(udp);
+    open_ = true;
+    receiveThread_ = std::thread([this]() { ReceiveReplies(); });
+    return true;
+}
+
+void ViscaCameraDriver::Close()
+{
+    if (!open_)
+        return;
+
+    // Unblocks the receive thread.
+    closesocket(static_cast<SOCKET>(socket_));
+    if (receiveThread_.joinable())
+        receiveThread_.join();
+    WSACleanup();
+    open_ = false;
+    socket_ = 0;
+    cameras_.clear();
+    endpoints_.clear();
+}
+
+bool ViscaCameraDriver::AddCamera(const std::string& cameraId, const std::wstring& address, uint16_t port)
+{
+    if (!Open())
+        return false;
+
+    in_addr parsed = {};
+    if (InetPtonW(AF_INET, address.c_str(), &parsed) != 1)
+    {
+        AppendLogLine("VISCA: not an IPv4 address for " + cameraId + ": " + WideToUtf8(address));
+        return false;
+    }
+
+    const uint32_t hostAddress = ntohl(parsed.s_addr);
+    const uint64_t key = MakeEndpointKey(hostAddress, port);
+    Endpoint& endpoint = endpoints_[key];
+    endpoint.address = hostAddress;
+    endpoint.port = port;
+    cameras_[cameraId] = key;
+    AppendLogLine("VISCA: " + cameraId + " at " + WideToUtf8(address) + ":" + std::to_string(port));
+    return true;
+}
+
+bool ViscaCameraDriver::SendPacket(const Endpoint& endpoint, const std::vector<uint8_t>& packet,
+    CameraCommandResult* result)
+{
+    sockaddr_in target = {};
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = htonl(endpoint.address);
+    target.sin_port = htons(endpoint.port);
+    // Non-blocking in practice: a datagram this small always fits the
+    // send buffer.
+    if (sendto(static_cast<SOCKET>(socket_), reinterpret_cast<const char*>(packet.data()),
+        static_cast<int>(packet.size()), 0, reinterpret_cast<const sockaddr*>(&target),
+        sizeof(target)) != SOCKET_ERROR)
+    {
+        return true;
+    }
+
+    result->hr = E_FAIL;
+    result->error = static_cast<DWORD>(WSAGetLastError());
+    result->errorText = FormatWin32Error(result->error);
+    return false;
+}
+
+Task<CameraCommandResult> ViscaCameraDriver::SendMove(std::string cameraId, JoystickState state, DWORD timeoutMs,
+    std::shared_ptr<CancellationSource> cancellation)
+{
+    CameraCommandResult result;
+    const auto camera = cameras_.find(cameraId);
+    if (!open_ || camera == cameras_.end())
+    {
+        result.hr = E_FAIL;
+        result.errorText = L"VISCA camera not configured";
+        co_return result;
+    }
+
+    const uint64_t key = camera->second;
+    Endpoint& endpoint = endpoints_[key];
+    ViscaSession& session = endpoint.session;
+    if (session.NeedsReset())
+    {
+        // The reset's reply is not awaited; a camera that missed it answers
+        // the next command with a sequence error and is reset again.
+        if (!SendPacket(endpoint, BuildViscaSequenceReset(), &result))
+            co_return result;
+        session.OnResetSent();
+        endpoint.lastZoomCode = -1;
+        // Moves still waiting on the old numbering have just failed.
+        replied_.NotifyAll();
+    }
+
+    std::vector<ViscaCommand> sent;
+    const auto sendCommand = [&](auto build)
+    {
+        const ViscaCommand command = session.BeginCommand();
+        sent.push_back(command);
+        return SendPacket(endpoint, build(command.sequence), &result);
+    };
+    const auto finishAll = [&]()
+    {
+        for (const auto& command : sent)
+            session.FinishCommand(command);
+    };
+    if (!sendCommand([&](uint32_t sequence) { return BuildViscaPanTiltDrive(state, sequence); }))
+    {
+        finishAll();
+        co_return result;
+    }
+
+    // A stop always includes the zoom stop, in case an earlier one was lost.
+    const uint8_t zoomCode = ViscaZoomCode(state.z);
+    const bool stop = state.x == 0.0 && state.y == 0.0 && state.z == 0.0;
+    if ((stop || zoomCode != endpoint.lastZoomCode) &&
+        !sendCommand([&](uint32_t sequence) { return BuildViscaZoom(state.z, sequence); }))
+    {
+        finishAll();
+        co_return result;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(timeoutMs != 0 ? timeoutMs : kDefaultReplyTimeoutMs);
+    auto allDone = [&]()
+    {
+        return std::all_of(sent.begin(), sent.end(),
+            [&](const ViscaCommand& command) { return session.IsDone(command); });
+    };
+    // Cancel() runs on this thread, so the wakeup needs no posting.
+    const uint64_t cancelId = cancellation ? cancellation->Register([this]() { replied_.NotifyAll(); }) : 0;
+    const auto cancelled = [&]() { return cancellation && (cancelId == 0 || cancellation->IsCancelled()); };
+    while (!allDone() && !cancelled() && std::chrono::steady_clock::now() < deadline)
+        co_await replied_.WaitUntil(deadline);
+    if (cancelId != 0)
+        cancellation->Unregister(cancelId);
+    const bool abandoned = cancelled();
+
+    result.acknowledged = true;
+    for (const auto& command : sent)
+    {
+        const ViscaCommandStatus reply = session.FinishCommand(command);
+        if (reply.acknowledged)
+            continue;
+
+        result.acknowledged = false;
+        result.hr = E_FAIL;
+        if (!reply.done && abandoned)
+        {
+            result.hr = E_ABORT;
+            result.errorText = L"Cancelled";
+            result.cancelled = true;
+        }
+        else if (!reply.done)
+        {
+            result.error = ERROR_TIMEOUT;
+            result.errorText = L"No VISCA reply";
+            result.timedOut = true;
+        }
+        else if (reply.errorCode != 0)
+        {
+            result.errorText = L"VISCA " + Utf8ToWide(DescribeViscaError(reply.errorCode));
+        }
+        else
+        {
+            result.errorText = L"VISCA sequence rejected";
+        }
+    }
+    if (result.acknowledged)
+        endpoint.lastZoomCode = zoomCode;
+    else
+        endpoint.lastZoomCode = -1;
+    co_return result;
+}
+
+void ViscaCameraDriver::ReceiveReplies()
+{
+    const SOCKET udp = static_cast<SOCKET>(socket_);
+    for (;;)
+    {
+        uint8_t buffer[kReceiveBufferSize] = {};
+        sockaddr_in from = {};
+        int fromLength = sizeof(from);
+        const int received = recvfrom(udp, reinterpret_cast<char*>(buffer), sizeof(buffer), 0,
+            reinterpret_cast<sockaddr*>(&from), &fromLength);
+        if (received == SOCKET_ERROR)
+        {
+            // An ICMP port-unreachable from an earlier send; the socket is
+            // still good.
+            if (WSAGetLastError() == WSAECONNRESET)
+                continue;
+            break;
+        }
+
+        ViscaReply reply;
+        if (!ParseViscaReply(buffer, static_cast<size_t>(received), &reply))
+            continue;
+        const uint64_t key = MakeEndpointKey(ntohl(from.sin_addr.s_addr), ntohs(from.sin_port));
+        reactor_.Post([this, key, reply]() { HandleReply(key, reply); });
+    }
+}
+
+void ViscaCameraDriver::HandleReply(uint64_t key, const ViscaReply& reply)
+{
+    auto endpoint = endpoints_.find(key);
+    if (endpoint != endpoints_.end() && endpoint->second.session.HandleReply(reply))
+        replied_.NotifyAll();
+}
@@ -0,0 +1,182 @@
+#include "ViscaProtocol.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr uint16_t kPayloadCommand = 0x0100;
+constexpr uint16_t kPayloadReply = 0x0111;
+constexpr uint16_t kPayloadControl = 0x0200;
+constexpr uint16_t kPayloadControlReply = 0x0201;
+constexpr size_t kHeaderSize = 8;
+
+constexpr double kStateMaxMagnitude = 750.0;
+constexpr uint8_t kPanSpeedMax = 0x18;
+constexpr uint8_t kTiltSpeedMax = 0x17;
+constexpr uint8_t kZoomSpeedMax = 0x07;
+
+std::vector<uint8_t> BuildPacket(uint16_t payloadType, uint32_t sequence, std::initializer_list<uint8_t> payload)
+{
+    std::vector<uint8_t> packet;
+    packet.reserve(kHeaderSize + payload.size());
+    const auto length = static_cast<uint16_t>(payload.size());
+    packet.push_back(static_cast<uint8_t>(payloadType >> 8));
+    packet.push_back(static_cast<uint8_t>(payloadType));
+    packet.push_back(static_cast<uint8_t>(length >> 8));
+    packet.push_back(static_cast<uint8_t>(length));
+    for (int shift = 24; shift >= 0; shift -= 8)
+        packet.push_back(static_cast<uint8_t>(sequence >> shift));
+    packet.insert(packet.end(), payload);
+    return packet;
+}
+
+// 0 when the axis is centred, otherwise 1..|maxSpeed|.
+uint8_t ScaleSpeed(double value, uint8_t maxSpeed)
+{
+    const double magnitude = std::min(std::abs(value) / kStateMaxMagnitude, 1.0);
+    if (magnitude <= 0.0)
+        return 0;
+    return static_cast<uint8_t>(std::clamp(std::lround(magnitude * maxSpeed), 1L, static_cast<long>(maxSpeed)));
+}
+
+uint64_t MakeCommandId(uint32_t generation, uint32_t sequence)
+{
+    return (static_cast<uint64_t>(generation) << 32) | sequence;
+}
+}
+
+std::vector<uint8_t> BuildViscaPanTiltDrive(const JoystickState& state, uint32_t sequence)
+{
+    const uint8_t panSpeed = ScaleSpeed(state.x, kPanSpeedMax);
+    const uint8_t tiltSpeed = ScaleSpeed(state.y, kTiltSpeedMax);
+    // 01 left/up, 02 right/down, 03 stop; a stopped axis still needs a
+    // valid speed byte.
+    const uint8_t pan = panSpeed == 0 ? 0x03 : (state.x < 0 ? 0x01 : 0x02);
+    const uint8_t tilt = tiltSpeed == 0 ? 0x03 : (state.y < 0 ? 0x01 : 0x02);
+    return BuildPacket(kPayloadCommand, sequence, {
+        0x81, 0x01, 0x06, 0x01,
+        std::max<uint8_t>(panSpeed, 1), std::max<uint8_t>(tiltSpeed, 1),
+        pan, tilt, 0xFF });
+}
+
+uint8_t ViscaZoomCode(double z)
+{
+    const uint8_t speed = ScaleSpeed(z, kZoomSpeedMax + 1);
+    if (speed == 0)
+        return 0x00;
+    // 2p tele, 3p wide, p = 0 (slow) to 7.
+    return static_cast<uint8_t>((z > 0 ? 0x20 : 0x30) | (speed - 1));
+}
+
+std::vector<uint8_t> BuildViscaZoom(double z, uint32_t sequence)
+{
+    return BuildPacket(kPayloadCommand, sequence, { 0x81, 0x01, 0x04, 0x07, ViscaZoomCode(z), 0xFF });
+}
+
+std::vector<uint8_t> BuildViscaSequenceReset()
+{
+    return BuildPacket(kPayloadControl, 0, { 0x01 });
+}
+
+bool ParseViscaReply(const uint8_t* data, size_t size, ViscaReply* reply)
+{
+    if (size < kHeaderSize + 1)
+        return false;
+
+    const uint16_t payloadType = static_cast<uint16_t>((data[0] << 8) | data[1]);
+    const size_t length = static_cast<size_t>((data[2] << 8) | data[3]);
+    if (length == 0 || kHeaderSize + length > size)
+        return false;
+
+    reply->sequence = (static_cast<uint32_t>(data[4]) << 24) | (static_cast<uint32_t>(data[5]) << 16) |
+        (static_cast<uint32_t>(data[6]) << 8) | data[7];
+    const uint8_t* payload = data + kHeaderSize;
+
+    if (payloadType == kPayloadControlReply)
+    {
+        // 01: reset acknowledged; 0F 01 / 0F 02: bad sequence or message.
+        reply->kind = payload[0] == 0x01 ? ViscaReplyKind::ControlAck : ViscaReplyKind::ControlError;
+        return true;
+    }
+
+    // 90 4y FF ack, 90 5y FF completion, 90 6y ee FF error.
+    if (payloadType != kPayloadReply || length < 3 || payload[0] != 0x90)
+        return false;
+    switch (payload[1] & 0xF0)
+    {
+    case 0x40:
+        reply->kind = ViscaReplyKind::Ack;
+        return true;
+    case 0x50:
+        reply->kind = ViscaReplyKind::Completion;
+        return true;
+    case 0x60:
+        if (length < 4)
+            return false;
+        reply->kind = ViscaReplyKind::Error;
+        reply->errorCode = payload[2];
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ViscaSession::OnResetSent(uint32_t firstSequence)
+{
+    for (auto& [id, status] : pending_)
+    {
+        if (!status.done)
+        {
+            status.done = true;
+            status.sequenceRejected = true;
+        }
+    }
+    ++generation_;
+    nextSequence_ = firstSequence;
+    needsReset_ = false;
+}
+
+ViscaCommand ViscaSession::BeginCommand()
+{
+    ViscaCommand command;
+    command.sequence = nextSequence_++;
+    command.id = MakeCommandId(generation_, command.sequence);
+    pending_[command.id] = {};
+    return command;
+}
+
+bool ViscaSession::HandleReply(const ViscaReply& reply)
+{
+    if (reply.kind == ViscaReplyKind::ControlAck)
+        return false;
+    if (reply.kind == ViscaReplyKind::ControlError)
+        needsReset_ = true;
+
+    // The completion that follows an ACK finds nothing left to update.
+    const auto it = pending_.find(MakeCommandId(generation_, reply.sequence));
+    if (it == pending_.end() || it->second.done)
+        return false;
+
+    ViscaCommandStatus& status = it->second;
+    status.done = true;
+    status.acknowledged = reply.kind == ViscaReplyKind::Ack || reply.kind == ViscaReplyKind::Completion;
+    status.errorCode = reply.kind == ViscaReplyKind::Error ? reply.errorCode : 0;
+    status.sequenceRejected = reply.kind == ViscaReplyKind::ControlError;
+    return true;
+}
+
+bool ViscaSession::IsDone(const ViscaCommand& command) const
+{
+    const auto it = pending_.find(command.id);
+    return it == pending_.end() || it->second.done;
+}
+
+ViscaCommandStatus ViscaSession::FinishCommand(const ViscaCommand& command)
+{
+    const auto it = pending_.find(command.id);
+    if (it == pending_.end())
+        return {};
+    const ViscaCommandStatus status = it->second;
+    pending_.erase(it);
+    return status;
+}
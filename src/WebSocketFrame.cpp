@@ -0,0 +1,214 @@
+#include "WebSocketFrame.h"
+
+#include "OnvifSoap.h"
+
+namespace {
+constexpr char kAcceptGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+constexpr size_t kMaxControlPayload = 125;
+
+bool IsControl(WebSocketOpcode opcode)
+{
+    return (static_cast<uint8_t>(opcode) & 0x8) != 0;
+}
+
+bool IsKnownOpcode(uint8_t opcode)
+{
+    return opcode <= 0x2 || (opcode >= 0x8 && opcode <= 0xA);
+}
+}
+
+void AppendWebSocketFrame(std::string* out, WebSocketOpcode opcode, std::string_view payload, bool final,
+    const uint8_t* maskKey)
+{
+    out->push_back(static_cast<char>((final ? 0x80 : 0x00) | static_cast<uint8_t>(opcode)));
+    const uint8_t maskBit = maskKey ? 0x80 : 0x00;
+    if (payload.size() <= 125)
+    {
+        out->push_back(static_cast<char>(maskBit | payload.size()));
+    }
+    else if (payload.size() <= 0xFFFF)
+    {
+        out->push_back(static_cast<char>(maskBit | 126));
+        out->push_back(static_cast<char>(payload.size() >> 8));
+        out->push_back(static_cast<char>(payload.size() & 0xFF));
+    }
+    else
+    {
+        out->push_back(static_cast<char>(maskBit | 127));
+        for (int shift = 56; shift >= 0; shift -= 8)
+            out->push_back(static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xFF));
+    }
+
+    if (!maskKey)
+    {
+        out->append(payload);
+        return;
+    }
+    out->append(reinterpret_cast<const char*>(maskKey), 4);
+    const size_t start = out->size();
+    out->append(payload);
+    for (size_t i = 0; i < payload.size(); ++i)
+        (*out)[start + i] = static_cast<char>((*out)[start + i] ^ maskKey[i % 4]);
+}
+
+std::string ComputeWebSocketAccept(std::string_view key)
+{
+    const std::array<uint8_t, 20> digest = ComputeSha1(std::string(key) + kAcceptGuid);
+    return EncodeBase64(digest.data(), digest.size());
+}
+
+bool IsValidWebSocketCloseCode(uint16_t code)
+{
+    // 1004 is reserved; 1012-1014 are registered since RFC 6455.
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1014) || (code >= 3000 && code <= 4999);
+}
+
+std::string BuildWebSocketClosePayload(uint16_t code, std::string_view reason)
+{
+    std::string payload;
+    payload.push_back(static_cast<char>(code >> 8));
+    payload.push_back(static_cast<char>(code & 0xFF));
+    payload.append(reason.substr(0, kMaxControlPayload - 2));
+    return payload;
+}
+
+bool TryParseWebSocketClose(std::string_view payload, uint16_t* code, std::string* reason)
+{
+    reason->clear();
+    if (payload.empty())
+    {
+        *code = kWebSocketCloseNoStatus;
+        return true;
+    }
+    if (payload.size() < 2)
+        return false;
+    *code = static_cast<uint16_t>((static_cast<uint8_t>(payload[0]) << 8) | static_cast<uint8_t>(payload[1]));
+    reason->assign(payload.substr(2));
+    return IsValidWebSocketCloseCode(*code);
+}
+
+void WebSocketFrameReader::Append(const char* data, size_t size)
+{
+    // Drop what earlier frames used before growing the buffer.
+    if (consumed_ > 0)
+    {
+        buffer_.erase(0, consumed_);
+        consumed_ = 0;
+    }
+    buffer_.append(data, size);
+}
+
+WebSocketFrameReader::Result WebSocketFrameReader::Next(WebSocketFrame* frame, uint16_t* closeCode)
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(buffer_.data() + consumed_);
+    const size_t available = buffer_.size() - consumed_;
+    if (available < 2)
+        return Result::NeedMore;
+
+    const bool final = (bytes[0] & 0x80) != 0;
+    const uint8_t opcode = bytes[0] & 0x0F;
+    // No extensions are negotiated, so the reserved bits must be clear.
+    if ((bytes[0] & 0x70) != 0 || !IsKnownOpcode(opcode))
+    {
+        *closeCode = kWebSocketCloseProtocolError;
+        return Result::Error;
+    }
+
+    const bool masked = (bytes[1] & 0x80) != 0;
+    uint64_t length = bytes[1] & 0x7F;
+    size_t header = 2;
+    if (length == 126 || length == 127)
+    {
+        const size_t lengthBytes = length == 126 ? 2 : 8;
+        if (available < header + lengthBytes)
+            return Result::NeedMore;
+        length = 0;
+        for (size_t i = 0; i < lengthBytes; ++i)
+            length = (length << 8) | bytes[header + i];
+        header += lengthBytes;
+        if ((length >> 63) != 0)
+        {
+            *closeCode = kWebSocketCloseProtocolError;
+            return Result::Error;
+        }
+    }
+
+    if (IsControl(static_cast<WebSocketOpcode>(opcode)) && (!final || length > kMaxControlPayload))
+    {
+        *closeCode = kWebSocketCloseProtocolError;
+        return Result::Error;
+    }
+    if (length > maxPayload_)
+    {
+        *closeCode = kWebSocketCloseTooBig;
+        return Result::Error;
+    }
+
+    const size_t maskOffset = header;
+    if (masked)
+        header += 4;
+    if (available < header + length)
+        return Result::NeedMore;
+
+    frame->opcode = static_cast<WebSocketOpcode>(opcode);
+    frame->final = final;
+    frame->masked = masked;
+    frame->payload.assign(reinterpret_cast<const char*>(bytes + header), static_cast<size_t>(length));
+    if (masked)
+    {
+        for (size_t i = 0; i < frame->payload.size(); ++i)
+            frame->payload[i] = static_cast<char>(frame->payload[i] ^ bytes[maskOffset + i % 4]);
+    }
+    consumed_ += header + static_cast<size_t>(length);
+    return Result::Frame;
+}
+
+WebSocketMessageAssembler::Result WebSocketMessageAssembler::Add(WebSocketOpcode opcode, bool final,
+    std::string_view payload)
+{
+    if (complete_)
+    {
+        message_.clear();
+        complete_ = false;
+    }
+
+    if (opcode == WebSocketOpcode::Continuation)
+    {
+        if (!inProgress_)
+            return Result::ProtocolError;
+    }
+    else if (opcode == WebSocketOpcode::Text || opcode == WebSocketOpcode::Binary)
+    {
+        if (inProgress_)
+        {
+            Reset();
+            return Result::ProtocolError;
+        }
+        inProgress_ = true;
+        binary_ = opcode == WebSocketOpcode::Binary;
+    }
+    else
+    {
+        return Result::ProtocolError;
+    }
+
+    if (payload.size() > maxMessage_ - message_.size())
+    {
+        Reset();
+        return Result::TooBig;
+    }
+    message_.append(payload);
+    if (!final)
+        return Result::Partial;
+
+    inProgress_ = false;
+    complete_ = true;
+    return binary_ ? Result::Binary : Result::Text;
+}
+
+void WebSocketMessageAssembler::Reset()
+{
+    message_.clear();
+    inProgress_ = false;
+    complete_ = false;
+}
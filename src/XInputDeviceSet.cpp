@@ -0,0 +1,241 @@
+#include "XInputDeviceSet.h"
+
+#include <algorithm>
+#include <cwchar>
+
+namespace {
+constexpr size_t kInitialCapacity = 16;
+constexpr uint64_t kFnvOffsetBasis = 1469598103934665603ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+int HexDigitValue(wchar_t ch)
+{
+    if (ch >= L'0' && ch <= L'9')
+        return ch - L'0';
+    if (ch >= L'A' && ch <= L'F')
+        return ch - L'A' + 10;
+    if (ch >= L'a' && ch <= L'f')
+        return ch - L'a' + 10;
+    return -1;
+}
+
+// Reads up to |maxDigits| hex digits; returns how many there were.
+size_t ParseHexPrefix(const wchar_t* text, size_t maxDigits, uint32_t* outValue)
+{
+    uint32_t value = 0;
+    size_t digits = 0;
+    for (; digits < maxDigits; ++digits)
+    {
+        const int digit = HexDigitValue(text[digits]);
+        if (digit < 0)
+            break;
+        value = (value << 4) | static_cast<uint32_t>(digit);
+    }
+
+    *outValue = value;
+    return digits;
+}
+
+bool TryParseHexDigits(const wchar_t* text, size_t digits, uint32_t* outValue)
+{
+    uint32_t value = 0;
+    if (ParseHexPrefix(text, digits, &value) != digits)
+        return false;
+
+    if (outValue)
+        *outValue = value;
+    return true;
+}
+
+// One to four hex digits after |tag|, as swscanf's "%4X" took them; 0 when
+// the tag is missing or not followed by a digit.
+uint32_t ParseTaggedHex(const wchar_t* deviceId, const wchar_t* tag)
+{
+    const wchar_t* start = wcsstr(deviceId, tag);
+    if (!start)
+        return 0;
+
+    uint32_t value = 0;
+    if (ParseHexPrefix(start + wcslen(tag), 4, &value) == 0)
+        return 0;
+    return value;
+}
+
+void HashBytes(uint64_t* hash, const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        *hash ^= bytes[i];
+        *hash *= kFnvPrime;
+    }
+}
+}
+
+void XInputDeviceSet::Insert(uint32_t vidPid)
+{
+    if (vidPid == 0)
+    {
+        hasZero_ = true;
+        return;
+    }
+
+    if ((count_ + 1) * 2 > slots_.size())
+        Rehash(slots_.empty() ? kInitialCapacity : slots_.size() * 2);
+
+    size_t slot = SlotFor(vidPid);
+    const size_t mask = slots_.size() - 1;
+    while (slots_[slot] != 0)
+    {
+        if (slots_[slot] == vidPid)
+            return;
+        slot = (slot + 1) & mask;
+    }
+
+    slots_[slot] = vidPid;
+    ++count_;
+}
+
+bool XInputDeviceSet::Contains(uint32_t vidPid) const
+{
+    if (vidPid == 0)
+        return hasZero_;
+    if (slots_.empty())
+        return false;
+
+    size_t slot = SlotFor(vidPid);
+    const size_t mask = slots_.size() - 1;
+    while (slots_[slot] != 0)
+    {
+        if (slots_[slot] == vidPid)
+            return true;
+        slot = (slot + 1) & mask;
+    }
+
+    return false;
+}
+
+void XInputDeviceSet::Clear()
+{
+    slots_.clear();
+    count_ = 0;
+    hasZero_ = false;
+}
+
+std::vector<uint32_t> XInputDeviceSet::ToSortedVector() const
+{
+    std::vector<uint32_t> values;
+    values.reserve(Size());
+    if (hasZero_)
+        values.push_back(0);
+    for (const uint32_t value : slots_)
+    {
+        if (value != 0)
+            values.push_back(value);
+    }
+
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+size_t XInputDeviceSet::SlotFor(uint32_t vidPid) const
+{
+    // Fibonacci hashing spreads the clustered VID values across the table.
+    const uint32_t hash = vidPid * 2654435769u;
+    return static_cast<size_t>(hash) & (slots_.size() - 1);
+}
+
+void XInputDeviceSet::Rehash(size_t capacity)
+{
+    std::vector<uint32_t> previous = std::move(slots_);
+    slots_.assign(capacity, 0);
+    count_ = 0;
+
+    const size_t mask = capacity - 1;
+    for (const uint32_t value : previous)
+    {
+        if (value == 0)
+            continue;
+
+        size_t slot = SlotFor(value);
+        while (slots_[slot] != 0)
+            slot = (slot + 1) & mask;
+        slots_[slot] = value;
+        ++count_;
+    }
+}
+
+bool TryGetXInputVidPid(const wchar_t* deviceId, uint32_t* outVidPid)
+{
+    if (!deviceId || !wcsstr(deviceId, L"IG_"))
+        return false;
+
+    const uint32_t vid = ParseTaggedHex(deviceId, L"VID_");
+    const uint32_t pid = ParseTaggedHex(deviceId, L"PID_");
+
+    if (outVidPid)
+        *outVidPid = MakeVidPid(static_cast<uint16_t>(vid), static_cast<uint16_t>(pid));
+    return true;
+}
+
+std::wstring FormatVidPidList(const XInputDeviceSet& devices)
+{
+    std::wstring text;
+    for (const uint32_t value : devices.ToSortedVector())
+    {
+        wchar_t buffer[16] = {};
+        swprintf(buffer, sizeof(buffer) / sizeof(buffer[0]), L"%08X", value);
+        if (!text.empty())
+            text += L',';
+        text += buffer;
+    }
+    return text;
+}
+
+bool TryParseVidPidList(const std::wstring& text, XInputDeviceSet* devices)
+{
+    if (!devices)
+        return false;
+
+    devices->Clear();
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        if (pos + 8 > text.size())
+            return false;
+
+        uint32_t value = 0;
+        if (!TryParseHexDigits(text.c_str() + pos, 8, &value))
+            return false;
+        devices->Insert(value);
+
+        pos += 8;
+        if (pos < text.size())
+        {
+            // A separator must be followed by another value.
+            if (text[pos] != L',' || pos + 1 == text.size())
+                return false;
+            ++pos;
+        }
+    }
+
+    return true;
+}
+
+std::wstring ComputeDeviceFingerprint(std::vector<std::wstring> devicePaths)
+{
+    std::sort(devicePaths.begin(), devicePaths.end());
+
+    uint64_t hash = kFnvOffsetBasis;
+    for (const auto& path : devicePaths)
+    {
+        HashBytes(&hash, path.data(), path.size() * sizeof(wchar_t));
+        const wchar_t separator = L'\0';
+        HashBytes(&hash, &separator, sizeof(separator));
+    }
+
+    wchar_t buffer[32] = {};
+    swprintf(buffer, sizeof(buffer) / sizeof(buffer[0]), L"%zu:%016llX",
+        devicePaths.size(), static_cast<unsigned long long>(hash));
+    return buffer;
+}
@@ -6,54 +6,86 @@
 
 #include "ComHelpers.h"
 #include "ComPtr.h"
+#include "LogUtils.h"
+#include "RegistryUtils.h"
+#include "XInputDeviceSet.h"
 
 #include <wbemidl.h>
-#include <new>
+#include <string>
+#include <vector>
 #include <wchar.h>
 
 namespace {
-struct XINPUT_DEVICE_NODE
-{
-    DWORD dwVidPid;
-    XINPUT_DEVICE_NODE* pNext;
-};
+constexpr wchar_t kRegistrySubkey[] = L"SOFTWARE\\JoystickTesting";
+constexpr wchar_t kRegistryXInputFingerprintName[] = L"XInput Cache Fingerprint";
+constexpr wchar_t kRegistryXInputDevicesName[] = L"XInput Cache Devices";
 
-XINPUT_DEVICE_NODE* g_xinputDeviceList = nullptr;
+XInputDeviceSet g_xinputDevices;
 
-bool TryGetVidPid(const wchar_t* deviceId, DWORD* outVidPid)
+std::wstring BuildAttachedDeviceFingerprint()
 {
-    if (!deviceId || !wcsstr(deviceId, L"IG_"))
-        return false;
+    UINT deviceCount = 0;
+    if (GetRawInputDeviceList(nullptr, &deviceCount, sizeof(RAWINPUTDEVICELIST)) != 0)
+        return L"";
+
+    std::vector<RAWINPUTDEVICELIST> devices(deviceCount);
+    if (deviceCount > 0)
+    {
+        const UINT listed = GetRawInputDeviceList(devices.data(), &deviceCount, sizeof(RAWINPUTDEVICELIST));
+        if (listed == static_cast<UINT>(-1))
+            return L"";
+        devices.resize(listed);
+    }
+
+    std::vector<std::wstring> devicePaths;
+    devicePaths.reserve(devices.size());
+    for (const auto& device : devices)
+    {
+        if (device.dwType != RIM_TYPEHID)
+            continue;
+
+        UINT nameLength = 0;
+        if (GetRawInputDeviceInfoW(device.hDevice, RIDI_DEVICENAME, nullptr, &nameLength) != 0 ||
+            nameLength == 0)
+        {
+            continue;
+        }
 
-    DWORD vid = 0;
-    DWORD pid = 0;
+        std::wstring name(nameLength, L'\0');
+        const UINT copied = GetRawInputDeviceInfoW(device.hDevice, RIDI_DEVICENAME, name.data(), &nameLength);
+        if (copied == static_cast<UINT>(-1))
+            continue;
 
-    const wchar_t* strVid = wcsstr(deviceId, L"VID_");
-    if (strVid && swscanf(strVid, L"VID_%4X", &vid) != 1)
-        vid = 0;
+        name.resize(wcsnlen(name.c_str(), name.size()));
+        devicePaths.push_back(std::move(name));
+    }
 
-    const wchar_t* strPid = wcsstr(deviceId, L"PID_");
-    if (strPid && swscanf(strPid, L"PID_%4X", &pid) != 1)
-        pid = 0;
+    return ComputeDeviceFingerprint(std::move(devicePaths));
+}
 
-    if (outVidPid)
-        *outVidPid = MAKELONG(vid, pid);
-    return true;
+bool TryLoadCachedXInputDevices(const std::wstring& fingerprint)
+{
+    if (fingerprint.empty() ||
+        ReadRegistryString(kRegistrySubkey, kRegistryXInputFingerprintName) != fingerprint)
+    {
+        return false;
+    }
+
+    return TryParseVidPidList(
+        ReadRegistryString(kRegistrySubkey, kRegistryXInputDevicesName), &g_xinputDevices);
 }
 
-void AddXInputDevice(DWORD vidPid)
+void SaveCachedXInputDevices(const std::wstring& fingerprint)
 {
-    XINPUT_DEVICE_NODE* newNode = new (std::nothrow) XINPUT_DEVICE_NODE;
-    if (!newNode)
+    if (fingerprint.empty())
         return;
 
-    newNode->dwVidPid = vidPid;
-    newNode->pNext = g_xinputDeviceList;
-    g_xinputDeviceList = newNode;
-}
+    // Devices first, so a partial write never pairs a new fingerprint with a stale list.
+    WriteRegistryString(kRegistrySubkey, kRegistryXInputDevicesName, FormatVidPidList(g_xinputDevices));
+    WriteRegistryString(kRegistrySubkey, kRegistryXInputFingerprintName, fingerprint);
 }
 
-HRESULT SetupForIsXInputDevice()
+HRESULT ScanXInputDevicesWmi()
 {
     ScopedComInit comInit;
     if (!comInit.ok())
@@ -116,41 +148,53 @@ HRESULT SetupForIsXInputDevice()
             if (value.vt != VT_BSTR || !value.bstrVal)
                 continue;
 
-            DWORD vidPid = 0;
-            if (!TryGetVidPid(value.bstrVal, &vidPid))
+            uint32_t vidPid = 0;
+            if (!TryGetXInputVidPid(value.bstrVal, &vidPid))
                 continue;
 
-            AddXInputDevice(vidPid);
+            g_xinputDevices.Insert(vidPid);
         }
     }
 
     return S_OK;
 }
+}
+
+HRESULT SetupForIsXInputDevice()
+{
+    const std::wstring fingerprint = BuildAttachedDeviceFingerprint();
+    if (TryLoadCachedXInputDevices(fingerprint))
+    {
+        AppendLogLine(L"XInput filter: attached devices unchanged, using cached list (" +
+            std::to_wstring(g_xinputDevices.Size()) + L")");
+        return S_OK;
+    }
+
+    g_xinputDevices.Clear();
+    const HRESULT hr = ScanXInputDevicesWmi();
+    if (SUCCEEDED(hr))
+    {
+        SaveCachedXInputDevices(fingerprint);
+        AppendLogLine(L"XInput filter: scanned " + std::to_wstring(g_xinputDevices.Size()) +
+            L" device(s)");
+    }
+    return hr;
+}
 
 bool IsXInputDevice(const GUID* productGuid)
 {
     if (!productGuid)
         return false;
 
-    XINPUT_DEVICE_NODE* node = g_xinputDeviceList;
-    while (node)
-    {
-        if (node->dwVidPid == productGuid->Data1)
-            return true;
-        node = node->pNext;
-    }
+    return IsXInputVidPid(productGuid->Data1);
+}
 
-    return false;
+bool IsXInputVidPid(uint32_t vidPid)
+{
+    return g_xinputDevices.Contains(vidPid);
 }
 
 void CleanupForIsXInputDevice()
 {
-    XINPUT_DEVICE_NODE* node = g_xinputDeviceList;
-    while (node)
-    {
-        XINPUT_DEVICE_NODE* toDelete = node;
-        node = node->pNext;
-        delete toDelete;
-    }
-    g_xinputDeviceList = nullptr;
+    g_xinputDevices.Clear();
 }
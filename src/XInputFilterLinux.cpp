@@ -0,0 +1,175 @@
+#include "XInputFilter.h"
+
+#include "XInputDeviceSet.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace {
+// Under the sysfs root.
+constexpr char kUsbDevicesPath[] = "/bus/usb/devices";
+constexpr char kInputClassPath[] = "/class/input";
+constexpr char kXpadDriverName[] = "xpad";
+
+struct XInputInterfaceSignature
+{
+    unsigned subClass;
+    unsigned protocol;
+};
+
+// Vendor-specific (class 0xFF) interface descriptors matched by xpad: wired
+// and wireless Xbox 360 pads, then Xbox One pads.
+constexpr XInputInterfaceSignature kXInputInterfaces[] = {
+    { 0x5D, 0x01 },
+    { 0x5D, 0x81 },
+    { 0x47, 0xD0 },
+};
+
+XInputDeviceSet g_xinputDevices;
+
+bool ReadSysfsHex(const std::string& path, unsigned* outValue)
+{
+    std::ifstream file(path);
+    std::string text;
+    if (!(file >> text))
+        return false;
+
+    char* endPtr = nullptr;
+    const unsigned long value = std::strtoul(text.c_str(), &endPtr, 16);
+    if (endPtr == text.c_str() || *endPtr != '\0')
+        return false;
+
+    if (outValue)
+        *outValue = static_cast<unsigned>(value);
+    return true;
+}
+
+std::string ReadLinkBaseName(const std::string& path)
+{
+    char buffer[PATH_MAX] = {};
+    const ssize_t length = readlink(path.c_str(), buffer, sizeof(buffer) - 1);
+    if (length <= 0)
+        return {};
+
+    const std::string target(buffer, static_cast<size_t>(length));
+    const size_t slash = target.find_last_of('/');
+    return slash == std::string::npos ? target : target.substr(slash + 1);
+}
+
+template<typename Callback>
+bool ForEachDirectoryEntry(const std::string& path, Callback callback)
+{
+    DIR* directory = opendir(path.c_str());
+    if (!directory)
+        return false;
+
+    while (const dirent* entry = readdir(directory))
+    {
+        if (entry->d_name[0] == '.')
+            continue;
+        callback(std::string(entry->d_name));
+    }
+
+    closedir(directory);
+    return true;
+}
+
+bool TryReadVidPid(const std::string& vendorPath, const std::string& productPath, uint32_t* outVidPid)
+{
+    unsigned vid = 0;
+    unsigned pid = 0;
+    if (!ReadSysfsHex(vendorPath, &vid) || !ReadSysfsHex(productPath, &pid))
+        return false;
+
+    if (outVidPid)
+        *outVidPid = MakeVidPid(static_cast<uint16_t>(vid), static_cast<uint16_t>(pid));
+    return true;
+}
+
+bool IsXInputInterface(const std::string& interfacePath)
+{
+    unsigned interfaceClass = 0;
+    unsigned subClass = 0;
+    unsigned protocol = 0;
+    if (!ReadSysfsHex(interfacePath + "/bInterfaceClass", &interfaceClass) || interfaceClass != 0xFF ||
+        !ReadSysfsHex(interfacePath + "/bInterfaceSubClass", &subClass) ||
+        !ReadSysfsHex(interfacePath + "/bInterfaceProtocol", &protocol))
+    {
+        return false;
+    }
+
+    for (const auto& signature : kXInputInterfaces)
+    {
+        if (signature.subClass == subClass && signature.protocol == protocol)
+            return true;
+    }
+    return false;
+}
+
+bool ScanUsbInterfaces(const std::string& sysfsRoot)
+{
+    const std::string devicesPath = sysfsRoot + kUsbDevicesPath;
+    return ForEachDirectoryEntry(devicesPath, [&](const std::string& name)
+    {
+        // Interfaces are named "<bus>-<port>:<config>.<interface>"; the parent
+        // device directory carries the VID/PID.
+        const size_t colon = name.find(':');
+        if (colon == std::string::npos)
+            return;
+
+        const std::string interfacePath = devicesPath + "/" + name;
+        if (!IsXInputInterface(interfacePath))
+            return;
+
+        const std::string devicePath = devicesPath + "/" + name.substr(0, colon);
+        uint32_t vidPid = 0;
+        if (TryReadVidPid(devicePath + "/idVendor", devicePath + "/idProduct", &vidPid))
+            g_xinputDevices.Insert(vidPid);
+    });
+}
+
+bool ScanInputDevices(const std::string& sysfsRoot)
+{
+    const std::string classPath = sysfsRoot + kInputClassPath;
+    return ForEachDirectoryEntry(classPath, [&](const std::string& name)
+    {
+        if (name.compare(0, 5, "input") != 0)
+            return;
+
+        const std::string inputPath = classPath + "/" + name;
+        if (ReadLinkBaseName(inputPath + "/device/driver") != kXpadDriverName)
+            return;
+
+        uint32_t vidPid = 0;
+        if (TryReadVidPid(inputPath + "/id/vendor", inputPath + "/id/product", &vidPid))
+            g_xinputDevices.Insert(vidPid);
+    });
+}
+}
+
+bool SetupForIsXInputDevice(const char* sysfsRoot)
+{
+    g_xinputDevices.Clear();
+
+    // The USB scan covers unbound pads; the input scan covers xpad devices on
+    // other buses. Either source alone is enough to succeed.
+    const std::string root = sysfsRoot ? sysfsRoot : "/sys";
+    const bool usbScanned = ScanUsbInterfaces(root);
+    const bool inputScanned = ScanInputDevices(root);
+    return usbScanned || inputScanned;
+}
+
+bool IsXInputVidPid(uint32_t vidPid)
+{
+    return g_xinputDevices.Contains(vidPid);
+}
+
+void CleanupForIsXInputDevice()
+{
+    g_xinputDevices.Clear();
+}
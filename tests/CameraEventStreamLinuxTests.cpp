@@ -0,0 +1,394 @@
+#include "TestHarness.h"
+
+#include "CameraEventStream.h"
+#include "LoopbackSocket.h"
+#include "WebSocketFrame.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+constexpr int kIoTimeoutMs = 2000;
+constexpr auto kResultTimeout = 2s;
+constexpr char kPath[] = "/proxy/protect/integration/v1/subscribe/devices";
+
+// What the stream passed to its callbacks, read from the test thread.
+struct StreamLog
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::string> messages;
+    std::vector<bool> connects;
+
+    void AddMessage(const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(message);
+        cv.notify_all();
+    }
+
+    void AddConnect(bool reconnected)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        connects.push_back(reconnected);
+        cv.notify_all();
+    }
+
+    bool WaitForMessages(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, kResultTimeout, [&] { return messages.size() >= count; });
+    }
+
+    bool WaitForConnects(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, kResultTimeout, [&] { return connects.size() >= count; });
+    }
+};
+
+// The server end of one accepted connection.
+class ServerConnection
+{
+public:
+    ServerConnection() = default;
+    ServerConnection(ScopedSocket socket, std::string pending) : socket_(std::move(socket))
+    {
+        reader_.Append(pending.data(), pending.size());
+    }
+
+    bool IsValid() const { return socket_.IsValid(); }
+
+    bool SendRaw(std::string_view bytes) { return SendAll(socket_.Get(), bytes); }
+
+    bool Send(WebSocketOpcode opcode, std::string_view payload, bool final = true)
+    {
+        std::string frame;
+        AppendWebSocketFrame(&frame, opcode, payload, final, nullptr);
+        return SendRaw(frame);
+    }
+
+    bool SendClose(uint16_t code, std::string_view reason)
+    {
+        return Send(WebSocketOpcode::Close, BuildWebSocketClosePayload(code, reason));
+    }
+
+    // The next frame from the client, which must be masked.
+    bool ReadFrame(WebSocketFrame* frame)
+    {
+        uint16_t code = 0;
+        for (;;)
+        {
+            const WebSocketFrameReader::Result result = reader_.Next(frame, &code);
+            if (result == WebSocketFrameReader::Result::Frame)
+                return frame->masked;
+            if (result == WebSocketFrameReader::Result::Error)
+                return false;
+            std::string chunk;
+            if (!ReceiveSome(socket_.Get(), &chunk, kIoTimeoutMs))
+                return false;
+            reader_.Append(chunk.data(), chunk.size());
+        }
+    }
+
+    // The code of the client's next frame, which must be a Close.
+    uint16_t ReadCloseCode()
+    {
+        WebSocketFrame frame;
+        uint16_t code = 0;
+        std::string reason;
+        if (!ReadFrame(&frame) || frame.opcode != WebSocketOpcode::Close ||
+            !TryParseWebSocketClose(frame.payload, &code, &reason))
+        {
+            return 0;
+        }
+        return code;
+    }
+
+    // True once the client has closed its end.
+    bool WaitForDisconnect()
+    {
+        std::string ignored;
+        while (ReceiveSome(socket_.Get(), &ignored, kIoTimeoutMs))
+            ignored.clear();
+        return WaitReadable(socket_.Get(), 0);
+    }
+
+    void Close() { socket_.Reset(); }
+
+private:
+    ScopedSocket socket_;
+    WebSocketFrameReader reader_{ 1 << 22 };
+};
+
+// A device-event endpoint on 127.0.0.1 that the test steps through one
+// connection at a time.
+class WebSocketResponder
+{
+public:
+    WebSocketResponder() { listener_ = BindLoopback(SOCK_STREAM, &port_); }
+
+    bool IsValid() const { return listener_.IsValid(); }
+    uint16_t Port() const { return port_; }
+    const std::string& LastRequest() const { return lastRequest_; }
+    const std::vector<Clock::time_point>& AcceptTimes() const { return acceptTimes_; }
+
+    // Reads the next upgrade request and answers with |status|; 101
+    // completes the handshake unless |accept| overrides the key's answer.
+    ServerConnection Accept(int status = 101, const char* accept = nullptr)
+    {
+        ScopedSocket socket = AcceptWithin(listener_.Get(), kIoTimeoutMs);
+        if (!socket.IsValid())
+            return {};
+        acceptTimes_.push_back(Clock::now());
+        std::string buffer;
+        HttpMessage request;
+        if (!ReadHttpMessage(socket.Get(), &buffer, &request, kIoTimeoutMs))
+            return {};
+        lastRequest_ = request.head;
+
+        std::string response;
+        if (status == 101)
+        {
+            response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                "sec-websocket-accept: " +
+                (accept ? std::string(accept) : ComputeWebSocketAccept(request.Header("Sec-WebSocket-Key"))) +
+                "\r\n\r\n";
+        }
+        else
+        {
+            response = "HTTP/1.1 " + std::to_string(status) + " Unavailable\r\nContent-Length: 0\r\n\r\n";
+        }
+        if (!SendAll(socket.Get(), response))
+            return {};
+        return ServerConnection(std::move(socket), std::move(buffer));
+    }
+
+private:
+    ScopedSocket listener_;
+    uint16_t port_ = 0;
+    std::string lastRequest_;
+    std::vector<Clock::time_point> acceptTimes_;
+};
+
+// Runs the event stream against |responder| for the life of the object.
+class ScopedEventStream
+{
+public:
+    ScopedEventStream(const WebSocketResponder& responder, StreamLog* log, ReconnectBackoff backoff)
+    {
+        CameraEventStreamEndpoint endpoint;
+        endpoint.host = L"127.0.0.1";
+        endpoint.port = responder.Port();
+        endpoint.secure = false;
+        endpoint.path = std::wstring(kPath, kPath + sizeof(kPath) - 1);
+        endpoint.headers = L"Authorization: Bearer token\r\n";
+        StartCameraEventStream(
+            [endpoint](CameraEventStreamEndpoint* out)
+            {
+                *out = endpoint;
+                return true;
+            },
+            [log](bool reconnected) { log->AddConnect(reconnected); },
+            [log](const std::string& message) { log->AddMessage(message); },
+            backoff);
+    }
+
+    ~ScopedEventStream() { StopCameraEventStream(); }
+
+    ScopedEventStream(const ScopedEventStream&) = delete;
+    ScopedEventStream& operator=(const ScopedEventStream&) = delete;
+};
+
+// Short, so the reconnects between cases do not add up.
+const ReconnectBackoff kQuickBackoff(5ms, 20ms);
+}
+
+TEST_CASE(EventStreamUpgradeRequest)
+{
+    WebSocketResponder responder;
+    REQUIRE(responder.IsValid());
+    StreamLog log;
+    ScopedEventStream stream(responder, &log, kQuickBackoff);
+
+    ServerConnection connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    REQUIRE(log.WaitForConnects(1));
+    const std::string& request = responder.LastRequest();
+    CHECK(request.starts_with(std::string("GET ") + kPath + " HTTP/1.1\r\n"));
+    CHECK(request.find("\r\nUpgrade: websocket\r\n") != std::string::npos);
+    CHECK(request.find("\r\nSec-WebSocket-Version: 13\r\n") != std::string::npos);
+    CHECK(request.find("\r\nAuthorization: Bearer token") != std::string::npos);
+    std::lock_guard<std::mutex> lock(log.mutex);
+    CHECK(!log.connects[0]);
+}
+
+TEST_CASE(EventStreamFragmentedMessages)
+{
+    WebSocketResponder responder;
+    REQUIRE(responder.IsValid());
+    StreamLog log;
+    ScopedEventStream stream(responder, &log, kQuickBackoff);
+    ServerConnection connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+
+    // A ping between the fragments is answered without breaking the message.
+    connection.Send(WebSocketOpcode::Text, "{\"type\":", false);
+    connection.Send(WebSocketOpcode::Ping, "keepalive");
+    connection.Send(WebSocketOpcode::Continuation, "\"update\"", false);
+    connection.Send(WebSocketOpcode::Continuation, "}", true);
+    WebSocketFrame pong;
+    REQUIRE(connection.ReadFrame(&pong));
+    CHECK(pong.opcode == WebSocketOpcode::Pong);
+    CHECK_EQ(pong.payload, std::string("keepalive"));
+
+    // One byte per write, across the 16-bit length form.
+    std::string split;
+    const std::string large(300, 'x');
+    AppendWebSocketFrame(&split, WebSocketOpcode::Text, large, true, nullptr);
+    for (const char byte : split)
+        REQUIRE(connection.SendRaw(std::string_view(&byte, 1)));
+
+    // Binary messages are not events.
+    connection.Send(WebSocketOpcode::Binary, "\x01\x02\x03");
+    connection.Send(WebSocketOpcode::Text, "", false);
+    connection.Send(WebSocketOpcode::Continuation, "last", true);
+
+    REQUIRE(log.WaitForMessages(3));
+    std::lock_guard<std::mutex> lock(log.mutex);
+    REQUIRE(log.messages.size() == 3);
+    CHECK_EQ(log.messages[0], std::string("{\"type\":\"update\"}"));
+    CHECK_EQ(log.messages[1], large);
+    CHECK_EQ(log.messages[2], std::string("last"));
+}
+
+TEST_CASE(EventStreamCloseCodes)
+{
+    WebSocketResponder responder;
+    REQUIRE(responder.IsValid());
+    StreamLog log;
+    ScopedEventStream stream(responder, &log, kQuickBackoff);
+
+    // A server close is echoed with its code, then the stream reconnects.
+    ServerConnection connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    connection.SendClose(kWebSocketCloseGoingAway, "restarting");
+    CHECK_EQ(connection.ReadCloseCode(), kWebSocketCloseGoingAway);
+    CHECK(connection.WaitForDisconnect());
+
+    // A close without a code is answered with an empty close.
+    connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    connection.Send(WebSocketOpcode::Close, "");
+    WebSocketFrame frame;
+    REQUIRE(connection.ReadFrame(&frame));
+    CHECK(frame.opcode == WebSocketOpcode::Close);
+    CHECK(frame.payload.empty());
+
+    // Protocol errors close with 1002: a masked server frame, a code that
+    // may not be sent, a continuation with no message.
+    connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    std::string masked;
+    const uint8_t maskKey[4] = { 1, 2, 3, 4 };
+    AppendWebSocketFrame(&masked, WebSocketOpcode::Text, "hi", true, maskKey);
+    connection.SendRaw(masked);
+    CHECK_EQ(connection.ReadCloseCode(), kWebSocketCloseProtocolError);
+
+    connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    connection.SendClose(kWebSocketCloseNoStatus, "");
+    CHECK_EQ(connection.ReadCloseCode(), kWebSocketCloseProtocolError);
+
+    connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    connection.Send(WebSocketOpcode::Continuation, "orphan");
+    CHECK_EQ(connection.ReadCloseCode(), kWebSocketCloseProtocolError);
+
+    // Reserved bits set.
+    connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    connection.SendRaw(std::string("\xC1\x00", 2));
+    CHECK_EQ(connection.ReadCloseCode(), kWebSocketCloseProtocolError);
+
+    // A message past the limit, in fragments each under it, closes with 1009.
+    connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    const std::string half(kMaxCameraEventMessage / 2 + 1, 'x');
+    connection.Send(WebSocketOpcode::Text, half, false);
+    connection.Send(WebSocketOpcode::Continuation, half, true);
+    CHECK_EQ(connection.ReadCloseCode(), kWebSocketCloseTooBig);
+
+    // Nothing broken was delivered; every reconnect was reported as one.
+    connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    REQUIRE(log.WaitForConnects(7));
+    connection.Send(WebSocketOpcode::Text, "still here");
+    REQUIRE(log.WaitForMessages(1));
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        CHECK_EQ(log.messages.size(), 1u);
+        CHECK_EQ(log.messages[0], std::string("still here"));
+        CHECK(!log.connects[0]);
+        for (size_t i = 1; i < log.connects.size(); ++i)
+            CHECK(log.connects[i]);
+    }
+
+    // Stopping says goodbye with 1001.
+    StopCameraEventStream();
+    CHECK_EQ(connection.ReadCloseCode(), kWebSocketCloseGoingAway);
+}
+
+TEST_CASE(EventStreamReconnectBackoff)
+{
+    WebSocketResponder responder;
+    REQUIRE(responder.IsValid());
+    StreamLog log;
+    constexpr auto kInitial = 40ms;
+    constexpr auto kMax = 160ms;
+    ScopedEventStream stream(responder, &log, ReconnectBackoff(kInitial, kMax));
+
+    // Refused upgrades and a bad accept key each double the wait, up to
+    // the cap.
+    for (int i = 0; i < 4; ++i)
+        REQUIRE(responder.Accept(503).IsValid());
+    ServerConnection badKey = responder.Accept(101, "bm90IHRoZSBrZXk=");
+    REQUIRE(badKey.IsValid());
+    CHECK(badKey.WaitForDisconnect());
+
+    // A completed upgrade resets it: a drop reconnects after |kInitial|.
+    ServerConnection connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    REQUIRE(log.WaitForConnects(1));
+    connection.Close();
+    connection = responder.Accept();
+    REQUIRE(connection.IsValid());
+    REQUIRE(log.WaitForConnects(2));
+
+    const std::vector<Clock::time_point>& times = responder.AcceptTimes();
+    REQUIRE(times.size() == 7);
+    const auto gap = [&](size_t i) { return times[i + 1] - times[i]; };
+    CHECK(gap(0) >= kInitial);
+    CHECK(gap(1) >= 2 * kInitial);
+    CHECK(gap(2) >= kMax);
+    CHECK(gap(3) >= kMax);
+    CHECK(gap(4) >= kMax);
+    // Capped rather than still doubling.
+    CHECK(gap(4) < 2 * kMax);
+    CHECK(gap(5) >= kInitial);
+    CHECK(gap(5) < kMax);
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        CHECK(!log.connects[0]);
+        CHECK(log.connects[1]);
+    }
+}
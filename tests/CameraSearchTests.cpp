@@ -0,0 +1,267 @@
+#include "TestHarness.h"
+
+#include "CameraCatalog.h"
+#include "CameraSearch.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+constexpr size_t kCameraCount = 10000;
+
+class Lcg
+{
+public:
+    uint32_t Next()
+    {
+        state_ = state_ * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<uint32_t>(state_ >> 33);
+    }
+
+    uint32_t Below(uint32_t bound) { return Next() % bound; }
+
+private:
+    uint64_t state_ = 0x13198A2E03707344ull;
+};
+
+std::string LowerAscii(std::string_view text)
+{
+    std::string lowered(text);
+    for (char& c : lowered)
+    {
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+    }
+    return lowered;
+}
+
+// A row's displayed name, ID and state, lowercased once for the scans.
+struct LoweredRow
+{
+    std::string name;
+    std::string id;
+    std::string state;
+};
+
+std::vector<LoweredRow> LowerRows(const CameraCatalogSnapshot& snapshot)
+{
+    std::vector<LoweredRow> rows;
+    for (const CameraRecord& camera : snapshot.Cameras())
+        rows.push_back({ LowerAscii(camera.name.empty() ? camera.id : camera.name), LowerAscii(camera.id),
+            LowerAscii(camera.state) });
+    return rows;
+}
+
+// What Search() promises, checked one row and one field at a time: rows
+// whose displayed name starts with the query, then the other matches, each
+// group in list order.
+std::vector<uint32_t> BruteForceSearch(const std::vector<LoweredRow>& rows, std::string_view query)
+{
+    const std::string lowered = LowerAscii(query);
+    std::vector<uint32_t> prefixed;
+    std::vector<uint32_t> others;
+    for (uint32_t row = 0; row < rows.size(); ++row)
+    {
+        const LoweredRow& camera = rows[row];
+        if (camera.name.starts_with(lowered))
+            prefixed.push_back(row);
+        else if (camera.name.find(lowered) != std::string::npos || camera.id.find(lowered) != std::string::npos ||
+            camera.state.find(lowered) != std::string::npos)
+        {
+            others.push_back(row);
+        }
+    }
+    prefixed.insert(prefixed.end(), others.begin(), others.end());
+    return prefixed;
+}
+
+std::string MakeId(uint32_t value)
+{
+    char id[32] = {};
+    snprintf(id, sizeof(id), "65a1%08x%012x", value * 2654435761u, value);
+    return id;
+}
+
+std::vector<CameraInfo> MakeCameras(Lcg& random, size_t count)
+{
+    static constexpr const char* kWords[] = { "North", "SOUTH", "gate", "Lobby", "Dock", "PTZ", "Parking",
+        "Caf\xC3\xA9", "\xE5\x8C\x97\xE9\x97\xA8", "Stra\xC3\x9F" "e", "\xC3\x89" "cole", "Loading", "roof",
+        "\xF0\x9F\x93\xB7", "Yard", "West", "eAST" };
+    static constexpr const char* kStates[] = { "CONNECTED", "DISCONNECTED", "Updating", "" };
+    constexpr size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+    std::vector<CameraInfo> cameras;
+    cameras.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        CameraInfo camera;
+        camera.id = MakeId(i);
+        // Some cameras have no name, so their ID is shown instead.
+        if (random.Below(20) != 0)
+        {
+            const uint32_t words = 1 + random.Below(3);
+            for (uint32_t w = 0; w < words; ++w)
+            {
+                if (w > 0)
+                    camera.name += ' ';
+                camera.name += kWords[random.Below(kWordCount)];
+            }
+            camera.name += ' ' + std::to_string(random.Below(200));
+        }
+        camera.state = kStates[random.Below(4)];
+        cameras.push_back(std::move(camera));
+    }
+    return cameras;
+}
+
+// Every one- and two-character query over a small alphabet, then substrings
+// of real rows in random case, then some that match nothing.
+std::vector<std::string> MakeQueries(Lcg& random, const CameraCatalogSnapshot& snapshot)
+{
+    static constexpr std::string_view kAlphabet = "aegnNtT0159 \xC3";
+    std::vector<std::string> queries = { "" };
+    for (const char first : kAlphabet)
+    {
+        queries.push_back(std::string(1, first));
+        for (const char second : kAlphabet)
+            queries.push_back(std::string{ first, second });
+    }
+
+    const auto& cameras = snapshot.Cameras();
+    for (int i = 0; i < 300; ++i)
+    {
+        const CameraRecord& camera = cameras[random.Below(static_cast<uint32_t>(cameras.size()))];
+        const std::string_view field = random.Below(4) == 0 ? camera.id : camera.name;
+        if (field.size() < 3)
+            continue;
+        const size_t length = 3 + random.Below(static_cast<uint32_t>(std::min<size_t>(field.size() - 2, 10)));
+        const size_t start = random.Below(static_cast<uint32_t>(field.size() - length + 1));
+        std::string query(field.substr(start, length));
+        for (char& c : query)
+        {
+            if (random.Below(2) == 0 && c >= 'a' && c <= 'z')
+                c = static_cast<char>(c - 'a' + 'A');
+        }
+        queries.push_back(std::move(query));
+    }
+
+    for (const char* missing : { "zzz", "gate 999", "north gate south gate", "\xC3\xA9\xC3\xA9", "qx" })
+        queries.push_back(missing);
+    return queries;
+}
+
+void CheckAgainstBruteForce(CameraSearchIndex& index, const std::vector<std::string>& queries)
+{
+    const std::vector<LoweredRow> rows = LowerRows(*index.Cameras());
+    for (const std::string& query : queries)
+    {
+        const std::vector<uint32_t> expected = BruteForceSearch(rows, query);
+        const std::vector<uint32_t>& actual = index.Search(query);
+        if (actual != expected)
+            ReportTestFailure(__FILE__, __LINE__, "Search(\"" + query + "\") matches brute force");
+        CHECK(&index.Results() == &actual);
+    }
+}
+}
+
+TEST_CASE(SearchMatchesBruteForce)
+{
+    Lcg random;
+    CameraCatalog catalog;
+    const auto snapshot = catalog.BuildSnapshot(MakeCameras(random, kCameraCount));
+    CameraSearchIndex index;
+    index.Build(snapshot);
+    REQUIRE(index.Cameras() == snapshot);
+
+    CheckAgainstBruteForce(index, MakeQueries(random, *snapshot));
+}
+
+TEST_CASE(SearchTypedQueriesMatchBruteForce)
+{
+    // Typing and deleting a character at a time takes the path that only
+    // rechecks the previous results.
+    Lcg random;
+    CameraCatalog catalog;
+    const auto snapshot = catalog.BuildSnapshot(MakeCameras(random, kCameraCount));
+    CameraSearchIndex index;
+    index.Build(snapshot);
+
+    std::vector<std::string> typed;
+    for (const std::string_view text : { std::string_view("North Gate 12"), std::string_view("caf\xC3\xA9 L"),
+             std::string_view("65A1"), std::string_view("DISCON") })
+    {
+        for (size_t length = 0; length <= text.size(); ++length)
+            typed.emplace_back(text.substr(0, length));
+        for (size_t length = text.size(); length-- > 0;)
+            typed.emplace_back(text.substr(0, length));
+    }
+    CheckAgainstBruteForce(index, typed);
+}
+
+TEST_CASE(SearchFoldsAsciiCaseOnly)
+{
+    CameraCatalog catalog;
+    const auto snapshot = catalog.BuildSnapshot({
+        { "id-1", "Caf\xC3\xA9 North", "CONNECTED" },
+        { "id-2", "CAF\xC3\x89 south", "connected" },
+        { "id-3", "", "Offline" },
+        { "id-4", "\xE5\x8C\x97\xE9\x97\xA8 Gate", "" },
+    });
+    CameraSearchIndex index;
+    index.Build(snapshot);
+
+    CHECK_EQ(index.Search("CAF"), (std::vector<uint32_t>{ 0, 1 }));
+    // The accented letters are bytes, not folded.
+    CHECK_EQ(index.Search("caf\xC3\xA9"), (std::vector<uint32_t>{ 0 }));
+    CHECK_EQ(index.Search("CAF\xC3\x89"), (std::vector<uint32_t>{ 1 }));
+    CHECK_EQ(index.Search("\xE9\x97\xA8 g"), (std::vector<uint32_t>{ 3 }));
+    // A missing name is searched, and ordered, as the ID.
+    CHECK_EQ(index.Search("ID-"), (std::vector<uint32_t>{ 2, 0, 1, 3 }));
+    CHECK_EQ(index.Search("Connected"), (std::vector<uint32_t>{ 0, 1 }));
+    CHECK_EQ(index.Search("o"), (std::vector<uint32_t>{ 0, 1, 2 }));
+    // Runs across fields are not text the list shows.
+    CHECK(index.Search("northid").empty());
+    CHECK(index.Search("\n").empty());
+    CHECK(index.Search("h\ni").empty());
+}
+
+TEST_CASE(SearchAfterRemovals)
+{
+    Lcg random;
+    CameraCatalog catalog;
+    std::shared_ptr<const CameraCatalogSnapshot> snapshot = catalog.BuildSnapshot(MakeCameras(random, kCameraCount));
+    CameraSearchIndex index;
+    index.Build(snapshot);
+    const std::vector<std::string> queries = MakeQueries(random, *snapshot);
+    // Leave results from the full list behind.
+    index.Search("gat");
+
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            const auto& cameras = snapshot->Cameras();
+            const CameraHandle handle = cameras[random.Below(static_cast<uint32_t>(cameras.size()))].handle;
+            snapshot = catalog.WithoutCamera(*snapshot, handle);
+        }
+        index.Build(snapshot);
+        REQUIRE(snapshot->Cameras().size() == kCameraCount - 500 * (round + 1));
+        CheckAgainstBruteForce(index, queries);
+    }
+
+    // Every camera removed.
+    while (!snapshot->Cameras().empty())
+        snapshot = catalog.WithoutCamera(*snapshot, snapshot->Cameras().front().handle);
+    index.Build(snapshot);
+    CHECK(index.Search("").empty());
+    CHECK(index.Search("gate").empty());
+
+    index.Build(nullptr);
+    CHECK(index.Cameras() == nullptr);
+    CHECK(index.Search("g").empty());
+}
@@ -0,0 +1,127 @@
+#include "TestHarness.h"
+
+#include "CircuitBreaker.h"
+
+#include <chrono>
+
+namespace {
+using Clock = CircuitBreaker::Clock;
+using std::chrono::milliseconds;
+
+const Clock::time_point kStart = Clock::time_point() + std::chrono::hours(1);
+
+// Fails an admitted request and returns how long until the next probe.
+milliseconds OpenAndMeasure(CircuitBreaker& breaker, Clock::time_point now)
+{
+    breaker.RecordFailure(now, true);
+    return std::chrono::duration_cast<milliseconds>(breaker.NextProbe() - now);
+}
+}
+
+TEST_CASE(CircuitBreakerOpensAfterThreeFailures)
+{
+    CircuitBreaker breaker(1);
+    CHECK(breaker.GetState() == CircuitBreaker::State::Closed);
+    CHECK(!breaker.RecordFailure(kStart, false));
+    CHECK(!breaker.RecordFailure(kStart, false));
+    CHECK(breaker.Admit(kStart));
+    CHECK(breaker.RecordFailure(kStart, false));
+    CHECK(breaker.GetState() == CircuitBreaker::State::Open);
+    CHECK_EQ(breaker.Failures(), 3u);
+    CHECK(!breaker.WouldAdmit(kStart));
+    CHECK(!breaker.Admit(kStart));
+
+    // Failures from requests already in flight change nothing more.
+    CHECK(!breaker.RecordFailure(kStart, false));
+    CHECK(breaker.GetState() == CircuitBreaker::State::Open);
+
+    // A success in between starts the count again.
+    CircuitBreaker counted(1);
+    counted.RecordFailure(kStart, false);
+    counted.RecordFailure(kStart, false);
+    CHECK(!counted.RecordSuccess());
+    CHECK(!counted.RecordFailure(kStart, false));
+    CHECK(counted.GetState() == CircuitBreaker::State::Closed);
+}
+
+TEST_CASE(CircuitBreakerOpensAtOnceOnRejectedLogin)
+{
+    CircuitBreaker breaker(2);
+    CHECK(breaker.RecordFailure(kStart, true));
+    CHECK(breaker.GetState() == CircuitBreaker::State::Open);
+    CHECK_EQ(breaker.Failures(), 1u);
+    CHECK(!breaker.WouldAdmit(kStart));
+}
+
+TEST_CASE(CircuitBreakerHalfOpenAdmitsOneProbe)
+{
+    CircuitBreaker breaker(3);
+    breaker.RecordFailure(kStart, true);
+    const Clock::time_point probe = breaker.NextProbe();
+    CHECK(!breaker.Admit(probe - milliseconds(1)));
+
+    CHECK(breaker.Admit(probe));
+    CHECK(breaker.GetState() == CircuitBreaker::State::HalfOpen);
+    // Everything else waits on the probe's answer, however late.
+    CHECK(!breaker.WouldAdmit(probe + std::chrono::hours(1)));
+    CHECK(!breaker.Admit(probe + std::chrono::hours(1)));
+
+    // Success closes it and resets the backoff.
+    CHECK(breaker.RecordSuccess());
+    CHECK(breaker.GetState() == CircuitBreaker::State::Closed);
+    CHECK_EQ(breaker.Failures(), 0u);
+    CHECK(breaker.Admit(probe));
+    CHECK(OpenAndMeasure(breaker, probe) <= milliseconds(1000));
+
+    // A failed probe reopens it.
+    CHECK(breaker.Admit(breaker.NextProbe()));
+    CHECK(breaker.RecordFailure(breaker.NextProbe(), false));
+    CHECK(breaker.GetState() == CircuitBreaker::State::Open);
+}
+
+TEST_CASE(CircuitBreakerAbandonedProbeReopens)
+{
+    CircuitBreaker breaker(4);
+    breaker.RecordFailure(kStart, true);
+    const Clock::time_point probe = breaker.NextProbe();
+    REQUIRE(breaker.Admit(probe));
+    breaker.RecordAbandoned();
+    CHECK(breaker.GetState() == CircuitBreaker::State::Open);
+    // The backoff has already passed, so the next request is the probe.
+    CHECK(breaker.Admit(probe));
+    CHECK(breaker.GetState() == CircuitBreaker::State::HalfOpen);
+
+    // Abandoning outside half-open changes nothing.
+    CircuitBreaker closed(4);
+    closed.RecordAbandoned();
+    CHECK(closed.GetState() == CircuitBreaker::State::Closed);
+}
+
+TEST_CASE(CircuitBreakerBackoffDoublesToCapWithJitter)
+{
+    // Each probe failure doubles the backoff up to 60 s; the wait drawn
+    // from it lies within [backoff / 2, backoff].
+    const milliseconds expected[] = { milliseconds(1000), milliseconds(2000), milliseconds(4000),
+        milliseconds(8000), milliseconds(16000), milliseconds(32000), milliseconds(60000), milliseconds(60000) };
+    for (unsigned seed = 0; seed < 200; ++seed)
+    {
+        CircuitBreaker breaker(seed);
+        Clock::time_point now = kStart;
+        for (const milliseconds backoff : expected)
+        {
+            const milliseconds wait = OpenAndMeasure(breaker, now);
+            CHECK(wait >= backoff / 2);
+            CHECK(wait <= backoff);
+            now = breaker.NextProbe();
+            REQUIRE(breaker.Admit(now));
+        }
+    }
+
+    // Reset forgets the backoff and the pending probe.
+    CircuitBreaker breaker(5);
+    OpenAndMeasure(breaker, kStart);
+    breaker.Reset();
+    CHECK(breaker.GetState() == CircuitBreaker::State::Closed);
+    CHECK(breaker.NextProbe() == Clock::time_point());
+    CHECK(OpenAndMeasure(breaker, kStart) <= milliseconds(1000));
+}
@@ -0,0 +1,127 @@
+#include "TestHarness.h"
+#include "TempDirectory.h"
+
+#include "DeviceWatcher.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr auto kEventTimeout = std::chrono::seconds(5);
+
+// Collects the changes the watcher thread reports.
+class ChangeLog
+{
+public:
+    DeviceChangeCallback Callback()
+    {
+        return [this](DeviceChange change)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            changes_.push_back(change);
+            changed_.notify_all();
+        };
+    }
+
+    // Waits for |change|, then checks that nothing else was reported before
+    // it; a burst may be reported as more than one change of a kind.
+    bool WaitForOnly(DeviceChange change)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_t seen = 0;
+        const bool found = changed_.wait_for(lock, kEventTimeout, [&]
+        {
+            for (; seen < changes_.size(); ++seen)
+            {
+                if (changes_[seen] == change)
+                    return true;
+            }
+            return false;
+        });
+        if (!found)
+            return false;
+
+        const bool onlyChange = seen == 0 || std::all_of(changes_.begin(), changes_.begin() + seen,
+            [&](DeviceChange other) { return other == change; });
+        changes_.erase(changes_.begin(), changes_.begin() + seen + 1);
+        return onlyChange;
+    }
+
+    size_t Pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return changes_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<DeviceChange> changes_;
+};
+}
+
+TEST_CASE(DeviceWatcherMissingDirectory)
+{
+    TempDirectory directory;
+    REQUIRE(directory.IsValid());
+    ChangeLog log;
+    CHECK(!StartDeviceWatcher(log.Callback(), (directory.Path() + "/missing").c_str()));
+    // Stopping a watcher that never started is harmless.
+    StopDeviceWatcher();
+}
+
+TEST_CASE(DeviceWatcherReportsJoystickNodes)
+{
+    TempDirectory directory;
+    REQUIRE(directory.IsValid());
+    ChangeLog log;
+    REQUIRE(StartDeviceWatcher(log.Callback(), directory.Path().c_str()));
+
+    // Other input nodes are ignored; the js node after them is the marker.
+    REQUIRE(directory.WriteFile("mouse0", ""));
+    REQUIRE(directory.WriteFile("js0", ""));
+    CHECK(log.WaitForOnly(DeviceChange::Arrival));
+
+    // udev fixing the node's permissions is reported as an arrival too.
+    REQUIRE(directory.WriteFile("event4", ""));
+    CHECK(log.WaitForOnly(DeviceChange::Arrival));
+    REQUIRE(chmod((directory.Path() + "/event4").c_str(), 0660) == 0);
+    CHECK(log.WaitForOnly(DeviceChange::Arrival));
+
+    REQUIRE(unlink((directory.Path() + "/mouse0").c_str()) == 0);
+    REQUIRE(unlink((directory.Path() + "/event4").c_str()) == 0);
+    CHECK(log.WaitForOnly(DeviceChange::Removal));
+
+    StopDeviceWatcher();
+    CHECK_EQ(log.Pending(), 0u);
+}
+
+TEST_CASE(DeviceWatcherStopsAndRestarts)
+{
+    TempDirectory first;
+    TempDirectory second;
+    REQUIRE(first.IsValid() && second.IsValid());
+    ChangeLog log;
+    REQUIRE(StartDeviceWatcher(log.Callback(), first.Path().c_str()));
+    // A second start while running keeps the first watch.
+    CHECK(StartDeviceWatcher(log.Callback(), second.Path().c_str()));
+    StopDeviceWatcher();
+    StopDeviceWatcher();
+
+    // Nothing is reported once stopped.
+    REQUIRE(first.WriteFile("js1", ""));
+    usleep(50 * 1000);
+    CHECK_EQ(log.Pending(), 0u);
+
+    REQUIRE(StartDeviceWatcher(log.Callback(), second.Path().c_str()));
+    REQUIRE(second.WriteFile("event0", ""));
+    CHECK(log.WaitForOnly(DeviceChange::Arrival));
+    StopDeviceWatcher();
+}
@@ -0,0 +1,179 @@
+#include "TestHarness.h"
+
+#include "FlightDumpReader.h"
+#include "FlightRecorder.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace {
+constexpr size_t kTextBytes = sizeof(FlightRecord::text);
+
+// Collects a dump in memory, as the app's file writer would on disk.
+struct MemoryDump
+{
+    std::string bytes;
+    // Run from inside the writer, while the dump is under way.
+    bool nestedResult = true;
+    bool tryNested = false;
+};
+
+bool WriteToMemory(const void* data, size_t size, void* context)
+{
+    auto* dump = static_cast<MemoryDump*>(context);
+    if (dump->tryNested)
+    {
+        dump->tryNested = false;
+        MemoryDump nested;
+        dump->nestedResult = WriteFlightDump("Nested", WriteToMemory, &nested);
+    }
+    dump->bytes.append(static_cast<const char*>(data), size);
+    return true;
+}
+
+bool RefuseWrite(const void*, size_t, void*)
+{
+    return false;
+}
+
+FlightDump DumpAndParse(const char* reason)
+{
+    MemoryDump memory;
+    REQUIRE(WriteFlightDump(reason, WriteToMemory, &memory));
+    FlightDump dump;
+    std::string error;
+    REQUIRE(ParseFlightDump(memory.bytes, &dump, &error));
+    return dump;
+}
+
+// Fills the ring, so a dump holds only what this test records next.
+void FillRing()
+{
+    for (uint32_t i = 0; i < kFlightRecordCount; ++i)
+        RecordFlightEvent(FlightEventType::None);
+}
+
+std::string_view Text(const FlightRecord& record)
+{
+    return std::string_view(record.text, record.textLength);
+}
+
+int64_t UnixNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+}
+
+TEST_CASE(FlightDumpRoundTripsEachEventType)
+{
+    FillRing();
+    RecordFlightEvent(FlightEventType::StateSubmitted, "cam-1", 250, -500, 1000);
+    RecordFlightEvent(FlightEventType::StopSubmitted);
+    RecordFlightEvent(FlightEventType::Request, "POST /api/move", 200, 0, 1500);
+    RecordFlightEvent(FlightEventType::Status, std::wstring(L"Connected"));
+    RecordFlightEvent(FlightEventType::Error, "Login failed", 5);
+    const int64_t before = UnixNowMs();
+    const FlightDump dump = DumpAndParse("Round trip");
+
+    const FlightDumpHeader& header = dump.header;
+    CHECK(memcmp(header.magic, kFlightDumpMagic, sizeof(header.magic)) == 0);
+    CHECK_EQ(header.version, kFlightDumpVersion);
+    CHECK_EQ(header.recordSize, static_cast<uint32_t>(sizeof(FlightRecord)));
+    CHECK_EQ(header.recordCount, kFlightRecordCount);
+    CHECK_EQ(std::string(header.reason), std::string("Round trip"));
+    CHECK(header.dumpUnixMs >= before && header.dumpUnixMs <= UnixNowMs());
+
+    REQUIRE(dump.records.size() == kFlightRecordCount);
+    CHECK_EQ(header.written, dump.records.back().sequence);
+    const FlightRecord* last = &dump.records[dump.records.size() - 5];
+    CHECK_EQ(last[0].type, static_cast<uint16_t>(FlightEventType::StateSubmitted));
+    CHECK_EQ(Text(last[0]), std::string_view("cam-1"));
+    CHECK(last[0].values[0] == 250 && last[0].values[1] == -500 && last[0].values[2] == 1000);
+    CHECK_EQ(last[1].type, static_cast<uint16_t>(FlightEventType::StopSubmitted));
+    CHECK_EQ(last[1].textLength, 0);
+    CHECK_EQ(last[2].type, static_cast<uint16_t>(FlightEventType::Request));
+    CHECK_EQ(Text(last[2]), std::string_view("POST /api/move"));
+    CHECK_EQ(last[3].type, static_cast<uint16_t>(FlightEventType::Status));
+    CHECK_EQ(Text(last[3]), std::string_view("Connected"));
+    CHECK_EQ(last[4].type, static_cast<uint16_t>(FlightEventType::Error));
+    CHECK_EQ(last[4].values[0], 5);
+    for (int i = 1; i < 5; ++i)
+        CHECK(last[i].timeNs >= last[i - 1].timeNs && last[i].thread == last[0].thread);
+
+    const std::string text = FormatFlightDump(dump);
+    CHECK(text.find(": Round trip\n") != std::string::npos);
+    CHECK(text.find("8192 of " + std::to_string(header.written) + " records kept\n") != std::string::npos);
+    CHECK(text.find("state    x=0.250 y=-0.500 z=1.000 camera=cam-1\n") != std::string::npos);
+    CHECK(text.find("stop     camera=(selected)\n") != std::string::npos);
+    CHECK(text.find("request  http=200 error=0 1.5 ms POST /api/move\n") != std::string::npos);
+    CHECK(text.find("status   Connected\n") != std::string::npos);
+    CHECK(text.find("error    code=5 Login failed\n") != std::string::npos);
+}
+
+TEST_CASE(FlightDumpKeepsNewestAfterWrap)
+{
+    constexpr int32_t kRecorded = 2 * kFlightRecordCount + 37;
+    for (int32_t i = 0; i < kRecorded; ++i)
+        RecordFlightEvent(FlightEventType::Request, "GET /", i);
+    const FlightDump dump = DumpAndParse("Wrapped");
+
+    REQUIRE(dump.records.size() == kFlightRecordCount);
+    CHECK_EQ(dump.records.back().sequence, dump.header.written);
+    bool inOrder = true;
+    for (uint32_t i = 0; i < kFlightRecordCount; ++i)
+    {
+        const FlightRecord& record = dump.records[i];
+        if (record.sequence != dump.header.written - kFlightRecordCount + 1 + i ||
+            record.values[0] != kRecorded - static_cast<int32_t>(kFlightRecordCount) + static_cast<int32_t>(i))
+        {
+            inOrder = false;
+        }
+    }
+    CHECK(inOrder);
+}
+
+TEST_CASE(FlightTextIsCut)
+{
+    FillRing();
+    const std::string longText(200, 'n');
+    RecordFlightEvent(FlightEventType::Status, longText);
+    RecordFlightEvent(FlightEventType::Status, std::string(kTextBytes, 'e'));
+    RecordFlightEvent(FlightEventType::Status, std::wstring(200, L'w'));
+    // Two bytes that would straddle the end: the wide form keeps it whole.
+    RecordFlightEvent(FlightEventType::Status, std::wstring(kTextBytes - 1, L'a') + L"é");
+    const FlightDump dump = DumpAndParse("Text");
+
+    REQUIRE(dump.records.size() == kFlightRecordCount);
+    const FlightRecord* last = &dump.records[dump.records.size() - 4];
+    CHECK_EQ(Text(last[0]), std::string_view(longText).substr(0, kTextBytes));
+    CHECK_EQ(Text(last[1]), std::string(kTextBytes, 'e'));
+    CHECK_EQ(Text(last[2]), std::string(kTextBytes, 'w'));
+    CHECK_EQ(Text(last[3]), std::string(kTextBytes - 1, 'a'));
+}
+
+TEST_CASE(FlightDumpRunsOneAtATime)
+{
+    MemoryDump memory;
+    memory.tryNested = true;
+    CHECK(WriteFlightDump("Outer", WriteToMemory, &memory));
+    CHECK(!memory.nestedResult);
+    CHECK_EQ(memory.bytes.size(), sizeof(FlightDumpHeader) + kFlightRecordCount * sizeof(FlightRecord));
+
+    // Neither a refused dump nor a failed writer leaves it held.
+    CHECK(!WriteFlightDump("Refused", RefuseWrite, nullptr));
+    MemoryDump after;
+    CHECK(WriteFlightDump("After", WriteToMemory, &after));
+
+    FlightDump dump;
+    std::string error;
+    CHECK(!ParseFlightDump(std::string_view(after.bytes).substr(0, 100), &dump, &error));
+    CHECK_EQ(error, std::string("too short for a flight recorder dump"));
+    CHECK(!ParseFlightDump(std::string_view(after.bytes).substr(0, after.bytes.size() - 1), &dump, &error));
+    CHECK_EQ(error, std::string("truncated"));
+    after.bytes[0] = 'X';
+    CHECK(!ParseFlightDump(after.bytes, &dump, &error));
+}
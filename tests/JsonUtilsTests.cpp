@@ -0,0 +1,332 @@
+#include "TestHarness.h"
+
+#include "JsonUtils.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using JsonUtils::JsonKind;
+using JsonUtils::JsonPathQuery;
+using JsonUtils::JsonValue;
+
+namespace {
+// Trimmed from the controller's GET /v1/cameras: settings objects, arrays
+// and nulls on either side of the fields the app reads.
+constexpr std::string_view kCameraList = R"([
+  {
+    "id": "65a1f0c2000b",
+    "modelKey": "camera",
+    "state": "CONNECTED",
+    "name": "Lobby \"North\" \u00e9",
+    "osdSettings": { "isNameEnabled": true, "overlayLocation": "topLeft" },
+    "lcdMessage": { "type": "LEAVE_PACKAGE_AT_DOOR", "resetAt": null, "text": "{\"id\":\"decoy\"}" },
+    "featureFlags": { "smartDetectTypes": ["person", "vehicle"], "videoModes": [["default"]] },
+    "ptz": { "returnHomeAfterInactivityMs": 30000 }
+  },
+  {
+    "name": "Dock",
+    "id": "65a1f0c2000c",
+    "state": "DISCONNECTED",
+    "ptz": { "returnHomeAfterInactivityMs": null }
+  },
+  { "modelKey": "camera", "name": "No id" },
+  "not a camera",
+  {
+    "id": "65a1f0c2000d",
+    "ptz": { "presets": [] }
+  }
+])";
+
+std::vector<JsonValue> Extract(const JsonPathQuery& query, std::string_view body, bool* ok = nullptr)
+{
+    std::vector<JsonValue> values(query.Size());
+    const bool extracted = query.Extract(body, values);
+    if (ok)
+        *ok = extracted;
+    return values;
+}
+
+JsonValue Value(JsonKind kind, std::string_view text, bool hasEscapes = false)
+{
+    JsonValue value;
+    value.kind = kind;
+    value.text = text;
+    value.hasEscapes = hasEscapes;
+    return value;
+}
+
+bool ReturnHome(std::string_view body, bool* disabled)
+{
+    *disabled = false;
+    return JsonUtils::TryParseReturnHomeDisabled(body, disabled);
+}
+}
+
+TEST_CASE(JsonPathQueryFindsEachKind)
+{
+    const JsonPathQuery query{ "/s", "/n", "/f", "/e", "/t", "/z", "/o", "/a", "/missing", "/o/deep/x" };
+    CHECK_EQ(query.Size(), 10u);
+    bool ok = false;
+    const std::vector<JsonValue> values = Extract(query,
+        R"({"s":"text","n":-42,"f":1.5,"e":1e3,"t":true,"z":null,"o":{"deep":{"x":7}},"a":[1,{"b":2}]})", &ok);
+    REQUIRE(ok);
+    CHECK(values[0].kind == JsonKind::String);
+    CHECK_EQ(values[0].text, std::string_view("text"));
+    CHECK(values[1].kind == JsonKind::Number);
+    CHECK_EQ(values[1].text, std::string_view("-42"));
+    CHECK_EQ(values[2].text, std::string_view("1.5"));
+    CHECK_EQ(values[3].text, std::string_view("1e3"));
+    CHECK(values[4].kind == JsonKind::Bool);
+    CHECK(values[5].kind == JsonKind::Null);
+    // A container on a path is walked, and still spans its whole text.
+    CHECK(values[6].kind == JsonKind::Object);
+    CHECK_EQ(values[6].text, std::string_view(R"({"deep":{"x":7}})"));
+    CHECK(values[7].kind == JsonKind::Array);
+    CHECK_EQ(values[7].text, std::string_view(R"([1,{"b":2}])"));
+    CHECK(values[8].kind == JsonKind::Missing);
+    CHECK_EQ(values[9].text, std::string_view("7"));
+}
+
+TEST_CASE(JsonPathQueryHashesManyKeys)
+{
+    // Enough keys at one level that the perfect hash has to search seeds;
+    // each must still land on its own value, and near misses on none.
+    std::vector<std::string> keys;
+    std::string body = "{";
+    for (int i = 0; i < 40; ++i)
+    {
+        keys.push_back("key" + std::to_string(i));
+        body += (i ? ",\"" : "\"") + keys.back() + "\":" + std::to_string(i);
+        body += ",\"key" + std::to_string(i) + "x\":-1";
+    }
+    body += "}";
+
+    const JsonPathQuery query{ "/key0", "/key7", "/key13", "/key21", "/key22", "/key30", "/key39", "/key4" };
+    const std::vector<JsonValue> values = Extract(query, body);
+    const char* const expected[] = { "0", "7", "13", "21", "22", "30", "39", "4" };
+    for (size_t i = 0; i < values.size(); ++i)
+        CHECK_EQ(values[i].text, std::string_view(expected[i]));
+}
+
+TEST_CASE(JsonPathQueryArrayIndicesAndPointerEscapes)
+{
+    const JsonPathQuery query{ "/items/0/id", "/items/2/id", "/items/10", "/a~1b", "/m~0n", "/items/1" };
+    const std::vector<JsonValue> values = Extract(query,
+        R"({"items":[{"id":"first"},"skip",{"id":"third"},3,4,5,6,7,8,9,"tenth"],"a/b":1,"m~n":2})");
+    CHECK_EQ(values[0].text, std::string_view("first"));
+    CHECK_EQ(values[1].text, std::string_view("third"));
+    CHECK_EQ(values[2].text, std::string_view("tenth"));
+    CHECK_EQ(values[3].text, std::string_view("1"));
+    CHECK_EQ(values[4].text, std::string_view("2"));
+    CHECK(values[5].kind == JsonKind::String);
+
+    // Past the end of the array, and an index into an object.
+    const JsonPathQuery absent{ "/items/5", "/o/0" };
+    const std::vector<JsonValue> none = Extract(absent, R"({"items":[1,2],"o":{"0":1}})");
+    CHECK(none[0].kind == JsonKind::Missing);
+    CHECK_EQ(none[1].text, std::string_view("1"));
+}
+
+TEST_CASE(JsonPathQuerySkipsStringsAndContainers)
+{
+    // Braces, brackets, quotes and keys inside skipped strings and
+    // containers must not be taken for structure.
+    const JsonPathQuery query{ "/id", "/after" };
+    const std::vector<JsonValue> values = Extract(query,
+        R"({"decoy":"}]\"id\":\"wrong\"","nested":{"id":"wrong","a":[{"id":"wrong"},"]"]},)"
+        R"("id":"right","after":"a\\"})");
+    CHECK_EQ(values[0].text, std::string_view("right"));
+    CHECK_EQ(values[1].text, std::string_view("a\\\\"));
+    CHECK(values[1].hasEscapes);
+
+    // The first occurrence of a duplicated key wins.
+    CHECK_EQ(Extract(query, R"({"id":"one","id":"two"})")[0].text, std::string_view("one"));
+}
+
+TEST_CASE(JsonPathQueryStopsOnceResolved)
+{
+    // Everything after the last wanted value is left unread, so trailing
+    // garbage does not fail the query.
+    const JsonPathQuery query{ "/id" };
+    bool ok = false;
+    const std::vector<JsonValue> values = Extract(query, R"({"id":"x", this is not json)", &ok);
+    CHECK(ok);
+    CHECK_EQ(values[0].text, std::string_view("x"));
+
+    // The offset form walks the whole value to report where it ends.
+    const std::string_view body = R"(  {"id":"x","rest":[1,2,{"a":"]"}]} ,next)";
+    size_t pos = 0;
+    JsonValue value;
+    REQUIRE(query.Extract(body, &pos, std::span<JsonValue>(&value, 1)));
+    CHECK_EQ(value.text, std::string_view("x"));
+    CHECK_EQ(body.substr(pos), std::string_view(" ,next"));
+}
+
+TEST_CASE(JsonPathQueryRejectsMalformedInput)
+{
+    const JsonPathQuery query{ "/a/b" };
+    for (const std::string_view body : {
+        std::string_view(""), std::string_view("   "), std::string_view("{"), std::string_view(R"({"a")"),
+        std::string_view(R"({"a":)"), std::string_view(R"({"a" 1})"), std::string_view(R"({"a":{"b":"open)"),
+        std::string_view(R"({"a":{"c":1 "b":2}})"), std::string_view(R"({a:1})"),
+        std::string_view(R"({"a":[1 2]})"), std::string_view(R"({"x":{"y":[}})") })
+    {
+        bool ok = true;
+        Extract(query, body, &ok);
+        CHECK(!ok);
+    }
+    size_t pos = 0;
+    JsonValue value;
+    CHECK(!query.Extract(R"({"a":{"b":1})", &pos, std::span<JsonValue>(&value, 1)));
+}
+
+TEST_CASE(JsonGetInt64)
+{
+    int64_t value = 0;
+    CHECK(JsonUtils::TryGetInt64(Value(JsonKind::Number, "30000"), &value));
+    CHECK_EQ(value, 30000);
+    CHECK(JsonUtils::TryGetInt64(Value(JsonKind::Number, "-5"), &value));
+    CHECK_EQ(value, -5);
+    // A fractional part or exponent is dropped.
+    CHECK(JsonUtils::TryGetInt64(Value(JsonKind::Number, "1.5"), &value));
+    CHECK_EQ(value, 1);
+    CHECK(JsonUtils::TryGetInt64(Value(JsonKind::Number, "1e3"), &value));
+    CHECK_EQ(value, 1);
+    CHECK(JsonUtils::TryGetInt64(Value(JsonKind::String, "42"), &value));
+    CHECK_EQ(value, 42);
+
+    // Strings must hold the whole number; other kinds never convert.
+    CHECK(!JsonUtils::TryGetInt64(Value(JsonKind::String, "1.5"), &value));
+    CHECK(!JsonUtils::TryGetInt64(Value(JsonKind::String, ""), &value));
+    CHECK(!JsonUtils::TryGetInt64(Value(JsonKind::String, "4\\u0032", true), &value));
+    CHECK(!JsonUtils::TryGetInt64(Value(JsonKind::Number, "99999999999999999999"), &value));
+    CHECK(!JsonUtils::TryGetInt64(Value(JsonKind::Null, "null"), &value));
+    CHECK(!JsonUtils::TryGetInt64(Value(JsonKind::Bool, "true"), &value));
+    CHECK(!JsonUtils::TryGetInt64(JsonValue{}, &value));
+}
+
+TEST_CASE(JsonDecodeString)
+{
+    CHECK_EQ(JsonUtils::DecodeString(Value(JsonKind::String, "plain")), std::string("plain"));
+    CHECK_EQ(JsonUtils::DecodeString(Value(JsonKind::String, R"(a\"b\\c\/d\n\t\r\b\f)", true)),
+        std::string("a\"b\\c/d\n\t\r\b\f"));
+    // One, two and three byte UTF-8, and a surrogate pair to four.
+    CHECK_EQ(JsonUtils::DecodeString(Value(JsonKind::String, R"(A\u00e9\u20AC\ud83d\ude00)", true)),
+        std::string("A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"));
+    // Lone surrogates become U+FFFD; a bad escape becomes '?'.
+    CHECK_EQ(JsonUtils::DecodeString(Value(JsonKind::String, R"(\ud83dx\ude00)", true)),
+        std::string("\xEF\xBF\xBDx\xEF\xBF\xBD"));
+    CHECK_EQ(JsonUtils::DecodeString(Value(JsonKind::String, R"(\u12G4)", true)), std::string("?12G4"));
+    CHECK_EQ(JsonUtils::DecodeString(Value(JsonKind::Number, "12")), std::string());
+}
+
+TEST_CASE(JsonFindMember)
+{
+    const std::string_view body = R"({"label":"returnHomeAfterInactivityMs","a":{"returnHomeAfterInactivityMs":5},)"
+        R"("returnHomeAfterInactivityMs":9})";
+    // The first member in document order, at any depth; a string value
+    // holding the name is not a member.
+    const JsonValue value = JsonUtils::FindMember(body, "returnHomeAfterInactivityMs");
+    CHECK_EQ(value.text, std::string_view("5"));
+    CHECK(JsonUtils::FindMember(body, "missing").kind == JsonKind::Missing);
+    CHECK(JsonUtils::FindMember(R"({"x":)", "x").kind == JsonKind::Missing);
+}
+
+TEST_CASE(JsonReturnHomeDisabled)
+{
+    bool disabled = false;
+    CHECK(ReturnHome(R"({"id":"c","ptz":{"returnHomeAfterInactivityMs":30000}})", &disabled));
+    CHECK(!disabled);
+    CHECK(ReturnHome(R"({"ptz":{"returnHomeAfterInactivityMs":0}})", &disabled));
+    CHECK(disabled);
+    CHECK(ReturnHome(R"({"ptz":{"returnHomeAfterInactivityMs":null}})", &disabled));
+    CHECK(disabled);
+    CHECK(ReturnHome(R"({"ptz":{"returnHomeAfterInactivityMs":NULL}})", &disabled));
+    CHECK(disabled);
+    CHECK(ReturnHome(R"({"ptz":{"returnHomeAfterInactivityMs":"null"}})", &disabled));
+    CHECK(disabled);
+    CHECK(ReturnHome(R"({"ptz":{"returnHomeAfterInactivityMs":"15000"}})", &disabled));
+    CHECK(!disabled);
+    CHECK(ReturnHome(R"({"ptz":{"returnHomeAfterInactivityMs":1.5e4}})", &disabled));
+    CHECK(!disabled);
+
+    // Found wherever it is, as a PATCH echo or another firmware's nesting.
+    CHECK(ReturnHome(R"({"returnHomeAfterInactivityMs":-1})", &disabled));
+    CHECK(disabled);
+    CHECK(ReturnHome(R"({"settings":{"motion":{"returnHomeAfterInactivityMs":null}}})", &disabled));
+    CHECK(disabled);
+
+    // Missing, unreadable, or not JSON at all.
+    CHECK(!ReturnHome(R"({"ptz":{}})", &disabled));
+    CHECK(!ReturnHome(R"({"ptz":{"returnHomeAfterInactivityMs":true}})", &disabled));
+    CHECK(!ReturnHome(R"({"ptz":{"returnHomeAfterInactivityMs":"soon"}})", &disabled));
+    CHECK(!ReturnHome("", &disabled));
+}
+
+TEST_CASE(JsonParseCameraList)
+{
+    std::vector<CameraInfo> cameras = { CameraInfo{ "stale" } };
+    REQUIRE(JsonUtils::TryParseCameraList(kCameraList, &cameras));
+    REQUIRE(cameras.size() == 3);
+
+    CHECK_EQ(cameras[0].id, std::string("65a1f0c2000b"));
+    CHECK_EQ(cameras[0].name, std::string("Lobby \"North\" \xC3\xA9"));
+    CHECK_EQ(cameras[0].state, std::string("CONNECTED"));
+    CHECK(cameras[0].hasReturnHome);
+    CHECK(!cameras[0].returnHomeDisabled);
+
+    // Fields in another order; a null setting disables return-home.
+    CHECK_EQ(cameras[1].name, std::string("Dock"));
+    CHECK_EQ(cameras[1].state, std::string("DISCONNECTED"));
+    CHECK(cameras[1].hasReturnHome);
+    CHECK(cameras[1].returnHomeDisabled);
+
+    // No name falls back to the id; no setting leaves it unknown.
+    CHECK_EQ(cameras[2].name, std::string("65a1f0c2000d"));
+    CHECK(cameras[2].state.empty());
+    CHECK(!cameras[2].hasReturnHome);
+
+    CHECK(JsonUtils::TryParseCameraList(" [ ] ", &cameras));
+    CHECK(cameras.empty());
+    CHECK(!JsonUtils::TryParseCameraList(R"({"id":"65a1f0c2000b"})", &cameras));
+    CHECK(!JsonUtils::TryParseCameraList(R"([{"id":"a"},{"id":"b")", &cameras));
+    CHECK(!JsonUtils::TryParseCameraList(R"([{"id":"a"} {"id":"b"}])", &cameras));
+    CHECK(!JsonUtils::TryParseCameraList("", &cameras));
+}
+
+TEST_CASE(JsonParseDeviceEvent)
+{
+    JsonUtils::DeviceEvent event;
+    REQUIRE(JsonUtils::TryParseDeviceEvent(
+        R"({"type":"update","item":{"modelKey":"camera","id":"65a1f0c2000b","state":"DISCONNECTED"}})", &event));
+    CHECK(event.type == JsonUtils::DeviceEventType::Update);
+    CHECK_EQ(event.modelKey, std::string("camera"));
+    CHECK_EQ(event.camera.id, std::string("65a1f0c2000b"));
+    CHECK(event.hasState);
+    CHECK(!event.hasName);
+    CHECK(!event.camera.hasReturnHome);
+
+    REQUIRE(JsonUtils::TryParseDeviceEvent(
+        R"({"item":{"id":"c","name":"Gate","ptz":{"returnHomeAfterInactivityMs":null}},"type":"add"})", &event));
+    CHECK(event.type == JsonUtils::DeviceEventType::Add);
+    CHECK(event.hasName);
+    CHECK_EQ(event.camera.name, std::string("Gate"));
+    CHECK(event.camera.hasReturnHome);
+    CHECK(event.camera.returnHomeDisabled);
+
+    REQUIRE(JsonUtils::TryParseDeviceEvent(R"({"type":"remove","item":{"id":"c"}})", &event));
+    CHECK(event.type == JsonUtils::DeviceEventType::Remove);
+
+    CHECK(!JsonUtils::TryParseDeviceEvent(R"({"type":"rename","item":{"id":"c"}})", &event));
+    CHECK(!JsonUtils::TryParseDeviceEvent(R"({"type":"add","item":{"name":"x"}})", &event));
+    CHECK(!JsonUtils::TryParseDeviceEvent(R"({"type":null,"item":{"id":"c"}})", &event));
+    CHECK(!JsonUtils::TryParseDeviceEvent("", &event));
+}
+
+TEST_CASE(JsonBuildMovePayload)
+{
+    CHECK_EQ(JsonUtils::BuildMovePayload({ 750.9, -12.5, 0 }),
+        std::string(R"({"type":"continuous","payload":{"x":750,"y":-12,"z":0}})"));
+}
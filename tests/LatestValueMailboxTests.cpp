@@ -0,0 +1,124 @@
+#include "TestHarness.h"
+
+#include "LatestValueMailbox.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace {
+constexpr uint64_t kPublishCount = 2000000;
+constexpr uint64_t kPublishesPerYield = 16;
+
+// Large enough that copying it is not one store; every word holds the same
+// sequence number, so a torn read shows up as a mismatch.
+struct Stamp
+{
+    uint64_t words[16];
+};
+
+Stamp MakeStamp(uint64_t sequence)
+{
+    Stamp stamp;
+    for (uint64_t& word : stamp.words)
+        word = sequence;
+    return stamp;
+}
+
+bool IsWhole(const Stamp& stamp)
+{
+    for (const uint64_t word : stamp.words)
+    {
+        if (word != stamp.words[0])
+            return false;
+    }
+    return true;
+}
+}
+
+TEST_CASE(MailboxNewestValueWins)
+{
+    LatestValueMailbox<int> mailbox;
+    int value = -1;
+    CHECK(!mailbox.HasUpdate());
+    CHECK(!mailbox.Take(&value));
+    CHECK_EQ(value, -1);
+
+    mailbox.Publish(1);
+    mailbox.Publish(2);
+    mailbox.Publish(3);
+    CHECK(mailbox.HasUpdate());
+    REQUIRE(mailbox.Take(&value));
+    CHECK_EQ(value, 3);
+
+    // Taken once only.
+    CHECK(!mailbox.HasUpdate());
+    CHECK(!mailbox.Take(&value));
+    CHECK_EQ(value, 3);
+
+    // Alternating, every value comes through; overwritten ones never do.
+    for (int i = 10; i < 20; ++i)
+    {
+        mailbox.Publish(i);
+        REQUIRE(mailbox.Take(&value));
+        CHECK_EQ(value, i);
+        CHECK(!mailbox.Take(&value));
+    }
+    mailbox.Publish(30);
+    mailbox.Publish(31);
+    REQUIRE(mailbox.Take(&value));
+    CHECK_EQ(value, 31);
+    CHECK(!mailbox.Take(&value));
+}
+
+TEST_CASE(MailboxAcrossThreadsNeverGoesBackOrTears)
+{
+    LatestValueMailbox<Stamp> mailbox;
+    std::atomic<bool> producerDone = false;
+    std::thread producer([&]
+    {
+        for (uint64_t sequence = 1; sequence <= kPublishCount; ++sequence)
+        {
+            mailbox.Publish(MakeStamp(sequence));
+            // Lets the consumer in between publishes on a single core too.
+            if (sequence % kPublishesPerYield == 0)
+                std::this_thread::yield();
+        }
+        producerDone = true;
+    });
+
+    uint64_t last = 0;
+    uint64_t taken = 0;
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+    Stamp stamp;
+    for (;;)
+    {
+        // Checked before Take(), so nothing published is left behind.
+        const bool done = producerDone;
+        if (!mailbox.Take(&stamp))
+        {
+            if (done)
+                break;
+            std::this_thread::yield();
+            continue;
+        }
+        ++taken;
+        if (!IsWhole(stamp))
+            ++torn;
+        // Strictly newer: a value read twice counts as going back.
+        if (stamp.words[0] <= last)
+            ++backwards;
+        else
+            last = stamp.words[0];
+    }
+    producer.join();
+
+    CHECK_EQ(torn, 0u);
+    CHECK_EQ(backwards, 0u);
+    // The last value is never overwritten, so the consumer always gets it.
+    CHECK_EQ(last, kPublishCount);
+    // Most are overwritten, but the consumer must have kept up with some.
+    CHECK(taken > kPublishCount / kPublishesPerYield / 100);
+    CHECK(!mailbox.Take(&stamp));
+}
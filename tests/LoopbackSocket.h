@@ -0,0 +1,199 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Blocking 127.0.0.1 sockets for the Linux tests' local responders. Every
+// read is bounded by a timeout so a broken exchange fails rather than hangs.
+class ScopedSocket
+{
+public:
+    ScopedSocket() = default;
+    explicit ScopedSocket(int fd) : fd_(fd) {}
+    ~ScopedSocket() { Reset(); }
+
+    ScopedSocket(ScopedSocket&& other) noexcept : fd_(other.Release()) {}
+    ScopedSocket& operator=(ScopedSocket&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            fd_ = other.Release();
+        }
+        return *this;
+    }
+    ScopedSocket(const ScopedSocket&) = delete;
+    ScopedSocket& operator=(const ScopedSocket&) = delete;
+
+    bool IsValid() const { return fd_ >= 0; }
+    int Get() const { return fd_; }
+
+    int Release()
+    {
+        const int fd = fd_;
+        fd_ = -1;
+        return fd;
+    }
+
+    void Reset()
+    {
+        if (fd_ >= 0)
+            close(fd_);
+        fd_ = -1;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+inline sockaddr_in MakeLoopbackAddress(uint16_t port)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    return address;
+}
+
+inline uint16_t GetLocalPort(int fd)
+{
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+        return 0;
+    return ntohs(address.sin_port);
+}
+
+// A socket bound to an ephemeral loopback port; listening for TCP.
+inline ScopedSocket BindLoopback(int type, uint16_t* port)
+{
+    ScopedSocket socket(::socket(AF_INET, type | SOCK_CLOEXEC, 0));
+    const sockaddr_in address = MakeLoopbackAddress(0);
+    if (!socket.IsValid() || bind(socket.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        return {};
+    if (type == SOCK_STREAM && listen(socket.Get(), 8) != 0)
+        return {};
+    *port = GetLocalPort(socket.Get());
+    return socket;
+}
+
+inline ScopedSocket ConnectLoopback(uint16_t port)
+{
+    ScopedSocket socket(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    const sockaddr_in address = MakeLoopbackAddress(port);
+    if (!socket.IsValid() || connect(socket.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        return {};
+    const int noDelay = 1;
+    setsockopt(socket.Get(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return socket;
+}
+
+inline bool WaitReadable(int fd, int timeoutMs)
+{
+    pollfd entry = { fd, POLLIN, 0 };
+    return poll(&entry, 1, timeoutMs) == 1;
+}
+
+inline ScopedSocket AcceptWithin(int listener, int timeoutMs)
+{
+    if (!WaitReadable(listener, timeoutMs))
+        return {};
+    ScopedSocket socket(accept4(listener, nullptr, nullptr, SOCK_CLOEXEC));
+    const int noDelay = 1;
+    if (socket.IsValid())
+        setsockopt(socket.Get(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return socket;
+}
+
+inline bool SendAll(int fd, std::string_view data)
+{
+    while (!data.empty())
+    {
+        const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent <= 0)
+            return false;
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+// Appends what arrives within |timeoutMs| to |buffer|; false on timeout,
+// error or the peer closing.
+inline bool ReceiveSome(int fd, std::string* buffer, int timeoutMs)
+{
+    if (!WaitReadable(fd, timeoutMs))
+        return false;
+    char chunk[4096];
+    const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+    if (received <= 0)
+        return false;
+    buffer->append(chunk, static_cast<size_t>(received));
+    return true;
+}
+
+// One HTTP/1.1 message: its start line and headers, and a body of
+// Content-Length bytes. Bytes past the message stay in |buffer|.
+struct HttpMessage
+{
+    std::string head;
+    std::string body;
+
+    // The value of header |name|, matched case-insensitively.
+    std::string Header(std::string_view name) const
+    {
+        size_t lineStart = head.find("\r\n");
+        while (lineStart != std::string::npos && lineStart + 2 < head.size())
+        {
+            lineStart += 2;
+            const size_t lineEnd = head.find("\r\n", lineStart);
+            const std::string_view line(head.data() + lineStart,
+                (lineEnd == std::string::npos ? head.size() : lineEnd) - lineStart);
+            if (line.size() > name.size() && line[name.size()] == ':' &&
+                strncasecmp(line.data(), name.data(), name.size()) == 0)
+            {
+                const size_t value = line.find_first_not_of(' ', name.size() + 1);
+                return value == std::string_view::npos ? std::string() : std::string(line.substr(value));
+            }
+            lineStart = lineEnd;
+        }
+        return {};
+    }
+};
+
+// |receive| appends more bytes to the buffer it is given, or returns false.
+template <typename Receive>
+bool ReadHttpMessage(Receive receive, std::string* buffer, HttpMessage* message)
+{
+    size_t headEnd = 0;
+    while ((headEnd = buffer->find("\r\n\r\n")) == std::string::npos)
+    {
+        if (!receive(buffer))
+            return false;
+    }
+    message->head = buffer->substr(0, headEnd);
+    const std::string length = message->Header("Content-Length");
+    const size_t bodySize = length.empty() ? 0 : strtoul(length.c_str(), nullptr, 10);
+    while (buffer->size() < headEnd + 4 + bodySize)
+    {
+        if (!receive(buffer))
+            return false;
+    }
+    message->body = buffer->substr(headEnd + 4, bodySize);
+    buffer->erase(0, headEnd + 4 + bodySize);
+    return true;
+}
+
+inline bool ReadHttpMessage(int fd, std::string* buffer, HttpMessage* message, int timeoutMs)
+{
+    return ReadHttpMessage([&](std::string* into) { return ReceiveSome(fd, into, timeoutMs); }, buffer, message);
+}
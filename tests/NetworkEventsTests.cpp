@@ -0,0 +1,201 @@
+#include "TestHarness.h"
+
+#include "NetworkEvents.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+using Handles = std::vector<CameraHandle>;
+
+NetworkEvent Status(const std::wstring& text)
+{
+    NetworkEvent event;
+    event.type = NetworkEventType::Status;
+    event.status = std::make_shared<const std::wstring>(text);
+    return event;
+}
+
+NetworkEvent Replaced()
+{
+    NetworkEvent event;
+    event.type = NetworkEventType::CameraListReplaced;
+    return event;
+}
+
+NetworkEvent Patched(Handles changed, Handles removed)
+{
+    NetworkEvent event;
+    event.type = NetworkEventType::CameraListPatched;
+    event.patch = std::make_shared<const CameraListPatch>(CameraListPatch{ std::move(changed), std::move(removed) });
+    return event;
+}
+
+NetworkEvent ReturnHome(bool disabled)
+{
+    NetworkEvent event;
+    event.type = NetworkEventType::ReturnHomeState;
+    event.returnHomeDisabled = disabled;
+    return event;
+}
+
+std::vector<NetworkEventType> Types(const std::vector<NetworkEvent>& events)
+{
+    std::vector<NetworkEventType> types;
+    for (const NetworkEvent& event : events)
+        types.push_back(event.type);
+    return types;
+}
+
+// The patch in a drained batch, which must hold exactly one.
+CameraListPatch OnlyPatch(const std::vector<NetworkEvent>& events)
+{
+    const CameraListPatch* found = nullptr;
+    for (const NetworkEvent& event : events)
+    {
+        if (event.type != NetworkEventType::CameraListPatched)
+            continue;
+        REQUIRE(found == nullptr);
+        found = event.patch.get();
+    }
+    REQUIRE(found != nullptr);
+    return *found;
+}
+}
+
+TEST_CASE(MergedPatchKeepsBothSides)
+{
+    const auto merged = MergeCameraListPatches(CameraListPatch{ { 1, 2 }, { 3 } }, CameraListPatch{ { 2, 4 }, { 5 } });
+    CHECK(merged->changed == (Handles{ 2, 4, 1 }));
+    CHECK(merged->removed == (Handles{ 5, 3 }));
+}
+
+TEST_CASE(MergedPatchTakesTheNewerChange)
+{
+    // Removed, then added back: it is in the list again.
+    const auto readded = MergeCameraListPatches(CameraListPatch{ {}, { 7 } }, CameraListPatch{ { 7 }, {} });
+    CHECK(readded->changed == (Handles{ 7 }));
+    CHECK(readded->removed.empty());
+
+    // Added, then removed: it is gone.
+    const auto dropped = MergeCameraListPatches(CameraListPatch{ { 7 }, {} }, CameraListPatch{ {}, { 7 } });
+    CHECK(dropped->changed.empty());
+    CHECK(dropped->removed == (Handles{ 7 }));
+
+    // Removed twice is listed once.
+    const auto twice = MergeCameraListPatches(CameraListPatch{ {}, { 7 } }, CameraListPatch{ {}, { 7 } });
+    CHECK(twice->removed == (Handles{ 7 }));
+}
+
+TEST_CASE(QueuedPatchesMerge)
+{
+    NetworkEventQueue queue;
+    queue.Push(Patched({ 1 }, {}));
+    queue.Push(Status(L"connected"));
+    queue.Push(Patched({}, { 1 }));
+    queue.Push(Patched({ 1, 2 }, {}));
+
+    std::vector<NetworkEvent> events;
+    REQUIRE(queue.Drain(&events));
+    // The merged patch takes the place of the newest.
+    CHECK(Types(events) == (std::vector<NetworkEventType>{ NetworkEventType::Status, NetworkEventType::CameraListPatched }));
+    const CameraListPatch patch = OnlyPatch(events);
+    CHECK(patch.changed == (Handles{ 1, 2 }));
+    CHECK(patch.removed.empty());
+}
+
+TEST_CASE(QueuedPatchesRemoveThenReadd)
+{
+    NetworkEventQueue queue;
+    queue.Push(Patched({ 3 }, { 8 }));
+    queue.Push(Patched({ 8 }, { 3 }));
+
+    std::vector<NetworkEvent> events;
+    REQUIRE(queue.Drain(&events));
+    const CameraListPatch patch = OnlyPatch(events);
+    CHECK(patch.changed == (Handles{ 8 }));
+    CHECK(patch.removed == (Handles{ 3 }));
+}
+
+TEST_CASE(FullListDropsQueuedPatches)
+{
+    NetworkEventQueue queue;
+    queue.Push(Patched({ 1 }, {}));
+    queue.Push(Replaced());
+
+    std::vector<NetworkEvent> events;
+    REQUIRE(queue.Drain(&events));
+    CHECK(Types(events) == (std::vector<NetworkEventType>{ NetworkEventType::CameraListReplaced }));
+
+    // A patch after the full list is kept, and stays after it.
+    queue.Push(Replaced());
+    queue.Push(Patched({ 2 }, {}));
+    queue.Push(Replaced());
+    queue.Push(Patched({ 4 }, {}));
+    REQUIRE(queue.Drain(&events));
+    CHECK(Types(events) == (std::vector<NetworkEventType>{ NetworkEventType::CameraListReplaced,
+        NetworkEventType::CameraListPatched }));
+    CHECK(OnlyPatch(events).changed == (Handles{ 4 }));
+}
+
+TEST_CASE(QueueHoldsOneEventPerType)
+{
+    NetworkEventQueue queue;
+    queue.Push(Status(L"first"));
+    queue.Push(ReturnHome(true));
+    queue.Push(Status(L"second"));
+    queue.Push(ReturnHome(false));
+
+    std::vector<NetworkEvent> events;
+    REQUIRE(queue.Drain(&events));
+    REQUIRE(events.size() == 2);
+    // The newest of each, in the order they were last pushed.
+    CHECK(events[0].type == NetworkEventType::Status);
+    CHECK(*events[0].status == L"second");
+    CHECK(events[1].type == NetworkEventType::ReturnHomeState);
+    CHECK(!events[1].returnHomeDisabled);
+    CHECK(!queue.Drain(&events));
+}
+
+TEST_CASE(NotifierRunsOncePerBatch)
+{
+    NetworkEventQueue queue;
+    int wakes = 0;
+    queue.SetNotifier([&] { ++wakes; });
+    queue.Push(Status(L"a"));
+    queue.Push(Patched({ 1 }, {}));
+    queue.Push(Replaced());
+    CHECK_EQ(wakes, 1);
+
+    std::vector<NetworkEvent> events;
+    REQUIRE(queue.Drain(&events));
+    queue.Push(Status(L"b"));
+    queue.Push(Status(L"c"));
+    CHECK_EQ(wakes, 2);
+
+    // An empty drain rearms it too.
+    REQUIRE(queue.Drain(&events));
+    CHECK(!queue.Drain(&events));
+    queue.Push(ReturnHome(true));
+    CHECK_EQ(wakes, 3);
+}
+
+TEST_CASE(NotifierSetLateSeesWaitingEvents)
+{
+    NetworkEventQueue queue;
+    queue.Push(Status(L"early"));
+    int wakes = 0;
+    queue.SetNotifier([&] { ++wakes; });
+    CHECK_EQ(wakes, 1);
+    queue.Push(ReturnHome(false));
+    CHECK_EQ(wakes, 1);
+
+    // Nothing waiting: no call until something is pushed.
+    int later = 0;
+    NetworkEventQueue empty;
+    empty.SetNotifier([&] { ++later; });
+    CHECK_EQ(later, 0);
+    empty.Push(Status(L"x"));
+    CHECK_EQ(later, 1);
+}
@@ -0,0 +1,232 @@
+#include "TestHarness.h"
+
+#include "NetworkReactor.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+constexpr auto kResultTimeout = 5s;
+
+// Reactor-thread log of what ran, read once the reactor has stopped.
+struct EventLog
+{
+    std::mutex mutex;
+    std::vector<std::string> events;
+
+    void Add(std::string event)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(std::move(event));
+    }
+};
+
+Task<void> SleepThenLog(NetworkReactor* reactor, Clock::duration delay, EventLog* log, std::string event)
+{
+    co_await reactor->SleepFor(delay);
+    log->Add(std::move(event));
+}
+
+Task<void> WaitForFlag(AsyncCondition* condition, const bool* flag, EventLog* log, std::string event)
+{
+    while (!*flag)
+        co_await condition->Wait();
+    log->Add(std::move(event));
+}
+
+Task<void> WaitWithDeadline(AsyncCondition* condition, Clock::duration timeout, EventLog* log)
+{
+    const auto start = Clock::now();
+    co_await condition->WaitUntil(start + timeout);
+    log->Add(Clock::now() - start >= timeout ? "timed out" : "woken early");
+}
+
+Task<void> JoinGroup(NetworkReactor* reactor, EventLog* log)
+{
+    TaskGroup group(*reactor);
+    group.Spawn(SleepThenLog(reactor, 20ms, log, "slow"));
+    group.Spawn(SleepThenLog(reactor, 1ms, log, "fast"));
+    co_await group.Join();
+    log->Add("joined");
+}
+
+// Runs |work| on the reactor thread and waits for it there.
+template<typename Work>
+bool RunOnReactor(NetworkReactor& reactor, Work work)
+{
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    reactor.Post([&]
+    {
+        work();
+        done.set_value();
+    });
+    return finished.wait_for(kResultTimeout) == std::future_status::ready;
+}
+}
+
+TEST_CASE(PollerWaitTimesOut)
+{
+    ReactorPoller poller;
+    REQUIRE(poller.IsValid());
+    const auto start = Clock::now();
+    poller.Wait(30);
+    CHECK(Clock::now() - start >= 30ms);
+}
+
+TEST_CASE(PollerWakeCoalesces)
+{
+    ReactorPoller poller;
+    REQUIRE(poller.IsValid());
+    // Wakes before the wait are not lost, and one wait consumes them all.
+    poller.Wake();
+    poller.Wake();
+    poller.Wake();
+    auto start = Clock::now();
+    poller.Wait(5000);
+    CHECK(Clock::now() - start < 1s);
+    start = Clock::now();
+    poller.Wait(30);
+    CHECK(Clock::now() - start >= 30ms);
+}
+
+TEST_CASE(PollerWakeFromAnotherThread)
+{
+    ReactorPoller poller;
+    REQUIRE(poller.IsValid());
+    std::thread waker([&]
+    {
+        std::this_thread::sleep_for(20ms);
+        poller.Wake();
+    });
+    const auto start = Clock::now();
+    poller.Wait(-1);
+    CHECK(Clock::now() - start < 5s);
+    waker.join();
+}
+
+TEST_CASE(ReactorRunsPostedWorkInOrder)
+{
+    NetworkReactor reactor;
+    EventLog log;
+    // Work posted before Start() runs once it starts.
+    reactor.Post([&] { log.Add("early"); });
+    REQUIRE(reactor.Start());
+    CHECK(!reactor.IsReactorThread());
+
+    bool onReactorThread = false;
+    for (int i = 0; i < 3; ++i)
+        reactor.Post([&, i] { log.Add("posted " + std::to_string(i)); });
+    REQUIRE(RunOnReactor(reactor, [&] { onReactorThread = reactor.IsReactorThread(); }));
+    reactor.Stop();
+
+    CHECK(onReactorThread);
+    CHECK_EQ(log.events, (std::vector<std::string>{ "early", "posted 0", "posted 1", "posted 2" }));
+}
+
+TEST_CASE(ReactorTimersFireInDeadlineOrder)
+{
+    NetworkReactor reactor;
+    EventLog log;
+    REQUIRE(reactor.Start());
+    REQUIRE(RunOnReactor(reactor, [&]
+    {
+        reactor.Spawn(SleepThenLog(&reactor, 60ms, &log, "60"));
+        reactor.Spawn(SleepThenLog(&reactor, 20ms, &log, "20"));
+        reactor.Spawn(SleepThenLog(&reactor, 40ms, &log, "40"));
+        // An elapsed deadline does not suspend at all.
+        reactor.Spawn(SleepThenLog(&reactor, -1ms, &log, "now"));
+    }));
+    // Stop waits for the sleeping tasks.
+    const auto start = Clock::now();
+    reactor.Stop();
+
+    CHECK(Clock::now() - start >= 40ms);
+    CHECK_EQ(log.events, (std::vector<std::string>{ "now", "20", "40", "60" }));
+}
+
+TEST_CASE(ReactorConditionNotifiesAndTimesOut)
+{
+    NetworkReactor reactor;
+    EventLog log;
+    AsyncCondition condition(reactor);
+    bool flag = false;
+    REQUIRE(reactor.Start());
+    REQUIRE(RunOnReactor(reactor, [&]
+    {
+        reactor.Spawn(WaitForFlag(&condition, &flag, &log, "first"));
+        reactor.Spawn(WaitForFlag(&condition, &flag, &log, "second"));
+        reactor.Spawn(WaitWithDeadline(&condition, 30ms, &log));
+    }));
+    // A notify without the flag set sends the waiters back to sleep; the
+    // timed waiter is resumed early by it.
+    REQUIRE(RunOnReactor(reactor, [&] { condition.NotifyAll(); }));
+    REQUIRE(RunOnReactor(reactor, [&]
+    {
+        flag = true;
+        condition.NotifyAll();
+    }));
+    reactor.Stop();
+
+    CHECK_EQ(log.events, (std::vector<std::string>{ "woken early", "first", "second" }));
+
+    log.events.clear();
+    REQUIRE(reactor.Start());
+    REQUIRE(RunOnReactor(reactor, [&] { reactor.Spawn(WaitWithDeadline(&condition, 20ms, &log)); }));
+    reactor.Stop();
+    CHECK_EQ(log.events, (std::vector<std::string>{ "timed out" }));
+}
+
+TEST_CASE(ReactorTaskGroupJoins)
+{
+    NetworkReactor reactor;
+    EventLog log;
+    REQUIRE(reactor.Start());
+    REQUIRE(RunOnReactor(reactor, [&] { reactor.Spawn(JoinGroup(&reactor, &log)); }));
+    reactor.Stop();
+    CHECK_EQ(log.events, (std::vector<std::string>{ "fast", "slow", "joined" }));
+}
+
+TEST_CASE(ReactorSignalBatchesRaises)
+{
+    NetworkReactor reactor;
+    std::atomic<int> handled = 0;
+    std::atomic<bool> onReactorThread = true;
+    ReactorSignal signal(reactor, [&]
+    {
+        onReactorThread = onReactorThread && reactor.IsReactorThread();
+        ++handled;
+    });
+    REQUIRE(reactor.Start());
+
+    constexpr int kRaises = 1000;
+    std::thread raiser([&]
+    {
+        for (int i = 0; i < kRaises; ++i)
+            signal.Raise();
+    });
+    raiser.join();
+
+    // The last raise is always handled, however many were folded into it.
+    const auto deadline = Clock::now() + kResultTimeout;
+    while (handled == 0 && Clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    REQUIRE(RunOnReactor(reactor, [] {}));
+    const int afterRaises = handled;
+    REQUIRE(RunOnReactor(reactor, [] {}));
+    reactor.Stop();
+
+    CHECK(afterRaises >= 1);
+    CHECK(afterRaises <= kRaises);
+    // Nothing more runs without another raise.
+    CHECK_EQ(handled.load(), afterRaises);
+    CHECK(onReactorThread);
+}
@@ -0,0 +1,380 @@
+#include "TestHarness.h"
+
+#include "LoopbackSocket.h"
+#include "OnvifSoap.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int kIoTimeoutMs = 2000;
+constexpr char kProfileToken[] = "Profile_1";
+
+std::string DecodeBase64(std::string_view text)
+{
+    static constexpr std::string_view kAlphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string decoded;
+    uint32_t bits = 0;
+    int count = 0;
+    for (const char ch : text)
+    {
+        const size_t value = kAlphabet.find(ch);
+        if (value == std::string_view::npos)
+            break;
+        bits = (bits << 6) | static_cast<uint32_t>(value);
+        count += 6;
+        if (count >= 8)
+        {
+            count -= 8;
+            decoded += static_cast<char>((bits >> count) & 0xFF);
+        }
+    }
+    return decoded;
+}
+
+// The text between <prefix:name ...> and </prefix:name>, or empty.
+std::string ElementText(const std::string& document, std::string_view qualifiedName)
+{
+    const std::string open = "<" + std::string(qualifiedName);
+    size_t start = 0;
+    while ((start = document.find(open, start)) != std::string::npos)
+    {
+        start += open.size();
+        if (document[start] == '>' || document[start] == ' ')
+            break;
+    }
+    if (start == std::string::npos)
+        return {};
+    const size_t textStart = document.find('>', start) + 1;
+    const size_t textEnd = document.find("</" + std::string(qualifiedName) + ">", textStart);
+    return textEnd == std::string::npos ? std::string() : document.substr(textStart, textEnd - textStart);
+}
+
+double AttributeValue(const std::string& document, std::string_view element, std::string_view attribute)
+{
+    const size_t start = document.find(element);
+    const size_t value = document.find(std::string(attribute) + "=\"", start);
+    return strtod(document.c_str() + value + attribute.size() + 2, nullptr);
+}
+
+std::string FaultBody(std::string_view subcode, std::string_view reason)
+{
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<env:Envelope xmlns:env=\"http://www.w3.org/2003/05/soap-envelope\""
+        " xmlns:ter=\"http://www.onvif.org/ver10/error\"><env:Body><env:Fault>"
+        "<env:Code><env:Value>env:Sender</env:Value><env:Subcode><env:Value>" + std::string(subcode) +
+        "</env:Value></env:Subcode></env:Code><env:Reason><env:Text xml:lang=\"en\">" + std::string(reason) +
+        "</env:Text></env:Reason></env:Fault></env:Body></env:Envelope>";
+}
+
+// What the responder accepted, in order.
+struct ReceivedMove
+{
+    double pan;
+    double tilt;
+    double zoom;
+};
+
+// A PTZ and media service on 127.0.0.1 as a camera implements them:
+// WS-UsernameToken digests checked against its own password, each nonce
+// accepted once, out-of-range velocities and unknown profiles refused with
+// SOAP faults. One connection at a time, kept alive between requests.
+class OnvifResponder
+{
+public:
+    explicit OnvifResponder(std::string password) : password_(std::move(password))
+    {
+        listener_ = BindLoopback(SOCK_STREAM, &port_);
+        if (listener_.IsValid())
+            thread_ = std::thread([this] { Run(); });
+    }
+
+    ~OnvifResponder()
+    {
+        stop_ = true;
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    bool IsValid() const { return listener_.IsValid(); }
+    uint16_t Port() const { return port_; }
+
+    std::vector<ReceivedMove> Moves()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return moves_;
+    }
+
+    int Stops()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stops_;
+    }
+
+private:
+    void Run()
+    {
+        while (!stop_)
+        {
+            ScopedSocket connection = AcceptWithin(listener_.Get(), 50);
+            std::string buffer;
+            HttpMessage request;
+            while (connection.IsValid() && !stop_ && ReadHttpMessage(connection.Get(), &buffer, &request, kIoTimeoutMs))
+            {
+                if (!SendAll(connection.Get(), Answer(request)))
+                    break;
+            }
+        }
+    }
+
+    std::string Answer(const HttpMessage& request)
+    {
+        int status = 200;
+        std::string body;
+        const std::string action = request.Header("Content-Type");
+        std::string subcode;
+        std::string reason;
+        if (!Authenticate(request.body, &reason))
+        {
+            status = 400;
+            subcode = "ter:NotAuthorized";
+        }
+        else if (action.find("/GetProfiles\"") != std::string::npos)
+        {
+            body = "<trt:GetProfilesResponse><trt:Profiles fixed=\"true\" token=\"" + std::string(kProfileToken) +
+                "\"><tt:Name>main</tt:Name></trt:Profiles></trt:GetProfilesResponse>";
+        }
+        else if (ElementText(request.body, "tptz:ProfileToken") != kProfileToken)
+        {
+            status = 400;
+            subcode = "ter:NoProfile";
+            reason = "No such profile";
+        }
+        else if (action.find("/ContinuousMove\"") != std::string::npos)
+        {
+            const ReceivedMove move = { AttributeValue(request.body, "<tt:PanTilt", "x"),
+                AttributeValue(request.body, "<tt:PanTilt", "y"), AttributeValue(request.body, "<tt:Zoom", "x") };
+            if (std::abs(move.pan) > 1.0 || std::abs(move.tilt) > 1.0 || std::abs(move.zoom) > 1.0)
+            {
+                status = 400;
+                subcode = "ter:InvalidArgVal";
+                reason = "Velocity out of range";
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                moves_.push_back(move);
+                body = "<tptz:ContinuousMoveResponse/>";
+            }
+        }
+        else if (action.find("/Stop\"") != std::string::npos)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stops_;
+            body = "<tptz:StopResponse/>";
+        }
+        else
+        {
+            status = 500;
+            subcode = "ter:ActionNotSupported";
+            reason = "Unknown action";
+        }
+
+        if (!subcode.empty())
+            body = FaultBody(subcode, reason);
+        else
+            body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><env:Envelope"
+                " xmlns:env=\"http://www.w3.org/2003/05/soap-envelope\"><env:Body>" + body +
+                "</env:Body></env:Envelope>";
+        return "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Error") +
+            "\r\nContent-Type: application/soap+xml; charset=utf-8\r\nContent-Length: " +
+            std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    bool Authenticate(const std::string& envelope, std::string* reason)
+    {
+        const std::string nonce = DecodeBase64(ElementText(envelope, "wsse:Nonce"));
+        const std::string created = ElementText(envelope, "wsu:Created");
+        const std::string digest = ElementText(envelope, "wsse:Password");
+        if (ElementText(envelope, "wsse:Username") != "admin" || nonce.empty() || created.empty())
+        {
+            *reason = "Sender not Authorized";
+            return false;
+        }
+        if (digest != ComputeOnvifPasswordDigest(nonce, created, password_))
+        {
+            *reason = "Digest mismatch";
+            return false;
+        }
+        // A UsernameToken is reused for a while, but its nonce never comes
+        // back with a different Created.
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto [seen, inserted] = nonces_.emplace(nonce, created);
+        if (!inserted && seen->second != created)
+        {
+            *reason = "Nonce replayed";
+            return false;
+        }
+        return true;
+    }
+
+    std::string password_;
+    ScopedSocket listener_;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_ = false;
+    std::thread thread_;
+
+    std::mutex mutex_;
+    std::map<std::string, std::string> nonces_;
+    std::vector<ReceivedMove> moves_;
+    int stops_ = 0;
+};
+
+struct SoapReply
+{
+    int status = 0;
+    std::string body;
+};
+
+// The driver's side of the exchange over a plain socket: WinHTTP is not
+// available here, the envelopes and headers are the same.
+class SoapClient
+{
+public:
+    explicit SoapClient(uint16_t port) : socket_(ConnectLoopback(port)) {}
+
+    bool IsValid() const { return socket_.IsValid(); }
+
+    bool Post(std::string_view action, const std::string& envelope, SoapReply* reply)
+    {
+        const std::string request = "POST /onvif/ptz_service HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+            "Content-Type: application/soap+xml; charset=utf-8; action=\"" + std::string(action) + "\"\r\n"
+            "Content-Length: " + std::to_string(envelope.size()) + "\r\n\r\n" + envelope;
+        HttpMessage response;
+        if (!SendAll(socket_.Get(), request) || !ReadHttpMessage(socket_.Get(), &buffer_, &response, kIoTimeoutMs))
+            return false;
+        reply->status = atoi(response.head.c_str() + response.head.find(' ') + 1);
+        reply->body = std::move(response.body);
+        return true;
+    }
+
+private:
+    ScopedSocket socket_;
+    std::string buffer_;
+};
+
+constexpr char kMoveAction[] = "http://www.onvif.org/ver20/ptz/wsdl/ContinuousMove";
+constexpr char kStopAction[] = "http://www.onvif.org/ver20/ptz/wsdl/Stop";
+constexpr char kGetProfilesAction[] = "http://www.onvif.org/ver10/media/wsdl/GetProfiles";
+
+std::string MakeSecurityHeader(std::string_view nonce, std::string_view created, std::string_view password)
+{
+    return BuildOnvifSecurityHeader("admin",
+        EncodeBase64(reinterpret_cast<const uint8_t*>(nonce.data()), nonce.size()), std::string(created),
+        ComputeOnvifPasswordDigest(nonce, created, password));
+}
+
+bool IsFault(const SoapReply& reply, std::string_view code)
+{
+    OnvifFault fault;
+    return reply.status >= 400 && TryParseOnvifFault(reply.body, &fault) && fault.code == code;
+}
+}
+
+TEST_CASE(OnvifLoopbackMoveAndStop)
+{
+    OnvifResponder camera("s3cret");
+    REQUIRE(camera.IsValid());
+    SoapClient client(camera.Port());
+    REQUIRE(client.IsValid());
+
+    const std::string security = MakeSecurityHeader("0123456789abcdef", "2026-10-18T12:00:00Z", "s3cret");
+    SoapReply reply;
+    REQUIRE(client.Post(kGetProfilesAction, BuildOnvifGetProfilesEnvelope(security), &reply));
+    CHECK_EQ(reply.status, 200);
+    std::string token;
+    REQUIRE(TryParseOnvifProfileToken(reply.body, &token));
+    CHECK_EQ(token, std::string(kProfileToken));
+    CHECK(!TryParseOnvifFault(reply.body, nullptr));
+
+    // One template, patched per move, on one kept-alive connection.
+    OnvifMoveTemplate move;
+    move.Build(security, token);
+    const JoystickState states[] = { { 375.0, -750.0, 0.0 }, { -1200.0, 10.0, 749.97 }, { 0.0, 0.0, -0.01 } };
+    for (const JoystickState& state : states)
+    {
+        REQUIRE(client.Post(kMoveAction, move.Serialize(state), &reply));
+        CHECK_EQ(reply.status, 200);
+    }
+    REQUIRE(client.Post(kStopAction, BuildOnvifStopEnvelope(security, token), &reply));
+    CHECK_EQ(reply.status, 200);
+
+    const std::vector<ReceivedMove> moves = camera.Moves();
+    REQUIRE(moves.size() == 3);
+    CHECK_EQ(moves[0].pan, 0.5);
+    CHECK_EQ(moves[0].tilt, 1.0);
+    CHECK_EQ(moves[1].pan, -1.0);
+    CHECK_EQ(moves[1].tilt, -0.0133);
+    CHECK_EQ(moves[1].zoom, 1.0);
+    CHECK_EQ(moves[2].zoom, 0.0);
+    CHECK_EQ(camera.Stops(), 1);
+}
+
+TEST_CASE(OnvifLoopbackFaults)
+{
+    OnvifResponder camera("s3cret");
+    REQUIRE(camera.IsValid());
+    SoapClient client(camera.Port());
+    REQUIRE(client.IsValid());
+    SoapReply reply;
+
+    // A digest made with the wrong password.
+    const std::string wrong = MakeSecurityHeader("nonce-one-16-byt", "2026-10-18T12:00:00Z", "guess");
+    REQUIRE(client.Post(kGetProfilesAction, BuildOnvifGetProfilesEnvelope(wrong), &reply));
+    CHECK(IsFault(reply, "ter:NotAuthorized"));
+    CHECK_EQ(reply.status, 400);
+    OnvifFault fault;
+    REQUIRE(TryParseOnvifFault(reply.body, &fault));
+    CHECK_EQ(fault.reason, std::string("Digest mismatch"));
+
+    // No security header at all.
+    REQUIRE(client.Post(kStopAction, BuildOnvifStopEnvelope("", kProfileToken), &reply));
+    CHECK(IsFault(reply, "ter:NotAuthorized"));
+
+    // A nonce reused with a new Created, as a replay would.
+    const std::string first = MakeSecurityHeader("nonce-two-16-byt", "2026-10-18T12:00:00Z", "s3cret");
+    REQUIRE(client.Post(kStopAction, BuildOnvifStopEnvelope(first, kProfileToken), &reply));
+    CHECK_EQ(reply.status, 200);
+    const std::string replayed = MakeSecurityHeader("nonce-two-16-byt", "2026-10-18T12:01:00Z", "s3cret");
+    REQUIRE(client.Post(kStopAction, BuildOnvifStopEnvelope(replayed, kProfileToken), &reply));
+    CHECK(IsFault(reply, "ter:NotAuthorized"));
+
+    // A profile the camera does not have.
+    REQUIRE(client.Post(kStopAction, BuildOnvifStopEnvelope(first, "Profile_9"), &reply));
+    CHECK(IsFault(reply, "ter:NoProfile"));
+
+    // The clamp keeps the template inside the range; a hand-edited
+    // envelope past it is refused.
+    OnvifMoveTemplate move;
+    move.Build(first, kProfileToken);
+    std::string envelope = move.Serialize({ 750.0, 0.0, 0.0 });
+    const size_t pan = envelope.find("x=\"+1.0000\"");
+    REQUIRE(pan != std::string::npos);
+    envelope.replace(pan + 3, 7, "+1.5000");
+    REQUIRE(client.Post(kMoveAction, envelope, &reply));
+    CHECK(IsFault(reply, "ter:InvalidArgVal"));
+    CHECK(camera.Moves().empty());
+
+    REQUIRE(client.Post("http://www.onvif.org/ver20/ptz/wsdl/AbsoluteMove", move.Serialize({}), &reply));
+    CHECK_EQ(reply.status, 500);
+    CHECK(IsFault(reply, "ter:ActionNotSupported"));
+}
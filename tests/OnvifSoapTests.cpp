@@ -0,0 +1,207 @@
+#include "TestHarness.h"
+
+#include "OnvifSoap.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace {
+std::string ToHex(const std::array<uint8_t, 20>& digest)
+{
+    std::string hex;
+    for (const uint8_t byte : digest)
+    {
+        char text[3] = {};
+        snprintf(text, sizeof(text), "%02x", byte);
+        hex += text;
+    }
+    return hex;
+}
+
+// The three velocity attributes of a serialized ContinuousMove, in order.
+struct Velocities
+{
+    std::string pan;
+    std::string tilt;
+    std::string zoom;
+};
+
+// The value of |attribute| in the first |element| tag at or after |*pos|;
+// |*pos| is left on its closing quote.
+std::string AttributeAfter(const std::string& envelope, std::string_view element, std::string_view attribute,
+    size_t* pos)
+{
+    if (!element.empty())
+        *pos = envelope.find(element, *pos);
+    if (*pos == std::string::npos)
+        return {};
+    const std::string prefix = " " + std::string(attribute) + "=\"";
+    const size_t start = envelope.find(prefix, *pos) + prefix.size();
+    *pos = envelope.find('"', start);
+    return envelope.substr(start, *pos - start);
+}
+
+Velocities ReadVelocities(const std::string& envelope)
+{
+    size_t pos = 0;
+    Velocities velocities;
+    velocities.pan = AttributeAfter(envelope, "<tt:PanTilt", "x", &pos);
+    velocities.tilt = AttributeAfter(envelope, "", "y", &pos);
+    velocities.zoom = AttributeAfter(envelope, "<tt:Zoom", "x", &pos);
+    return velocities;
+}
+
+bool operator==(const Velocities& a, const Velocities& b)
+{
+    return a.pan == b.pan && a.tilt == b.tilt && a.zoom == b.zoom;
+}
+}
+
+TEST_CASE(Sha1KnownVectors)
+{
+    // FIPS 180-4 examples, and lengths either side of the padding boundary.
+    CHECK_EQ(ToHex(ComputeSha1("")), std::string("da39a3ee5e6b4b0d3255bfef95601890afd80709"));
+    CHECK_EQ(ToHex(ComputeSha1("abc")), std::string("a9993e364706816aba3e25717850c26c9cd0d89d"));
+    CHECK_EQ(ToHex(ComputeSha1("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")),
+        std::string("84983e441c3bd26ebaae4aa1f95129e5e54670f1"));
+    CHECK_EQ(ToHex(ComputeSha1(std::string(1000000, 'a'))), std::string("34aa973cd4c4daa4f61eeb2bdbad27316534016f"));
+    CHECK_EQ(ToHex(ComputeSha1(std::string(55, 'x'))), std::string("cef734ba81a024479e09eb5a75b6ddae62e6abf1"));
+    CHECK_EQ(ToHex(ComputeSha1(std::string(56, 'x'))), std::string("901305367c259952f4e7af8323f480d59f81335b"));
+    CHECK_EQ(ToHex(ComputeSha1(std::string(64, 'x'))), std::string("bb2fa3ee7afb9f54c6dfb5d021f14b1ffe40c163"));
+}
+
+TEST_CASE(PasswordDigestKnownVector)
+{
+    // The ONVIF Programmer's Guide example: nonce LKqI6G/AikKCQrN0zqZFlg==.
+    const std::string_view nonce("\x2C\xAA\x88\xE8\x6F\xC0\x8A\x42\x82\x42\xB3\x74\xCE\xA6\x45\x96", 16);
+    CHECK_EQ(EncodeBase64(reinterpret_cast<const uint8_t*>(nonce.data()), nonce.size()),
+        std::string("LKqI6G/AikKCQrN0zqZFlg=="));
+    CHECK_EQ(ComputeOnvifPasswordDigest(nonce, "2010-09-16T07:50:45Z", "userpassword"),
+        std::string("tuOSpGlFlIXsozq4HFNeeGeFLEI="));
+    // Each input changes it.
+    CHECK(ComputeOnvifPasswordDigest(nonce, "2010-09-16T07:50:46Z", "userpassword") !=
+        std::string("tuOSpGlFlIXsozq4HFNeeGeFLEI="));
+    CHECK(ComputeOnvifPasswordDigest(nonce.substr(1), "2010-09-16T07:50:45Z", "userpassword") !=
+        std::string("tuOSpGlFlIXsozq4HFNeeGeFLEI="));
+}
+
+TEST_CASE(Base64Padding)
+{
+    const auto encode = [](std::string_view text)
+    {
+        return EncodeBase64(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    };
+    CHECK_EQ(encode(""), std::string(""));
+    CHECK_EQ(encode("f"), std::string("Zg=="));
+    CHECK_EQ(encode("fo"), std::string("Zm8="));
+    CHECK_EQ(encode("foo"), std::string("Zm9v"));
+    CHECK_EQ(encode("foob"), std::string("Zm9vYg=="));
+    CHECK_EQ(encode("\xFF\xFE\xFD"), std::string("//79"));
+}
+
+TEST_CASE(MoveTemplatePatchesVelocities)
+{
+    OnvifMoveTemplate move;
+    CHECK(!move.IsBuilt());
+    move.Build(BuildOnvifSecurityHeader("admin", "bm9uY2U=", "2026-01-01T00:00:00Z", "ZGlnZXN0"), "Profile_1");
+    REQUIRE(move.IsBuilt());
+
+    const std::string& first = move.Serialize({ 375.0, -750.0, 75.0 });
+    CHECK((ReadVelocities(first) == Velocities{ "+0.5000", "+1.0000", "+0.1000" }));
+    const size_t size = first.size();
+
+    // Patched in place: the same buffer, the same length, nothing else moved.
+    const std::string before = first;
+    const std::string& second = move.Serialize({ -1.0, 0.5, -749.9 });
+    CHECK(&second == &first);
+    CHECK_EQ(second.size(), size);
+    CHECK((ReadVelocities(second) == Velocities{ "-0.0013", "-0.0007", "-0.9999" }));
+    size_t differing = 0;
+    for (size_t i = 0; i < size; ++i)
+        differing += before[i] != second[i];
+    CHECK(differing <= 21);
+    CHECK(second.find("<tptz:ProfileToken>Profile_1</tptz:ProfileToken>") != std::string::npos);
+    CHECK(second.find("<wsse:Username>admin</wsse:Username>") != std::string::npos);
+}
+
+TEST_CASE(MoveTemplateClampsAndFormats)
+{
+    OnvifMoveTemplate move;
+    move.Build("", "P");
+
+    // Past the stick range is clamped.
+    CHECK((ReadVelocities(move.Serialize({ 1000.0, -2000.0, -751.0 })) == Velocities{ "+1.0000", "+1.0000", "-1.0000" }));
+    const double infinity = std::numeric_limits<double>::infinity();
+    CHECK((ReadVelocities(move.Serialize({ infinity, infinity, -infinity })) ==
+        Velocities{ "+1.0000", "-1.0000", "-1.0000" }));
+    // Zero, and what rounds to it, never carries a minus sign.
+    CHECK((ReadVelocities(move.Serialize({ 0.0, 0.0, -0.0 })) == Velocities{ "+0.0000", "+0.0000", "+0.0000" }));
+    CHECK((ReadVelocities(move.Serialize({ -0.03, 0.03, -0.0374 })) == Velocities{ "+0.0000", "+0.0000", "+0.0000" }));
+    // Four decimals, rounded to nearest.
+    CHECK((ReadVelocities(move.Serialize({ 0.0376, 0.0376, 749.97 })) == Velocities{ "+0.0001", "-0.0001", "+1.0000" }));
+    CHECK((ReadVelocities(move.Serialize({ -0.0376, 749.97, -374.96 })) == Velocities{ "-0.0001", "-1.0000", "-0.4999" }));
+    // NaN is written as zero rather than as a short "+nan".
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const std::string& envelope = move.Serialize({ nan, nan, nan });
+    CHECK((ReadVelocities(envelope) == Velocities{ "+0.0000", "+0.0000", "+0.0000" }));
+    CHECK_EQ(envelope.find('\0'), std::string::npos);
+
+    // No security header leaves an empty Header element.
+    CHECK(envelope.find("<s:Header></s:Header>") != std::string::npos);
+}
+
+TEST_CASE(StopAndProfilesEnvelopes)
+{
+    const std::string stop = BuildOnvifStopEnvelope("", "a<b&\"c\"");
+    CHECK(stop.find("<tptz:ProfileToken>a&lt;b&amp;&quot;c&quot;</tptz:ProfileToken>") != std::string::npos);
+    CHECK(stop.find("<tptz:PanTilt>true</tptz:PanTilt><tptz:Zoom>true</tptz:Zoom>") != std::string::npos);
+    CHECK(BuildOnvifGetProfilesEnvelope("").find("<s:Body><trt:GetProfiles/></s:Body>") != std::string::npos);
+
+    std::string token;
+    CHECK(TryParseOnvifProfileToken(
+        "<trt:GetProfilesResponse><trt:Profiles fixed=\"true\" token=\"Profile_7\"><tt:Name>main</tt:Name>"
+        "</trt:Profiles><trt:Profiles token=\"Profile_8\"></trt:Profiles></trt:GetProfilesResponse>",
+        &token));
+    CHECK_EQ(token, std::string("Profile_7"));
+    CHECK(!TryParseOnvifProfileToken("<trt:GetProfilesResponse/>", &token));
+    CHECK(!TryParseOnvifProfileToken("<Profiles token=\"\"></Profiles>", &token));
+}
+
+TEST_CASE(FaultParsing)
+{
+    const std::string notAuthorized =
+        "<?xml version=\"1.0\"?><env:Envelope xmlns:env=\"http://www.w3.org/2003/05/soap-envelope\""
+        " xmlns:ter=\"http://www.onvif.org/ver10/error\"><env:Body><env:Fault>"
+        "<env:Code><env:Value>env:Sender</env:Value>"
+        "<env:Subcode><env:Value>ter:NotAuthorized</env:Value></env:Subcode></env:Code>"
+        "<env:Reason><env:Text xml:lang=\"en\">Sender not Authorized</env:Text></env:Reason>"
+        "</env:Fault></env:Body></env:Envelope>";
+    OnvifFault fault;
+    REQUIRE(TryParseOnvifFault(notAuthorized, &fault));
+    CHECK_EQ(fault.code, std::string("ter:NotAuthorized"));
+    CHECK_EQ(fault.reason, std::string("Sender not Authorized"));
+
+    // Nested subcodes, whitespace, and a Reason with no Text.
+    const std::string nested =
+        "<s:Fault>\n <s:Code>\n  <s:Value>s:Sender</s:Value>\n  <s:Subcode><s:Value>ter:InvalidArgVal</s:Value>"
+        "<s:Subcode><s:Value> ter:NoProfile </s:Value></s:Subcode></s:Subcode>\n </s:Code>"
+        "<s:Reason/></s:Fault>";
+    REQUIRE(TryParseOnvifFault(nested, &fault));
+    CHECK_EQ(fault.code, std::string("ter:NoProfile"));
+    CHECK_EQ(fault.reason, std::string());
+
+    // A receiver fault with no subcode.
+    REQUIRE(TryParseOnvifFault("<Fault><Code><Value>Receiver</Value></Code><Reason><Text>busy</Text></Reason></Fault>",
+        &fault));
+    CHECK_EQ(fault.code, std::string("Receiver"));
+    CHECK_EQ(fault.reason, std::string("busy"));
+
+    CHECK(!TryParseOnvifFault("<tptz:ContinuousMoveResponse/>", &fault));
+    CHECK(!TryParseOnvifFault("<tt:FaultCount>3</tt:FaultCount>", &fault));
+    CHECK(!TryParseOnvifFault("", nullptr));
+    CHECK(TryParseOnvifFault(notAuthorized, nullptr));
+}
@@ -0,0 +1,429 @@
+#include "TestHarness.h"
+
+#include "PipelineTrace.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr size_t kRingSize = 4096;
+// Timestamps are microseconds with three decimals.
+constexpr double kUsTolerance = 0.0015;
+
+// Just enough of a JSON reader to hold the export to the grammar: any
+// syntax error fails the parse, and the result can be walked.
+struct JsonNode
+{
+    enum class Kind { Null, Bool, Number, String, Array, Object };
+
+    Kind kind = Kind::Null;
+    double number = 0;
+    std::string text;
+    std::vector<JsonNode> items;
+    std::vector<std::pair<std::string, JsonNode>> members;
+
+    const JsonNode* Find(std::string_view key) const
+    {
+        for (const auto& [name, value] : members)
+        {
+            if (name == key)
+                return &value;
+        }
+        return nullptr;
+    }
+
+    std::string Text(std::string_view key) const
+    {
+        const JsonNode* value = Find(key);
+        return value && value->kind == Kind::String ? value->text : std::string();
+    }
+
+    double Number(std::string_view key) const
+    {
+        const JsonNode* value = Find(key);
+        return value && value->kind == Kind::Number ? value->number : NAN;
+    }
+};
+
+class JsonReader
+{
+public:
+    explicit JsonReader(std::string_view text)
+        : text_(text)
+    {
+    }
+
+    bool Parse(JsonNode* root)
+    {
+        if (!ParseValue(root, 0))
+            return false;
+        SkipSpace();
+        return pos_ == text_.size();
+    }
+
+private:
+    static constexpr int kMaxDepth = 16;
+
+    std::string_view text_;
+    size_t pos_ = 0;
+
+    void SkipSpace()
+    {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\n' || text_[pos_] == '\r' ||
+            text_[pos_] == '\t'))
+        {
+            ++pos_;
+        }
+    }
+
+    bool Consume(char c)
+    {
+        SkipSpace();
+        if (pos_ >= text_.size() || text_[pos_] != c)
+            return false;
+        ++pos_;
+        return true;
+    }
+
+    bool ConsumeWord(std::string_view word)
+    {
+        if (text_.substr(pos_, word.size()) != word)
+            return false;
+        pos_ += word.size();
+        return true;
+    }
+
+    bool ParseString(std::string* out)
+    {
+        if (!Consume('"'))
+            return false;
+        while (pos_ < text_.size())
+        {
+            const char c = text_[pos_++];
+            if (c == '"')
+                return true;
+            if (static_cast<unsigned char>(c) < 0x20)
+                return false;
+            if (c != '\\')
+            {
+                out->push_back(c);
+                continue;
+            }
+            if (pos_ >= text_.size())
+                return false;
+            const char escape = text_[pos_++];
+            if (escape == 'u')
+            {
+                if (pos_ + 4 > text_.size())
+                    return false;
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    if (!isxdigit(static_cast<unsigned char>(text_[pos_ + i])))
+                        return false;
+                }
+                out->push_back(static_cast<char>(strtoul(std::string(text_.substr(pos_, 4)).c_str(), nullptr, 16)));
+                pos_ += 4;
+            }
+            else if (std::string_view("\"\\/bfnrt").find(escape) != std::string_view::npos)
+            {
+                out->push_back(escape);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    bool ParseNumber(double* out)
+    {
+        const size_t start = pos_;
+        if (pos_ < text_.size() && text_[pos_] == '-')
+            ++pos_;
+        const auto digits = [&]()
+        {
+            const size_t first = pos_;
+            while (pos_ < text_.size() && isdigit(static_cast<unsigned char>(text_[pos_])))
+                ++pos_;
+            return pos_ > first;
+        };
+        if (!digits())
+            return false;
+        if (pos_ < text_.size() && text_[pos_] == '.')
+        {
+            ++pos_;
+            if (!digits())
+                return false;
+        }
+        if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E'))
+        {
+            ++pos_;
+            if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-'))
+                ++pos_;
+            if (!digits())
+                return false;
+        }
+        *out = strtod(std::string(text_.substr(start, pos_ - start)).c_str(), nullptr);
+        return true;
+    }
+
+    bool ParseValue(JsonNode* node, int depth)
+    {
+        if (depth > kMaxDepth)
+            return false;
+        SkipSpace();
+        if (pos_ >= text_.size())
+            return false;
+
+        const char c = text_[pos_];
+        if (c == '{')
+        {
+            node->kind = JsonNode::Kind::Object;
+            ++pos_;
+            if (Consume('}'))
+                return true;
+            do
+            {
+                std::pair<std::string, JsonNode> member;
+                if (!ParseString(&member.first) || !Consume(':') || !ParseValue(&member.second, depth + 1))
+                    return false;
+                node->members.push_back(std::move(member));
+            } while (Consume(','));
+            return Consume('}');
+        }
+        if (c == '[')
+        {
+            node->kind = JsonNode::Kind::Array;
+            ++pos_;
+            if (Consume(']'))
+                return true;
+            do
+            {
+                node->items.emplace_back();
+                if (!ParseValue(&node->items.back(), depth + 1))
+                    return false;
+            } while (Consume(','));
+            return Consume(']');
+        }
+        if (c == '"')
+        {
+            node->kind = JsonNode::Kind::String;
+            return ParseString(&node->text);
+        }
+        if (c == 't' || c == 'f')
+        {
+            node->kind = JsonNode::Kind::Bool;
+            return ConsumeWord(c == 't' ? "true" : "false");
+        }
+        if (c == 'n')
+            return ConsumeWord("null");
+        node->kind = JsonNode::Kind::Number;
+        return ParseNumber(&node->number);
+    }
+};
+
+// The exported events of the thread named |threadName|, metadata aside.
+struct ThreadEvents
+{
+    bool named = false;
+    std::vector<JsonNode> events;
+};
+
+ThreadEvents ExportThread(const std::string& threadName)
+{
+    const std::string json = ExportChromeTrace();
+    JsonNode root;
+    REQUIRE(JsonReader(json).Parse(&root));
+    const JsonNode* events = root.Find("traceEvents");
+    REQUIRE(events && events->kind == JsonNode::Kind::Array);
+
+    ThreadEvents result;
+    double tid = NAN;
+    for (const JsonNode& event : events->items)
+    {
+        const JsonNode* args = event.Find("args");
+        if (event.Text("ph") == "M" && event.Text("name") == "thread_name" && args &&
+            args->Text("name") == threadName)
+        {
+            REQUIRE(!result.named);
+            result.named = true;
+            tid = event.Number("tid");
+        }
+    }
+    for (const JsonNode& event : events->items)
+    {
+        if (event.Text("ph") != "M" && event.Number("tid") == tid)
+            result.events.push_back(event);
+    }
+    return result;
+}
+
+// Runs |record| on a thread of its own, named |name|, so it gets a fresh
+// ring.
+template<typename Record>
+void RecordOnThread(const char* name, Record record)
+{
+    std::thread thread([&]()
+    {
+        SetTraceThreadName(name);
+        record();
+    });
+    thread.join();
+}
+
+double ArgsId(const JsonNode& event)
+{
+    const JsonNode* args = event.Find("args");
+    return args ? args->Number("id") : NAN;
+}
+
+bool Near(double actual, double expected)
+{
+    return std::fabs(actual - expected) <= kUsTolerance;
+}
+}
+
+TEST_CASE(TraceExportPairsKeyedStages)
+{
+    const uint64_t base = TraceNow();
+    RecordOnThread("Trace \"keyed\" test", [&]()
+    {
+        RecordTraceSpan(TraceStage::Request, base, base + 4000, 7);
+        RecordTraceSpan(TraceStage::Connect, base + 500, base + 1500, 7);
+        RecordTraceSpan(TraceStage::Poll, base + 2000, base + 2250);
+        RecordTraceSpan(TraceStage::Parse, base + 3000, base + 3125, 9);
+    });
+
+    const ThreadEvents thread = ExportThread("Trace \"keyed\" test");
+    CHECK(thread.named);
+    REQUIRE(thread.events.size() == 6);
+
+    const JsonNode* requestBegin = nullptr;
+    const JsonNode* requestEnd = nullptr;
+    const JsonNode* connectBegin = nullptr;
+    const JsonNode* connectEnd = nullptr;
+    const JsonNode* poll = nullptr;
+    const JsonNode* parse = nullptr;
+    for (const JsonNode& event : thread.events)
+    {
+        const std::string name = event.Text("name");
+        const std::string phase = event.Text("ph");
+        CHECK_EQ(event.Text("cat"), std::string("pipeline"));
+        if (name == "Request")
+            (phase == "b" ? requestBegin : requestEnd) = &event;
+        else if (name == "Connect")
+            (phase == "b" ? connectBegin : connectEnd) = &event;
+        else if (name == "Poll")
+            poll = &event;
+        else if (name == "Parse")
+            parse = &event;
+    }
+    REQUIRE(requestBegin && requestEnd && connectBegin && connectEnd && poll && parse);
+
+    // Keyed: a b/e pair sharing the id, one span apart, and no duration.
+    CHECK_EQ(requestEnd->Text("ph"), std::string("e"));
+    CHECK_EQ(requestBegin->Number("id"), 7.0);
+    CHECK_EQ(requestEnd->Number("id"), 7.0);
+    CHECK_EQ(connectBegin->Number("id"), 7.0);
+    CHECK_EQ(connectEnd->Number("id"), 7.0);
+    CHECK(!requestBegin->Find("dur"));
+    CHECK(Near(requestEnd->Number("ts") - requestBegin->Number("ts"), 4.0));
+    CHECK(Near(connectBegin->Number("ts") - requestBegin->Number("ts"), 0.5));
+    CHECK(Near(connectEnd->Number("ts") - connectBegin->Number("ts"), 1.0));
+
+    // Unkeyed: one complete event with its duration; an id stays in args.
+    CHECK_EQ(poll->Text("ph"), std::string("X"));
+    CHECK(Near(poll->Number("dur"), 0.25));
+    CHECK(!poll->Find("id") && !poll->Find("args"));
+    CHECK_EQ(parse->Text("ph"), std::string("X"));
+    CHECK(Near(parse->Number("dur"), 0.125));
+    CHECK(!parse->Find("id"));
+    CHECK_EQ(ArgsId(*parse), 9.0);
+    CHECK(Near(parse->Number("ts") - requestBegin->Number("ts"), 3.0));
+}
+
+TEST_CASE(TraceExportKeepsNewestSpans)
+{
+    constexpr uint64_t kRecorded = kRingSize + 904;
+    const uint64_t base = TraceNow();
+    // Span i starts i microseconds in, lasts i % 1000 ns, and carries id i + 1.
+    RecordOnThread("Trace wrap test", [&]()
+    {
+        for (uint64_t i = 0; i < kRecorded; ++i)
+            RecordTraceSpan(TraceStage::Parse, base + i * 1000, base + i * 1000 + i % 1000, i + 1);
+    });
+
+    const ThreadEvents thread = ExportThread("Trace wrap test");
+    CHECK(thread.named);
+    REQUIRE(thread.events.size() == kRingSize);
+    const double firstTs = thread.events.front().Number("ts");
+    bool consistent = true;
+    for (size_t i = 0; i < thread.events.size(); ++i)
+    {
+        const JsonNode& event = thread.events[i];
+        const uint64_t span = kRecorded - kRingSize + i;
+        if (ArgsId(event) != static_cast<double>(span + 1) || !Near(event.Number("dur"), (span % 1000) / 1000.0) ||
+            !Near(event.Number("ts") - firstTs, static_cast<double>(i)))
+        {
+            consistent = false;
+        }
+    }
+    CHECK(consistent);
+}
+
+TEST_CASE(TraceExportWhileRecordingIsNeverTorn)
+{
+    const uint64_t base = TraceNow();
+    std::atomic<bool> stop = false;
+    std::atomic<bool> named = false;
+    std::thread writer([&]()
+    {
+        SetTraceThreadName("Trace torn test");
+        named = true;
+        for (uint64_t i = 0; !stop; ++i)
+            RecordTraceSpan(TraceStage::Parse, base + i * 1000, base + i * 1000 + i % 1000, i + 1);
+    });
+    while (!named)
+        std::this_thread::yield();
+
+    size_t exported = 0;
+    bool consistent = true;
+    for (int round = 0; round < 20; ++round)
+    {
+        const ThreadEvents thread = ExportThread("Trace torn test");
+        REQUIRE(thread.named);
+        CHECK(thread.events.size() <= kRingSize);
+        exported += thread.events.size();
+        if (thread.events.empty())
+            continue;
+
+        // Every field of a span comes from the same write, and spans run on
+        // without a gap.
+        const double firstId = ArgsId(thread.events.front());
+        const double firstTs = thread.events.front().Number("ts");
+        for (size_t i = 0; i < thread.events.size(); ++i)
+        {
+            const JsonNode& event = thread.events[i];
+            const double id = ArgsId(event);
+            const uint64_t span = static_cast<uint64_t>(id) - 1;
+            if (id != firstId + static_cast<double>(i) || !Near(event.Number("dur"), (span % 1000) / 1000.0) ||
+                !Near(event.Number("ts") - firstTs, id - firstId))
+            {
+                consistent = false;
+            }
+        }
+        std::this_thread::yield();
+    }
+    stop = true;
+    writer.join();
+    CHECK(consistent);
+    CHECK(exported > 0);
+}
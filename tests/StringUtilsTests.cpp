@@ -0,0 +1,248 @@
+#include "TestHarness.h"
+
+#include "ScalarUtf8.h"
+#include "StringUtils.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace {
+constexpr bool kWideIsUtf16 = sizeof(wchar_t) == 2;
+constexpr wchar_t kReplacement = static_cast<wchar_t>(0xFFFD);
+
+std::wstring Replacements(size_t count)
+{
+    return std::wstring(count, kReplacement);
+}
+
+// Places |text| after an ASCII run long enough to leave the vector path
+// part-way through a block.
+std::string AfterAsciiRun(std::string_view text)
+{
+    return std::string(21, 'a') + std::string(text);
+}
+
+// A fixed-seed generator, so failures reproduce.
+class Lcg
+{
+public:
+    uint32_t Next()
+    {
+        state_ = state_ * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<uint32_t>(state_ >> 33);
+    }
+
+private:
+    uint64_t state_ = 0x243F6A8885A308D3ull;
+};
+
+// Mostly ASCII with lead, continuation and invalid bytes mixed in, so that
+// sequences are often truncated or broken.
+std::string RandomBytes(Lcg& random, size_t size)
+{
+    static constexpr unsigned char kInteresting[] = { 0x80, 0xBF, 0xC0, 0xC1, 0xC2, 0xDF, 0xE0, 0xED,
+        0xEF, 0xF0, 0xF4, 0xF5, 0xFF, 0x9F, 0xA0, 0x8F, 0x90 };
+    std::string bytes;
+    for (size_t i = 0; i < size; ++i)
+    {
+        const uint32_t pick = random.Next();
+        if (pick % 4 == 0)
+            bytes.push_back(static_cast<char>(kInteresting[(pick >> 8) % sizeof(kInteresting)]));
+        else if (pick % 4 == 1)
+            bytes.push_back(static_cast<char>(pick >> 8));
+        else
+            bytes.push_back(static_cast<char>(0x20 + (pick >> 8) % 0x5F));
+    }
+    return bytes;
+}
+
+std::wstring RandomUnits(Lcg& random, size_t size)
+{
+    std::wstring units;
+    for (size_t i = 0; i < size; ++i)
+    {
+        const uint32_t pick = random.Next();
+        switch (pick % 5)
+        {
+        case 0:
+            units.push_back(static_cast<wchar_t>(0xD800 + (pick >> 8) % 0x800));
+            break;
+        case 1:
+            units.push_back(static_cast<wchar_t>((pick >> 8) & 0xFFFF));
+            break;
+        case 2:
+            // Beyond U+10FFFF where wchar_t can hold it.
+            units.push_back(static_cast<wchar_t>(kWideIsUtf16 ? (pick >> 8) & 0xFFFF : pick >> 8));
+            break;
+        default:
+            units.push_back(static_cast<wchar_t>(0x20 + (pick >> 8) % 0x5F));
+            break;
+        }
+    }
+    return units;
+}
+
+bool IsWellFormedUtf8(std::string_view text)
+{
+    // Well-formed text decodes with no replacement except those it spells.
+    return ScalarUtf8::WideToUtf8(ScalarUtf8::Utf8ToWide(text)) == text;
+}
+}
+
+TEST_CASE(Utf8AsciiAcrossVectorBlocks)
+{
+    for (size_t length = 0; length < 70; ++length)
+    {
+        std::string text;
+        for (size_t i = 0; i < length; ++i)
+            text.push_back(static_cast<char>('!' + i % 90));
+        const std::wstring wide = Utf8ToWide(text);
+        CHECK_EQ(wide, std::wstring(text.begin(), text.end()));
+        CHECK_EQ(WideToUtf8(wide), text);
+    }
+}
+
+TEST_CASE(Utf8ValidRoundTrip)
+{
+    const std::string text = "Caf\xC3\xA9 \xE5\x8C\x97\xE9\x97\xA8 \xF0\x9F\x93\xB7 \xEF\xBF\xBD \xF4\x8F\xBF\xBF";
+    const std::wstring wide = Utf8ToWide(text);
+    CHECK_EQ(wide, ScalarUtf8::Utf8ToWide(text));
+    CHECK_EQ(WideToUtf8(wide), text);
+    CHECK_EQ(WideToUtf8(Utf8ToWide(AfterAsciiRun(text))), AfterAsciiRun(text));
+
+    const std::wstring camera = kWideIsUtf16
+        ? std::wstring{ static_cast<wchar_t>(0xD83D), static_cast<wchar_t>(0xDCF7) }
+        : std::wstring(1, static_cast<wchar_t>(0x1F4F7));
+    CHECK_EQ(Utf8ToWide("\xF0\x9F\x93\xB7"), camera);
+}
+
+TEST_CASE(Utf8TruncatedSequences)
+{
+    // Each byte of a broken sequence is replaced on its own.
+    CHECK_EQ(Utf8ToWide("\xC3"), Replacements(1));
+    CHECK_EQ(Utf8ToWide("\xE2\x82"), Replacements(2));
+    CHECK_EQ(Utf8ToWide("\xF0\x9F\x93"), Replacements(3));
+    CHECK_EQ(Utf8ToWide("\xE2\x82" "A"), Replacements(2) + L"A");
+    CHECK_EQ(Utf8ToWide("\xF0\x9F" "\xC3\xA9"), Replacements(2) + L"\u00E9");
+    CHECK_EQ(Utf8ToWide(AfterAsciiRun("\xF0\x9F\x93")), std::wstring(21, L'a') + Replacements(3));
+    // Stray continuation bytes.
+    CHECK_EQ(Utf8ToWide("\x80\xBF" "A\xA9"), Replacements(2) + L"A" + Replacements(1));
+}
+
+TEST_CASE(Utf8Overlongs)
+{
+    CHECK_EQ(Utf8ToWide("\xC0\xAF"), Replacements(2));
+    CHECK_EQ(Utf8ToWide("\xC1\xBF"), Replacements(2));
+    CHECK_EQ(Utf8ToWide("\xE0\x80\xAF"), Replacements(3));
+    CHECK_EQ(Utf8ToWide("\xE0\x9F\xBF"), Replacements(3));
+    CHECK_EQ(Utf8ToWide("\xF0\x80\x80\xAF"), Replacements(4));
+    CHECK_EQ(Utf8ToWide("\xF0\x8F\xBF\xBF"), Replacements(4));
+    // The shortest forms of the same boundaries are fine.
+    CHECK_EQ(Utf8ToWide("\xC2\x80\xE0\xA0\x80"), std::wstring(L"\u0080\u0800"));
+}
+
+TEST_CASE(Utf8SurrogatesAndOutOfRange)
+{
+    // UTF-16 halves spelled in UTF-8 (CESU-8) are not characters.
+    CHECK_EQ(Utf8ToWide("\xED\xA0\x80"), Replacements(3));
+    CHECK_EQ(Utf8ToWide("\xED\xBF\xBF"), Replacements(3));
+    CHECK_EQ(Utf8ToWide("\xED\xA0\xBD\xED\xB3\xB7"), Replacements(6));
+    CHECK_EQ(Utf8ToWide("\xED\x9F\xBF"), std::wstring(L"\uD7FF"));
+    CHECK_EQ(Utf8ToWide("\xF4\x90\x80\x80"), Replacements(4));
+    CHECK_EQ(Utf8ToWide("\xF5\x80\x80\x80"), Replacements(4));
+    CHECK_EQ(Utf8ToWide("\xFE\xFF"), Replacements(2));
+}
+
+TEST_CASE(WideUnpairedSurrogates)
+{
+    const wchar_t high = static_cast<wchar_t>(0xD83D);
+    const wchar_t low = static_cast<wchar_t>(0xDCF7);
+    const std::string replacement = "\xEF\xBF\xBD";
+
+    CHECK_EQ(WideToUtf8(std::wstring{ high }), replacement);
+    CHECK_EQ(WideToUtf8(std::wstring{ low }), replacement);
+    CHECK_EQ(WideToUtf8(std::wstring{ low, high }), replacement + replacement);
+    CHECK_EQ(WideToUtf8(std::wstring{ high, L'A' }), replacement + "A");
+    CHECK_EQ(WideToUtf8(std::wstring{ high, high, low }),
+        kWideIsUtf16 ? replacement + "\xF0\x9F\x93\xB7" : replacement + replacement + replacement);
+    CHECK_EQ(WideToUtf8(std::wstring(21, L'a') + high), std::string(21, 'a') + replacement);
+
+    if constexpr (!kWideIsUtf16)
+    {
+        // UTF-32 units never pair, and some values are past U+10FFFF.
+        CHECK_EQ(WideToUtf8(std::wstring{ high, low }), replacement + replacement);
+        CHECK_EQ(WideToUtf8(std::wstring{ static_cast<wchar_t>(0x110000) }), replacement);
+        CHECK_EQ(WideToUtf8(std::wstring{ static_cast<wchar_t>(0x10FFFF) }), std::string("\xF4\x8F\xBF\xBF"));
+    }
+}
+
+TEST_CASE(Utf8MalformedMatchesReference)
+{
+    Lcg random;
+    for (int round = 0; round < 2000; ++round)
+    {
+        const std::string bytes = RandomBytes(random, random.Next() % 64);
+        const std::wstring wide = Utf8ToWide(bytes);
+        REQUIRE(wide == ScalarUtf8::Utf8ToWide(bytes));
+
+        // Whatever went in, what comes back out is well formed and stable.
+        const std::string narrowed = WideToUtf8(wide);
+        REQUIRE(narrowed == ScalarUtf8::WideToUtf8(wide));
+        CHECK(IsWellFormedUtf8(narrowed));
+        CHECK_EQ(Utf8ToWide(narrowed), wide);
+        if (IsWellFormedUtf8(bytes))
+            CHECK_EQ(narrowed, bytes);
+    }
+}
+
+TEST_CASE(WideMalformedMatchesReference)
+{
+    Lcg random;
+    for (int round = 0; round < 2000; ++round)
+    {
+        const std::wstring units = RandomUnits(random, random.Next() % 48);
+        const std::string narrowed = WideToUtf8(units);
+        REQUIRE(narrowed == ScalarUtf8::WideToUtf8(units));
+        CHECK(IsWellFormedUtf8(narrowed));
+        CHECK_EQ(WideToUtf8(Utf8ToWide(narrowed)), narrowed);
+    }
+}
+
+TEST_CASE(WidePrefixStopsAtWholeCodePoints)
+{
+    char out[8];
+    const auto prefix = [&](std::wstring_view text, size_t capacity)
+    {
+        return std::string(out, WideToUtf8Prefix(text, out, capacity));
+    };
+
+    CHECK_EQ(prefix(L"GET /api", 8), std::string("GET /api"));
+    CHECK_EQ(prefix(L"GET /api/cameras", 8), std::string("GET /api"));
+    CHECK_EQ(prefix(L"", 8), std::string());
+    CHECK_EQ(prefix(L"abc", 0), std::string());
+
+    // U+00E9 is two bytes and U+1F4F7 four: neither is split.
+    CHECK_EQ(prefix(L"abcdefé", 7), std::string("abcdef"));
+    CHECK_EQ(prefix(L"abcdefé", 8), std::string("abcdef\xC3\xA9"));
+    CHECK_EQ(prefix(L"abc📷x", 6), std::string("abc"));
+    CHECK_EQ(prefix(L"abc📷x", 8), std::string("abc\xF0\x9F\x93\xB7x"));
+
+    // Matches WideToUtf8 whenever everything fits.
+    Lcg random;
+    std::string large(256, '\0');
+    for (int round = 0; round < 500; ++round)
+    {
+        const std::wstring units = RandomUnits(random, random.Next() % 48);
+        REQUIRE(std::string(large.data(), WideToUtf8Prefix(units, large.data(), large.size())) == WideToUtf8(units));
+    }
+}
+
+TEST_CASE(TrimWideStripsControlAndSpace)
+{
+    CHECK_EQ(TrimWide(L"  \t Camera 1 \r\n"), std::wstring(L"Camera 1"));
+    CHECK_EQ(TrimWide(L" \t\r\n"), std::wstring());
+    CHECK_EQ(TrimWide(L""), std::wstring());
+    // Only C0 controls and space; a no-break space stays.
+    CHECK_EQ(TrimWide(L"\u00A0x\u00A0"), std::wstring(L"\u00A0x\u00A0"));
+}
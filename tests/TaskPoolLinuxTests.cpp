@@ -0,0 +1,247 @@
+#include "TestHarness.h"
+
+#include "NetworkReactor.h"
+#include "TaskPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+using namespace std::chrono_literals;
+
+constexpr auto kResultTimeout = 5s;
+
+// A one-shot signal between the test and pool tasks. Opened on destruction,
+// so a failed check never leaves a worker blocked and the pool unstoppable.
+class Gate
+{
+public:
+    Gate()
+        : opened_(promise_.get_future().share())
+    {
+    }
+
+    ~Gate() { Open(); }
+
+    void Open()
+    {
+        std::call_once(once_, [this]() { promise_.set_value(); });
+    }
+
+    void Wait() const { opened_.wait(); }
+    bool WaitFor() const { return opened_.wait_for(kResultTimeout) == std::future_status::ready; }
+
+private:
+    std::promise<void> promise_;
+    std::shared_future<void> opened_;
+    std::once_flag once_;
+};
+
+// Declare before the gates the pool's tasks wait on, so those open first.
+struct ScopedTaskPool
+{
+    explicit ScopedTaskPool(size_t threadCount) { StartTaskPool(threadCount); }
+    ~ScopedTaskPool() { StopTaskPool(); }
+};
+
+// Which tasks ran, in order, and on which threads.
+struct RunLog
+{
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<std::thread::id> threads;
+
+    size_t Add(int task)
+    {
+        std::scoped_lock lock(mutex);
+        order.push_back(task);
+        threads.push_back(std::this_thread::get_id());
+        return order.size();
+    }
+
+    bool AllOn(std::thread::id thread)
+    {
+        std::scoped_lock lock(mutex);
+        for (const std::thread::id ran : threads)
+        {
+            if (ran != thread)
+                return false;
+        }
+        return true;
+    }
+
+    bool NoneOn(std::thread::id thread)
+    {
+        std::scoped_lock lock(mutex);
+        for (const std::thread::id ran : threads)
+        {
+            if (ran == thread)
+                return false;
+        }
+        return true;
+    }
+};
+
+struct ResumeThreads
+{
+    std::thread::id before;
+    std::thread::id work;
+    std::thread::id after;
+    bool afterOnReactor = false;
+};
+
+Task<void> RunWorkAndResume(NetworkReactor* reactor, ResumeThreads* threads, std::promise<void>* done)
+{
+    threads->before = std::this_thread::get_id();
+    co_await RunOnTaskPool(*reactor, [threads]() { threads->work = std::this_thread::get_id(); });
+    threads->after = std::this_thread::get_id();
+    threads->afterOnReactor = reactor->IsReactorThread();
+    done->set_value();
+}
+
+// Runs one RunWorkAndResume on a fresh reactor.
+bool RunOnReactor(ResumeThreads* threads)
+{
+    NetworkReactor reactor;
+    if (!reactor.Start())
+        return false;
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    reactor.Post([&]() { reactor.Spawn(RunWorkAndResume(&reactor, threads, &done)); });
+    const bool ran = finished.wait_for(kResultTimeout) == std::future_status::ready;
+    reactor.Stop();
+    return ran;
+}
+}
+
+TEST_CASE(TaskPoolKeepsSpawnedWorkOnItsWorker)
+{
+    ScopedTaskPool pool(2);
+    Gate release;
+    Gate blocking;
+    Gate childrenDone;
+    std::thread::id blockedThread;
+    std::thread::id parentThread;
+    std::vector<TaskPoolQueueStats> queued;
+    RunLog log;
+
+    // One worker held, so nothing on the other's queue can be stolen.
+    REQUIRE(SubmitPoolTask([&]()
+    {
+        blockedThread = std::this_thread::get_id();
+        blocking.Open();
+        release.Wait();
+    }));
+    REQUIRE(blocking.WaitFor());
+
+    REQUIRE(SubmitPoolTask([&]()
+    {
+        parentThread = std::this_thread::get_id();
+        for (int task = 1; task <= 3; ++task)
+        {
+            SubmitPoolTask([&, task]()
+            {
+                if (log.Add(task) == 3)
+                    childrenDone.Open();
+            });
+        }
+        queued = GetTaskPoolStats();
+    }));
+    REQUIRE(childrenDone.WaitFor());
+    release.Open();
+
+    // All three went to the parent's queue and ran there, newest first.
+    REQUIRE(queued.size() == 2);
+    CHECK((queued[0].depth == 3 && queued[1].depth == 0) || (queued[0].depth == 0 && queued[1].depth == 3));
+    CHECK(log.order == (std::vector<int>{ 3, 2, 1 }));
+    CHECK(parentThread != blockedThread);
+    CHECK(log.AllOn(parentThread));
+}
+
+TEST_CASE(TaskPoolStealsOldestFromBusyWorker)
+{
+    ScopedTaskPool pool(2);
+    Gate release;
+    Gate stolenDone;
+    std::thread::id busyThread;
+    RunLog log;
+
+    // Queued behind a task that does not return until the others are done.
+    REQUIRE(SubmitPoolTask([&]()
+    {
+        busyThread = std::this_thread::get_id();
+        for (int task = 1; task <= 4; ++task)
+        {
+            SubmitPoolTask([&, task]()
+            {
+                if (log.Add(task) == 4)
+                    stolenDone.Open();
+            });
+        }
+        release.Wait();
+    }));
+    REQUIRE(stolenDone.WaitFor());
+    const std::vector<TaskPoolQueueStats> stats = GetTaskPoolStats();
+    release.Open();
+
+    CHECK(log.order == (std::vector<int>{ 1, 2, 3, 4 }));
+    CHECK(log.NoneOn(busyThread));
+    uint64_t stolen = 0;
+    for (const TaskPoolQueueStats& queue : stats)
+        stolen += queue.stolen;
+    // The busy task may itself have been stolen on its way in.
+    CHECK(stolen >= 4);
+}
+
+TEST_CASE(TaskPoolStopRunsQueuedTasks)
+{
+    CHECK(!SubmitPoolTask([]() {}));
+
+    ScopedTaskPool pool(1);
+    Gate release;
+    Gate blocking;
+    std::atomic<int> ran = 0;
+    REQUIRE(SubmitPoolTask([&]()
+    {
+        blocking.Open();
+        release.Wait();
+    }));
+    REQUIRE(blocking.WaitFor());
+    for (int i = 0; i < 5; ++i)
+        REQUIRE(SubmitPoolTask([&]() { ++ran; }));
+
+    std::thread stopper(StopTaskPool);
+    // Refused once the stop has begun, with the five still queued.
+    while (SubmitPoolTask([]() {}))
+        std::this_thread::sleep_for(1ms);
+    CHECK_EQ(ran.load(), 0);
+    release.Open();
+    stopper.join();
+
+    CHECK_EQ(ran.load(), 5);
+    CHECK(!SubmitPoolTask([&]() { ++ran; }));
+    CHECK(GetTaskPoolStats().empty());
+}
+
+TEST_CASE(RunOnTaskPoolResumesOnReactor)
+{
+    {
+        ScopedTaskPool pool(2);
+        ResumeThreads threads;
+        REQUIRE(RunOnReactor(&threads));
+        CHECK(threads.work != threads.before);
+        CHECK(threads.after == threads.before);
+        CHECK(threads.afterOnReactor);
+    }
+
+    // Stopped: the work runs inline on the reactor.
+    ResumeThreads threads;
+    REQUIRE(RunOnReactor(&threads));
+    CHECK(threads.work == threads.before);
+    CHECK(threads.after == threads.before);
+    CHECK(threads.afterOnReactor);
+}
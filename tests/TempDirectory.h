@@ -0,0 +1,75 @@
+#pragma once
+
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// A directory under $TMPDIR (or /tmp) for the Linux tests, removed with
+// everything in it when the object goes away.
+class TempDirectory
+{
+public:
+    TempDirectory()
+    {
+        const char* base = getenv("TMPDIR");
+        std::string pattern = std::string(base && *base ? base : "/tmp") + "/joystick_test_XXXXXX";
+        if (mkdtemp(pattern.data()))
+            path_ = pattern;
+    }
+
+    ~TempDirectory()
+    {
+        if (!path_.empty())
+            nftw(path_.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+
+    TempDirectory(const TempDirectory&) = delete;
+    TempDirectory& operator=(const TempDirectory&) = delete;
+
+    bool IsValid() const { return !path_.empty(); }
+    const std::string& Path() const { return path_; }
+
+    // Creates |relative| and any missing parents.
+    bool MakeDirectories(const std::string& relative) const
+    {
+        std::string current = path_;
+        size_t start = 0;
+        while (start < relative.size())
+        {
+            size_t slash = relative.find('/', start);
+            if (slash == std::string::npos)
+                slash = relative.size();
+            current += "/" + relative.substr(start, slash - start);
+            if (mkdir(current.c_str(), 0755) != 0 && errno != EEXIST)
+                return false;
+            start = slash + 1;
+        }
+        return true;
+    }
+
+    bool WriteFile(const std::string& relative, const std::string& contents) const
+    {
+        std::ofstream file(path_ + "/" + relative, std::ios::binary | std::ios::trunc);
+        file << contents;
+        return static_cast<bool>(file);
+    }
+
+    bool MakeSymlink(const std::string& target, const std::string& relative) const
+    {
+        return symlink(target.c_str(), (path_ + "/" + relative).c_str()) == 0;
+    }
+
+private:
+    static int RemoveEntry(const char* path, const struct stat*, int, FTW*)
+    {
+        return remove(path);
+    }
+
+    std::string path_;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A small runner for the tests under tests/; each test executable links
+// TestMain.cpp, which runs every TEST_CASE in it (or those whose name
+// contains the first argument) and exits non-zero on any failure.
+
+struct TestCase
+{
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& RegisteredTests();
+void ReportTestFailure(const char* file, int line, const std::string& message);
+
+// Thrown by REQUIRE to end the current test.
+struct TestAborted
+{
+};
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, void (*run)())
+    {
+        RegisteredTests().push_back({ name, run });
+    }
+};
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static const TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+            ReportTestFailure(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+    } while (false)
+
+#define CHECK_EQ(actual, expected) \
+    do \
+    { \
+        if (!((actual) == (expected))) \
+            ReportTestFailure(__FILE__, __LINE__, "CHECK_EQ(" #actual ", " #expected ")"); \
+    } while (false)
+
+#define REQUIRE(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            ReportTestFailure(__FILE__, __LINE__, "REQUIRE(" #condition ")"); \
+            throw TestAborted(); \
+        } \
+    } while (false)
@@ -0,0 +1,57 @@
+#include "TestHarness.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace {
+int g_failures = 0;
+}
+
+std::vector<TestCase>& RegisteredTests()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+void ReportTestFailure(const char* file, int line, const std::string& message)
+{
+    ++g_failures;
+    fprintf(stderr, "%s:%d: %s failed\n", file, line, message.c_str());
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int failedTests = 0;
+    int ran = 0;
+    for (const TestCase& test : RegisteredTests())
+    {
+        if (filter && !strstr(test.name, filter))
+            continue;
+
+        ++ran;
+        const int failuresBefore = g_failures;
+        printf("[ RUN  ] %s\n", test.name);
+        fflush(stdout);
+        try
+        {
+            test.run();
+        }
+        catch (const TestAborted&)
+        {
+        }
+        catch (const std::exception& e)
+        {
+            ReportTestFailure(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+        }
+
+        const bool passed = g_failures == failuresBefore;
+        if (!passed)
+            ++failedTests;
+        printf("[ %s ] %s\n", passed ? " OK " : "FAIL", test.name);
+    }
+
+    printf("%d of %d tests passed\n", ran - failedTests, ran);
+    return failedTests == 0 && ran > 0 ? 0 : 1;
+}
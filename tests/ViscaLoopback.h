@@ -0,0 +1,276 @@
+#pragma once
+
+#include "LoopbackSocket.h"
+#include "ViscaProtocol.h"
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A VISCA-over-IP camera on 127.0.0.1 for the Linux tests and the transport
+// bench. Each command gets an ACK and then a completion carrying its
+// sequence number; a sequence reset gets the control ACK. Replies can be
+// dropped or held back to stand in for a lossy LAN.
+class ViscaResponder
+{
+public:
+    ViscaResponder()
+    {
+        socket_ = BindLoopback(SOCK_DGRAM, &port_);
+        if (socket_.IsValid())
+            thread_ = std::thread([this] { Run(); });
+    }
+
+    ~ViscaResponder()
+    {
+        stop_ = true;
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    bool IsValid() const { return socket_.IsValid(); }
+    uint16_t Port() const { return port_; }
+
+    // Refuse (0F 01) a command whose number does not follow the last one,
+    // as cameras do. The first command after a reset sets the count.
+    void RequireSequence(bool require) { requireSequence_ = require; }
+
+    // The next |count| commands go unanswered.
+    void DropReplies(int count)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dropCount_ = count;
+    }
+
+    // The next command's replies are sent |delay| late; later commands are
+    // answered as usual meanwhile.
+    void DelayNextReply(std::chrono::milliseconds delay)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nextDelay_ = delay;
+    }
+
+    // Sequence numbers of the commands received, in order.
+    std::vector<uint32_t> Sequences()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sequences_;
+    }
+
+    int Resets()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return resets_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Outgoing
+    {
+        Clock::time_point due;
+        sockaddr_in to;
+        std::vector<uint8_t> packet;
+    };
+
+    static std::vector<uint8_t> Packet(uint16_t payloadType, uint32_t sequence, std::vector<uint8_t> payload)
+    {
+        std::vector<uint8_t> packet = {
+            static_cast<uint8_t>(payloadType >> 8), static_cast<uint8_t>(payloadType),
+            static_cast<uint8_t>(payload.size() >> 8), static_cast<uint8_t>(payload.size()),
+            static_cast<uint8_t>(sequence >> 24), static_cast<uint8_t>(sequence >> 16),
+            static_cast<uint8_t>(sequence >> 8), static_cast<uint8_t>(sequence) };
+        packet.insert(packet.end(), payload.begin(), payload.end());
+        return packet;
+    }
+
+    void Run()
+    {
+        std::vector<Outgoing> queue;
+        while (!stop_)
+        {
+            int timeoutMs = 10;
+            if (!queue.empty())
+            {
+                const auto next = std::min_element(queue.begin(), queue.end(),
+                    [](const Outgoing& a, const Outgoing& b) { return a.due < b.due; });
+                const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next->due - Clock::now());
+                timeoutMs = static_cast<int>(std::clamp<int64_t>(wait.count(), 0, timeoutMs));
+            }
+            if (WaitReadable(socket_.Get(), timeoutMs))
+                Receive(&queue);
+
+            const auto now = Clock::now();
+            for (auto it = queue.begin(); it != queue.end();)
+            {
+                if (it->due > now)
+                {
+                    ++it;
+                    continue;
+                }
+                sendto(socket_.Get(), it->packet.data(), it->packet.size(), 0,
+                    reinterpret_cast<const sockaddr*>(&it->to), sizeof(it->to));
+                it = queue.erase(it);
+            }
+        }
+    }
+
+    void Receive(std::vector<Outgoing>* queue)
+    {
+        uint8_t buffer[64];
+        sockaddr_in from = {};
+        socklen_t fromLength = sizeof(from);
+        const ssize_t received = recvfrom(socket_.Get(), buffer, sizeof(buffer), 0,
+            reinterpret_cast<sockaddr*>(&from), &fromLength);
+        if (received < 9)
+            return;
+
+        const uint16_t payloadType = static_cast<uint16_t>((buffer[0] << 8) | buffer[1]);
+        const uint32_t sequence = (static_cast<uint32_t>(buffer[4]) << 24) |
+            (static_cast<uint32_t>(buffer[5]) << 16) | (static_cast<uint32_t>(buffer[6]) << 8) | buffer[7];
+        const auto now = Clock::now();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (payloadType == 0x0200)
+        {
+            ++resets_;
+            expectAny_ = true;
+            queue->push_back({ now, from, Packet(0x0201, 0, { 0x01 }) });
+            return;
+        }
+        if (payloadType != 0x0100)
+            return;
+
+        sequences_.push_back(sequence);
+        if (requireSequence_ && !expectAny_ && sequence != expected_)
+        {
+            queue->push_back({ now, from, Packet(0x0201, sequence, { 0x0F, 0x01 }) });
+            return;
+        }
+        expectAny_ = false;
+        expected_ = sequence + 1;
+
+        if (dropCount_ > 0)
+        {
+            --dropCount_;
+            return;
+        }
+        const auto due = now + nextDelay_;
+        nextDelay_ = {};
+        queue->push_back({ due, from, Packet(0x0111, sequence, { 0x90, 0x41, 0xFF }) });
+        queue->push_back({ due, from, Packet(0x0111, sequence, { 0x90, 0x51, 0xFF }) });
+    }
+
+    ScopedSocket socket_;
+    uint16_t port_ = 0;
+    std::thread thread_;
+    std::atomic<bool> stop_{ false };
+    std::atomic<bool> requireSequence_{ false };
+
+    std::mutex mutex_;
+    std::vector<uint32_t> sequences_;
+    int resets_ = 0;
+    int dropCount_ = 0;
+    std::chrono::milliseconds nextDelay_{ 0 };
+    bool expectAny_ = true;
+    uint32_t expected_ = 0;
+};
+
+// The host side of a VISCA exchange: a UDP socket connected to one camera
+// and the ViscaSession that numbers its commands and matches the replies,
+// as ViscaCameraDriver does per endpoint.
+class ViscaLoopbackClient
+{
+public:
+    explicit ViscaLoopbackClient(uint16_t port)
+    {
+        socket_ = ScopedSocket(::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0));
+        const sockaddr_in address = MakeLoopbackAddress(port);
+        if (socket_.IsValid() &&
+            connect(socket_.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            socket_.Reset();
+        }
+    }
+
+    bool IsValid() const { return socket_.IsValid(); }
+    ViscaSession& Session() { return session_; }
+
+    // The reset's reply is not awaited, as in the driver.
+    bool Reset(uint32_t firstSequence = 0)
+    {
+        if (!SendPacket(BuildViscaSequenceReset()))
+            return false;
+        session_.OnResetSent(firstSequence);
+        return true;
+    }
+
+    // Numbers a command, builds it with |build| and sends it.
+    template <typename Build>
+    ViscaCommand Send(Build build)
+    {
+        const ViscaCommand command = session_.BeginCommand();
+        SendPacket(build(command.sequence));
+        return command;
+    }
+
+    // Feeds replies to the session until every one of |commands| is done
+    // or |timeoutMs| passes, then finishes them. A reply that comes in
+    // later is read by the next wait and matches nothing.
+    std::vector<ViscaCommandStatus> Wait(const std::vector<ViscaCommand>& commands, int timeoutMs)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        const auto allDone = [&]()
+        {
+            return std::all_of(commands.begin(), commands.end(),
+                [&](const ViscaCommand& command) { return session_.IsDone(command); });
+        };
+        while (!allDone())
+        {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0 || !WaitReadable(socket_.Get(), static_cast<int>(left.count())))
+                break;
+            Receive();
+        }
+
+        std::vector<ViscaCommandStatus> statuses;
+        for (const auto& command : commands)
+            statuses.push_back(session_.FinishCommand(command));
+        return statuses;
+    }
+
+    // Feeds whatever replies are already queued to the session; returns how
+    // many of them completed a command.
+    int Drain()
+    {
+        int matched = 0;
+        while (WaitReadable(socket_.Get(), 0))
+            matched += Receive() ? 1 : 0;
+        return matched;
+    }
+
+private:
+    bool SendPacket(const std::vector<uint8_t>& packet)
+    {
+        return send(socket_.Get(), packet.data(), packet.size(), 0) == static_cast<ssize_t>(packet.size());
+    }
+
+    bool Receive()
+    {
+        uint8_t buffer[64];
+        const ssize_t received = recv(socket_.Get(), buffer, sizeof(buffer), 0);
+        ViscaReply reply;
+        return received > 0 && ParseViscaReply(buffer, static_cast<size_t>(received), &reply) &&
+            session_.HandleReply(reply);
+    }
+
+    ScopedSocket socket_;
+    ViscaSession session_;
+};
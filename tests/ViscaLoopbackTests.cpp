@@ -0,0 +1,128 @@
+#include "TestHarness.h"
+
+#include "ViscaLoopback.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int kReplyTimeoutMs = 2000;
+// Long enough that a missing reply is not just a slow one.
+constexpr int kDroppedTimeoutMs = 100;
+
+JoystickState Move(double x, double y, double z)
+{
+    JoystickState state;
+    state.x = x;
+    state.y = y;
+    state.z = z;
+    return state;
+}
+
+// One move as the driver sends it: pan/tilt, then zoom.
+std::vector<ViscaCommand> SendMove(ViscaLoopbackClient& client, const JoystickState& state)
+{
+    return {
+        client.Send([&](uint32_t sequence) { return BuildViscaPanTiltDrive(state, sequence); }),
+        client.Send([&](uint32_t sequence) { return BuildViscaZoom(state.z, sequence); }),
+    };
+}
+
+bool AllAcknowledged(const std::vector<ViscaCommandStatus>& statuses)
+{
+    for (const auto& status : statuses)
+    {
+        if (!status.acknowledged)
+            return false;
+    }
+    return true;
+}
+}
+
+TEST_CASE(ViscaLoopbackSequenceWraps)
+{
+    ViscaResponder camera;
+    REQUIRE(camera.IsValid());
+    camera.RequireSequence(true);
+    ViscaLoopbackClient client(camera.Port());
+    REQUIRE(client.IsValid());
+
+    // Start just short of the wrap; the camera counts on through it too.
+    REQUIRE(client.Reset(0xFFFFFFFD));
+    for (int i = 0; i < 3; ++i)
+        CHECK(AllAcknowledged(client.Wait(SendMove(client, Move(100.0 * i, -50, 0)), kReplyTimeoutMs)));
+
+    const std::vector<uint32_t> expected = { 0xFFFFFFFD, 0xFFFFFFFE, 0xFFFFFFFF, 0, 1, 2 };
+    CHECK(camera.Sequences() == expected);
+    CHECK_EQ(camera.Resets(), 1);
+    CHECK(!client.Session().NeedsReset());
+    CHECK_EQ(client.Session().OutstandingCount(), 0u);
+}
+
+TEST_CASE(ViscaLoopbackDroppedReplyTimesOut)
+{
+    ViscaResponder camera;
+    REQUIRE(camera.IsValid());
+    ViscaLoopbackClient client(camera.Port());
+    REQUIRE(client.IsValid());
+    REQUIRE(client.Reset());
+
+    camera.DropReplies(1);
+    const std::vector<ViscaCommandStatus> statuses = client.Wait(SendMove(client, Move(300, 0, 0)), kDroppedTimeoutMs);
+    REQUIRE(statuses.size() == 2);
+    // The pan/tilt went unanswered; the zoom behind it still got through.
+    CHECK(!statuses[0].done);
+    CHECK(statuses[1].acknowledged);
+
+    // Nothing is left waiting, and the next move goes through.
+    CHECK_EQ(client.Session().OutstandingCount(), 0u);
+    CHECK(AllAcknowledged(client.Wait(SendMove(client, Move(0, 0, 0)), kReplyTimeoutMs)));
+}
+
+TEST_CASE(ViscaLoopbackLateReplyIsIgnored)
+{
+    ViscaResponder camera;
+    REQUIRE(camera.IsValid());
+    ViscaLoopbackClient client(camera.Port());
+    REQUIRE(client.IsValid());
+    REQUIRE(client.Reset());
+
+    camera.DelayNextReply(std::chrono::milliseconds(3 * kDroppedTimeoutMs));
+    const std::vector<ViscaCommandStatus> late = client.Wait(SendMove(client, Move(-200, 0, 0)), kDroppedTimeoutMs);
+    REQUIRE(late.size() == 2);
+    CHECK(!late[0].done);
+    CHECK(late[1].acknowledged);
+
+    // The late ACK and completion turn up once the next move is done;
+    // neither completes anything.
+    const std::vector<ViscaCommand> next = SendMove(client, Move(0, 0, 0));
+    CHECK(AllAcknowledged(client.Wait(next, kReplyTimeoutMs)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(3 * kDroppedTimeoutMs));
+    CHECK_EQ(client.Drain(), 0);
+    CHECK_EQ(client.Session().OutstandingCount(), 0u);
+}
+
+TEST_CASE(ViscaLoopbackRejectedSequenceResets)
+{
+    ViscaResponder camera;
+    REQUIRE(camera.IsValid());
+    camera.RequireSequence(true);
+    ViscaLoopbackClient client(camera.Port());
+    REQUIRE(client.IsValid());
+    REQUIRE(client.Reset());
+    CHECK(AllAcknowledged(client.Wait(SendMove(client, Move(100, 0, 0)), kReplyTimeoutMs)));
+
+    // Numbering that no longer follows the camera's, as after the camera
+    // restarts, is refused until the client resets.
+    client.Session().OnResetSent(40);
+    const std::vector<ViscaCommandStatus> rejected = client.Wait(SendMove(client, Move(100, 0, 0)), kReplyTimeoutMs);
+    REQUIRE(rejected.size() == 2);
+    CHECK(rejected[0].sequenceRejected);
+    CHECK(client.Session().NeedsReset());
+
+    REQUIRE(client.Reset());
+    CHECK(AllAcknowledged(client.Wait(SendMove(client, Move(0, 0, 0)), kReplyTimeoutMs)));
+    CHECK_EQ(camera.Resets(), 2);
+}
@@ -0,0 +1,149 @@
+#include "TestHarness.h"
+
+#include "ViscaProtocol.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace {
+std::vector<uint8_t> Bytes(std::initializer_list<uint8_t> bytes)
+{
+    return std::vector<uint8_t>(bytes);
+}
+
+bool Parse(std::initializer_list<uint8_t> bytes, ViscaReply* reply)
+{
+    const std::vector<uint8_t> packet(bytes);
+    return ParseViscaReply(packet.data(), packet.size(), reply);
+}
+
+ViscaReply Reply(ViscaReplyKind kind, uint32_t sequence, uint8_t errorCode = 0)
+{
+    ViscaReply reply;
+    reply.kind = kind;
+    reply.sequence = sequence;
+    reply.errorCode = errorCode;
+    return reply;
+}
+}
+
+TEST_CASE(ViscaPacketsCarryHeaderAndSequence)
+{
+    JoystickState state;
+    state.x = 750;
+    state.y = -375;
+    CHECK(BuildViscaPanTiltDrive(state, 0x01020304) == Bytes({
+        0x01, 0x00, 0x00, 0x09, 0x01, 0x02, 0x03, 0x04,
+        0x81, 0x01, 0x06, 0x01, 0x18, 0x0C, 0x02, 0x01, 0xFF }));
+
+    // A centred stick stops both axes but keeps a valid speed.
+    CHECK(BuildViscaPanTiltDrive(JoystickState{}, 0xFFFFFFFF) == Bytes({
+        0x01, 0x00, 0x00, 0x09, 0xFF, 0xFF, 0xFF, 0xFF,
+        0x81, 0x01, 0x06, 0x01, 0x01, 0x01, 0x03, 0x03, 0xFF }));
+
+    CHECK(BuildViscaZoom(-750, 7) == Bytes({
+        0x01, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x07, 0x81, 0x01, 0x04, 0x07, 0x37, 0xFF }));
+    CHECK_EQ(ViscaZoomCode(0), 0x00);
+    CHECK_EQ(ViscaZoomCode(750), 0x27);
+    CHECK(BuildViscaSequenceReset() == Bytes({ 0x02, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01 }));
+}
+
+TEST_CASE(ViscaRepliesParse)
+{
+    ViscaReply reply;
+    REQUIRE(Parse({ 0x01, 0x11, 0x00, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x90, 0x41, 0xFF }, &reply));
+    CHECK(reply.kind == ViscaReplyKind::Ack);
+    CHECK_EQ(reply.sequence, 0xFFFFFFFFu);
+    REQUIRE(Parse({ 0x01, 0x11, 0x00, 0x03, 0x00, 0x00, 0x00, 0x05, 0x90, 0x51, 0xFF }, &reply));
+    CHECK(reply.kind == ViscaReplyKind::Completion);
+    CHECK_EQ(reply.sequence, 5u);
+    REQUIRE(Parse({ 0x01, 0x11, 0x00, 0x04, 0x00, 0x00, 0x00, 0x06, 0x90, 0x61, 0x41, 0xFF }, &reply));
+    CHECK(reply.kind == ViscaReplyKind::Error);
+    CHECK_EQ(reply.errorCode, 0x41);
+    REQUIRE(Parse({ 0x02, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01 }, &reply));
+    CHECK(reply.kind == ViscaReplyKind::ControlAck);
+    REQUIRE(Parse({ 0x02, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x09, 0x0F, 0x01 }, &reply));
+    CHECK(reply.kind == ViscaReplyKind::ControlError);
+    CHECK_EQ(reply.sequence, 9u);
+
+    // Truncated, over-long length, an error with no code, not a reply.
+    CHECK(!Parse({ 0x01, 0x11, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00 }, &reply));
+    CHECK(!Parse({ 0x01, 0x11, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x90, 0x41, 0xFF }, &reply));
+    CHECK(!Parse({ 0x01, 0x11, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x90, 0x61, 0xFF }, &reply));
+    CHECK(!Parse({ 0x01, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x90, 0x41, 0xFF }, &reply));
+}
+
+TEST_CASE(ViscaSessionNumbersAcrossTheWrap)
+{
+    ViscaSession session;
+    CHECK(session.NeedsReset());
+    session.OnResetSent(0xFFFFFFFE);
+    CHECK(!session.NeedsReset());
+
+    const ViscaCommand a = session.BeginCommand();
+    const ViscaCommand b = session.BeginCommand();
+    const ViscaCommand c = session.BeginCommand();
+    CHECK_EQ(a.sequence, 0xFFFFFFFEu);
+    CHECK_EQ(b.sequence, 0xFFFFFFFFu);
+    CHECK_EQ(c.sequence, 0u);
+
+    // Out of order, and the completion after the ACK changes nothing.
+    CHECK(session.HandleReply(Reply(ViscaReplyKind::Ack, 0)));
+    CHECK(!session.HandleReply(Reply(ViscaReplyKind::Completion, 0)));
+    CHECK(session.IsDone(c));
+    CHECK(!session.IsDone(b));
+    CHECK(session.HandleReply(Reply(ViscaReplyKind::Completion, 0xFFFFFFFF)));
+    CHECK(session.HandleReply(Reply(ViscaReplyKind::Error, 0xFFFFFFFE, 0x41)));
+
+    const ViscaCommandStatus first = session.FinishCommand(a);
+    CHECK(first.done);
+    CHECK(!first.acknowledged);
+    CHECK_EQ(first.errorCode, 0x41);
+    CHECK(session.FinishCommand(b).acknowledged);
+    CHECK(session.FinishCommand(c).acknowledged);
+    CHECK_EQ(session.OutstandingCount(), 0u);
+}
+
+TEST_CASE(ViscaSessionDropsLateReplies)
+{
+    ViscaSession session;
+    session.OnResetSent();
+    const ViscaCommand lost = session.BeginCommand();
+    // Given up on: the reply that turns up afterwards matches nothing.
+    const ViscaCommandStatus status = session.FinishCommand(lost);
+    CHECK(!status.done);
+    CHECK(!session.HandleReply(Reply(ViscaReplyKind::Ack, lost.sequence)));
+
+    // Still outstanding across a reset: failed by it, and a reply to the
+    // old number does not complete the new command that reuses it.
+    const ViscaCommand stale = session.BeginCommand();
+    session.OnResetSent(stale.sequence);
+    const ViscaCommand fresh = session.BeginCommand();
+    CHECK_EQ(fresh.sequence, stale.sequence);
+    CHECK(fresh.id != stale.id);
+    CHECK(session.IsDone(stale));
+    CHECK(session.FinishCommand(stale).sequenceRejected);
+    CHECK(!session.IsDone(fresh));
+    CHECK(session.HandleReply(Reply(ViscaReplyKind::Ack, fresh.sequence)));
+    CHECK(session.FinishCommand(fresh).acknowledged);
+}
+
+TEST_CASE(ViscaSessionResetsAfterRejection)
+{
+    ViscaSession session;
+    session.OnResetSent();
+    const ViscaCommand command = session.BeginCommand();
+    CHECK(!session.HandleReply(Reply(ViscaReplyKind::ControlAck, 0)));
+    CHECK(session.HandleReply(Reply(ViscaReplyKind::ControlError, command.sequence)));
+    CHECK(session.NeedsReset());
+
+    const ViscaCommandStatus status = session.FinishCommand(command);
+    CHECK(status.done);
+    CHECK(!status.acknowledged);
+    CHECK(status.sequenceRejected);
+
+    session.OnResetSent();
+    CHECK(!session.NeedsReset());
+    CHECK_EQ(session.BeginCommand().sequence, 0u);
+}
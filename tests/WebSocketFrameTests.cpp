@@ -0,0 +1,165 @@
+#include "TestHarness.h"
+
+#include "WebSocketFrame.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+constexpr uint8_t kRfcMaskKey[4] = { 0x37, 0xFA, 0x21, 0x3D };
+
+std::string Bytes(std::initializer_list<uint8_t> bytes)
+{
+    return std::string(bytes.begin(), bytes.end());
+}
+
+std::string Frame(WebSocketOpcode opcode, std::string_view payload, bool final = true, const uint8_t* maskKey = nullptr)
+{
+    std::string frame;
+    AppendWebSocketFrame(&frame, opcode, payload, final, maskKey);
+    return frame;
+}
+
+// Feeds |bytes| and returns the close code of the error it ends in, or 0.
+uint16_t ReadErrorCode(std::string_view bytes, size_t maxPayload = 1024)
+{
+    WebSocketFrameReader reader(maxPayload);
+    reader.Append(bytes.data(), bytes.size());
+    WebSocketFrame frame;
+    uint16_t code = 0;
+    while (reader.Next(&frame, &code) == WebSocketFrameReader::Result::Frame)
+    {
+    }
+    return code;
+}
+}
+
+TEST_CASE(WebSocketFramesMatchRfcExamples)
+{
+    // RFC 6455 section 5.7.
+    CHECK_EQ(Frame(WebSocketOpcode::Text, "Hello"), Bytes({ 0x81, 0x05, 0x48, 0x65, 0x6C, 0x6C, 0x6F }));
+    CHECK_EQ(Frame(WebSocketOpcode::Text, "Hello", true, kRfcMaskKey),
+        Bytes({ 0x81, 0x85, 0x37, 0xFA, 0x21, 0x3D, 0x7F, 0x9F, 0x4D, 0x51, 0x58 }));
+    CHECK_EQ(Frame(WebSocketOpcode::Text, "Hel", false), Bytes({ 0x01, 0x03, 0x48, 0x65, 0x6C }));
+    CHECK_EQ(Frame(WebSocketOpcode::Continuation, "lo"), Bytes({ 0x80, 0x02, 0x6C, 0x6F }));
+    CHECK_EQ(Frame(WebSocketOpcode::Ping, "Hello"), Bytes({ 0x89, 0x05, 0x48, 0x65, 0x6C, 0x6C, 0x6F }));
+
+    // The length forms, each at its limits.
+    CHECK_EQ(Frame(WebSocketOpcode::Binary, std::string(125, 'x')).substr(0, 2), Bytes({ 0x82, 0x7D }));
+    CHECK_EQ(Frame(WebSocketOpcode::Binary, std::string(126, 'x')).substr(0, 4), Bytes({ 0x82, 0x7E, 0x00, 0x7E }));
+    CHECK_EQ(Frame(WebSocketOpcode::Binary, std::string(256, 'x')).substr(0, 4), Bytes({ 0x82, 0x7E, 0x01, 0x00 }));
+    CHECK_EQ(Frame(WebSocketOpcode::Binary, std::string(65535, 'x')).substr(0, 4), Bytes({ 0x82, 0x7E, 0xFF, 0xFF }));
+    const std::string large = Frame(WebSocketOpcode::Binary, std::string(65536, 'x'), true, kRfcMaskKey);
+    CHECK_EQ(large.substr(0, 10), Bytes({ 0x82, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00 }));
+    CHECK_EQ(large.size(), 10u + 4u + 65536u);
+}
+
+TEST_CASE(WebSocketAcceptKey)
+{
+    // RFC 6455 section 1.3.
+    CHECK_EQ(ComputeWebSocketAccept("dGhlIHNhbXBsZSBub25jZQ=="), std::string("s3pPLMBiTxaQ9kYGzzhZRbK+xOo="));
+}
+
+TEST_CASE(WebSocketReaderSplitsAndUnmasks)
+{
+    std::string stream = Frame(WebSocketOpcode::Text, "Hel", false, kRfcMaskKey);
+    stream += Frame(WebSocketOpcode::Ping, "ping");
+    stream += Frame(WebSocketOpcode::Continuation, "lo", true, kRfcMaskKey);
+    stream += Frame(WebSocketOpcode::Binary, std::string(70000, 'b'));
+
+    // A byte at a time: every header and payload split is crossed.
+    WebSocketFrameReader reader(1 << 20);
+    std::vector<WebSocketFrame> frames;
+    WebSocketFrame frame;
+    uint16_t code = 0;
+    for (const char byte : stream)
+    {
+        reader.Append(&byte, 1);
+        WebSocketFrameReader::Result result;
+        while ((result = reader.Next(&frame, &code)) == WebSocketFrameReader::Result::Frame)
+            frames.push_back(frame);
+        REQUIRE(result == WebSocketFrameReader::Result::NeedMore);
+    }
+
+    REQUIRE(frames.size() == 4);
+    CHECK(frames[0].opcode == WebSocketOpcode::Text);
+    CHECK(!frames[0].final);
+    CHECK(frames[0].masked);
+    CHECK_EQ(frames[0].payload, std::string("Hel"));
+    CHECK(frames[1].opcode == WebSocketOpcode::Ping);
+    CHECK(!frames[1].masked);
+    CHECK_EQ(frames[1].payload, std::string("ping"));
+    CHECK(frames[2].opcode == WebSocketOpcode::Continuation);
+    CHECK_EQ(frames[2].payload, std::string("lo"));
+    CHECK_EQ(frames[3].payload.size(), 70000u);
+}
+
+TEST_CASE(WebSocketReaderRejectsBadFrames)
+{
+    // Reserved bits, and opcodes 3-7 and B-F.
+    CHECK_EQ(ReadErrorCode(Bytes({ 0xC1, 0x00 })), kWebSocketCloseProtocolError);
+    CHECK_EQ(ReadErrorCode(Bytes({ 0x83, 0x00 })), kWebSocketCloseProtocolError);
+    CHECK_EQ(ReadErrorCode(Bytes({ 0x8B, 0x00 })), kWebSocketCloseProtocolError);
+    // Control frames are never fragmented nor over 125 bytes.
+    CHECK_EQ(ReadErrorCode(Bytes({ 0x09, 0x00 })), kWebSocketCloseProtocolError);
+    CHECK_EQ(ReadErrorCode(Bytes({ 0x88, 0x7E, 0x00, 0x7E })), kWebSocketCloseProtocolError);
+    // The top bit of a 64-bit length.
+    CHECK_EQ(ReadErrorCode(Bytes({ 0x82, 0x7F, 0x80, 0, 0, 0, 0, 0, 0, 0 })), kWebSocketCloseProtocolError);
+    // Past the limit fails on the header, before the payload arrives.
+    CHECK_EQ(ReadErrorCode(Bytes({ 0x81, 0x7E, 0x04, 0x01 })), kWebSocketCloseTooBig);
+    CHECK_EQ(ReadErrorCode(Frame(WebSocketOpcode::Text, std::string(1024, 'x'))), 0);
+}
+
+TEST_CASE(WebSocketCloseCodes)
+{
+    uint16_t code = 0;
+    std::string reason;
+    REQUIRE(TryParseWebSocketClose(BuildWebSocketClosePayload(kWebSocketCloseGoingAway, "restart"), &code, &reason));
+    CHECK_EQ(code, kWebSocketCloseGoingAway);
+    CHECK_EQ(reason, std::string("restart"));
+    REQUIRE(TryParseWebSocketClose("", &code, &reason));
+    CHECK_EQ(code, kWebSocketCloseNoStatus);
+    CHECK(!TryParseWebSocketClose("\x03", &code, &reason));
+
+    for (const uint16_t valid : { 1000, 1001, 1002, 1003, 1007, 1008, 1009, 1010, 1011, 1014, 3000, 4999 })
+        CHECK(IsValidWebSocketCloseCode(valid));
+    for (const uint16_t invalid : { 0, 999, 1004, 1005, 1006, 1015, 1016, 2999, 5000 })
+    {
+        CHECK(!IsValidWebSocketCloseCode(invalid));
+        CHECK(!TryParseWebSocketClose(BuildWebSocketClosePayload(invalid, ""), &code, &reason));
+    }
+
+    // The reason is cut to fit a control frame.
+    CHECK_EQ(BuildWebSocketClosePayload(kWebSocketCloseNormal, std::string(200, 'r')).size(), 125u);
+}
+
+TEST_CASE(WebSocketMessageAssembly)
+{
+    WebSocketMessageAssembler assembler(8);
+    CHECK(assembler.Add(WebSocketOpcode::Text, false, "ab") == WebSocketMessageAssembler::Result::Partial);
+    CHECK(assembler.InProgress());
+    CHECK(assembler.Add(WebSocketOpcode::Continuation, false, "") == WebSocketMessageAssembler::Result::Partial);
+    CHECK(assembler.Add(WebSocketOpcode::Continuation, true, "cd") == WebSocketMessageAssembler::Result::Text);
+    CHECK_EQ(assembler.Message(), std::string("abcd"));
+    CHECK(!assembler.InProgress());
+
+    CHECK(assembler.Add(WebSocketOpcode::Binary, true, "\x01\x02") == WebSocketMessageAssembler::Result::Binary);
+    CHECK_EQ(assembler.Message(), std::string("\x01\x02"));
+
+    // Exactly at the limit, then one past it across fragments.
+    CHECK(assembler.Add(WebSocketOpcode::Text, true, "12345678") == WebSocketMessageAssembler::Result::Text);
+    CHECK(assembler.Add(WebSocketOpcode::Text, false, "12345") == WebSocketMessageAssembler::Result::Partial);
+    CHECK(assembler.Add(WebSocketOpcode::Continuation, true, "6789") == WebSocketMessageAssembler::Result::TooBig);
+    CHECK(!assembler.InProgress());
+
+    // Continuations with nothing started, and a message inside another.
+    CHECK(assembler.Add(WebSocketOpcode::Continuation, true, "x") == WebSocketMessageAssembler::Result::ProtocolError);
+    CHECK(assembler.Add(WebSocketOpcode::Text, false, "a") == WebSocketMessageAssembler::Result::Partial);
+    CHECK(assembler.Add(WebSocketOpcode::Text, true, "b") == WebSocketMessageAssembler::Result::ProtocolError);
+    CHECK(assembler.Add(WebSocketOpcode::Ping, true, "") == WebSocketMessageAssembler::Result::ProtocolError);
+    CHECK(assembler.Add(WebSocketOpcode::Text, true, "ok") == WebSocketMessageAssembler::Result::Text);
+    CHECK_EQ(assembler.Message(), std::string("ok"));
+}
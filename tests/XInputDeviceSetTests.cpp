@@ -0,0 +1,167 @@
+#include "TestHarness.h"
+
+#include "XInputDeviceSet.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+uint32_t ParseOrSentinel(const wchar_t* deviceId)
+{
+    uint32_t vidPid = 0xDEADBEEF;
+    if (!TryGetXInputVidPid(deviceId, &vidPid))
+        return 0xDEADBEEF;
+    return vidPid;
+}
+}
+
+TEST_CASE(VidPidFromXInputDeviceId)
+{
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_045E&PID_028E&IG_00\\7&1a2b&0&0000"), MakeVidPid(0x045E, 0x028E));
+    // Hex digits of either case.
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_045e&PID_02fF&IG_01"), MakeVidPid(0x045E, 0x02FF));
+}
+
+TEST_CASE(VidPidRequiresIgMarker)
+{
+    uint32_t vidPid = 0;
+    CHECK(!TryGetXInputVidPid(L"HID\\VID_046D&PID_C21D\\6&2c4f", &vidPid));
+    CHECK(!TryGetXInputVidPid(L"", &vidPid));
+    CHECK(!TryGetXInputVidPid(nullptr, &vidPid));
+    // The tags are matched as PnP writes them.
+    CHECK(!TryGetXInputVidPid(L"HID\\VID_045E&PID_028E&ig_00", &vidPid));
+}
+
+TEST_CASE(VidPidShortFields)
+{
+    // One to four digits, as swscanf's "%4X" read them.
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_45E&PID_2&IG_00"), MakeVidPid(0x045E, 0x0002));
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_0&PID_028E&IG_00"), MakeVidPid(0x0000, 0x028E));
+    // A fifth digit is not part of the field.
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_045E1&PID_028E&IG_00"), MakeVidPid(0x045E, 0x028E));
+    // A field at the very end of the ID.
+    CHECK_EQ(ParseOrSentinel(L"IG_00&VID_045E&PID_2"), MakeVidPid(0x045E, 0x0002));
+}
+
+TEST_CASE(VidPidMissingSeparators)
+{
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_045EPID_028EIG_00"), MakeVidPid(0x045E, 0x028E));
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_045E&IG_00"), MakeVidPid(0x045E, 0x0000));
+    CHECK_EQ(ParseOrSentinel(L"HID\\PID_028E&IG_00"), MakeVidPid(0x0000, 0x028E));
+}
+
+TEST_CASE(VidPidGarbageFields)
+{
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_XYZW&PID_&IG_00"), 0u);
+    CHECK_EQ(ParseOrSentinel(L"HID\\VID_&PID_G12&IG_00"), 0u);
+    CHECK_EQ(ParseOrSentinel(L"IG_"), 0u);
+    uint32_t vidPid = 0;
+    CHECK(TryGetXInputVidPid(L"IG_00", nullptr));
+    CHECK(TryGetXInputVidPid(L"VID_-1&PID_ 12&IG_00", &vidPid));
+    CHECK_EQ(vidPid, 0u);
+}
+
+TEST_CASE(VidPidListRoundTrip)
+{
+    XInputDeviceSet devices;
+    devices.Insert(MakeVidPid(0x045E, 0x028E));
+    devices.Insert(MakeVidPid(0x046D, 0xC21D));
+    devices.Insert(0);
+    const std::wstring text = FormatVidPidList(devices);
+    CHECK_EQ(text, std::wstring(L"00000000,028E045E,C21D046D"));
+
+    XInputDeviceSet parsed;
+    REQUIRE(TryParseVidPidList(text, &parsed));
+    CHECK_EQ(parsed.ToSortedVector(), devices.ToSortedVector());
+
+    REQUIRE(TryParseVidPidList(L"", &parsed));
+    CHECK_EQ(parsed.Size(), 0u);
+    REQUIRE(TryParseVidPidList(L"028e045e", &parsed));
+    CHECK(parsed.Contains(MakeVidPid(0x045E, 0x028E)));
+}
+
+TEST_CASE(VidPidListRejectsMalformed)
+{
+    XInputDeviceSet parsed;
+    CHECK(!TryParseVidPidList(L"028E045", &parsed));
+    CHECK(!TryParseVidPidList(L"028E045E,", &parsed));
+    CHECK(!TryParseVidPidList(L"028E045E;C21D046D", &parsed));
+    CHECK(!TryParseVidPidList(L"028E045G", &parsed));
+    CHECK(!TryParseVidPidList(L",028E045E", &parsed));
+    CHECK(!TryParseVidPidList(L"028E045E", nullptr));
+    // A failed parse keeps the entries before the error; callers rescan.
+    CHECK(!TryParseVidPidList(L"028E045E,XX", &parsed));
+    CHECK_EQ(parsed.Size(), 1u);
+}
+
+TEST_CASE(DeviceSetInsertAndLookup)
+{
+    XInputDeviceSet devices;
+    CHECK(!devices.Contains(MakeVidPid(0x045E, 0x028E)));
+    CHECK(!devices.Contains(0));
+
+    devices.Insert(MakeVidPid(0x045E, 0x028E));
+    devices.Insert(MakeVidPid(0x045E, 0x028E));
+    CHECK_EQ(devices.Size(), 1u);
+    CHECK(devices.Contains(MakeVidPid(0x045E, 0x028E)));
+    CHECK(!devices.Contains(MakeVidPid(0x028E, 0x045E)));
+
+    // Zero is a valid key, kept beside the table.
+    devices.Insert(0);
+    CHECK(devices.Contains(0));
+    CHECK_EQ(devices.Size(), 2u);
+
+    devices.Clear();
+    CHECK_EQ(devices.Size(), 0u);
+    CHECK(!devices.Contains(0));
+    CHECK(!devices.Contains(MakeVidPid(0x045E, 0x028E)));
+}
+
+TEST_CASE(DeviceSetCollisions)
+{
+    // Keys whose Fibonacci hashes share low bits land in one probe run;
+    // multiples of 2^28 differ only in the bits the mask drops.
+    XInputDeviceSet devices;
+    std::vector<uint32_t> keys;
+    for (uint32_t i = 1; i <= 7; ++i)
+        keys.push_back(i << 28);
+    for (const uint32_t key : keys)
+        devices.Insert(key);
+
+    CHECK_EQ(devices.Size(), keys.size());
+    for (const uint32_t key : keys)
+        CHECK(devices.Contains(key));
+    CHECK(!devices.Contains(8u << 28));
+    CHECK(!devices.Contains(1u << 27));
+}
+
+TEST_CASE(DeviceSetGrows)
+{
+    XInputDeviceSet devices;
+    std::vector<uint32_t> keys;
+    for (uint32_t i = 0; i < 1000; ++i)
+        keys.push_back(MakeVidPid(static_cast<uint16_t>(0x045E + i), static_cast<uint16_t>(0x0200 + i * 7)));
+    for (const uint32_t key : keys)
+        devices.Insert(key);
+
+    CHECK_EQ(devices.Size(), keys.size());
+    for (const uint32_t key : keys)
+        CHECK(devices.Contains(key));
+    CHECK(!devices.Contains(MakeVidPid(0xFFFF, 0xFFFF)));
+
+    std::vector<uint32_t> sorted = devices.ToSortedVector();
+    CHECK_EQ(sorted.size(), keys.size());
+    CHECK(std::is_sorted(sorted.begin(), sorted.end()));
+}
+
+TEST_CASE(DeviceFingerprintIgnoresOrder)
+{
+    const std::wstring a = ComputeDeviceFingerprint({ L"\\\\?\\hid#vid_045e", L"\\\\?\\hid#vid_046d" });
+    const std::wstring b = ComputeDeviceFingerprint({ L"\\\\?\\hid#vid_046d", L"\\\\?\\hid#vid_045e" });
+    CHECK_EQ(a, b);
+    CHECK(a != ComputeDeviceFingerprint({ L"\\\\?\\hid#vid_045e" }));
+    // The separator keeps ("ab", "c") apart from ("a", "bc").
+    CHECK(ComputeDeviceFingerprint({ L"ab", L"c" }) != ComputeDeviceFingerprint({ L"a", L"bc" }));
+}
@@ -0,0 +1,106 @@
+#include "TestHarness.h"
+#include "TempDirectory.h"
+
+#include "XInputDeviceSet.h"
+#include "XInputFilter.h"
+
+#include <string>
+
+namespace {
+// Lays out a USB device and one of its interfaces as sysfs shows them.
+void AddUsbInterface(const TempDirectory& sysfs, const std::string& device, const char* vid, const char* pid,
+    const char* interfaceClass, const char* subClass, const char* protocol)
+{
+    const std::string devicePath = "bus/usb/devices/" + device;
+    const std::string interfacePath = devicePath + ":1.0";
+    REQUIRE(sysfs.MakeDirectories(devicePath));
+    REQUIRE(sysfs.MakeDirectories(interfacePath));
+    REQUIRE(sysfs.WriteFile(devicePath + "/idVendor", std::string(vid) + "\n"));
+    REQUIRE(sysfs.WriteFile(devicePath + "/idProduct", std::string(pid) + "\n"));
+    REQUIRE(sysfs.WriteFile(interfacePath + "/bInterfaceClass", std::string(interfaceClass) + "\n"));
+    REQUIRE(sysfs.WriteFile(interfacePath + "/bInterfaceSubClass", std::string(subClass) + "\n"));
+    REQUIRE(sysfs.WriteFile(interfacePath + "/bInterfaceProtocol", std::string(protocol) + "\n"));
+}
+
+// An input class device whose driver link names |driver|.
+void AddInputDevice(const TempDirectory& sysfs, const std::string& name, const char* vid, const char* pid,
+    const char* driver)
+{
+    const std::string inputPath = "class/input/" + name;
+    REQUIRE(sysfs.MakeDirectories(inputPath + "/id"));
+    REQUIRE(sysfs.MakeDirectories(inputPath + "/device"));
+    REQUIRE(sysfs.WriteFile(inputPath + "/id/vendor", std::string(vid) + "\n"));
+    REQUIRE(sysfs.WriteFile(inputPath + "/id/product", std::string(pid) + "\n"));
+    REQUIRE(sysfs.MakeSymlink(std::string("../../../../bus/hid/drivers/") + driver, inputPath + "/device/driver"));
+}
+}
+
+TEST_CASE(XInputFilterMissingSysfs)
+{
+    TempDirectory sysfs;
+    REQUIRE(sysfs.IsValid());
+    CHECK(!SetupForIsXInputDevice(sysfs.Path().c_str()));
+    CHECK(!IsXInputVidPid(MakeVidPid(0x045E, 0x028E)));
+}
+
+TEST_CASE(XInputFilterUsbInterfaces)
+{
+    TempDirectory sysfs;
+    REQUIRE(sysfs.IsValid());
+    // Wired 360, wireless 360 receiver, and Xbox One pads.
+    AddUsbInterface(sysfs, "1-1", "045e", "028e", "ff", "5d", "01");
+    AddUsbInterface(sysfs, "1-2", "045e", "0719", "ff", "5d", "81");
+    AddUsbInterface(sysfs, "1-3", "045e", "02ea", "ff", "47", "d0");
+    // A HID joystick, and a vendor interface with another protocol.
+    AddUsbInterface(sysfs, "1-4", "046d", "c21d", "03", "00", "00");
+    AddUsbInterface(sysfs, "1-5", "1234", "5678", "ff", "5d", "02");
+    // An XInput interface whose device has no readable IDs.
+    REQUIRE(sysfs.MakeDirectories("bus/usb/devices/2-1:1.0"));
+    REQUIRE(sysfs.WriteFile("bus/usb/devices/2-1:1.0/bInterfaceClass", "ff\n"));
+    REQUIRE(sysfs.WriteFile("bus/usb/devices/2-1:1.0/bInterfaceSubClass", "5d\n"));
+    REQUIRE(sysfs.WriteFile("bus/usb/devices/2-1:1.0/bInterfaceProtocol", "01\n"));
+
+    REQUIRE(SetupForIsXInputDevice(sysfs.Path().c_str()));
+    CHECK(IsXInputVidPid(MakeVidPid(0x045E, 0x028E)));
+    CHECK(IsXInputVidPid(MakeVidPid(0x045E, 0x0719)));
+    CHECK(IsXInputVidPid(MakeVidPid(0x045E, 0x02EA)));
+    CHECK(!IsXInputVidPid(MakeVidPid(0x046D, 0xC21D)));
+    CHECK(!IsXInputVidPid(MakeVidPid(0x1234, 0x5678)));
+    CHECK(!IsXInputVidPid(0));
+
+    CleanupForIsXInputDevice();
+    CHECK(!IsXInputVidPid(MakeVidPid(0x045E, 0x028E)));
+}
+
+TEST_CASE(XInputFilterXpadInputDevices)
+{
+    TempDirectory sysfs;
+    REQUIRE(sysfs.IsValid());
+    // No USB tree: a Bluetooth pad bound to xpad still counts.
+    AddInputDevice(sysfs, "input7", "045e", "0b13", "xpad");
+    AddInputDevice(sysfs, "input8", "046d", "c21d", "hid-generic");
+    // Only inputN entries are devices; eventN and jsN are their nodes.
+    AddInputDevice(sysfs, "event3", "1111", "2222", "xpad");
+    REQUIRE(sysfs.MakeDirectories("class/input/input9"));
+
+    REQUIRE(SetupForIsXInputDevice(sysfs.Path().c_str()));
+    CHECK(IsXInputVidPid(MakeVidPid(0x045E, 0x0B13)));
+    CHECK(!IsXInputVidPid(MakeVidPid(0x046D, 0xC21D)));
+    CHECK(!IsXInputVidPid(MakeVidPid(0x1111, 0x2222)));
+}
+
+TEST_CASE(XInputFilterRescanReplacesDevices)
+{
+    TempDirectory first;
+    TempDirectory second;
+    REQUIRE(first.IsValid() && second.IsValid());
+    AddUsbInterface(first, "1-1", "045e", "028e", "ff", "5d", "01");
+    AddInputDevice(second, "input1", "045e", "0b13", "xpad");
+
+    REQUIRE(SetupForIsXInputDevice(first.Path().c_str()));
+    CHECK(IsXInputVidPid(MakeVidPid(0x045E, 0x028E)));
+    REQUIRE(SetupForIsXInputDevice(second.Path().c_str()));
+    CHECK(!IsXInputVidPid(MakeVidPid(0x045E, 0x028E)));
+    CHECK(IsXInputVidPid(MakeVidPid(0x045E, 0x0B13)));
+    CleanupForIsXInputDevice();
+}
@@ -0,0 +1,41 @@
+// Prints a flight recorder dump (see FlightRecorder.h) oldest record first.
+//
+//   flight_decode DUMP
+//
+// Each line gives the time before the dump, the UTC wall time, the
+// recording thread, and the event.
+
+#include "FlightDumpReader.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s DUMP\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file)
+    {
+        fprintf(stderr, "%s: cannot open\n", argv[1]);
+        return 1;
+    }
+
+    const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    FlightDump dump;
+    std::string error;
+    if (!ParseFlightDump(bytes, &dump, &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+
+    fputs(FormatFlightDump(dump).c_str(), stdout);
+    return 0;
+}